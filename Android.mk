@@ -21,6 +21,32 @@ LOCAL_STATIC_LIBRARIES += libgpuperfcnt
 
 LOCAL_SRC_FILES := \
   gputop/debugfs.c \
+  gputop/database.c \
+  gputop/parse.c \
+  gputop/arena.c \
+  gputop/clients.c \
+  gputop/workers.c \
+  gputop/procwatch.c \
+  gputop/shm.c \
+  gputop/snapshot.c \
+  gputop/daemon.c \
+  gputop/sockpath.c \
+  gputop/history.c \
+  gputop/ftrace.c \
+  gputop/markers.c \
+  gputop/alerts.c \
+  gputop/record.c \
+  gputop/report.c \
+  gputop/trace.c \
+  gputop/query.c \
+  gputop/compare.c \
+  gputop/gate.c \
+  gputop/phases.c \
+  gputop/correlate.c \
+  gputop/classify.c \
+  gputop/baseline.c \
+  gputop/json.c \
+  gputop/tools.c \
   gputop/top.c
 
 LOCAL_VENDOR_MODULE  := true
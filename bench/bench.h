@@ -0,0 +1,105 @@
+/*
+ * Copyright NXP 2017
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sub license,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#ifndef __GPUTOP_BENCH_H
+#define __GPUTOP_BENCH_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <time.h>
+
+/**
+ * bench_now:
+ *
+ * Monotonic time, in milliseconds.
+ */
+static inline double
+bench_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+/**
+ * bench_load:
+ *
+ * The whole of path in memory, with room for one more byte, its size in
+ * len. NULL with errno set if it can't be read, ENOENT if there's no such
+ * file.
+ */
+char *
+bench_load(const char *path, size_t *len);
+
+/**
+ * bench_name:
+ *
+ * Last component of the corpus directory dir, to name it in reports; it
+ * may end with slashes.
+ */
+const char *
+bench_name(const char *dir);
+
+/**
+ * bench_fixture:
+ *
+ * What a synthetic board looks like: procs processes, with contexts
+ * contexts between them, or 1 to 8 each if contexts is 0. Processes
+ * i % 100 == refresh % 100 have changed their allocations since refresh
+ * - 1; refresh 0 is the corpus as written to disk.
+ */
+struct bench_fixture {
+	uint32_t procs;
+	uint32_t contexts;
+	uint32_t refresh;
+};
+
+/**
+ * bench_fixture_contexts:
+ *
+ * Number of contexts of process i of fixture; its pid is 1000 + i.
+ */
+uint32_t
+bench_fixture_contexts(const struct bench_fixture *fixture, uint32_t i);
+
+/**
+ * bench_fixture_write:
+ *
+ * Write the file name (clients, database, vidmem, clk or gpu_govern) of
+ * fixture to file. Returns -1 if there's no such file.
+ */
+int
+bench_fixture_write(FILE *file, const char *name,
+		    const struct bench_fixture *fixture);
+
+/**
+ * bench_fixtures_write:
+ *
+ * Write the corpus of procs processes in dir/procs, or of 1 to 5000
+ * processes if procs is 0. Returns -1 on error, which is printed.
+ */
+int
+bench_fixtures_write(const char *dir, uint32_t procs);
+
+#endif /* __GPUTOP_BENCH_H */
@@ -0,0 +1,189 @@
+/*
+ * Copyright NXP 2017
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sub license,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+/*
+ * Refreshes the clients of a synthetic board with many processes and
+ * contexts, as fixtures.c writes it, the way the clients page does: parse
+ * clients and the database, then update the client registry. Checks every
+ * client ends up with its contexts, and that each context maps back to its
+ * client. A few processes change between refreshes; the rest shouldn't
+ * cost more than looking them up, however many contexts they have.
+ *
+ * gputop-bench-clients [processes] [contexts] [refreshes]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "database.h"
+#include "parse.h"
+#include "arena.h"
+#include "clients.h"
+
+#include "bench.h"
+
+/*
+ * file name of fixture in memory, in data, with room for the byte the
+ * tokenizers write past the end
+ */
+static int
+bench_write(const char *name, const struct bench_fixture *fixture,
+	    char **data, size_t *len)
+{
+	FILE *file;
+
+	free(*data);
+	*data = NULL;
+
+	file = open_memstream(data, len);
+	if (!file)
+		return -1;
+
+	bench_fixture_write(file, name, fixture);
+	return fclose(file) == 0 ? 0 : -1;
+}
+
+static bool
+bench_check(struct gtop_clients *clients, struct debugfs_database *db,
+	    const struct bench_fixture *fixture)
+{
+	if (clients->nr != fixture->procs) {
+		fprintf(stderr, "%u clients, not %u\n", clients->nr, fixture->procs);
+		return false;
+	}
+
+	for (uint32_t i = 0; i < fixture->procs; i++) {
+		struct gtop_client *client = gtop_clients_find(clients, 1000 + i);
+		uint32_t nr = bench_fixture_contexts(fixture, i);
+
+		if (!client || client->ctx_no != nr) {
+			fprintf(stderr, "pid %u: wrong contexts\n", 1000 + i);
+			return false;
+		}
+
+		for (uint32_t c = 0; c < nr; c++) {
+			uint32_t pid = 0;
+
+			if (!debugfs_database_find_ctx(db, client->ctx[c], &pid) ||
+			    pid != 1000 + i) {
+				fprintf(stderr, "pid %u: wrong context %u\n",
+					1000 + i, client->ctx[c]);
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+static int
+bench_run(uint32_t procs, uint32_t contexts, uint32_t refreshes)
+{
+	struct bench_fixture fixture = { .procs = procs, .contexts = contexts };
+	char *clients_data = NULL, *database_data = NULL;
+	size_t clients_len = 0, database_len = 0;
+	struct gtop_clients clients = {};
+	struct debugfs_database db = {};
+	struct gtop_arena arena = {};
+	double parse = 0, update = 0;
+	int ret = -1;
+
+	/* refresh 0 has everyone arrive, it isn't timed */
+	for (uint32_t refresh = 0; refresh <= refreshes; refresh++) {
+		struct debugfs_client list = {};
+		struct gtop_lines lines;
+		double start, parsed;
+
+		fixture.refresh = refresh;
+		if (bench_write("clients", &fixture, &clients_data, &clients_len) < 0 ||
+		    bench_write("database", &fixture, &database_data, &database_len) < 0)
+			goto out;
+		start = bench_now();
+
+		gtop_arena_reset(&arena);
+		gtop_lines_init_buf(&lines, clients_data, clients_len);
+		debugfs_parse_clients(&list, &lines, &arena);
+
+		gtop_lines_init_buf(&lines, database_data, database_len);
+		if (debugfs_database_parse(&db, &lines) < 0)
+			goto out;
+
+		parsed = bench_now();
+		if (gtop_clients_update(&clients, list.head, &db, NULL, 0) < 0)
+			goto out;
+
+		if (refresh) {
+			parse += parsed - start;
+			update += bench_now() - parsed;
+		}
+	}
+
+	if (!bench_check(&clients, &db, &fixture))
+		goto out;
+
+	fprintf(stdout, "%8u %10u %12.3f %12.3f\n", procs, contexts,
+		parse / refreshes, update / refreshes);
+	ret = 0;
+
+out:
+	gtop_clients_fini(&clients);
+	debugfs_database_free(&db);
+	gtop_arena_fini(&arena);
+	free(clients_data);
+	free(database_data);
+	return ret;
+}
+
+int
+main(int argc, char *argv[])
+{
+	uint32_t procs = 5000, contexts = 50000, refreshes = 20;
+
+	if (argc > 1)
+		procs = strtoul(argv[1], NULL, 10);
+	if (argc > 2)
+		contexts = strtoul(argv[2], NULL, 10);
+	if (argc > 3)
+		refreshes = strtoul(argv[3], NULL, 10);
+
+	if (!procs || contexts < procs || !refreshes) {
+		fprintf(stderr, "Usage: %s [processes] [contexts] [refreshes]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	fprintf(stdout, "per refresh:\n%8s %10s %12s %12s\n",
+		"procs", "contexts", "parse(ms)", "update(ms)");
+
+	/* the same processes, with ten times the contexts each step */
+	for (uint32_t c = contexts / 100; c <= contexts; c *= 10) {
+		if (c < procs)
+			continue;
+		if (bench_run(procs, c, refreshes) < 0) {
+			fprintf(stderr, "%u processes, %u contexts: failed\n", procs, c);
+			return EXIT_FAILURE;
+		}
+	}
+
+	return EXIT_SUCCESS;
+}
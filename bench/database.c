@@ -0,0 +1,200 @@
+/*
+ * Copyright NXP 2017
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sub license,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+/*
+ * Times context look-ups on the database of a corpus: re-parsing the
+ * database for each client (the way debugfs_get_current_ctx() is used to
+ * validate a context) against parsing it once into a debugfs_database.
+ *
+ * gputop-bench-database [-n iterations] <dir>...
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+#include "database.h"
+#include "parse.h"
+
+#include "bench.h"
+
+struct bench_keys {
+	uint32_t *pids;
+	uint32_t pids_no;
+	uint32_t *ctx;
+	uint32_t ctx_no;
+};
+
+/* each parse gets a fresh copy, as if it had just been read */
+static int
+bench_parse(struct debugfs_database *db, const char *data, size_t len,
+	    char *work)
+{
+	struct gtop_lines lines;
+
+	memcpy(work, data, len);
+	gtop_lines_init_buf(&lines, work, len);
+
+	return debugfs_database_parse(db, &lines);
+}
+
+/*
+ * what clients look up: each pid once, and the contexts of its last
+ * entry, which are the ones that count
+ */
+static int
+bench_lookups(struct bench_keys *keys, struct debugfs_database *db)
+{
+	keys->pids = calloc(db->procs_no + 1, sizeof(*keys->pids));
+	keys->ctx = calloc(db->ctx_no + 1, sizeof(*keys->ctx));
+	if (!keys->pids || !keys->ctx)
+		return -1;
+
+	for (uint32_t i = 0; i < db->procs_no; i++) {
+		const struct debugfs_db_process *proc = &db->procs[i];
+
+		if (debugfs_database_find_pid(db, proc->pid) != proc)
+			continue;
+
+		keys->pids[keys->pids_no++] = proc->pid;
+		memcpy(keys->ctx + keys->ctx_no, debugfs_database_contexts(db, proc),
+		       proc->ctx_no * sizeof(*keys->ctx));
+		keys->ctx_no += proc->ctx_no;
+	}
+
+	return 0;
+}
+
+static int
+bench_run(const char *dir, uint32_t iterations)
+{
+	struct debugfs_database db = {};
+	struct bench_keys keys = {};
+	double start, per_client, indexed;
+	uint64_t found = 0, expected;
+	char path[4096];
+	char *data, *work = NULL;
+	size_t len;
+	int ret = -1;
+
+	snprintf(path, sizeof(path), "%s/database", dir);
+	data = bench_load(path, &len);
+	if (!data) {
+		if (errno == ENOENT)
+			return 0;
+
+		fprintf(stderr, "%s: %s\n", path, strerror(errno));
+		return -1;
+	}
+
+	work = malloc(len + 1);
+	if (!work || bench_parse(&db, data, len, work) < 0 ||
+	    bench_lookups(&keys, &db) < 0) {
+		fprintf(stderr, "%s: %s\n", path, strerror(errno));
+		goto out;
+	}
+
+	/* one parse per client */
+	start = bench_now();
+	for (uint32_t it = 0; it < iterations; it++) {
+		for (uint32_t i = 0; i < keys.pids_no; i++) {
+			if (bench_parse(&db, data, len, work) < 0)
+				goto out;
+			found += debugfs_database_find_pid(&db, keys.pids[i]) != NULL;
+		}
+	}
+	per_client = (bench_now() - start) / iterations;
+
+	/* one parse, then look-ups both ways */
+	start = bench_now();
+	for (uint32_t it = 0; it < iterations; it++) {
+		uint32_t pid;
+
+		if (bench_parse(&db, data, len, work) < 0)
+			goto out;
+
+		for (uint32_t i = 0; i < keys.pids_no; i++)
+			found += debugfs_database_find_pid(&db, keys.pids[i]) != NULL;
+		for (uint32_t c = 0; c < keys.ctx_no; c++)
+			found += debugfs_database_find_ctx(&db, keys.ctx[c], &pid);
+	}
+	indexed = (bench_now() - start) / iterations;
+
+	expected = (uint64_t) iterations * (2 * keys.pids_no + keys.ctx_no);
+	if (found != expected) {
+		fprintf(stderr, "%s: look-ups failed: %llu out of %llu\n", path,
+			(unsigned long long) found, (unsigned long long) expected);
+		goto out;
+	}
+
+	fprintf(stdout, "%-10.*s %8u %10u %12.3f %12.3f %10.1fx\n",
+		(int) strcspn(bench_name(dir), "/"), bench_name(dir),
+		keys.pids_no, keys.ctx_no, per_client, indexed,
+		indexed > 0 ? per_client / indexed : 0);
+	ret = 0;
+
+out:
+	debugfs_database_free(&db);
+	free(keys.pids);
+	free(keys.ctx);
+	free(work);
+	free(data);
+	return ret;
+}
+
+int
+main(int argc, char *argv[])
+{
+	uint32_t iterations = 20;
+	int ret = EXIT_SUCCESS;
+	bool usage = false;
+	int c;
+
+	while ((c = getopt(argc, argv, "n:")) != -1) {
+		switch (c) {
+		case 'n':
+			iterations = strtoul(optarg, NULL, 10);
+			break;
+		default:
+			usage = true;
+			break;
+		}
+	}
+
+	if (usage || optind >= argc || !iterations) {
+		fprintf(stderr, "Usage: %s [-n iterations] <dir>...\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	fprintf(stdout, "%-10s %8s %10s %12s %12s %11s\n", "corpus", "procs",
+		"contexts", "client(ms)", "indexed(ms)", "speed-up");
+
+	for (int i = optind; i < argc; i++) {
+		if (bench_run(argv[i], iterations) < 0)
+			ret = EXIT_FAILURE;
+	}
+
+	return ret;
+}
@@ -0,0 +1,282 @@
+/*
+ * Copyright NXP 2017
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sub license,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+/*
+ * The benchmark corpus: directories with any of clients, database, vidmem,
+ * clk and gpu_govern in them, as galcore lays them out. The synthetic
+ * part of it is written from here, one directory per number of processes;
+ * the benchmarks that need a board refreshing write it in memory the same
+ * way.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include "bench.h"
+#include "util.h"
+
+static const uint32_t fixtures_sizes[] = { 1, 10, 100, 1000, 5000 };
+
+/* vidmem types galcore reports, and a few it may add */
+static const char *fixtures_types[] = {
+	"Index", "Vertex", "Texture", "RenderTarget", "Depth", "Bitmap",
+	"TileStatus", "Image", "Mask", "Scissor", "HZ", "ICache", "TxDesc",
+	"Fence", "TFBHeader", "Sync", "Compute",
+};
+
+uint32_t
+bench_fixture_contexts(const struct bench_fixture *fixture, uint32_t i)
+{
+	uint32_t procs = fixture->procs;
+	uint32_t avg, nr;
+
+	if (!fixture->contexts)
+		return 1 + i % 8;
+
+	/* uneven, some have a lot; the last one takes what's left */
+	avg = fixture->contexts / procs;
+	nr = i % 2 ? avg / 2 : avg + avg / 2;
+	if (i == procs - 1)
+		nr = fixture->contexts - (procs - 1) / 2 * (avg / 2) -
+			(procs - 1 - (procs - 1) / 2) * (avg + avg / 2);
+	return nr;
+}
+
+static void
+fixtures_clients(FILE *file, const struct bench_fixture *fixture)
+{
+	fprintf(file, "PID           NAME\n------------------------\n");
+
+	for (uint32_t i = 0; i < fixture->procs; i++)
+		fprintf(file, "%-13u app-%u\n", 1000 + i, i);
+}
+
+/*
+ * a few records per process, then its contexts; every 50th process
+ * shows up twice, as processes re-using a pid do
+ */
+static void
+fixtures_database(FILE *file, const struct bench_fixture *fixture)
+{
+	uint32_t procs = fixture->procs;
+	uint32_t ctx = 1;
+
+	fprintf(file, "VidMem Usage (Process 0):\n  Current allocation:   %u B\n\n",
+		procs * 4096);
+
+	for (uint32_t i = 0; i < procs; i++) {
+		uint32_t contexts = bench_fixture_contexts(fixture, i);
+		uint32_t age = i % 100 == fixture->refresh % 100 ? fixture->refresh : 0;
+
+		if (i % 50 == 49)
+			fprintf(file, "Process: %-6u  app-%u\nContext 0 %x\n\n",
+				1000 + i, i, ctx++);
+
+		fprintf(file, "Process: %-6u  app-%u\n", 1000 + i, i);
+		fprintf(file, "VidMem Usage:\n  Current allocation:   %u B\n"
+			"  Maximum allocation:   %u B\n  Total allocation:     %u B\n",
+			(i + age) * 4096, (i + age) * 8192, (i + age) * 16384);
+		fprintf(file, "Record:\n  Index       0x%08x\n  Vertex      0x%08x\n"
+			"  Texture     0x%08x\n", i * 3, i * 7, i * 11);
+
+		for (uint32_t c = 0; c < contexts; c++)
+			fprintf(file, "Context     %u  %x\n", c & 1, ctx++);
+
+		fprintf(file, "Counters:\n  Signal      %u\n\n", i);
+	}
+}
+
+/*
+ * the answer for one process, the vidmem batch reads one per process
+ */
+static void
+fixtures_vid_mem(FILE *file, const struct bench_fixture *fixture)
+{
+	uint32_t procs = fixture->procs;
+	uint32_t total = 0;
+
+	for (uint32_t i = 0; i < ARRAY_SIZE(fixtures_types); i++)
+		total += (i + 1) * procs;
+
+	fprintf(file, "All-Types    %u\n", total);
+	for (uint32_t i = 0; i < ARRAY_SIZE(fixtures_types); i++)
+		fprintf(file, "%-12s %u\n", fixtures_types[i], (i + 1) * procs);
+}
+
+static void
+fixtures_clk(FILE *file, const struct bench_fixture *fixture)
+{
+	(void) fixture;
+
+	fprintf(file, "gpu0 mc clock: 800000000 HZ.\ngpu0 sh clock: 1000000000 HZ.\n"
+		"gpu1 mc clock: 800000000 HZ.\ngpu1 sh clock: 1000000000 HZ.\n");
+}
+
+static void
+fixtures_govern(FILE *file, const struct bench_fixture *fixture)
+{
+	(void) fixture;
+
+	fprintf(file, "GPU support 3 modes\n"
+		"overdrive:      core_clk frequency: 800000000   shader_clk frequency: 1000000000\n"
+		"nominal:        core_clk frequency: 600000000   shader_clk frequency: 800000000\n"
+		"underdrive:     core_clk frequency: 200000000   shader_clk frequency: 200000000\n"
+		"Currently GPU runs on mode nominal\n");
+}
+
+static const struct {
+	const char *name;
+	void (*write)(FILE *file, const struct bench_fixture *fixture);
+} fixtures_files[] = {
+	{ "clients",	fixtures_clients },
+	{ "database",	fixtures_database },
+	{ "vidmem",	fixtures_vid_mem },
+	{ "clk",	fixtures_clk },
+	{ "gpu_govern",	fixtures_govern },
+};
+
+int
+bench_fixture_write(FILE *file, const char *name,
+		    const struct bench_fixture *fixture)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(fixtures_files); i++) {
+		if (!strcmp(fixtures_files[i].name, name)) {
+			fixtures_files[i].write(file, fixture);
+			return 0;
+		}
+	}
+
+	return -1;
+}
+
+static int
+fixtures_mkdir(const char *path)
+{
+	if (mkdir(path, 0755) < 0 && errno != EEXIST) {
+		fprintf(stderr, "mkdir %s: %s\n", path, strerror(errno));
+		return -1;
+	}
+
+	return 0;
+}
+
+static int
+fixtures_write(const char *dir, uint32_t procs)
+{
+	struct bench_fixture fixture = { .procs = procs };
+	char path[4096];
+
+	snprintf(path, sizeof(path), "%s/%u", dir, procs);
+	if (fixtures_mkdir(path) < 0)
+		return -1;
+
+	for (size_t i = 0; i < ARRAY_SIZE(fixtures_files); i++) {
+		FILE *file;
+
+		snprintf(path, sizeof(path), "%s/%u/%s", dir, procs, fixtures_files[i].name);
+		file = fopen(path, "w");
+		if (!file) {
+			fprintf(stderr, "%s: %s\n", path, strerror(errno));
+			return -1;
+		}
+
+		fixtures_files[i].write(file, &fixture);
+
+		if (fclose(file) != 0) {
+			fprintf(stderr, "%s: %s\n", path, strerror(errno));
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+int
+bench_fixtures_write(const char *dir, uint32_t procs)
+{
+	if (fixtures_mkdir(dir) < 0)
+		return -1;
+
+	if (procs)
+		return fixtures_write(dir, procs);
+
+	for (size_t i = 0; i < ARRAY_SIZE(fixtures_sizes); i++) {
+		if (fixtures_write(dir, fixtures_sizes[i]) < 0)
+			return -1;
+	}
+
+	return 0;
+}
+
+char *
+bench_load(const char *path, size_t *len)
+{
+	FILE *file = fopen(path, "r");
+	char *data = NULL;
+	size_t size = 0;
+
+	*len = 0;
+	if (!file)
+		return NULL;
+
+	for (;;) {
+		size_t nr;
+
+		if (*len + 1 >= size) {
+			char *buf;
+
+			size = size ? size * 2 : 4096;
+			buf = realloc(data, size);
+			if (!buf) {
+				free(data);
+				fclose(file);
+				return NULL;
+			}
+			data = buf;
+		}
+
+		nr = fread(data + *len, 1, size - *len - 1, file);
+		if (!nr)
+			break;
+		*len += nr;
+	}
+
+	fclose(file);
+	return data;
+}
+
+const char *
+bench_name(const char *dir)
+{
+	size_t len = strlen(dir);
+
+	while (len > 1 && dir[len - 1] == '/')
+		len--;
+	while (len > 0 && dir[len - 1] != '/')
+		len--;
+
+	return dir + len;
+}
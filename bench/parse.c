@@ -0,0 +1,380 @@
+/*
+ * Copyright NXP 2017
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sub license,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+/*
+ * Per-refresh parse cost of the debugfs/sysfs files: the fgets() + sscanf()
+ * parsers with their scratch allocations, the way debugfs.c used to parse
+ * them, against the whole file split by the tokenizers of parse.c, the
+ * way debugfs.c reads them now. Both parse the corpus gputop-bench-suite
+ * times and must agree.
+ *
+ * gputop-bench-parse [-t msecs] <dir>...
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <unistd.h>
+
+#include "parse.h"
+
+#include "bench.h"
+
+static int
+legacy_clients(struct debugfs_client *clients, FILE *file)
+{
+	char buf[1024];
+	int i = 0;
+
+	while ((fgets(buf, 1024, file)) != NULL) {
+		struct debugfs_client *client;
+
+		if (*buf == 'P' || *buf == '-')
+			continue;
+
+		client = calloc(1, sizeof(*client));
+		client->name = calloc(512, sizeof(char));
+		if (sscanf(buf, "%d  %[a-zA-Z0-9-]s\n", &client->pid, client->name) != 2) {
+			free(client->name);
+			free(client);
+			continue;
+		}
+
+		client->next = clients->head;
+		clients->head = client;
+		i++;
+	}
+
+	return i;
+}
+
+static int
+legacy_vid_mem(struct debugfs_vid_mem_client *client, FILE *file)
+{
+	static const struct {
+		const char *name;
+		size_t offset;
+	} fields[] = {
+		{ "Index", offsetof(struct debugfs_vid_mem_client, index) },
+		{ "Vertex", offsetof(struct debugfs_vid_mem_client, vertex) },
+		{ "Texture", offsetof(struct debugfs_vid_mem_client, texture) },
+		{ "RenderTarget", offsetof(struct debugfs_vid_mem_client, render_target) },
+		{ "Depth", offsetof(struct debugfs_vid_mem_client, depth) },
+		{ "Bitmap", offsetof(struct debugfs_vid_mem_client, bitmap) },
+		{ "TileStatus", offsetof(struct debugfs_vid_mem_client, tile_status) },
+		{ "Image", offsetof(struct debugfs_vid_mem_client, image) },
+		{ "Mask", offsetof(struct debugfs_vid_mem_client, mask) },
+		{ "Scissor", offsetof(struct debugfs_vid_mem_client, scissor) },
+		{ "HZ", offsetof(struct debugfs_vid_mem_client, hz) },
+		{ "ICache", offsetof(struct debugfs_vid_mem_client, i_cache) },
+		{ "TxDesc", offsetof(struct debugfs_vid_mem_client, tx_desc) },
+		{ "Fence", offsetof(struct debugfs_vid_mem_client, fence) },
+		{ "TFBHeader", offsetof(struct debugfs_vid_mem_client, tfbheader) },
+	};
+	char buf[1024];
+
+	while ((fgets(buf, 1024, file)) != NULL) {
+		if (!strncmp(buf, "All-Types", strlen("All-Types")))
+			continue;
+
+		char *name = calloc(512, sizeof(char));
+
+		/* one strncmp() and sscanf() per field, as it was */
+		for (size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); i++) {
+			if (!strncmp(buf, fields[i].name, strlen(fields[i].name)))
+				sscanf(buf, "%[a-zA-Z0-9-] %u", name,
+				       (uint32_t *) ((char *) client + fields[i].offset));
+		}
+
+		free(name);
+	}
+
+	return 0;
+}
+
+static int
+legacy_gpu_clocks(struct debugfs_clock *clocks, FILE *file)
+{
+	char buf[1024];
+
+	while ((fgets(buf, 1024, file)) != NULL) {
+		int core = -1;
+		unsigned int clock_freq = 0;
+
+		if (strncmp(buf, "gpu", 3))
+			continue;
+
+		if (sscanf(buf, "gpu%d mc clock: %u HZ.", &core, &clock_freq) == 2 &&
+		    clock_freq) {
+			if (core == 0)
+				clocks->gpu_core_0 = clock_freq;
+			else if (core == 1)
+				clocks->gpu_core_1 = clock_freq;
+			continue;
+		}
+
+		if (sscanf(buf, "gpu%d sh clock: %u HZ.", &core, &clock_freq) == 2 &&
+		    clock_freq) {
+			if (core == 0)
+				clocks->shader_core_0 = clock_freq;
+			else if (core == 1)
+				clocks->shader_core_1 = clock_freq;
+		}
+	}
+
+	return 0;
+}
+
+static int
+legacy_governor(struct debugfs_govern *governor, FILE *file)
+{
+	struct debugfs_govern *modes = NULL;
+	unsigned int nr = 0, index = 0;
+	char buf[1024];
+
+	while ((fgets(buf, 1024, file)) != NULL) {
+		if (!strncmp(buf, "GPU support", 11)) {
+			if (sscanf(buf, "GPU support %u modes", &nr) == 1)
+				modes = calloc(nr, sizeof(*modes));
+			continue;
+		}
+
+		char *naming_mode = calloc(1024, sizeof(char));
+		sscanf(buf, "%[a-zA-Z0-9-]s", naming_mode);
+
+		if (modes && index < nr &&
+		    (!strncmp(naming_mode, "overdrive", 9) ||
+		     !strncmp(naming_mode, "nominal", 7) ||
+		     !strncmp(naming_mode, "underdrive", 10))) {
+			unsigned long core = 0, shader = 0;
+
+			sscanf(buf + strlen(naming_mode), "%*[^c]core_clk frequency: %lu%*[^s]shader_clk frequency: %lu",
+			       &core, &shader);
+			modes[index].governor = !strncmp(naming_mode, "overdrive", 9) ? OVERDRIVE :
+						!strncmp(naming_mode, "nominal", 7) ? NOMINAL : UNDERDRIVE;
+			modes[index].gpu_core_freq = core;
+			modes[index].shader_core_freq = shader;
+			index++;
+		}
+		free(naming_mode);
+
+		if (!strncmp(buf, "Currently", 9)) {
+			char *current_mode = calloc(1024, sizeof(char));
+
+			sscanf(buf, "Currently GPU runs on mode %[a-zA-Z0-9-]s", current_mode);
+			for (unsigned int i = 0; i < index; i++) {
+				if ((modes[i].governor == OVERDRIVE && !strncmp(current_mode, "overdrive", 9)) ||
+				    (modes[i].governor == NOMINAL && !strncmp(current_mode, "nominal", 7)) ||
+				    (modes[i].governor == UNDERDRIVE && !strncmp(current_mode, "underdrive", 10)))
+					*governor = modes[i];
+			}
+			free(current_mode);
+		}
+	}
+
+	free(modes);
+	return 0;
+}
+
+enum bench_parser {
+	BENCH_CLIENTS,
+	BENCH_VIDMEM,
+	BENCH_CLK,
+	BENCH_GOVERN,
+	BENCH_NR,
+};
+
+static const char *bench_files[BENCH_NR] = { "clients", "vidmem", "clk", "gpu_govern" };
+
+/*
+ * parse data once, with either parser; results end up in out to compare
+ * them. The legacy ones read it through file, the tokenizers from a fresh
+ * copy in work, as if it had just been read.
+ */
+static int
+bench_parse(enum bench_parser parser, bool legacy, FILE *file,
+	    const char *data, size_t len, char *work, uint32_t *out)
+{
+	struct debugfs_client clients = {};
+	struct debugfs_vid_mem_client vid_mem = {};
+	struct debugfs_clock clocks = {};
+	struct debugfs_govern governor = {};
+	struct debugfs_client *client, *next;
+	static struct gtop_arena arena;
+	struct gtop_lines lines;
+	int ret = 0;
+
+	if (legacy) {
+		rewind(file);
+	} else {
+		memcpy(work, data, len);
+		gtop_lines_init_buf(&lines, work, len);
+	}
+
+	switch (parser) {
+	case BENCH_CLIENTS:
+		ret = legacy ? legacy_clients(&clients, file) :
+			       debugfs_parse_clients(&clients, &lines, &arena);
+		out[0] = ret;
+		out[1] = 0;
+		for (client = clients.head; client != NULL; client = next) {
+			next = client->next;
+			out[1] += client->pid + strlen(client->name);
+			if (legacy) {
+				free(client->name);
+				free(client);
+			}
+		}
+		gtop_arena_reset(&arena);
+		break;
+	case BENCH_VIDMEM:
+		ret = legacy ? legacy_vid_mem(&vid_mem, file) :
+			       debugfs_parse_vid_mem(&vid_mem, &lines);
+		/* the legacy parser drops the types it doesn't know */
+		memcpy(out, &vid_mem, offsetof(struct debugfs_vid_mem_client, extra));
+		break;
+	case BENCH_CLK:
+		ret = legacy ? legacy_gpu_clocks(&clocks, file) :
+			       debugfs_parse_gpu_clocks(&clocks, &lines);
+		memcpy(out, &clocks, sizeof(clocks));
+		break;
+	case BENCH_GOVERN:
+		ret = legacy ? legacy_governor(&governor, file) :
+			       debugfs_parse_governor(&governor, &lines);
+		memcpy(out, &governor, sizeof(governor));
+		break;
+	default:
+		break;
+	}
+
+	return ret;
+}
+
+/*
+ * time both parsers on dir/<file of parser> for at least msecs each; 0 if
+ * there's no such file
+ */
+static int
+bench_run(const char *dir, enum bench_parser parser, double msecs)
+{
+	uint32_t before[64] = {}, after[64] = {};
+	double time[2];
+	char path[4096];
+	char *data, *work;
+	FILE *file;
+	size_t len;
+	int ret = -1;
+
+	snprintf(path, sizeof(path), "%s/%s", dir, bench_files[parser]);
+	data = bench_load(path, &len);
+	if (!data) {
+		if (errno == ENOENT)
+			return 0;
+
+		fprintf(stderr, "%s: %s\n", path, strerror(errno));
+		return -1;
+	}
+
+	/* nothing to compare */
+	if (!len) {
+		free(data);
+		return 0;
+	}
+
+	work = malloc(len + 1);
+	file = fmemopen(data, len, "r");
+	if (!work || !file) {
+		fprintf(stderr, "%s: %s\n", path, strerror(errno));
+		goto out;
+	}
+
+	for (int legacy = 1; legacy >= 0; legacy--) {
+		uint64_t iterations = 0;
+		double start = bench_now(), elapsed;
+
+		do {
+			bench_parse(parser, legacy, file, data, len, work,
+				    legacy ? before : after);
+
+			iterations++;
+			elapsed = bench_now() - start;
+		} while (elapsed < msecs);
+
+		time[!legacy] = elapsed * 1e3 / iterations;
+	}
+
+	if (memcmp(before, after, sizeof(before))) {
+		fprintf(stderr, "%s: parsers disagree\n", path);
+		goto out;
+	}
+
+	fprintf(stdout, "%-10.*s %-12s %12.2f %12.2f %10.1fx\n",
+		(int) strcspn(bench_name(dir), "/"), bench_name(dir),
+		bench_files[parser], time[0], time[1], time[0] / time[1]);
+	ret = 0;
+
+out:
+	if (file)
+		fclose(file);
+	free(work);
+	free(data);
+	return ret;
+}
+
+int
+main(int argc, char *argv[])
+{
+	double msecs = 200;
+	int ret = EXIT_SUCCESS;
+	bool usage = false;
+	int c;
+
+	while ((c = getopt(argc, argv, "t:")) != -1) {
+		switch (c) {
+		case 't':
+			msecs = atof(optarg);
+			break;
+		default:
+			usage = true;
+			break;
+		}
+	}
+
+	if (usage || optind >= argc || msecs <= 0) {
+		fprintf(stderr, "Usage: %s [-t msecs] <dir>...\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	fprintf(stdout, "%-10s %-12s %12s %12s %11s\n", "corpus", "file",
+		"sscanf(us)", "tokens(us)", "speed-up");
+
+	for (int i = optind; i < argc; i++) {
+		for (int p = 0; p < BENCH_NR; p++) {
+			if (bench_run(argv[i], p, msecs) < 0)
+				ret = EXIT_FAILURE;
+		}
+	}
+
+	return ret;
+}
@@ -0,0 +1,275 @@
+/*
+ * Copyright NXP 2017
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sub license,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+/*
+ * Times each parser of debugfs/sysfs files over a corpus: directories
+ * with any of clients, database, vidmem, clk and gpu_govern in them, such
+ * as bench/fixtures/sample or the synthetic ones -w writes. For each file
+ * it reports the time and throughput of one parse, and how many
+ * allocations it took the first time and then on average.
+ *
+ * gputop-bench-suite [-t msecs] <dir>...
+ * gputop-bench-suite -w <dir> [processes...]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+#include "database.h"
+#include "parse.h"
+#include "arena.h"
+#include "util.h"
+
+#include "bench.h"
+
+/* malloc(), calloc() and realloc() done by the parsers */
+static uint64_t bench_allocs;
+
+#ifdef BENCH_COUNT_ALLOCS
+/* linked with --wrap, only calls from our objects come here */
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t nmemb, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void *__wrap_malloc(size_t size);
+void *__wrap_calloc(size_t nmemb, size_t size);
+void *__wrap_realloc(void *ptr, size_t size);
+
+void *
+__wrap_malloc(size_t size)
+{
+	bench_allocs++;
+	return __real_malloc(size);
+}
+
+void *
+__wrap_calloc(size_t nmemb, size_t size)
+{
+	bench_allocs++;
+	return __real_calloc(nmemb, size);
+}
+
+void *
+__wrap_realloc(void *ptr, size_t size)
+{
+	bench_allocs++;
+	return __real_realloc(ptr, size);
+}
+#endif
+
+/* what the parsers fill, kept across parses the way gputop keeps them */
+static struct {
+	struct gtop_arena arena;
+	struct debugfs_client clients;
+	struct debugfs_database db;
+	struct debugfs_vid_mem_client vid_mem;
+	struct debugfs_clock clocks;
+	struct debugfs_govern governor;
+} bench;
+
+static int
+bench_clients(struct gtop_lines *lines)
+{
+	/* a new refresh */
+	gtop_arena_reset(&bench.arena);
+	memset(&bench.clients, 0, sizeof(bench.clients));
+
+	return debugfs_parse_clients(&bench.clients, lines, &bench.arena);
+}
+
+static int
+bench_database(struct gtop_lines *lines)
+{
+	return debugfs_database_parse(&bench.db, lines);
+}
+
+static int
+bench_vid_mem(struct gtop_lines *lines)
+{
+	memset(&bench.vid_mem, 0, sizeof(bench.vid_mem));
+	return debugfs_parse_vid_mem(&bench.vid_mem, lines);
+}
+
+static int
+bench_clocks(struct gtop_lines *lines)
+{
+	memset(&bench.clocks, 0, sizeof(bench.clocks));
+	return debugfs_parse_gpu_clocks(&bench.clocks, lines);
+}
+
+static int
+bench_governor(struct gtop_lines *lines)
+{
+	memset(&bench.governor, 0, sizeof(bench.governor));
+	return debugfs_parse_governor(&bench.governor, lines);
+}
+
+static const struct {
+	const char *file;
+	int (*parse)(struct gtop_lines *lines);
+} bench_parsers[] = {
+	{ "clients",	bench_clients },
+	{ "database",	bench_database },
+	{ "vidmem",	bench_vid_mem },
+	{ "clk",	bench_clocks },
+	{ "gpu_govern",	bench_governor },
+};
+
+/*
+ * parse data over and over for at least msecs; each parse gets a fresh
+ * copy, as if it had just been read
+ */
+static int
+bench_run(const char *dir, size_t p, double msecs)
+{
+	uint64_t iterations = 0, first, allocs;
+	double start, elapsed;
+	struct gtop_lines lines;
+	char path[4096];
+	char *data, *work;
+	size_t len;
+
+	snprintf(path, sizeof(path), "%s/%s", dir, bench_parsers[p].file);
+	data = bench_load(path, &len);
+	if (!data) {
+		if (errno == ENOENT)
+			return 0;
+
+		fprintf(stderr, "%s: %s\n", path, strerror(errno));
+		return -1;
+	}
+
+	work = malloc(len + 1);
+	if (!work) {
+		fprintf(stderr, "%s: %s\n", path, strerror(errno));
+		free(data);
+		return -1;
+	}
+
+	/* the first parse is where storage gets allocated */
+	memcpy(work, data, len);
+	gtop_lines_init_buf(&lines, work, len);
+
+	allocs = bench_allocs;
+	if (bench_parsers[p].parse(&lines) < 0) {
+		fprintf(stderr, "%s: failed to parse\n", path);
+		free(work);
+		free(data);
+		return -1;
+	}
+	first = bench_allocs - allocs;
+
+	allocs = bench_allocs;
+	start = bench_now();
+	do {
+		memcpy(work, data, len);
+		gtop_lines_init_buf(&lines, work, len);
+		bench_parsers[p].parse(&lines);
+
+		iterations++;
+		elapsed = bench_now() - start;
+	} while (elapsed < msecs);
+	allocs = bench_allocs - allocs;
+
+	fprintf(stdout, "%-10.*s %-12s %10zu %12.2f %10.1f %8"PRIu64" %12.2f\n",
+		(int) strcspn(bench_name(dir), "/"), bench_name(dir),
+		bench_parsers[p].file, len,
+		elapsed * 1e3 / iterations,
+		len * iterations / (elapsed * 1e3),
+		first, (double) allocs / iterations);
+
+	free(work);
+	free(data);
+	return 0;
+}
+
+int
+main(int argc, char *argv[])
+{
+	const char *corpus = NULL;
+	double msecs = 200;
+	int ret = EXIT_SUCCESS;
+	bool usage = false;
+	int c;
+
+	while ((c = getopt(argc, argv, "t:w:")) != -1) {
+		switch (c) {
+		case 't':
+			msecs = atof(optarg);
+			break;
+		case 'w':
+			corpus = optarg;
+			break;
+		default:
+			usage = true;
+			break;
+		}
+	}
+
+	if (usage || (!corpus && optind >= argc) || msecs <= 0) {
+		fprintf(stderr, "Usage: %s [-t msecs] <dir>...\n"
+			"       %s -w <dir> [processes...]\n", argv[0], argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	/* the synthetic corpus, of 1 to 5000 processes unless told */
+	if (corpus) {
+		if (optind == argc)
+			return bench_fixtures_write(corpus, 0) < 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+
+		for (int i = optind; i < argc; i++) {
+			uint32_t procs = strtoul(argv[i], NULL, 10);
+
+			if (!procs) {
+				fprintf(stderr, "%s: not a number of processes\n", argv[i]);
+				return EXIT_FAILURE;
+			}
+
+			if (bench_fixtures_write(corpus, procs) < 0)
+				return EXIT_FAILURE;
+		}
+
+		return EXIT_SUCCESS;
+	}
+
+#ifndef BENCH_COUNT_ALLOCS
+	fprintf(stdout, "allocations aren't counted with this linker\n");
+#endif
+	fprintf(stdout, "%-10s %-12s %10s %12s %10s %8s %12s\n",
+		"corpus", "file", "bytes", "us/parse", "MB/s",
+		"allocs", "allocs/parse");
+
+	for (int i = optind; i < argc; i++) {
+		for (size_t p = 0; p < ARRAY_SIZE(bench_parsers); p++) {
+			if (bench_run(argv[i], p, msecs) < 0)
+				ret = EXIT_FAILURE;
+		}
+	}
+
+	gtop_arena_fini(&bench.arena);
+	debugfs_database_free(&bench.db);
+	return ret;
+}
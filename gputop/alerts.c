@@ -0,0 +1,507 @@
+/*
+ * Copyright NXP 2017
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sub license,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <fnmatch.h>
+#include <math.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include "alerts.h"
+
+#define GTOP_ALERTS_LINE_LEN	512
+#define GTOP_ALERTS_MSG_LEN	256
+
+extern char **environ;
+
+enum gtop_alerts_action {
+	GTOP_ALERTS_LOG,
+	GTOP_ALERTS_FIFO,
+	GTOP_ALERTS_EXEC,
+};
+
+/* where a rule stands for one metric, or one client */
+struct gtop_alerts_state {
+	/* metric id, or pid of the client */
+	int32_t id;
+	bool active;
+	bool seen;
+	/* since when the condition holds, 0 if it doesn't */
+	uint64_t since;
+
+	/* previous value, for rates */
+	float last;
+	uint64_t last_ts;
+
+	/* name of the client */
+	char client[GTOP_RECORD_CLIENT_NAME_LEN];
+};
+
+struct gtop_alerts_rule {
+	char metric[GTOP_METRIC_NAME_LEN];
+	bool client;
+	bool rate;
+	bool above;
+	double threshold;
+	double clear;
+	uint64_t hold;
+
+	enum gtop_alerts_action action;
+	char *arg;
+	FILE *log;
+
+	/* one per metric matched, or per client */
+	struct gtop_alerts_state *states;
+	uint32_t nr_states;
+};
+
+struct gtop_alerts {
+	const struct gtop_snapshot_names *names;
+
+	struct gtop_alerts_rule rules[GTOP_ALERTS_MAX_RULES];
+	uint32_t nr_rules;
+};
+
+static int
+gtop_alerts_time(const char *arg, uint64_t *ns)
+{
+	char *end;
+	double value = strtod(arg, &end);
+
+	if (end == arg || value < 0)
+		return -1;
+
+	if (!strcmp(end, "ms"))
+		value /= 1000;
+	else if (*end && strcmp(end, "s"))
+		return -1;
+
+	*ns = value * 1e9;
+	return 0;
+}
+
+static int
+gtop_alerts_parse(struct gtop_alerts_rule *rule, char *line,
+		  const struct gtop_snapshot_names *names)
+{
+	char name[GTOP_METRIC_NAME_LEN], *tok, *save, *end;
+	bool clear = false;
+	uint32_t m;
+
+	tok = strtok_r(line, " \t\n", &save);
+	if (!tok || strlen(tok) >= sizeof(rule->metric))
+		return -1;
+	strcpy(rule->metric, tok);
+	rule->client = !strncmp(tok, "client.", strlen("client."));
+
+	tok = strtok_r(NULL, " \t\n", &save);
+	if (tok && !strcmp(tok, "rate")) {
+		rule->rate = true;
+		tok = strtok_r(NULL, " \t\n", &save);
+	}
+	if (!tok || (strcmp(tok, "above") && strcmp(tok, "below")))
+		return -1;
+	rule->above = !strcmp(tok, "above");
+
+	tok = strtok_r(NULL, " \t\n", &save);
+	if (!tok)
+		return -1;
+	rule->threshold = strtod(tok, &end);
+	if (end == tok || *end)
+		return -1;
+
+	while ((tok = strtok_r(NULL, " \t\n", &save))) {
+		if (!strcmp(tok, "for")) {
+			tok = strtok_r(NULL, " \t\n", &save);
+			if (!tok || gtop_alerts_time(tok, &rule->hold) < 0)
+				return -1;
+		} else if (!strcmp(tok, "clear")) {
+			tok = strtok_r(NULL, " \t\n", &save);
+			if (!tok)
+				return -1;
+			rule->clear = strtod(tok, &end);
+			if (end == tok || *end)
+				return -1;
+			clear = true;
+		} else {
+			break;
+		}
+	}
+	if (!clear)
+		rule->clear = rule->threshold;
+
+	if (!tok)
+		return -1;
+
+	if (!strcmp(tok, "log")) {
+		rule->action = GTOP_ALERTS_LOG;
+		tok = strtok_r(NULL, " \t\n", &save);
+	} else if (!strcmp(tok, "fifo")) {
+		rule->action = GTOP_ALERTS_FIFO;
+		tok = strtok_r(NULL, " \t\n", &save);
+		if (!tok)
+			return -1;
+	} else if (!strcmp(tok, "exec")) {
+		rule->action = GTOP_ALERTS_EXEC;
+		/* the rest of the line */
+		tok = strtok_r(NULL, "\n", &save);
+		if (!tok)
+			return -1;
+	} else {
+		return -1;
+	}
+
+	if (tok) {
+		rule->arg = strdup(tok);
+		if (!rule->arg)
+			return -1;
+	}
+
+	if (rule->action == GTOP_ALERTS_LOG) {
+		rule->log = rule->arg ? fopen(rule->arg, "a") : stderr;
+		if (!rule->log) {
+			fprintf(stderr, "Failed to open %s: %s\n", rule->arg, strerror(errno));
+			return -1;
+		}
+	}
+
+	if (rule->client) {
+		rule->states = calloc(GTOP_ALERTS_MAX_CLIENTS, sizeof(*rule->states));
+		return rule->states ? 0 : -1;
+	}
+
+	/* a state per metric matched */
+	rule->states = calloc(GTOP_METRIC_NR, sizeof(*rule->states));
+	if (!rule->states)
+		return -1;
+
+	for (m = 0; m < GTOP_METRIC_NR; m++) {
+		if (!gtop_snapshot_metric_name(names, m, name, sizeof(name)) ||
+		    fnmatch(rule->metric, name, 0))
+			continue;
+
+		rule->states[rule->nr_states++].id = m;
+	}
+
+	if (!rule->nr_states) {
+		fprintf(stderr, "No metric matches %s\n", rule->metric);
+		return -1;
+	}
+
+	return 0;
+}
+
+struct gtop_alerts *
+gtop_alerts_create(const char *path, const struct gtop_snapshot_names *names)
+{
+	char line[GTOP_ALERTS_LINE_LEN];
+	struct gtop_alerts *alerts;
+	uint32_t nr = 0;
+	FILE *f;
+
+	f = fopen(path, "r");
+	if (!f) {
+		fprintf(stderr, "Failed to open %s: %s\n", path, strerror(errno));
+		return NULL;
+	}
+
+	alerts = calloc(1, sizeof(*alerts));
+	if (!alerts)
+		goto err;
+	alerts->names = names;
+
+	while (fgets(line, sizeof(line), f)) {
+		char *p = line + strspn(line, " \t");
+
+		nr++;
+		if (*p == '#' || *p == '\n' || !*p)
+			continue;
+
+		if (alerts->nr_rules == GTOP_ALERTS_MAX_RULES) {
+			fprintf(stderr, "%s: more than %u rules\n", path, GTOP_ALERTS_MAX_RULES);
+			goto err;
+		}
+
+		/* counted first so destroy frees what parsing allocated */
+		if (gtop_alerts_parse(&alerts->rules[alerts->nr_rules++], p, names) < 0) {
+			fprintf(stderr, "%s:%u: invalid rule\n", path, nr);
+			goto err;
+		}
+	}
+
+	fclose(f);
+	return alerts;
+
+err:
+	fclose(f);
+	gtop_alerts_destroy(alerts);
+	return NULL;
+}
+
+void
+gtop_alerts_destroy(struct gtop_alerts *alerts)
+{
+	uint32_t i;
+
+	if (!alerts)
+		return;
+
+	/* hooks still running are left to init */
+	while (waitpid(-1, NULL, WNOHANG) > 0)
+		;
+
+	for (i = 0; i < alerts->nr_rules; i++) {
+		struct gtop_alerts_rule *rule = &alerts->rules[i];
+
+		if (rule->log && rule->log != stderr)
+			fclose(rule->log);
+		free(rule->arg);
+		free(rule->states);
+	}
+
+	free(alerts);
+}
+
+static void
+gtop_alerts_exec(const struct gtop_alerts_rule *rule, bool fire,
+		 const char *metric, float value)
+{
+	char env[3][GTOP_ALERTS_MSG_LEN];
+	char **envp;
+	size_t nr = 0, i;
+	pid_t pid;
+
+	while (environ[nr])
+		nr++;
+
+	envp = calloc(nr + 4, sizeof(*envp));
+	if (!envp)
+		return;
+
+	/* all of it before fork, the child only execs */
+	snprintf(env[0], sizeof(env[0]), "GPUTOP_ALERT=%s", fire ? "fire" : "clear");
+	snprintf(env[1], sizeof(env[1]), "GPUTOP_METRIC=%s", metric);
+	snprintf(env[2], sizeof(env[2]), "GPUTOP_VALUE=%g", value);
+	for (i = 0; i < nr; i++)
+		envp[i] = environ[i];
+	for (i = 0; i < 3; i++)
+		envp[nr + i] = env[i];
+
+	pid = fork();
+	if (pid == 0) {
+		execle("/bin/sh", "sh", "-c", rule->arg, (char *) NULL, envp);
+		_exit(127);
+	}
+	if (pid < 0)
+		fprintf(stderr, "Failed to run %s: %s\n", rule->arg, strerror(errno));
+
+	free(envp);
+}
+
+static void
+gtop_alerts_act(const struct gtop_alerts *alerts, const struct gtop_alerts_rule *rule,
+		const struct gtop_alerts_state *state, bool fire, float value,
+		uint64_t timestamp)
+{
+	char metric[GTOP_METRIC_NAME_LEN + GTOP_RECORD_CLIENT_NAME_LEN];
+	char msg[GTOP_ALERTS_MSG_LEN];
+	int len, fd;
+
+	if (rule->client)
+		snprintf(metric, sizeof(metric), "client.%s[%d]", state->client, state->id);
+	else if (!gtop_snapshot_metric_name(alerts->names, state->id, metric, sizeof(metric)))
+		return;
+
+	len = snprintf(msg, sizeof(msg), "%.3f %s %s%s %s %g: %g\n",
+		       timestamp / 1e9, fire ? "FIRE" : "CLEAR", metric,
+		       rule->rate ? " rate" : "", rule->above ? "above" : "below",
+		       rule->threshold, value);
+	if (len >= (int) sizeof(msg))
+		len = sizeof(msg) - 1;
+
+	switch (rule->action) {
+	case GTOP_ALERTS_LOG:
+		fputs(msg, rule->log);
+		fflush(rule->log);
+		break;
+	case GTOP_ALERTS_FIFO:
+		/* nobody reading is fine, and never blocks */
+		fd = open(rule->arg, O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+		if (fd >= 0) {
+			if (write(fd, msg, len) < 0 && errno != EAGAIN)
+				fprintf(stderr, "Failed to write %s: %s\n", rule->arg,
+					strerror(errno));
+			close(fd);
+		}
+		break;
+	case GTOP_ALERTS_EXEC:
+		gtop_alerts_exec(rule, fire, metric, value);
+		break;
+	}
+}
+
+static void
+gtop_alerts_check(const struct gtop_alerts *alerts, const struct gtop_alerts_rule *rule,
+		  struct gtop_alerts_state *state, float value, uint64_t timestamp)
+{
+	bool hit;
+
+	if (rule->rate) {
+		float last = state->last;
+		uint64_t last_ts = state->last_ts;
+
+		state->last = value;
+		state->last_ts = timestamp;
+
+		if (!last_ts || timestamp <= last_ts)
+			return;
+		value = (value - last) * 1e9 / (timestamp - last_ts);
+	}
+
+	if (state->active) {
+		/* past the clear level, on the way back */
+		if (rule->above ? value > rule->clear : value < rule->clear)
+			return;
+
+		state->active = false;
+		state->since = 0;
+		gtop_alerts_act(alerts, rule, state, false, value, timestamp);
+		return;
+	}
+
+	hit = rule->above ? value > rule->threshold : value < rule->threshold;
+	if (!hit) {
+		state->since = 0;
+		return;
+	}
+
+	if (!state->since)
+		state->since = timestamp;
+
+	if (timestamp - state->since >= rule->hold) {
+		state->active = true;
+		gtop_alerts_act(alerts, rule, state, true, value, timestamp);
+	}
+}
+
+void
+gtop_alerts_update(struct gtop_alerts *alerts, const float *values,
+		   uint64_t timestamp)
+{
+	uint32_t r, s;
+
+	/* hooks done since last time */
+	while (waitpid(-1, NULL, WNOHANG) > 0)
+		;
+
+	for (r = 0; r < alerts->nr_rules; r++) {
+		struct gtop_alerts_rule *rule = &alerts->rules[r];
+
+		if (rule->client)
+			continue;
+
+		for (s = 0; s < rule->nr_states; s++) {
+			struct gtop_alerts_state *state = &rule->states[s];
+
+			if (!isnan(values[state->id]))
+				gtop_alerts_check(alerts, rule, state, values[state->id],
+						  timestamp);
+		}
+	}
+}
+
+static struct gtop_alerts_state *
+gtop_alerts_client_state(struct gtop_alerts_rule *rule,
+			 const struct gtop_record_client *client)
+{
+	struct gtop_alerts_state *state;
+	uint32_t s;
+
+	for (s = 0; s < rule->nr_states; s++) {
+		state = &rule->states[s];
+		if (state->id == (int32_t) client->pid &&
+		    !strncmp(state->client, client->name, sizeof(state->client)))
+			return state;
+	}
+
+	if (rule->nr_states == GTOP_ALERTS_MAX_CLIENTS)
+		return NULL;
+
+	state = &rule->states[rule->nr_states++];
+	memset(state, 0, sizeof(*state));
+	state->id = client->pid;
+	strncpy(state->client, client->name, sizeof(state->client) - 1);
+
+	return state;
+}
+
+void
+gtop_alerts_clients(struct gtop_alerts *alerts,
+		    const struct gtop_record_client *clients, uint32_t nr,
+		    uint64_t timestamp)
+{
+	char name[GTOP_RECORD_CLIENT_NAME_LEN + 1];
+	uint32_t r, s, c;
+
+	for (r = 0; r < alerts->nr_rules; r++) {
+		struct gtop_alerts_rule *rule = &alerts->rules[r];
+		const char *pattern = rule->metric + strlen("client.");
+
+		if (!rule->client)
+			continue;
+
+		for (s = 0; s < rule->nr_states; s++)
+			rule->states[s].seen = false;
+
+		for (c = 0; c < nr; c++) {
+			struct gtop_alerts_state *state;
+
+			snprintf(name, sizeof(name), "%.*s", GTOP_RECORD_CLIENT_NAME_LEN,
+				 clients[c].name);
+			if (fnmatch(pattern, name, 0))
+				continue;
+
+			state = gtop_alerts_client_state(rule, &clients[c]);
+			if (!state)
+				continue;
+
+			state->seen = true;
+			gtop_alerts_check(alerts, rule, state, clients[c].total / 1024.0f,
+					  timestamp);
+		}
+
+		/* forget the ones that went away */
+		for (s = 0; s < rule->nr_states; ) {
+			if (rule->states[s].seen) {
+				s++;
+				continue;
+			}
+			rule->states[s] = rule->states[--rule->nr_states];
+		}
+	}
+}
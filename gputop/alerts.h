@@ -0,0 +1,98 @@
+/*
+ * Copyright NXP 2017
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sub license,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#ifndef __GPUTOP_ALERTS_H
+#define __GPUTOP_ALERTS_H
+
+#include <stdint.h>
+
+#include "snapshot.h"
+#include "record.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * A rules file has one alert per line, # starts a comment:
+ *
+ *	<metric> [rate] above|below <n> [for <time>] [clear <n>] <action>
+ *
+ * with action one of
+ *
+ *	log [path]		append a line to path, stderr by default
+ *	fifo <path>		write the same line to a FIFO, if read
+ *	exec <command>		run command with sh -c
+ *
+ * metric is named as printed by -C, or client.<name> for the video memory
+ * (kB) of every client called name, and may be a shell pattern. With rate
+ * the change per second is checked instead. An alert fires once the
+ * condition held for the given time (e.g. 500ms, 2s; 0 by default), and
+ * clears once the value is back on the other side of the clear level (the
+ * threshold by default), which keeps it from flapping.
+ *
+ * Hooks get GPUTOP_ALERT (fire or clear), GPUTOP_METRIC and GPUTOP_VALUE in
+ * their environment.
+ */
+#define GTOP_ALERTS_MAX_RULES		64
+/* clients tracked by a client rule */
+#define GTOP_ALERTS_MAX_CLIENTS		64
+
+struct gtop_alerts;
+
+/**
+ * gtop_alerts_create:
+ *
+ * Parse the rules at path, resolving metric names with names, which must
+ * outlive the alerts.
+ */
+struct gtop_alerts *
+gtop_alerts_create(const char *path, const struct gtop_snapshot_names *names);
+
+void
+gtop_alerts_destroy(struct gtop_alerts *alerts);
+
+/**
+ * gtop_alerts_update:
+ *
+ * Check rules against new values, GTOP_METRIC_NR of them, NaN for the ones
+ * not part of this update. Cheap enough to be called on every sample.
+ */
+void
+gtop_alerts_update(struct gtop_alerts *alerts, const float *values,
+		   uint64_t timestamp);
+
+/**
+ * gtop_alerts_clients:
+ *
+ * Check client rules against the memory of the clients seen right now.
+ */
+void
+gtop_alerts_clients(struct gtop_alerts *alerts,
+		    const struct gtop_record_client *clients, uint32_t nr,
+		    uint64_t timestamp);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __GPUTOP_ALERTS_H */
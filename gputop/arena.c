@@ -0,0 +1,175 @@
+/*
+ * Copyright NXP 2017
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sub license,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "arena.h"
+
+/* what malloc() aligns for, max_align_t being C11 */
+union gtop_arena_align {
+	long long l;
+	long double d;
+	void *p;
+	void (*f)(void);
+};
+
+struct gtop_arena_chunk {
+	struct gtop_arena_chunk *next;
+	size_t size;
+	size_t used;
+	union gtop_arena_align data[];
+};
+
+#define GTOP_ARENA_ALIGN	(sizeof(union gtop_arena_align))
+
+static size_t
+gtop_arena_align(size_t size)
+{
+	return (size + GTOP_ARENA_ALIGN - 1) / GTOP_ARENA_ALIGN * GTOP_ARENA_ALIGN;
+}
+
+/*
+ * from the last chunk, or a new one as big as the block (or size, if
+ * bigger) so that overflowing doesn't take a malloc() per allocation
+ */
+static void *
+gtop_arena_chunk_alloc(struct gtop_arena *arena, size_t size)
+{
+	struct gtop_arena_chunk *chunk = arena->chunks;
+	char *ptr;
+
+	if (!chunk || size > chunk->size - chunk->used) {
+		size_t chunk_size = size > arena->size ? size : arena->size;
+
+		chunk = malloc(sizeof(*chunk) + chunk_size);
+		if (!chunk)
+			return NULL;
+
+		arena->mallocs++;
+		chunk->size = chunk_size;
+		chunk->used = 0;
+		chunk->next = arena->chunks;
+		arena->chunks = chunk;
+	}
+
+	ptr = (char *) chunk->data + chunk->used;
+	chunk->used += size;
+	arena->overflow += size;
+
+	return ptr;
+}
+
+void *
+gtop_arena_alloc(struct gtop_arena *arena, size_t size)
+{
+	void *ptr;
+
+	size = gtop_arena_align(size ? size : 1);
+
+	if (!arena->block) {
+		arena->block = malloc(GTOP_ARENA_SIZE);
+		if (!arena->block)
+			return NULL;
+
+		arena->mallocs++;
+		arena->size = GTOP_ARENA_SIZE;
+		arena->used = 0;
+	}
+
+	if (size <= arena->size - arena->used) {
+		ptr = arena->block + arena->used;
+		arena->used += size;
+	} else {
+		ptr = gtop_arena_chunk_alloc(arena, size);
+		if (!ptr)
+			return NULL;
+	}
+
+	if (gtop_arena_in_use(arena) > arena->peak)
+		arena->peak = gtop_arena_in_use(arena);
+
+	memset(ptr, 0, size);
+	return ptr;
+}
+
+char *
+gtop_arena_strdup(struct gtop_arena *arena, const char *str)
+{
+	size_t len = strlen(str) + 1;
+	char *dst;
+
+	dst = gtop_arena_alloc(arena, len);
+	if (dst)
+		memcpy(dst, str, len);
+
+	return dst;
+}
+
+void
+gtop_arena_reset(struct gtop_arena *arena)
+{
+	struct gtop_arena_chunk *chunk = arena->chunks;
+
+	if (!chunk) {
+		arena->used = 0;
+		return;
+	}
+
+	while (chunk) {
+		struct gtop_arena_chunk *next = chunk->next;
+
+		free(chunk);
+		chunk = next;
+	}
+
+	arena->chunks = NULL;
+	arena->overflow = 0;
+	arena->used = 0;
+
+	/* the block didn't do, make it big enough for the worst so far */
+	if (arena->peak > arena->size) {
+		size_t size = arena->size;
+		char *block;
+
+		while (size < arena->peak)
+			size *= 2;
+
+		block = malloc(size);
+		if (!block)
+			return;
+
+		arena->mallocs++;
+		free(arena->block);
+		arena->block = block;
+		arena->size = size;
+	}
+}
+
+void
+gtop_arena_fini(struct gtop_arena *arena)
+{
+	gtop_arena_reset(arena);
+	free(arena->block);
+	memset(arena, 0, sizeof(*arena));
+}
@@ -0,0 +1,111 @@
+/*
+ * Copyright NXP 2017
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sub license,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#ifndef __GPUTOP_ARENA_H
+#define __GPUTOP_ARENA_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* what the arena starts with, before it learns how much a refresh takes */
+#define GTOP_ARENA_SIZE		(16 * 1024)
+
+struct gtop_arena_chunk;
+
+/**
+ * gtop_arena:
+ *
+ * Bump allocator for data that lives for one refresh: the clients list,
+ * names and contexts read from debugfs. Allocations can't be freed one by
+ * one, gtop_arena_reset() drops them all at once.
+ *
+ * Whatever doesn't fit in the block goes to overflow chunks. On reset they
+ * are freed and the block is grown to the peak seen so far, so once a
+ * refresh has been as big as it gets, refreshes don't call malloc() at all.
+ */
+struct gtop_arena {
+	char *block;
+	size_t size;
+	size_t used;
+
+	struct gtop_arena_chunk *chunks;
+	/* bytes handed out from chunks since the last reset */
+	size_t overflow;
+
+	/* most bytes in use between two resets */
+	size_t peak;
+	/* calls to malloc() done, for the benchmarks */
+	uint64_t mallocs;
+};
+
+/**
+ * gtop_arena_alloc:
+ *
+ * size bytes, zeroed and aligned for any type. NULL if we ran out of memory.
+ */
+void *
+gtop_arena_alloc(struct gtop_arena *arena, size_t size);
+
+/**
+ * gtop_arena_strdup:
+ *
+ * A copy of str, held by the arena.
+ */
+char *
+gtop_arena_strdup(struct gtop_arena *arena, const char *str);
+
+/**
+ * gtop_arena_reset:
+ *
+ * Drop everything allocated from arena, which can be used again.
+ */
+void
+gtop_arena_reset(struct gtop_arena *arena);
+
+/**
+ * gtop_arena_fini:
+ *
+ * Free all memory held by arena.
+ */
+void
+gtop_arena_fini(struct gtop_arena *arena);
+
+/**
+ * gtop_arena_in_use:
+ *
+ * Bytes allocated since the last reset.
+ */
+static inline size_t
+gtop_arena_in_use(const struct gtop_arena *arena)
+{
+	return arena->used + arena->overflow;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __GPUTOP_ARENA_H */
@@ -0,0 +1,99 @@
+/*
+ * Copyright NXP 2017
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sub license,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+
+#include "baseline.h"
+
+void
+gtop_baseline_values(const struct gtop_snapshot *snap, float *values)
+{
+	/* DDR and counters are rates already */
+	gtop_snapshot_metrics(snap, values);
+}
+
+int
+gtop_baselines_pin(struct gtop_baselines *baselines, const char *name,
+		   const struct gtop_snapshot *snap)
+{
+	struct gtop_baseline *baseline;
+	uint32_t i;
+
+	for (i = 0; i < baselines->nr; i++)
+		if (!strcmp(baselines->baselines[i].name, name))
+			break;
+
+	if (i == GTOP_BASELINES_MAX)
+		return -1;
+	if (i == baselines->nr)
+		baselines->nr++;
+
+	baseline = &baselines->baselines[i];
+	snprintf(baseline->name, sizeof(baseline->name), "%s", name);
+	baseline->timestamp = snap->timestamp;
+	gtop_baseline_values(snap, baseline->values);
+
+	baselines->active = i;
+	return i;
+}
+
+const struct gtop_baseline *
+gtop_baselines_active(const struct gtop_baselines *baselines)
+{
+	if (!baselines->nr)
+		return NULL;
+
+	return &baselines->baselines[baselines->active];
+}
+
+void
+gtop_baselines_next(struct gtop_baselines *baselines)
+{
+	if (baselines->nr)
+		baselines->active = (baselines->active + 1) % baselines->nr;
+}
+
+bool
+gtop_baseline_compare(const struct gtop_baseline *baseline, const float *values,
+		      uint32_t metric, struct gtop_baseline_delta *delta)
+{
+	if (metric >= GTOP_METRIC_NR ||
+	    isnan(baseline->values[metric]) || isnan(values[metric]))
+		return false;
+
+	delta->base = baseline->values[metric];
+	delta->now = values[metric];
+	delta->delta = delta->now - delta->base;
+	delta->change = delta->base != 0.0 ? 100.0 * delta->delta / fabs(delta->base) : NAN;
+
+	/* occupancy and DMA states are already percentages */
+	if (metric < GTOP_METRIC_DDR)
+		delta->significant = fabs(delta->delta) >= GTOP_BASELINE_SIGNIFICANT_POINTS;
+	else
+		delta->significant = delta->delta != 0.0 &&
+			(isnan(delta->change) ||
+			 fabs(delta->change) >= GTOP_BASELINE_SIGNIFICANT_CHANGE);
+
+	return true;
+}
@@ -0,0 +1,128 @@
+/*
+ * Copyright NXP 2017
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sub license,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#ifndef __GPUTOP_BASELINE_H
+#define __GPUTOP_BASELINE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "snapshot.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define GTOP_BASELINES_MAX		8
+#define GTOP_BASELINE_NAME_LEN		32
+
+/*
+ * a change is significant past either: points for what is in % (occupancy,
+ * DMA states), % of the baseline for the rest
+ */
+#define GTOP_BASELINE_SIGNIFICANT_POINTS	5.0
+#define GTOP_BASELINE_SIGNIFICANT_CHANGE	10.0
+
+/**
+ * gtop_baseline:
+ *
+ * An interval pinned to compare the next ones against. DDR and counters are
+ * kept as rates (per second) so that intervals of different lengths
+ * compare.
+ */
+struct gtop_baseline {
+	char name[GTOP_BASELINE_NAME_LEN];
+	uint64_t timestamp;
+	float values[GTOP_METRIC_NR];
+};
+
+struct gtop_baselines {
+	struct gtop_baseline baselines[GTOP_BASELINES_MAX];
+	uint32_t nr;
+	/* the one deltas are against */
+	uint32_t active;
+};
+
+/**
+ * gtop_baseline_delta:
+ *
+ * How a metric moved from the baseline, in the units of the baseline.
+ */
+struct gtop_baseline_delta {
+	double base;
+	double now;
+	double delta;
+	/* % of base, NaN if base is 0 */
+	double change;
+	bool significant;
+};
+
+/**
+ * gtop_baseline_values:
+ *
+ * The values of a snapshot the way baselines keep them.
+ */
+void
+gtop_baseline_values(const struct gtop_snapshot *snap, float *values);
+
+/**
+ * gtop_baselines_pin:
+ *
+ * Pin snap as baseline name, replacing the one with the same name if any,
+ * and make it the active one. Returns its index, -1 if there's no room
+ * left.
+ */
+int
+gtop_baselines_pin(struct gtop_baselines *baselines, const char *name,
+		   const struct gtop_snapshot *snap);
+
+/**
+ * gtop_baselines_active:
+ *
+ * NULL if nothing has been pinned.
+ */
+const struct gtop_baseline *
+gtop_baselines_active(const struct gtop_baselines *baselines);
+
+/**
+ * gtop_baselines_next:
+ *
+ * Make the next baseline (in pinning order) the active one.
+ */
+void
+gtop_baselines_next(struct gtop_baselines *baselines);
+
+/**
+ * gtop_baseline_compare:
+ *
+ * Fill delta for metric, from values as returned by gtop_baseline_values().
+ * False if it is missing on either side.
+ */
+bool
+gtop_baseline_compare(const struct gtop_baseline *baseline, const float *values,
+		      uint32_t metric, struct gtop_baseline_delta *delta);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __GPUTOP_BASELINE_H */
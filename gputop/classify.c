@@ -0,0 +1,352 @@
+/*
+ * Copyright NXP 2017
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sub license,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+
+#include "classify.h"
+#include "util.h"
+
+static const char *gtop_verdict_names[GTOP_VERDICT_NR] = {
+	[GTOP_VERDICT_UNKNOWN]		= "unknown",
+	[GTOP_VERDICT_IDLE]		= "idle",
+	[GTOP_VERDICT_FRONT_END]	= "front-end",
+	[GTOP_VERDICT_SHADER]		= "shader",
+	[GTOP_VERDICT_TEXTURE]		= "texture/memory",
+	[GTOP_VERDICT_FILL]		= "fill",
+};
+
+/* as they start the module names in states.c */
+static const char *gtop_classify_units[GTOP_CLASSIFY_NR_UNITS] = {
+	[GTOP_CLASSIFY_FE]	= "FE",
+	[GTOP_CLASSIFY_SH]	= "SH",
+	[GTOP_CLASSIFY_PE]	= "PE",
+	[GTOP_CLASSIFY_RA]	= "RA",
+	[GTOP_CLASSIFY_TX]	= "TX",
+	[GTOP_CLASSIFY_MC]	= "MC",
+};
+
+#define GTOP_CLASSIFY_CMD_DMA_IDLE	"Command DMA state/IDLE"
+
+/*
+ * what a verdict looks at: modules shown as evidence, and words that tell
+ * its counters apart (lowercase)
+ */
+static const struct {
+	int units[3];
+	const char *words[6];
+} gtop_classify_rules[GTOP_VERDICT_NR] = {
+	[GTOP_VERDICT_FRONT_END] = {
+		{ GTOP_CLASSIFY_FE, GTOP_CLASSIFY_SH, GTOP_CLASSIFY_PE },
+		{ "fe_", "front", "command", "vertex", "draw" },
+	},
+	[GTOP_VERDICT_SHADER] = {
+		{ GTOP_CLASSIFY_SH, GTOP_CLASSIFY_TX, GTOP_CLASSIFY_PE },
+		{ "sh_", "shader", "instruction", "alu" },
+	},
+	[GTOP_VERDICT_TEXTURE] = {
+		{ GTOP_CLASSIFY_TX, GTOP_CLASSIFY_MC, GTOP_CLASSIFY_SH },
+		{ "tx_", "texture", "mc_", "memory", "cache" },
+	},
+	[GTOP_VERDICT_FILL] = {
+		{ GTOP_CLASSIFY_PE, GTOP_CLASSIFY_RA, GTOP_CLASSIFY_SH },
+		{ "pe_", "pixel", "ra_", "raster", "depth" },
+	},
+};
+
+const char *
+gtop_verdict_name(enum gtop_verdict verdict)
+{
+	if (verdict >= GTOP_VERDICT_NR)
+		return gtop_verdict_names[GTOP_VERDICT_UNKNOWN];
+
+	return gtop_verdict_names[verdict];
+}
+
+static bool
+gtop_classify_is_unit(const char *name, const char *unit)
+{
+	size_t len = strlen(unit);
+
+	return !strncmp(name, unit, len) &&
+		(name[len] == ' ' || name[len] == '(' || name[len] == '\0');
+}
+
+static enum gtop_verdict
+gtop_classify_counter_verdict(const char *name)
+{
+	char lower[GTOP_SNAPSHOT_NAME_LEN];
+	uint32_t v, w;
+	size_t i;
+
+	for (i = 0; name[i] && i < sizeof(lower) - 1; i++)
+		lower[i] = tolower((unsigned char) name[i]);
+	lower[i] = '\0';
+
+	for (v = 0; v < GTOP_VERDICT_NR; v++)
+		for (w = 0; w < ARRAY_SIZE(gtop_classify_rules[v].words) &&
+			    gtop_classify_rules[v].words[w]; w++)
+			if (strstr(lower, gtop_classify_rules[v].words[w]))
+				return v;
+
+	return GTOP_VERDICT_UNKNOWN;
+}
+
+void
+gtop_classifier_init(struct gtop_classifier *classifier,
+		     const struct gtop_snapshot_names *names, double ddr_peak)
+{
+	uint32_t i, j, u, p, controllers = 0;
+
+	memset(classifier, 0, sizeof(*classifier));
+	classifier->names = names;
+
+	for (u = 0; u < GTOP_CLASSIFY_NR_UNITS; u++) {
+		classifier->units[u] = -1;
+		for (i = 0; i < GTOP_SNAPSHOT_MAX_MODULES; i++)
+			if (gtop_classify_is_unit(names->modules[i], gtop_classify_units[u]))
+				classifier->units[u] = GTOP_METRIC_MODULES + i;
+	}
+
+	classifier->cmd_dma_idle = -1;
+	for (i = 0; i < GTOP_SNAPSHOT_MAX_DMA_STATES; i++)
+		if (!strcmp(names->dma_states[i], GTOP_CLASSIFY_CMD_DMA_IDLE))
+			classifier->cmd_dma_idle = GTOP_METRIC_DMA_STATES + i;
+
+	/* events are named controller/event, the peak is per controller */
+	for (i = 0; i < GTOP_SNAPSHOT_MAX_DDR; i++) {
+		size_t len = strcspn(names->ddr[i], "/");
+
+		if (!names->ddr[i][0])
+			continue;
+		for (j = 0; j < i; j++)
+			if (!strncmp(names->ddr[j], names->ddr[i], len) &&
+			    names->ddr[j][len] == '/')
+				break;
+		if (j == i)
+			controllers++;
+	}
+	classifier->ddr_peak = (ddr_peak > 0.0 ? ddr_peak : GTOP_CLASSIFY_DEFAULT_PEAK) *
+		(controllers ? controllers : 1);
+
+	for (p = 0; p < 2; p++) {
+		for (i = 0; i < GTOP_SNAPSHOT_MAX_COUNTERS; i++) {
+			enum gtop_verdict v;
+
+			if (!names->counters[p][i][0])
+				continue;
+			v = gtop_classify_counter_verdict(names->counters[p][i]);
+			if (v == GTOP_VERDICT_UNKNOWN ||
+			    classifier->nr_counters[v] >= GTOP_CLASSIFY_MAX_COUNTERS)
+				continue;
+			classifier->counters[v][classifier->nr_counters[v]++] =
+				GTOP_METRIC_COUNTERS(p) + i;
+		}
+	}
+}
+
+/* NaN-ignoring max */
+static double
+gtop_classify_max(double a, double b)
+{
+	if (isnan(a))
+		return b;
+	if (isnan(b))
+		return a;
+	return a > b ? a : b;
+}
+
+static void
+gtop_classify_add(struct gtop_classification *result, const char *name,
+		  double value, const char *unit)
+{
+	struct gtop_classify_evidence *e;
+
+	if (isnan(value) || result->nr_evidence >= GTOP_CLASSIFY_MAX_EVIDENCE)
+		return;
+
+	e = &result->evidence[result->nr_evidence++];
+	snprintf(e->name, sizeof(e->name), "%s", name);
+	e->value = value;
+	e->unit = unit;
+}
+
+/* the busiest counters of the verdict */
+static void
+gtop_classify_add_counters(const struct gtop_classifier *classifier,
+			   struct gtop_classification *result, const float *values,
+			   uint32_t max)
+{
+	const uint32_t *counters = classifier->counters[result->verdict];
+	uint32_t i, n = classifier->nr_counters[result->verdict];
+	bool used[GTOP_CLASSIFY_MAX_COUNTERS] = { false };
+
+	while (max--) {
+		uint32_t best = n;
+		char name[GTOP_METRIC_NAME_LEN];
+
+		for (i = 0; i < n; i++)
+			if (!used[i] && !isnan(values[counters[i]]) && values[counters[i]] > 0 &&
+			    (best == n || values[counters[i]] > values[counters[best]]))
+				best = i;
+		if (best == n)
+			break;
+
+		used[best] = true;
+		gtop_snapshot_metric_name(classifier->names, counters[best], name, sizeof(name));
+		gtop_classify_add(result, name, values[counters[best]], "/s");
+	}
+}
+
+/*
+ * each verdict's counters weigh in with their share of the events of all
+ * the counters tied to a verdict; one verdict alone can't be compared
+ */
+static void
+gtop_classify_add_rates(const struct gtop_classifier *classifier,
+			struct gtop_classification *result, const float *values)
+{
+	double rates[GTOP_VERDICT_NR], total = 0.0;
+	uint32_t i, v, nr = 0;
+
+	for (v = GTOP_VERDICT_FRONT_END; v < GTOP_VERDICT_NR; v++) {
+		rates[v] = NAN;
+		for (i = 0; i < classifier->nr_counters[v]; i++) {
+			float value = values[classifier->counters[v][i]];
+
+			if (!isnan(value))
+				rates[v] = (isnan(rates[v]) ? 0.0 : rates[v]) + value;
+		}
+		if (!isnan(rates[v])) {
+			total += rates[v];
+			nr++;
+		}
+	}
+	if (nr < 2 || total <= 0.0)
+		return;
+
+	for (v = GTOP_VERDICT_FRONT_END; v < GTOP_VERDICT_NR; v++) {
+		double share;
+
+		if (isnan(rates[v]))
+			continue;
+
+		share = 100.0 * rates[v] / total;
+		if (isnan(result->scores[v]))
+			result->scores[v] = share;
+		else
+			result->scores[v] = (1.0 - GTOP_CLASSIFY_RATES_WEIGHT) * result->scores[v] +
+				GTOP_CLASSIFY_RATES_WEIGHT * share;
+	}
+}
+
+void
+gtop_classify(const struct gtop_classifier *classifier,
+	      const struct gtop_snapshot *snap, struct gtop_classification *result)
+{
+	float values[GTOP_METRIC_NR];
+	double units[GTOP_CLASSIFY_NR_UNITS];
+	double busy = NAN, ddr = NAN, downstream, best = NAN;
+	uint32_t c, u, v;
+
+	memset(result, 0, sizeof(*result));
+	for (v = 0; v < GTOP_VERDICT_NR; v++)
+		result->scores[v] = NAN;
+
+	gtop_snapshot_metrics(snap, values);
+
+	for (c = 0; c < GTOP_SNAPSHOT_MAX_CORES; c++)
+		busy = gtop_classify_max(busy, values[GTOP_METRIC_CORES + c]);
+	if (isnan(busy))
+		return;
+
+	for (u = 0; u < GTOP_CLASSIFY_NR_UNITS; u++)
+		units[u] = classifier->units[u] >= 0 ? values[classifier->units[u]] : NAN;
+
+	for (c = GTOP_METRIC_DDR; c < GTOP_METRIC_COUNTERS(0); c++)
+		if (!isnan(values[c]))
+			ddr = (isnan(ddr) ? 0.0 : ddr) + values[c];
+	ddr = 100.0 * ddr / classifier->ddr_peak;
+
+	downstream = gtop_classify_max(units[GTOP_CLASSIFY_SH],
+				       gtop_classify_max(units[GTOP_CLASSIFY_PE],
+							 units[GTOP_CLASSIFY_TX]));
+
+	result->scores[GTOP_VERDICT_IDLE] = 100.0 - busy;
+	result->scores[GTOP_VERDICT_FRONT_END] = units[GTOP_CLASSIFY_FE] - downstream;
+	if (classifier->cmd_dma_idle >= 0)
+		result->scores[GTOP_VERDICT_FRONT_END] =
+			gtop_classify_max(result->scores[GTOP_VERDICT_FRONT_END],
+					  100.0 - values[classifier->cmd_dma_idle] - downstream);
+	result->scores[GTOP_VERDICT_SHADER] = units[GTOP_CLASSIFY_SH];
+	result->scores[GTOP_VERDICT_TEXTURE] =
+		gtop_classify_max(ddr, gtop_classify_max(units[GTOP_CLASSIFY_TX],
+							 units[GTOP_CLASSIFY_MC]));
+	result->scores[GTOP_VERDICT_FILL] =
+		gtop_classify_max(units[GTOP_CLASSIFY_PE], units[GTOP_CLASSIFY_RA]);
+	gtop_classify_add_rates(classifier, result, values);
+
+	if (busy < GTOP_CLASSIFY_IDLE) {
+		result->verdict = GTOP_VERDICT_IDLE;
+	} else {
+		for (v = GTOP_VERDICT_FRONT_END; v < GTOP_VERDICT_NR; v++) {
+			if (isnan(result->scores[v]) ||
+			    (!isnan(best) && result->scores[v] <= best))
+				continue;
+			best = result->scores[v];
+			result->verdict = v;
+		}
+	}
+
+	gtop_classify_add(result, "core", busy, "%");
+	if (result->verdict == GTOP_VERDICT_IDLE || result->verdict == GTOP_VERDICT_UNKNOWN)
+		return;
+
+	for (u = 0; u < ARRAY_SIZE(gtop_classify_rules[result->verdict].units); u++) {
+		enum gtop_classify_unit unit = gtop_classify_rules[result->verdict].units[u];
+
+		gtop_classify_add(result, gtop_classify_units[unit], units[unit], "%");
+	}
+	if (result->verdict == GTOP_VERDICT_FRONT_END && classifier->cmd_dma_idle >= 0)
+		gtop_classify_add(result, "cmd-dma", 100.0 - values[classifier->cmd_dma_idle], "%");
+	if (result->verdict == GTOP_VERDICT_TEXTURE)
+		gtop_classify_add(result, "ddr-peak", ddr, "%");
+
+	gtop_classify_add_counters(classifier, result, values, 3);
+}
+
+void
+gtop_classification_print(FILE *f, const struct gtop_classification *result)
+{
+	uint32_t i;
+
+	fprintf(f, "%s", gtop_verdict_name(result->verdict));
+	for (i = 0; i < result->nr_evidence; i++) {
+		const struct gtop_classify_evidence *e = &result->evidence[i];
+
+		if (!strcmp(e->unit, "%"))
+			fprintf(f, "%s %s %.0f%%", i ? "," : ":", e->name, e->value);
+		else
+			fprintf(f, "%s %s %.3g%s", i ? "," : ":", e->name, e->value, e->unit);
+	}
+}
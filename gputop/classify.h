@@ -0,0 +1,155 @@
+/*
+ * Copyright NXP 2017
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sub license,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#ifndef __GPUTOP_CLASSIFY_H
+#define __GPUTOP_CLASSIFY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "snapshot.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * A verdict on what holds the GPU back over an interval, from rules over
+ * what a snapshot has:
+ *
+ *	- idle: the 3D cores are busy less than GTOP_CLASSIFY_IDLE % of the time
+ *	- front-end: FE (or the command DMA) is busy while SH, PE and TX wait
+ *	- shader: SH is the busiest
+ *	- texture/memory: TX or MC is the busiest, or DDR runs close to its peak
+ *	- fill: PE or RA is the busiest
+ *
+ * Each rule gives a score in % and the highest wins. Counters whose name
+ * ties them to a verdict move its score towards their share of the events
+ * of all such counters, by GTOP_CLASSIFY_RATES_WEIGHT; those of the winning
+ * verdict are listed with the occupancy as evidence, busiest first.
+ */
+enum gtop_verdict {
+	GTOP_VERDICT_UNKNOWN,
+	GTOP_VERDICT_IDLE,
+	GTOP_VERDICT_FRONT_END,
+	GTOP_VERDICT_SHADER,
+	GTOP_VERDICT_TEXTURE,
+	GTOP_VERDICT_FILL,
+
+	GTOP_VERDICT_NR,
+};
+
+/* % of core busy below which the GPU is idle */
+#define GTOP_CLASSIFY_IDLE		10.0
+/* how much counter rates weigh against occupancy in a score */
+#define GTOP_CLASSIFY_RATES_WEIGHT	0.25
+/* MB/s per DDR controller, LPDDR4-3200 on 32 bits */
+#define GTOP_CLASSIFY_DEFAULT_PEAK	12800.0
+
+#define GTOP_CLASSIFY_MAX_EVIDENCE	8
+#define GTOP_CLASSIFY_MAX_COUNTERS	16
+
+/* the modules the rules look at */
+enum gtop_classify_unit {
+	GTOP_CLASSIFY_FE,
+	GTOP_CLASSIFY_SH,
+	GTOP_CLASSIFY_PE,
+	GTOP_CLASSIFY_RA,
+	GTOP_CLASSIFY_TX,
+	GTOP_CLASSIFY_MC,
+
+	GTOP_CLASSIFY_NR_UNITS,
+};
+
+/**
+ * gtop_classifier:
+ *
+ * Where the rules find what they need in a snapshot, resolved once from
+ * its names.
+ */
+struct gtop_classifier {
+	/* MB/s, all controllers together */
+	double ddr_peak;
+
+	/* metric ids, -1 when not there */
+	int units[GTOP_CLASSIFY_NR_UNITS];
+	int cmd_dma_idle;
+
+	/* counters belonging to each verdict */
+	uint32_t counters[GTOP_VERDICT_NR][GTOP_CLASSIFY_MAX_COUNTERS];
+	uint32_t nr_counters[GTOP_VERDICT_NR];
+
+	const struct gtop_snapshot_names *names;
+};
+
+struct gtop_classify_evidence {
+	char name[GTOP_METRIC_NAME_LEN];
+	double value;
+	/* "%" or "/s" */
+	const char *unit;
+};
+
+struct gtop_classification {
+	enum gtop_verdict verdict;
+	/* score of each verdict, NaN if it couldn't be checked */
+	double scores[GTOP_VERDICT_NR];
+
+	struct gtop_classify_evidence evidence[GTOP_CLASSIFY_MAX_EVIDENCE];
+	uint32_t nr_evidence;
+};
+
+/**
+ * gtop_classifier_init:
+ *
+ * ddr_peak is the bandwidth (MB/s) of one DDR controller, 0 for the
+ * default. names must outlive the classifier.
+ */
+void
+gtop_classifier_init(struct gtop_classifier *classifier,
+		     const struct gtop_snapshot_names *names, double ddr_peak);
+
+void
+gtop_classify(const struct gtop_classifier *classifier,
+	      const struct gtop_snapshot *snap, struct gtop_classification *result);
+
+/**
+ * gtop_verdict_name:
+ *
+ * Short name of a verdict, usable as a key.
+ */
+const char *
+gtop_verdict_name(enum gtop_verdict verdict);
+
+/**
+ * gtop_classification_print:
+ *
+ * The verdict followed by its evidence, on one line (no newline).
+ */
+void
+gtop_classification_print(FILE *f, const struct gtop_classification *result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __GPUTOP_CLASSIFY_H */
@@ -0,0 +1,235 @@
+/*
+ * Copyright NXP 2017
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sub license,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "clients.h"
+
+static void
+gtop_clients_event_add(struct gtop_clients *clients, enum gtop_client_event_type type,
+		       const struct gtop_client *client, uint64_t now)
+{
+	uint32_t i = clients->nr_events % GTOP_CLIENTS_EVENTS;
+	struct gtop_record_client_event *event = &clients->events[i];
+
+	memset(event, 0, sizeof(*event));
+	event->pid = client->pid;
+	event->type = type;
+	memcpy(event->name, client->name, sizeof(event->name));
+
+	clients->event_time[i] = now;
+	clients->nr_events++;
+}
+
+static struct gtop_client *
+gtop_clients_search(const struct gtop_clients *clients, uint32_t nr, uint32_t pid)
+{
+	uint32_t lo = 0, hi = nr;
+
+	while (lo < hi) {
+		uint32_t mid = lo + (hi - lo) / 2;
+
+		if (clients->clients[mid].pid < pid)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	if (lo == nr || clients->clients[lo].pid != pid)
+		return NULL;
+
+	return &clients->clients[lo];
+}
+
+/*
+ * contexts, and whether the database entry changed; an entry that didn't
+ * change has the same contexts, those are only copied when it does
+ */
+static int
+gtop_clients_refresh(struct gtop_clients *clients, struct gtop_client *client,
+		     const struct debugfs_database *db)
+{
+	const struct debugfs_db_process *proc;
+	uint32_t sum = 0;
+
+	proc = debugfs_database_find_pid(db, client->pid);
+	if (proc && strncmp(client->name, proc->name, strlen(proc->name)))
+		proc = NULL;
+	if (proc)
+		sum = proc->sum;
+
+	/* new clients have no contexts yet, whatever the sum */
+	if (sum == client->sum && client->changed != clients->scan)
+		return 0;
+
+	client->ctx_no = 0;
+	if (proc) {
+		if (proc->ctx_no > client->ctx_size) {
+			uint32_t size = client->ctx_size ? client->ctx_size : 4;
+			uint32_t *ctx;
+
+			while (size < proc->ctx_no)
+				size *= 2;
+
+			ctx = realloc(client->ctx, size * sizeof(*ctx));
+			if (!ctx)
+				return -1;
+
+			client->ctx = ctx;
+			client->ctx_size = size;
+		}
+
+		memcpy(client->ctx, debugfs_database_contexts(db, proc),
+		       proc->ctx_no * sizeof(*client->ctx));
+		client->ctx_no = proc->ctx_no;
+	}
+
+	client->sum = sum;
+	client->changed = clients->scan;
+	return 0;
+}
+
+static int
+gtop_client_cmp(const void *a, const void *b)
+{
+	const struct gtop_client *ca = a;
+	const struct gtop_client *cb = b;
+
+	return ca->pid < cb->pid ? -1 : (ca->pid > cb->pid);
+}
+
+int
+gtop_clients_update(struct gtop_clients *clients, const struct debugfs_client *list,
+		    const struct debugfs_database *db, const char *ignore,
+		    uint64_t now)
+{
+	const struct debugfs_client *entry;
+	uint64_t nr_events = clients->nr_events;
+	uint32_t nr = clients->nr;
+	uint32_t i, kept = 0;
+
+	clients->scan++;
+
+	for (entry = list; entry != NULL; entry = entry->next) {
+		struct gtop_client *client;
+
+		if (ignore && !strncmp(entry->name, ignore, strlen(ignore)))
+			continue;
+
+		/* only look among the ones we had, not the ones just added */
+		client = gtop_clients_search(clients, nr, entry->pid);
+
+		/* a pid re-used by another program is an exit and an arrival */
+		if (client && strncmp(client->name, entry->name, sizeof(client->name) - 1)) {
+			gtop_clients_event_add(clients, GTOP_CLIENT_EXITED, client, now);
+			client->seen = 0;
+			client = NULL;
+		}
+
+		if (!client) {
+			if (clients->nr == clients->size) {
+				uint32_t size = clients->size ? clients->size * 2 : 16;
+				struct gtop_client *c;
+
+				c = realloc(clients->clients, size * sizeof(*c));
+				if (!c)
+					return -1;
+
+				clients->clients = c;
+				clients->size = size;
+			}
+
+			client = &clients->clients[clients->nr++];
+			memset(client, 0, sizeof(*client));
+
+			client->pid = entry->pid;
+			strncpy(client->name, entry->name, sizeof(client->name) - 1);
+			client->arrived = now;
+			client->changed = clients->scan;
+
+			gtop_clients_event_add(clients, GTOP_CLIENT_ARRIVED, client, now);
+		}
+
+		client->seen = clients->scan;
+		if (gtop_clients_refresh(clients, client, db) < 0)
+			return -1;
+	}
+
+	/* whoever wasn't listed exited */
+	for (i = 0; i < clients->nr; i++) {
+		struct gtop_client *client = &clients->clients[i];
+
+		if (client->seen != clients->scan) {
+			/* pid re-used: its exit has been told already */
+			if (client->seen)
+				gtop_clients_event_add(clients, GTOP_CLIENT_EXITED, client, now);
+			free(client->ctx);
+			continue;
+		}
+
+		if (kept != i)
+			clients->clients[kept] = *client;
+		kept++;
+	}
+	clients->nr = kept;
+
+	if (clients->nr_events != nr_events)
+		qsort(clients->clients, clients->nr, sizeof(*clients->clients),
+		      gtop_client_cmp);
+
+	return clients->nr_events - nr_events;
+}
+
+struct gtop_client *
+gtop_clients_find(const struct gtop_clients *clients, uint32_t pid)
+{
+	return gtop_clients_search(clients, clients->nr, pid);
+}
+
+void
+gtop_clients_fini(struct gtop_clients *clients)
+{
+	for (uint32_t i = 0; i < clients->nr; i++)
+		free(clients->clients[i].ctx);
+	free(clients->clients);
+
+	memset(clients, 0, sizeof(*clients));
+}
+
+const struct gtop_record_client_event *
+gtop_clients_event(const struct gtop_clients *clients, uint64_t seq,
+		   uint64_t *timestamp)
+{
+	uint32_t i = seq % GTOP_CLIENTS_EVENTS;
+
+	if (seq >= clients->nr_events ||
+	    clients->nr_events - seq > GTOP_CLIENTS_EVENTS)
+		return NULL;
+
+	if (timestamp)
+		*timestamp = clients->event_time[i];
+	return &clients->events[i];
+}
@@ -0,0 +1,169 @@
+/*
+ * Copyright NXP 2017
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sub license,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#ifndef __GPUTOP_CLIENTS_H
+#define __GPUTOP_CLIENTS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <sys/types.h>
+
+#include "debugfs.h"
+#include "record.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* client events kept for whoever hasn't seen them yet */
+#define GTOP_CLIENTS_EVENTS		64
+
+/*
+ * scans after which what we know of a client is queried again, even if its
+ * database entry didn't change
+ */
+#define GTOP_CLIENTS_REQUERY		10
+
+/**
+ * gtop_client:
+ *
+ * A client as tracked across scans. Memory and vidmem are what was last
+ * queried, at scan mem_scan and vid_mem_scan; see gtop_client_stale().
+ * While a query is still running, the pending flag is set and what we
+ * have is older than wanted.
+ */
+struct gtop_client {
+	uint32_t pid;
+	char name[GTOP_RECORD_CLIENT_NAME_LEN];
+
+	/* CLOCK_MONOTONIC (ns) of the scan that found it */
+	uint64_t arrived;
+	/* last scan it was listed in */
+	uint64_t seen;
+	/* last scan it arrived, or its database entry changed */
+	uint64_t changed;
+	/* of its database entry */
+	uint32_t sum;
+
+	uint32_t *ctx;
+	uint32_t ctx_no;
+	uint32_t ctx_size;
+
+	struct gtop_record_client mem;
+	uint64_t mem_scan;
+	bool mem_pending;
+
+	struct debugfs_vid_mem_client vid_mem;
+	uint64_t vid_mem_scan;
+	bool vid_mem_pending;
+};
+
+/**
+ * gtop_clients:
+ *
+ * Clients of the GPU, kept between scans and sorted by pid. Each scan is
+ * diffed against the previous one: clients that weren't there are
+ * arrivals, clients no longer there exits. Events are numbered from 0, the
+ * last GTOP_CLIENTS_EVENTS are kept.
+ */
+struct gtop_clients {
+	struct gtop_client *clients;
+	uint32_t nr;
+	uint32_t size;
+
+	/* scans done, the first one is 1 */
+	uint64_t scan;
+
+	struct gtop_record_client_event events[GTOP_CLIENTS_EVENTS];
+	uint64_t event_time[GTOP_CLIENTS_EVENTS];
+	uint64_t nr_events;
+};
+
+/**
+ * gtop_clients_update:
+ *
+ * Diff the clients list just read (and the database, for contexts) against
+ * what clients had. Clients whose name starts with ignore aren't tracked.
+ * Returns the number of events it added, -1 if we ran out of memory.
+ */
+int
+gtop_clients_update(struct gtop_clients *clients, const struct debugfs_client *list,
+		    const struct debugfs_database *db, const char *ignore,
+		    uint64_t now);
+
+/**
+ * gtop_clients_keep:
+ *
+ * Count a scan without reading anything, when nothing could have changed:
+ * clients stay as they are, what was queried of them keeps getting older.
+ */
+static inline void
+gtop_clients_keep(struct gtop_clients *clients)
+{
+	clients->scan++;
+}
+
+/**
+ * gtop_clients_find:
+ *
+ * The client with pid, NULL if there's none.
+ */
+struct gtop_client *
+gtop_clients_find(const struct gtop_clients *clients, uint32_t pid);
+
+/**
+ * gtop_clients_fini:
+ *
+ * Free all memory held by clients.
+ */
+void
+gtop_clients_fini(struct gtop_clients *clients);
+
+/**
+ * gtop_client_stale:
+ *
+ * Whether what was queried at scan needs to be queried again: it never
+ * was, or the client changed since, or it is too old.
+ */
+static inline bool
+gtop_client_stale(const struct gtop_clients *clients,
+		  const struct gtop_client *client, uint64_t scan)
+{
+	return scan == 0 || scan < client->changed ||
+		clients->scan - scan >= GTOP_CLIENTS_REQUERY;
+}
+
+/**
+ * gtop_clients_event:
+ *
+ * Event seq and its timestamp, NULL if it hasn't happened yet or has been
+ * dropped already.
+ */
+const struct gtop_record_client_event *
+gtop_clients_event(const struct gtop_clients *clients, uint64_t seq,
+		   uint64_t *timestamp);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __GPUTOP_CLIENTS_H */
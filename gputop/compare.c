@@ -0,0 +1,355 @@
+/*
+ * Copyright NXP 2017
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sub license,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <math.h>
+
+#include "compare.h"
+#include "json.h"
+#include "util.h"
+
+#define GTOP_COMPARE_DEFAULT_CONFIDENCE	95
+
+/* what is compared, in that order */
+static const struct {
+	const char *title;
+	const char *unit;
+	uint32_t from;
+	uint32_t to;
+} gtop_compare_groups[] = {
+	{ "Occupancy", "%", GTOP_METRIC_CORES, GTOP_METRIC_DMA_STATES },
+	{ "DMA states", "%", GTOP_METRIC_DMA_STATES, GTOP_METRIC_DDR },
+	{ "DDR", "MB/s", GTOP_METRIC_DDR, GTOP_METRIC_COUNTERS(0) },
+	{ "Counters", "/s", GTOP_METRIC_COUNTERS(0), GTOP_METRIC_SCALARS },
+};
+
+/*
+ * inverse of the standard normal CDF, Acklam's rational approximation
+ */
+static double
+gtop_compare_z(double p)
+{
+	static const double a[] = {
+		-3.969683028665376e+01, 2.209460984245205e+02, -2.759285104469687e+02,
+		1.383577518672690e+02, -3.066479806614716e+01, 2.506628277459239e+00,
+	};
+	static const double b[] = {
+		-5.447609879822406e+01, 1.615858368580409e+02, -1.556989798598866e+02,
+		6.680131188771972e+01, -1.328068155288572e+01,
+	};
+	static const double c[] = {
+		-7.784894002430293e-03, -3.223964580411365e-01, -2.400758277161838e+00,
+		-2.549732539343734e+00, 4.374664141464968e+00, 2.938163982698783e+00,
+	};
+	static const double d[] = {
+		7.784695709041462e-03, 3.224671290700398e-01, 2.445134137142996e+00,
+		3.754408661907416e+00,
+	};
+	double q, r;
+
+	if (p < 0.02425) {
+		q = sqrt(-2 * log(p));
+		return (((((c[0] * q + c[1]) * q + c[2]) * q + c[3]) * q + c[4]) * q + c[5]) /
+			((((d[0] * q + d[1]) * q + d[2]) * q + d[3]) * q + 1);
+	}
+
+	if (p > 1 - 0.02425)
+		return -gtop_compare_z(1 - p);
+
+	q = p - 0.5;
+	r = q * q;
+	return (((((a[0] * r + a[1]) * r + a[2]) * r + a[3]) * r + a[4]) * r + a[5]) * q /
+		(((((b[0] * r + b[1]) * r + b[2]) * r + b[3]) * r + b[4]) * r + 1);
+}
+
+/*
+ * two-sided critical value of Student's t with df degrees of freedom,
+ * Cornish-Fisher expansion around the normal one
+ */
+static double
+gtop_compare_t(double confidence, double df)
+{
+	double z = gtop_compare_z(1 - (1 - confidence) / 2);
+	double z3 = z * z * z, z5 = z3 * z * z;
+
+	return z + (z3 + z) / (4 * df) + (5 * z5 + 16 * z3 + 3 * z) / (96 * df * df);
+}
+
+double
+gtop_compare_mean(const struct gtop_report *report, uint32_t m)
+{
+	/* what they amounted to, over the time they were sampled */
+	if (m >= GTOP_METRIC_DDR && m < GTOP_METRIC_SCALARS)
+		return gtop_report_rate(report, m);
+
+	return gtop_report_mean(&report->metrics[m]);
+}
+
+/*
+ * more load, bandwidth or events for the same work is worse, except for
+ * the time DMA engines spend idle
+ */
+static bool
+gtop_compare_higher_is_better(uint32_t m, const char *name)
+{
+	static const char idle[] = "/IDLE";
+	size_t len = strlen(name);
+
+	return m >= GTOP_METRIC_DMA_STATES && m < GTOP_METRIC_DDR &&
+		len >= sizeof(idle) - 1 && !strcmp(name + len - (sizeof(idle) - 1), idle);
+}
+
+int
+gtop_compare_metric(const struct gtop_report *a, const struct gtop_report *b,
+		    uint32_t m, double confidence, struct gtop_compare *cmp)
+{
+	const struct gtop_report_metric *ma = &a->metrics[m], *mb;
+	char name[GTOP_METRIC_NAME_LEN];
+	double na, nb, va, vb, se, df, t;
+	int idx;
+
+	if (!gtop_snapshot_metric_name(&a->names, m, name, sizeof(name)))
+		return -1;
+
+	idx = gtop_snapshot_metric_find(&b->names, name);
+	if (idx < 0)
+		return -1;
+	mb = &b->metrics[idx];
+
+	if (ma->count < 2 || mb->count < 2)
+		return -1;
+
+	cmp->a = gtop_compare_mean(a, m);
+	cmp->b = gtop_compare_mean(b, idx);
+	cmp->diff = cmp->b - cmp->a;
+	cmp->change = cmp->a ? 100.0 * cmp->diff / fabs(cmp->a) : NAN;
+
+	/*
+	 * the spread is that of the values of each interval; rates weigh as
+	 * much as their interval, as they do in the rate compared
+	 */
+	if (m >= GTOP_METRIC_DDR && m < GTOP_METRIC_SCALARS) {
+		na = gtop_report_rate_count(a, m);
+		nb = gtop_report_rate_count(b, idx);
+		va = pow(gtop_report_rate_stddev(a, m), 2) / na;
+		vb = pow(gtop_report_rate_stddev(b, idx), 2) / nb;
+	} else {
+		na = ma->count;
+		nb = mb->count;
+		va = pow(gtop_report_stddev(ma), 2) / na;
+		vb = pow(gtop_report_stddev(mb), 2) / nb;
+	}
+	if (isnan(va) || isnan(vb))
+		return -1;
+	se = sqrt(va + vb);
+
+	/* Welch-Satterthwaite */
+	if (se > 0) {
+		df = (va + vb) * (va + vb) /
+			(va * va / (na - 1) + vb * vb / (nb - 1));
+		t = gtop_compare_t(confidence, df);
+	} else {
+		t = 0;
+	}
+
+	cmp->low = cmp->diff - t * se;
+	cmp->high = cmp->diff + t * se;
+	cmp->significant = cmp->low > 0 || cmp->high < 0;
+	cmp->worse = cmp->significant &&
+		(cmp->diff > 0) != gtop_compare_higher_is_better(m, name);
+
+	return 0;
+}
+
+static const char *
+gtop_compare_verdict(const struct gtop_compare *cmp)
+{
+	if (!cmp->significant)
+		return "same";
+
+	return cmp->worse ? "worse" : "better";
+}
+
+static void
+gtop_compare_print_text(const struct gtop_report *a, const struct gtop_report *b,
+			double confidence, bool all)
+{
+	char name[GTOP_METRIC_NAME_LEN];
+	struct gtop_compare cmp;
+	uint32_t g, m, nr[2] = { 0, 0 };
+
+	for (g = 0; g < ARRAY_SIZE(gtop_compare_groups); g++) {
+		bool header = false;
+
+		for (m = gtop_compare_groups[g].from; m < gtop_compare_groups[g].to; m++) {
+			if (gtop_compare_metric(a, b, m, confidence, &cmp) < 0)
+				continue;
+			if (cmp.significant)
+				nr[cmp.worse]++;
+			if (!all && !cmp.significant)
+				continue;
+
+			if (!header) {
+				fprintf(stdout, "\n%s (%s)\n", gtop_compare_groups[g].title,
+					gtop_compare_groups[g].unit);
+				fprintf(stdout, " %-39s %12s %12s %12s %12s %8s %6s\n", "",
+					"A", "B", "diff", "+/-", "change", "");
+				header = true;
+			}
+
+			gtop_snapshot_metric_name(&a->names, m, name, sizeof(name));
+			fprintf(stdout, " %-39.39s %12.2f %12.2f %12.2f %12.2f %7.1f%% %6s\n",
+				name, cmp.a, cmp.b, cmp.diff, (cmp.high - cmp.low) / 2,
+				cmp.change, gtop_compare_verdict(&cmp));
+		}
+	}
+
+	fprintf(stdout, "\n%u worse, %u better at %.0f%% confidence\n",
+		nr[1], nr[0], confidence * 100);
+}
+
+static void
+gtop_compare_print_json(const struct gtop_report *a, const struct gtop_report *b,
+			const char *path_a, const char *path_b,
+			double confidence, bool all)
+{
+	char name[GTOP_METRIC_NAME_LEN];
+	struct gtop_compare cmp;
+	uint32_t g, m, nr[2] = { 0, 0 };
+	bool first = true;
+
+	fprintf(stdout, "{\n  \"a\": ");
+	gtop_json_string(stdout, path_a);
+	fprintf(stdout, ",\n  \"b\": ");
+	gtop_json_string(stdout, path_b);
+	fprintf(stdout, ",\n  \"confidence\": ");
+	gtop_json_number(stdout, confidence);
+	fprintf(stdout, ",\n  \"metrics\": {");
+
+	for (g = 0; g < ARRAY_SIZE(gtop_compare_groups); g++) {
+		for (m = gtop_compare_groups[g].from; m < gtop_compare_groups[g].to; m++) {
+			if (gtop_compare_metric(a, b, m, confidence, &cmp) < 0)
+				continue;
+			if (cmp.significant)
+				nr[cmp.worse]++;
+			if (!all && !cmp.significant)
+				continue;
+
+			gtop_snapshot_metric_name(&a->names, m, name, sizeof(name));
+			fprintf(stdout, "%s\n    ", first ? "" : ",");
+			first = false;
+
+			gtop_json_string(stdout, name);
+			fprintf(stdout, ": { \"a\": ");
+			gtop_json_number(stdout, cmp.a);
+			fprintf(stdout, ", \"b\": ");
+			gtop_json_number(stdout, cmp.b);
+			fprintf(stdout, ", \"diff\": ");
+			gtop_json_number(stdout, cmp.diff);
+			fprintf(stdout, ", \"low\": ");
+			gtop_json_number(stdout, cmp.low);
+			fprintf(stdout, ", \"high\": ");
+			gtop_json_number(stdout, cmp.high);
+			fprintf(stdout, ", \"change\": ");
+			gtop_json_number(stdout, cmp.change);
+			fprintf(stdout, ", \"unit\": ");
+			gtop_json_string(stdout, gtop_compare_groups[g].unit);
+			fprintf(stdout, ", \"verdict\": \"%s\" }", gtop_compare_verdict(&cmp));
+		}
+	}
+
+	fprintf(stdout, "\n  },\n  \"worse\": %u,\n  \"better\": %u\n}\n", nr[1], nr[0]);
+}
+
+static void
+gtop_compare_usage(void)
+{
+	fprintf(stderr, "Usage: gputop compare [-j jobs] [-c confidence] [-a] [-J] <a> <b>\n");
+	fprintf(stderr, "  -j <jobs>     Threads to read each recording with\n");
+	fprintf(stderr, "  -c <percent>  Confidence of the intervals (default %u)\n",
+		GTOP_COMPARE_DEFAULT_CONFIDENCE);
+	fprintf(stderr, "  -a            List every metric, not only the ones that moved\n");
+	fprintf(stderr, "  -J            Print JSON instead of text\n");
+}
+
+int
+gtop_compare_main(int argc, char **argv)
+{
+	struct gtop_report a, b;
+	double confidence = GTOP_COMPARE_DEFAULT_CONFIDENCE / 100.0;
+	unsigned int jobs = 0;
+	bool json = false, all = false;
+	int c;
+
+	optind = 1;
+	while ((c = getopt(argc, argv, "j:c:aJh")) != -1) {
+		switch (c) {
+		case 'j':
+			jobs = atoi(optarg);
+			break;
+		case 'c':
+			confidence = atof(optarg) / 100.0;
+			if (confidence <= 0 || confidence >= 1) {
+				fprintf(stderr, "Confidence must be between 0 and 100\n");
+				return EXIT_FAILURE;
+			}
+			break;
+		case 'a':
+			all = true;
+			break;
+		case 'J':
+			json = true;
+			break;
+		case 'h':
+		default:
+			gtop_compare_usage();
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (optind != argc - 2) {
+		gtop_compare_usage();
+		return EXIT_FAILURE;
+	}
+
+	if (gtop_report_build(&a, argv[optind], jobs, 0, UINT64_MAX, 0.0) < 0)
+		return EXIT_FAILURE;
+	if (gtop_report_build(&b, argv[optind + 1], jobs, 0, UINT64_MAX, 0.0) < 0) {
+		gtop_report_fini(&a);
+		return EXIT_FAILURE;
+	}
+
+	if (json)
+		gtop_compare_print_json(&a, &b, argv[optind], argv[optind + 1],
+					confidence, all);
+	else
+		gtop_compare_print_text(&a, &b, confidence, all);
+
+	gtop_report_fini(&a);
+	gtop_report_fini(&b);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,90 @@
+/*
+ * Copyright NXP 2017
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sub license,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#ifndef __GPUTOP_COMPARE_H
+#define __GPUTOP_COMPARE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "report.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * gtop_compare:
+ *
+ * How a metric moved from a to b: means in display units (% for
+ * occupancy and DMA states, MB/s for DDR, events/s for counters), their
+ * difference with its confidence interval and the change in % of a.
+ * Significant when the interval doesn't include 0.
+ */
+struct gtop_compare {
+	double a;
+	double b;
+
+	double diff;
+	double low;
+	double high;
+	double change;
+
+	bool significant;
+	/* significant, and in the direction that costs more */
+	bool worse;
+};
+
+/**
+ * gtop_compare_mean:
+ *
+ * What metric m is compared by: its mean, or for DDR and counters the rate
+ * over the whole report, see gtop_report_rate().
+ */
+double
+gtop_compare_mean(const struct gtop_report *report, uint32_t m);
+
+/**
+ * gtop_compare_metric:
+ *
+ * Compare metric m of a with the metric of the same name in b, at the
+ * given confidence (e.g. 0.95). Welch's t-test: samples are taken as
+ * independent, which back to back intervals nearly are. Returns -1 if b
+ * doesn't have it or either has fewer than 2 samples.
+ */
+int
+gtop_compare_metric(const struct gtop_report *a, const struct gtop_report *b,
+		    uint32_t m, double confidence, struct gtop_compare *cmp);
+
+/**
+ * gtop_compare_main:
+ *
+ * `gputop compare`, which metrics moved between two recordings.
+ */
+int
+gtop_compare_main(int argc, char **argv);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __GPUTOP_COMPARE_H */
@@ -0,0 +1,321 @@
+/*
+ * Copyright NXP 2017
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sub license,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "correlate.h"
+
+#define N	GTOP_CORRELATE_MAX_METRICS
+
+struct gtop_correlate {
+	/* slot of each metric, -1 if not tracked, and the reverse */
+	int16_t slots[GTOP_METRIC_NR];
+	uint32_t metrics[N];
+	uint32_t nr;
+
+	uint32_t samples;
+	double mean[N];
+	/* deviations from the mean before and after the last update */
+	double before[N];
+	double after[N];
+	/* upper triangle of the co-moments, rows of N */
+	double *comoment;
+
+	/* last snapshots, for ranks */
+	float window[GTOP_CORRELATE_WINDOW][N];
+	uint32_t head;
+	uint32_t nr_window;
+
+	/* scratch for ranks */
+	uint32_t order[GTOP_CORRELATE_WINDOW];
+	double ranks[2][GTOP_CORRELATE_WINDOW];
+};
+
+/* occupancy, and DDR and counters, which are rates */
+static bool
+gtop_correlate_tracked(uint32_t m)
+{
+	return (m >= GTOP_METRIC_MODULES && m < GTOP_METRIC_DMA_STATES) ||
+		(m >= GTOP_METRIC_DDR && m < GTOP_METRIC_SCALARS);
+}
+
+static void
+gtop_correlate_reset(struct gtop_correlate *correlate, const float *values)
+{
+	uint32_t m;
+
+	correlate->nr = 0;
+	for (m = 0; m < GTOP_METRIC_NR; m++) {
+		correlate->slots[m] = -1;
+		if (!gtop_correlate_tracked(m) || isnan(values[m]))
+			continue;
+		correlate->slots[m] = correlate->nr;
+		correlate->metrics[correlate->nr++] = m;
+	}
+
+	correlate->samples = 0;
+	correlate->head = 0;
+	correlate->nr_window = 0;
+	memset(correlate->mean, 0, sizeof(correlate->mean));
+	memset(correlate->comoment, 0, N * N * sizeof(double));
+}
+
+static bool
+gtop_correlate_same(const struct gtop_correlate *correlate, const float *values)
+{
+	uint32_t m;
+
+	for (m = 0; m < GTOP_METRIC_NR; m++)
+		if (gtop_correlate_tracked(m) &&
+		    (correlate->slots[m] < 0) != (isnan(values[m]) != 0))
+			return false;
+
+	return true;
+}
+
+/* the hot loop, kept apart so the compiler can vectorize it */
+static void
+gtop_correlate_row(double *restrict row, double scale,
+		   const double *restrict after, uint32_t n)
+{
+	uint32_t j;
+
+	for (j = 0; j < n; j++)
+		row[j] += scale * after[j];
+}
+
+struct gtop_correlate *
+gtop_correlate_create(void)
+{
+	struct gtop_correlate *correlate = calloc(1, sizeof(*correlate));
+	uint32_t m;
+
+	if (!correlate)
+		return NULL;
+
+	correlate->comoment = calloc(N * N, sizeof(double));
+	if (!correlate->comoment) {
+		free(correlate);
+		return NULL;
+	}
+
+	for (m = 0; m < GTOP_METRIC_NR; m++)
+		correlate->slots[m] = -1;
+
+	return correlate;
+}
+
+void
+gtop_correlate_destroy(struct gtop_correlate *correlate)
+{
+	if (!correlate)
+		return;
+
+	free(correlate->comoment);
+	free(correlate);
+}
+
+void
+gtop_correlate_add(struct gtop_correlate *correlate,
+		   const struct gtop_snapshot *snap)
+{
+	float values[GTOP_METRIC_NR];
+	uint32_t i, n;
+	float *x;
+
+	if (!snap->interval)
+		return;
+
+	gtop_snapshot_metrics(snap, values);
+	if (!correlate->samples || !gtop_correlate_same(correlate, values))
+		gtop_correlate_reset(correlate, values);
+
+	/* a reset rewinds the window */
+	x = correlate->window[correlate->head];
+	n = correlate->nr;
+	for (i = 0; i < n; i++) {
+		uint32_t m = correlate->metrics[i];
+
+		x[i] = values[m];
+	}
+
+	/* Welford, generalized to co-moments */
+	correlate->samples++;
+	for (i = 0; i < n; i++) {
+		correlate->before[i] = x[i] - correlate->mean[i];
+		correlate->mean[i] += correlate->before[i] / correlate->samples;
+		correlate->after[i] = x[i] - correlate->mean[i];
+	}
+	for (i = 0; i < n; i++)
+		gtop_correlate_row(&correlate->comoment[i * N + i], correlate->before[i],
+				   &correlate->after[i], n - i);
+
+	correlate->head = (correlate->head + 1) % GTOP_CORRELATE_WINDOW;
+	if (correlate->nr_window < GTOP_CORRELATE_WINDOW)
+		correlate->nr_window++;
+}
+
+uint32_t
+gtop_correlate_samples(const struct gtop_correlate *correlate)
+{
+	return correlate->samples;
+}
+
+static double
+gtop_correlate_slots(const struct gtop_correlate *correlate, uint32_t i, uint32_t j)
+{
+	const double *c = correlate->comoment;
+	double den;
+
+	if (i > j) {
+		uint32_t t = i;
+
+		i = j;
+		j = t;
+	}
+
+	den = c[i * N + i] * c[j * N + j];
+	if (correlate->samples < 3 || den <= 0.0)
+		return NAN;
+
+	return c[i * N + j] / sqrt(den);
+}
+
+double
+gtop_correlate_pearson(const struct gtop_correlate *correlate, uint32_t a,
+		       uint32_t b)
+{
+	if (a >= GTOP_METRIC_NR || b >= GTOP_METRIC_NR ||
+	    correlate->slots[a] < 0 || correlate->slots[b] < 0)
+		return NAN;
+
+	return gtop_correlate_slots(correlate, correlate->slots[a], correlate->slots[b]);
+}
+
+static const struct gtop_correlate *gtop_correlate_sorting;
+static uint32_t gtop_correlate_sorting_slot;
+
+static int
+gtop_correlate_cmp(const void *a, const void *b)
+{
+	const struct gtop_correlate *c = gtop_correlate_sorting;
+	float x = c->window[*(const uint32_t *) a][gtop_correlate_sorting_slot];
+	float y = c->window[*(const uint32_t *) b][gtop_correlate_sorting_slot];
+
+	return x < y ? -1 : x > y;
+}
+
+/* ranks of a slot over the window, ties get the mean of theirs */
+static void
+gtop_correlate_rank(struct gtop_correlate *correlate, uint32_t slot, double *ranks)
+{
+	uint32_t i, j, n = correlate->nr_window;
+
+	for (i = 0; i < n; i++)
+		correlate->order[i] = i;
+
+	gtop_correlate_sorting = correlate;
+	gtop_correlate_sorting_slot = slot;
+	qsort(correlate->order, n, sizeof(correlate->order[0]), gtop_correlate_cmp);
+
+	for (i = 0; i < n; i = j) {
+		float value = correlate->window[correlate->order[i]][slot];
+
+		double rank;
+
+		for (j = i + 1; j < n && correlate->window[correlate->order[j]][slot] == value; j++)
+			;
+		/* positions i to j - 1, ranks i + 1 to j */
+		rank = (i + 1 + j) / 2.0;
+		while (i < j)
+			ranks[correlate->order[i++]] = rank;
+	}
+}
+
+double
+gtop_correlate_spearman(struct gtop_correlate *correlate, uint32_t a,
+			uint32_t b)
+{
+	double *ra = correlate->ranks[0], *rb = correlate->ranks[1];
+	double mean, sab = 0.0, saa = 0.0, sbb = 0.0;
+	uint32_t i, n = correlate->nr_window;
+
+	if (a >= GTOP_METRIC_NR || b >= GTOP_METRIC_NR ||
+	    correlate->slots[a] < 0 || correlate->slots[b] < 0 || n < 3)
+		return NAN;
+
+	gtop_correlate_rank(correlate, correlate->slots[a], ra);
+	gtop_correlate_rank(correlate, correlate->slots[b], rb);
+
+	mean = (n + 1) / 2.0;
+	for (i = 0; i < n; i++) {
+		sab += (ra[i] - mean) * (rb[i] - mean);
+		saa += (ra[i] - mean) * (ra[i] - mean);
+		sbb += (rb[i] - mean) * (rb[i] - mean);
+	}
+
+	if (saa <= 0.0 || sbb <= 0.0)
+		return NAN;
+
+	return sab / sqrt(saa * sbb);
+}
+
+uint32_t
+gtop_correlate_top(const struct gtop_correlate *correlate, uint32_t metric,
+		   uint32_t *metrics, double *r, uint32_t max)
+{
+	uint32_t i, k, n = 0;
+	int slot;
+
+	if (metric >= GTOP_METRIC_NR || (slot = correlate->slots[metric]) < 0)
+		return 0;
+
+	for (i = 0; i < correlate->nr; i++) {
+		uint32_t m = correlate->metrics[i];
+		double value;
+
+		if (m >= GTOP_METRIC_DDR && m < GTOP_METRIC_COUNTERS(0))
+			continue;
+
+		value = gtop_correlate_slots(correlate, slot, i);
+		if (isnan(value))
+			continue;
+
+		/* insertion into the max strongest so far */
+		for (k = n; k > 0 && fabs(r[k - 1]) < fabs(value); k--) {
+			if (k < max) {
+				metrics[k] = metrics[k - 1];
+				r[k] = r[k - 1];
+			}
+		}
+		if (k < max) {
+			metrics[k] = m;
+			r[k] = value;
+			if (n < max)
+				n++;
+		}
+	}
+
+	return n;
+}
@@ -0,0 +1,108 @@
+/*
+ * Copyright NXP 2017
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sub license,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#ifndef __GPUTOP_CORRELATE_H
+#define __GPUTOP_CORRELATE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "snapshot.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Correlation between the module occupancy, the counter rates of both parts
+ * and the DDR bandwidth, one value of each per snapshot. Pearson's r is
+ * kept for every pair since the metrics sampled last changed, by updating
+ * their co-moments on each snapshot: O(metrics^2), a row at a time.
+ * Spearman's rho needs ranks, so it is computed on demand over the last
+ * GTOP_CORRELATE_WINDOW snapshots.
+ */
+#define GTOP_CORRELATE_MAX_METRICS	(GTOP_SNAPSHOT_MAX_MODULES + \
+					 GTOP_SNAPSHOT_MAX_DDR + \
+					 2 * GTOP_SNAPSHOT_MAX_COUNTERS)
+#define GTOP_CORRELATE_WINDOW		128
+
+struct gtop_correlate;
+
+struct gtop_correlate *
+gtop_correlate_create(void);
+
+void
+gtop_correlate_destroy(struct gtop_correlate *correlate);
+
+/**
+ * gtop_correlate_add:
+ *
+ * Account for a snapshot. When it doesn't have the same metrics as the
+ * previous ones everything starts over.
+ */
+void
+gtop_correlate_add(struct gtop_correlate *correlate,
+		   const struct gtop_snapshot *snap);
+
+/**
+ * gtop_correlate_samples:
+ *
+ * How many snapshots the correlations are over.
+ */
+uint32_t
+gtop_correlate_samples(const struct gtop_correlate *correlate);
+
+/**
+ * gtop_correlate_pearson:
+ *
+ * Pearson's r between two metrics (ids as in snapshot.h), NaN if either
+ * isn't tracked or didn't move.
+ */
+double
+gtop_correlate_pearson(const struct gtop_correlate *correlate, uint32_t a,
+		       uint32_t b);
+
+/**
+ * gtop_correlate_spearman:
+ *
+ * Spearman's rho between two metrics over the last GTOP_CORRELATE_WINDOW
+ * snapshots.
+ */
+double
+gtop_correlate_spearman(struct gtop_correlate *correlate, uint32_t a,
+			uint32_t b);
+
+/**
+ * gtop_correlate_top:
+ *
+ * Up to max metrics most correlated (by |r|) with metric, strongest first,
+ * and their r. DDR bandwidth isn't matched against itself. Returns how many.
+ */
+uint32_t
+gtop_correlate_top(const struct gtop_correlate *correlate, uint32_t metric,
+		   uint32_t *metrics, double *r, uint32_t max);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __GPUTOP_CORRELATE_H */
@@ -0,0 +1,665 @@
+/*
+ * Copyright NXP 2017
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sub license,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/file.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "daemon.h"
+#include "sockpath.h"
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL	0
+#endif
+
+#define GTOP_DAEMON_MAX(a, b)	((a) > (b) ? (a) : (b))
+
+#define GTOP_DAEMON_OUT_SIZE \
+	(sizeof(struct gtop_daemon_msg) + \
+	 GTOP_DAEMON_MAX(sizeof(struct gtop_snapshot_names), sizeof(struct gtop_daemon_history)))
+
+#define GTOP_DAEMON_IN_SIZE \
+	(sizeof(struct gtop_daemon_msg) + \
+	 GTOP_DAEMON_MAX(sizeof(struct gtop_daemon_subscribe), \
+			 sizeof(struct gtop_daemon_history_query)))
+
+struct gtop_daemon_client {
+	int fd;
+
+	/* subscription */
+	bool subscribed;
+	uint32_t streams;
+	uint64_t interval;
+	uint64_t last_sent;
+
+	/* requests being read */
+	char in[GTOP_DAEMON_IN_SIZE];
+	size_t in_len;
+
+	/* history asked for, answered before the next snapshot */
+	bool query_pending;
+	uint64_t query_span;
+
+	/* message being written, and how much of it went out already */
+	char *out;
+	size_t out_len;
+	size_t out_off;
+
+	/* latest snapshot that came in while out was still busy */
+	bool pending;
+	struct gtop_snapshot next;
+	uint64_t dropped;
+};
+
+struct gtop_daemon {
+	int fd;
+	char *path;
+
+	bool has_names;
+	struct gtop_snapshot_names names;
+
+	/* NULL without -H */
+	const struct gtop_history *history;
+
+	struct gtop_daemon_client clients[GTOP_DAEMON_MAX_CLIENTS];
+};
+
+static uint64_t
+gtop_daemon_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int
+gtop_daemon_set_nonblock(int fd)
+{
+	int fl = fcntl(fd, F_GETFL);
+
+	if (fl < 0)
+		return -1;
+
+	return fcntl(fd, F_SETFL, fl | O_NONBLOCK);
+}
+
+static int
+gtop_daemon_sockaddr(struct sockaddr_un *addr, const char *path)
+{
+	memset(addr, 0, sizeof(*addr));
+	addr->sun_family = AF_UNIX;
+
+	if (strlen(path) >= sizeof(addr->sun_path)) {
+		fprintf(stderr, "Socket path %s too long\n", path);
+		return -1;
+	}
+
+	strcpy(addr->sun_path, path);
+	return 0;
+}
+
+static void
+gtop_daemon_client_close(struct gtop_daemon_client *client)
+{
+	char *out = client->out;
+
+	close(client->fd);
+
+	/* keep the buffer around for the next one using this slot */
+	memset(client, 0, sizeof(*client));
+	client->fd = -1;
+	client->out = out;
+}
+
+static void
+gtop_daemon_client_queue(struct gtop_daemon_client *client, uint32_t type,
+			 const void *payload, size_t size)
+{
+	struct gtop_daemon_msg msg = {
+		.type = type,
+		.size = size,
+		.dropped = client->dropped,
+	};
+
+	memcpy(client->out, &msg, sizeof(msg));
+	memcpy(client->out + sizeof(msg), payload, size);
+
+	client->out_len = sizeof(msg) + size;
+	client->out_off = 0;
+}
+
+static void
+gtop_daemon_client_queue_history(struct gtop_daemon *daemon,
+				 struct gtop_daemon_client *client)
+{
+	struct gtop_daemon_msg msg = {
+		.type = GTOP_DAEMON_MSG_HISTORY,
+		.size = sizeof(struct gtop_daemon_history),
+		.dropped = client->dropped,
+	};
+	struct gtop_daemon_history *answer =
+		(struct gtop_daemon_history *) (client->out + sizeof(msg));
+	uint32_t m;
+
+	memcpy(client->out, &msg, sizeof(msg));
+	memset(answer, 0, sizeof(*answer));
+
+	if (daemon->history) {
+		answer->span = client->query_span;
+		for (m = 0; m < GTOP_METRIC_NR; m++)
+			gtop_history_query(daemon->history, m, client->query_span,
+					   &answer->rollups[m]);
+	}
+
+	client->out_len = sizeof(msg) + msg.size;
+	client->out_off = 0;
+	client->query_pending = false;
+}
+
+static void
+gtop_daemon_client_flush(struct gtop_daemon *daemon, struct gtop_daemon_client *client)
+{
+	while (client->fd >= 0) {
+		while (client->out_off < client->out_len) {
+			ssize_t nr = send(client->fd, client->out + client->out_off,
+					  client->out_len - client->out_off,
+					  MSG_NOSIGNAL | MSG_DONTWAIT);
+			if (nr < 0) {
+				if (errno == EINTR)
+					continue;
+				if (errno != EAGAIN && errno != EWOULDBLOCK)
+					gtop_daemon_client_close(client);
+				return;
+			}
+			client->out_off += nr;
+		}
+
+		client->out_len = client->out_off = 0;
+
+		if (client->query_pending) {
+			gtop_daemon_client_queue_history(daemon, client);
+			continue;
+		}
+
+		if (!client->pending)
+			return;
+
+		client->pending = false;
+		gtop_daemon_client_queue(client, GTOP_DAEMON_MSG_SNAPSHOT,
+					 &client->next, sizeof(client->next));
+	}
+}
+
+static void
+gtop_daemon_client_handle(struct gtop_daemon *daemon, struct gtop_daemon_client *client,
+			  const struct gtop_daemon_msg *msg, const void *payload)
+{
+	struct gtop_daemon_subscribe sub;
+	struct gtop_daemon_history_query query;
+
+	/* subscribing comes first, and only once */
+	if (client->subscribed == (msg->type == GTOP_DAEMON_MSG_SUBSCRIBE)) {
+		gtop_daemon_client_close(client);
+		return;
+	}
+
+	switch (msg->type) {
+	case GTOP_DAEMON_MSG_SUBSCRIBE:
+		memcpy(&sub, payload, sizeof(sub));
+		if (msg->size != sizeof(sub) || sub.magic != GTOP_DAEMON_MAGIC ||
+		    !sub.version || sub.version > GTOP_DAEMON_VERSION) {
+			gtop_daemon_client_close(client);
+			return;
+		}
+
+		client->subscribed = true;
+		client->streams = sub.streams;
+		client->interval = sub.interval * 1000000ULL;
+
+		if (daemon->has_names) {
+			gtop_daemon_client_queue(client, GTOP_DAEMON_MSG_NAMES,
+						 &daemon->names, sizeof(daemon->names));
+			gtop_daemon_client_flush(daemon, client);
+		}
+		break;
+	case GTOP_DAEMON_MSG_HISTORY:
+		if (msg->size != sizeof(query)) {
+			gtop_daemon_client_close(client);
+			return;
+		}
+
+		/* a second one before the first went out replaces it */
+		memcpy(&query, payload, sizeof(query));
+		client->query_span = query.span;
+		client->query_pending = true;
+		if (!client->out_len)
+			gtop_daemon_client_flush(daemon, client);
+		break;
+	default:
+		/* from a newer front-end, nothing we can answer */
+		break;
+	}
+}
+
+static void
+gtop_daemon_client_read(struct gtop_daemon *daemon, struct gtop_daemon_client *client)
+{
+	struct gtop_daemon_msg msg;
+	size_t len;
+	ssize_t nr;
+
+	nr = recv(client->fd, client->in + client->in_len,
+		  sizeof(client->in) - client->in_len, MSG_DONTWAIT);
+	if (nr == 0 || (nr < 0 && errno != EAGAIN && errno != EINTR)) {
+		gtop_daemon_client_close(client);
+		return;
+	}
+	if (nr < 0)
+		return;
+
+	client->in_len += nr;
+
+	/* whole messages only, there may be more than one */
+	while (client->in_len >= sizeof(msg)) {
+		memcpy(&msg, client->in, sizeof(msg));
+		if (msg.size > sizeof(client->in) - sizeof(msg)) {
+			gtop_daemon_client_close(client);
+			return;
+		}
+
+		len = sizeof(msg) + msg.size;
+		if (client->in_len < len)
+			return;
+
+		gtop_daemon_client_handle(daemon, client, &msg, client->in + sizeof(msg));
+		if (client->fd < 0)
+			return;
+
+		client->in_len -= len;
+		memmove(client->in, client->in + len, client->in_len);
+	}
+}
+
+static void
+gtop_daemon_accept(struct gtop_daemon *daemon)
+{
+	struct gtop_daemon_client *client = NULL;
+	size_t i;
+	int fd;
+
+	fd = accept(daemon->fd, NULL, NULL);
+	if (fd < 0)
+		return;
+
+	for (i = 0; i < GTOP_DAEMON_MAX_CLIENTS; i++) {
+		if (daemon->clients[i].fd < 0) {
+			client = &daemon->clients[i];
+			break;
+		}
+	}
+
+	if (!client || gtop_daemon_set_nonblock(fd) < 0) {
+		close(fd);
+		return;
+	}
+
+	if (!client->out) {
+		client->out = malloc(GTOP_DAEMON_OUT_SIZE);
+		if (!client->out) {
+			close(fd);
+			return;
+		}
+	}
+
+	client->fd = fd;
+}
+
+struct gtop_daemon *
+gtop_daemon_create(const char *path)
+{
+	struct gtop_daemon *daemon;
+	struct sockaddr_un addr;
+	size_t i;
+
+	if (gtop_daemon_sockaddr(&addr, path) < 0)
+		return NULL;
+
+	daemon = calloc(1, sizeof(*daemon));
+	if (!daemon)
+		return NULL;
+
+	for (i = 0; i < GTOP_DAEMON_MAX_CLIENTS; i++)
+		daemon->clients[i].fd = -1;
+
+	daemon->fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (daemon->fd < 0) {
+		fprintf(stderr, "Failed to create socket: %s\n", strerror(errno));
+		free(daemon);
+		return NULL;
+	}
+
+	/* a daemon already owns the device, or someone else owns path */
+	if (gtop_sockpath_claim(path, SOCK_STREAM) < 0) {
+		close(daemon->fd);
+		free(daemon);
+		return NULL;
+	}
+
+	if (bind(daemon->fd, (struct sockaddr *) &addr, sizeof(addr)) < 0 ||
+	    listen(daemon->fd, GTOP_DAEMON_MAX_CLIENTS) < 0 ||
+	    gtop_daemon_set_nonblock(daemon->fd) < 0) {
+		fprintf(stderr, "Failed to listen on %s: %s\n", path, strerror(errno));
+		close(daemon->fd);
+		free(daemon);
+		return NULL;
+	}
+
+	daemon->path = strdup(path);
+	return daemon;
+}
+
+void
+gtop_daemon_destroy(struct gtop_daemon *daemon)
+{
+	size_t i;
+
+	if (!daemon)
+		return;
+
+	for (i = 0; i < GTOP_DAEMON_MAX_CLIENTS; i++) {
+		if (daemon->clients[i].fd >= 0)
+			close(daemon->clients[i].fd);
+		free(daemon->clients[i].out);
+	}
+
+	close(daemon->fd);
+	unlink(daemon->path);
+
+	free(daemon->path);
+	free(daemon);
+}
+
+void
+gtop_daemon_set_names(struct gtop_daemon *daemon,
+		      const struct gtop_snapshot_names *names)
+{
+	memcpy(&daemon->names, names, sizeof(*names));
+	daemon->has_names = true;
+}
+
+void
+gtop_daemon_set_history(struct gtop_daemon *daemon,
+			const struct gtop_history *history)
+{
+	daemon->history = history;
+}
+
+void
+gtop_daemon_publish(struct gtop_daemon *daemon, const struct gtop_snapshot *snap)
+{
+	size_t i;
+
+	for (i = 0; i < GTOP_DAEMON_MAX_CLIENTS; i++) {
+		struct gtop_daemon_client *client = &daemon->clients[i];
+		struct gtop_snapshot *dst;
+
+		if (client->fd < 0 || !client->subscribed)
+			continue;
+
+		/* each front-end runs at its own rate */
+		if (client->last_sent &&
+		    snap->timestamp - client->last_sent < client->interval)
+			continue;
+
+		client->last_sent = snap->timestamp;
+
+		if (client->out_len == 0) {
+			gtop_daemon_client_queue(client, GTOP_DAEMON_MSG_SNAPSHOT,
+						 snap, sizeof(*snap));
+			dst = (struct gtop_snapshot *)
+				(client->out + sizeof(struct gtop_daemon_msg));
+		} else {
+			/* too slow, replace whatever has been waiting */
+			if (client->pending)
+				client->dropped++;
+
+			client->pending = true;
+			memcpy(&client->next, snap, sizeof(*snap));
+			dst = &client->next;
+		}
+
+		/* flags saying how to read them go along */
+		dst->valid &= client->streams | GTOP_SNAPSHOT_COUNTER_EVENTS;
+
+		gtop_daemon_client_flush(daemon, client);
+	}
+}
+
+void
+gtop_daemon_poll(struct gtop_daemon *daemon, int timeout)
+{
+	struct pollfd fds[GTOP_DAEMON_MAX_CLIENTS + 1];
+	struct gtop_daemon_client *clients[GTOP_DAEMON_MAX_CLIENTS + 1];
+	uint64_t deadline = gtop_daemon_now() + timeout * 1000000ULL;
+
+	for (;;) {
+		uint64_t now = gtop_daemon_now();
+		nfds_t nfds = 0;
+		size_t i;
+
+		if (now >= deadline)
+			break;
+
+		fds[nfds].fd = daemon->fd;
+		fds[nfds].events = POLLIN;
+		clients[nfds++] = NULL;
+
+		for (i = 0; i < GTOP_DAEMON_MAX_CLIENTS; i++) {
+			struct gtop_daemon_client *client = &daemon->clients[i];
+
+			if (client->fd < 0)
+				continue;
+
+			fds[nfds].fd = client->fd;
+			fds[nfds].events = POLLIN;
+			if (client->out_len)
+				fds[nfds].events |= POLLOUT;
+			clients[nfds++] = client;
+		}
+
+		if (poll(fds, nfds, (deadline - now + 999999) / 1000000) <= 0)
+			continue;
+
+		for (i = 1; i < nfds; i++) {
+			struct gtop_daemon_client *client = clients[i];
+
+			if (fds[i].revents & POLLOUT)
+				gtop_daemon_client_flush(daemon, client);
+
+			if (client->fd >= 0 &&
+			    (fds[i].revents & (POLLIN | POLLHUP | POLLERR)))
+				gtop_daemon_client_read(daemon, client);
+		}
+
+		if (fds[0].revents & POLLIN)
+			gtop_daemon_accept(daemon);
+	}
+}
+
+int
+gtop_daemon_lock(const char *path)
+{
+	char owner[sizeof(((struct sockaddr_un *) 0)->sun_path)];
+	ssize_t len;
+	int fd;
+
+	fd = open(GTOP_DAEMON_LOCK, O_RDWR | O_CREAT | O_NOFOLLOW | O_CLOEXEC, 0644);
+	/* created by another user, a lock is all we need from it */
+	if (fd < 0 && errno == EACCES)
+		fd = open(GTOP_DAEMON_LOCK, O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+	if (fd < 0) {
+		fprintf(stderr, "Failed to open %s: %s\n", GTOP_DAEMON_LOCK, strerror(errno));
+		return -1;
+	}
+
+	if (!flock(fd, (path ? LOCK_EX : LOCK_SH) | LOCK_NB)) {
+		if (path && (ftruncate(fd, 0) < 0 || pwrite(fd, path, strlen(path), 0) < 0))
+			fprintf(stderr, "Failed to write %s: %s\n", GTOP_DAEMON_LOCK,
+				strerror(errno));
+		return fd;
+	}
+
+	if (errno != EWOULDBLOCK) {
+		fprintf(stderr, "Failed to lock %s: %s\n", GTOP_DAEMON_LOCK, strerror(errno));
+		close(fd);
+		return -1;
+	}
+
+	/* only other instances share it: no daemon is running */
+	if (path && !flock(fd, LOCK_SH | LOCK_NB)) {
+		fprintf(stderr, "Another gputop is sampling the device, stop it first\n");
+		close(fd);
+		return -1;
+	}
+
+	len = pread(fd, owner, sizeof(owner) - 1, 0);
+	owner[len > 0 ? len : 0] = '\0';
+	fprintf(stderr, "A gputop daemon owns the device, connect to it with -C %s\n",
+		owner[0] ? owner : "<socket>");
+
+	close(fd);
+	return -1;
+}
+
+int
+gtop_daemon_connect(const char *path, uint32_t streams, uint32_t interval)
+{
+	struct sockaddr_un addr;
+	struct {
+		struct gtop_daemon_msg msg;
+		struct gtop_daemon_subscribe sub;
+	} req;
+	int fd;
+
+	if (gtop_daemon_sockaddr(&addr, path) < 0)
+		return -1;
+
+	fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0)
+		return -1;
+
+	if (connect(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0) {
+		fprintf(stderr, "Failed to connect to %s: %s\n", path, strerror(errno));
+		close(fd);
+		return -1;
+	}
+
+	memset(&req, 0, sizeof(req));
+	req.msg.type = GTOP_DAEMON_MSG_SUBSCRIBE;
+	req.msg.size = sizeof(req.sub);
+	req.sub.magic = GTOP_DAEMON_MAGIC;
+	req.sub.version = GTOP_DAEMON_VERSION;
+	req.sub.streams = streams;
+	req.sub.interval = interval;
+
+	if (send(fd, &req, sizeof(req), MSG_NOSIGNAL) != sizeof(req)) {
+		close(fd);
+		return -1;
+	}
+
+	return fd;
+}
+
+int
+gtop_daemon_query_history(int fd, uint64_t span)
+{
+	struct {
+		struct gtop_daemon_msg msg;
+		struct gtop_daemon_history_query query;
+	} req;
+
+	memset(&req, 0, sizeof(req));
+	req.msg.type = GTOP_DAEMON_MSG_HISTORY;
+	req.msg.size = sizeof(req.query);
+	req.query.span = span;
+
+	if (send(fd, &req, sizeof(req), MSG_NOSIGNAL) != sizeof(req))
+		return -1;
+
+	return 0;
+}
+
+static int
+gtop_daemon_read_full(int fd, void *buf, size_t size)
+{
+	char *p = buf;
+
+	while (size) {
+		/* a signal is a reason to stop as well */
+		ssize_t nr = read(fd, p, size);
+		if (nr <= 0)
+			return -1;
+		p += nr;
+		size -= nr;
+	}
+
+	return 0;
+}
+
+int
+gtop_daemon_recv(int fd, struct gtop_daemon_msg *msg, void *buf, size_t size)
+{
+	size_t len;
+
+	if (gtop_daemon_read_full(fd, msg, sizeof(*msg)) < 0)
+		return -1;
+
+	len = msg->size < size ? msg->size : size;
+	memset(buf, 0, size);
+	if (gtop_daemon_read_full(fd, buf, len) < 0)
+		return -1;
+
+	/* skip whatever a newer daemon sent and we don't know about */
+	while (len < msg->size) {
+		char dummy[256];
+		size_t chunk = msg->size - len;
+
+		if (chunk > sizeof(dummy))
+			chunk = sizeof(dummy);
+		if (gtop_daemon_read_full(fd, dummy, chunk) < 0)
+			return -1;
+		len += chunk;
+	}
+
+	return 0;
+}
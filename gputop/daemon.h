@@ -0,0 +1,205 @@
+/*
+ * Copyright NXP 2017
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sub license,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __GPUTOP_DAEMON_H
+#define __GPUTOP_DAEMON_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "snapshot.h"
+#include "history.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define GTOP_DAEMON_MAGIC	0x44505447	/* "GTPD" */
+#define GTOP_DAEMON_VERSION	2
+
+/* held by every gputop that opens the device, see gtop_daemon_lock() */
+#define GTOP_DAEMON_LOCK	"/tmp/gputop.lock"
+
+/* how many front-ends can subscribe at the same time */
+#define GTOP_DAEMON_MAX_CLIENTS	16
+
+enum gtop_daemon_msg_type {
+	GTOP_DAEMON_MSG_SUBSCRIBE = 1,
+	GTOP_DAEMON_MSG_NAMES,
+	GTOP_DAEMON_MSG_SNAPSHOT,
+	/* since version 2 */
+	GTOP_DAEMON_MSG_HISTORY,
+};
+
+/**
+ * gtop_daemon_msg:
+ *
+ * Every message on the socket starts with this header, followed by size
+ * bytes of payload: struct gtop_daemon_subscribe, struct
+ * gtop_snapshot_names or struct gtop_snapshot, depending on type. A
+ * GTOP_DAEMON_MSG_HISTORY is a struct gtop_daemon_history_query from the
+ * front-end, and a struct gtop_daemon_history back.
+ */
+struct gtop_daemon_msg {
+	uint32_t type;
+	uint32_t size;
+
+	/** snapshots dropped for this subscriber because it was too slow */
+	uint64_t dropped;
+};
+
+/**
+ * gtop_daemon_subscribe:
+ *
+ * Sent by a front-end right after connecting. streams is a mask of enum
+ * gtop_snapshot_valid, interval the minimum time between two snapshots (ms),
+ * 0 for every one the daemon samples.
+ */
+struct gtop_daemon_subscribe {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t streams;
+	uint32_t interval;
+};
+
+/**
+ * gtop_daemon_history_query:
+ *
+ * Sent once subscribed, for statistics of every metric over the last span
+ * ns of the daemon's history (see gtop_history_query()).
+ */
+struct gtop_daemon_history_query {
+	uint64_t span;
+};
+
+/**
+ * gtop_daemon_history:
+ *
+ * The answer: span as asked, 0 if the daemon keeps no history (-H), and a
+ * rollup for each metric, with a count of 0 for those it has nothing of.
+ */
+struct gtop_daemon_history {
+	uint64_t span;
+	struct gtop_rollup rollups[GTOP_METRIC_NR];
+};
+
+struct gtop_daemon;
+
+/**
+ * gtop_daemon_create:
+ *
+ * Listen on a unix domain socket at path.
+ */
+struct gtop_daemon *
+gtop_daemon_create(const char *path);
+
+/**
+ * gtop_daemon_destroy:
+ *
+ * Disconnect all front-ends and remove the socket.
+ */
+void
+gtop_daemon_destroy(struct gtop_daemon *daemon);
+
+/**
+ * gtop_daemon_set_names:
+ *
+ * Names sent to every front-end when it subscribes.
+ */
+void
+gtop_daemon_set_names(struct gtop_daemon *daemon,
+		      const struct gtop_snapshot_names *names);
+
+/**
+ * gtop_daemon_set_history:
+ *
+ * Where history queries are answered from; it must outlive the daemon.
+ */
+void
+gtop_daemon_set_history(struct gtop_daemon *daemon,
+			const struct gtop_history *history);
+
+/**
+ * gtop_daemon_publish:
+ *
+ * Fan out a snapshot to subscribers that are due for one. Never blocks: a
+ * front-end that hasn't drained its previous message only gets the latest
+ * snapshot once it does, the ones in between are dropped and accounted.
+ */
+void
+gtop_daemon_publish(struct gtop_daemon *daemon, const struct gtop_snapshot *snap);
+
+/**
+ * gtop_daemon_poll:
+ *
+ * Accept new front-ends, read their subscriptions and flush pending output
+ * for up to timeout ms. Use this in place of sleeping between intervals.
+ */
+void
+gtop_daemon_poll(struct gtop_daemon *daemon, int timeout);
+
+/**
+ * gtop_daemon_lock:
+ *
+ * Take GTOP_DAEMON_LOCK before opening the device: alone for a daemon
+ * serving on path, shared with the others for any other gputop (path
+ * NULL). A daemon leaves its socket path in the file, so a gputop that
+ * can't have the device can tell where to connect instead. Returns the
+ * fd holding the lock until it's closed, or -1 with the reason printed.
+ */
+int
+gtop_daemon_lock(const char *path);
+
+/**
+ * gtop_daemon_connect:
+ *
+ * Front-end side: connect to the daemon and subscribe. Returns the socket or
+ * -1.
+ */
+int
+gtop_daemon_connect(const char *path, uint32_t streams, uint32_t interval);
+
+/**
+ * gtop_daemon_query_history:
+ *
+ * Front-end side: ask for statistics over the last span ns. The answer
+ * comes as a GTOP_DAEMON_MSG_HISTORY, between snapshots. Returns 0 or -1.
+ */
+int
+gtop_daemon_query_history(int fd, uint64_t span);
+
+/**
+ * gtop_daemon_recv:
+ *
+ * Front-end side: block until the next message arrives. The payload is
+ * copied into buf, truncated to size. Returns 0, or -1 when the daemon went
+ * away or a signal has been received.
+ */
+int
+gtop_daemon_recv(int fd, struct gtop_daemon_msg *msg, void *buf, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __GPUTOP_DAEMON_H */
@@ -0,0 +1,301 @@
+/*
+ * Copyright NXP 2017
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sub license,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "database.h"
+#include "parse.h"
+
+#define DEBUGFS_DATABASE_PROCS_MIN	64
+#define DEBUGFS_DATABASE_CTX_MIN	256
+
+/* FNV-1a */
+#define DEBUGFS_DATABASE_SUM_BASIS	2166136261U
+#define DEBUGFS_DATABASE_SUM_PRIME	16777619U
+
+static uint32_t
+debugfs_database_sum(uint32_t sum, const char *line)
+{
+	while (*line) {
+		sum ^= (unsigned char) *line++;
+		sum *= DEBUGFS_DATABASE_SUM_PRIME;
+	}
+
+	return sum;
+}
+
+static int
+debugfs_database_grow_procs(struct debugfs_database *db)
+{
+	uint32_t size = db->procs_size ? db->procs_size * 2 : DEBUGFS_DATABASE_PROCS_MIN;
+	struct debugfs_db_process *procs;
+
+	procs = realloc(db->procs, size * sizeof(*procs));
+	if (!procs)
+		return -1;
+
+	db->procs = procs;
+	db->procs_size = size;
+	return 0;
+}
+
+static int
+debugfs_database_grow_ctx(struct debugfs_database *db)
+{
+	uint32_t size = db->ctx_size ? db->ctx_size * 2 : DEBUGFS_DATABASE_CTX_MIN;
+	uint32_t *ctx;
+	struct debugfs_db_ctx *by_ctx;
+
+	ctx = realloc(db->ctx, size * sizeof(*ctx));
+	if (!ctx)
+		return -1;
+	db->ctx = ctx;
+
+	by_ctx = realloc(db->by_ctx, size * sizeof(*by_ctx));
+	if (!by_ctx)
+		return -1;
+	db->by_ctx = by_ctx;
+
+	db->ctx_size = size;
+	return 0;
+}
+
+/*
+ * Process: <pid>   <name>
+ */
+static bool
+debugfs_database_parse_process(const char *line, struct debugfs_db_process *proc)
+{
+	const char *str;
+
+	memset(proc, 0, sizeof(*proc));
+
+	if (!(str = gtop_parse_u32(line + 8, &proc->pid)))
+		return false;
+
+	/* a process without a name still owns its contexts */
+	gtop_parse_ident(str, proc->name, sizeof(proc->name));
+	return true;
+}
+
+/*
+ * Context <GPU> <ctx>, with the GPU (0 or 1) not always there
+ */
+static uint32_t
+debugfs_database_parse_context(const char *line)
+{
+	const char *str = gtop_parse_ws(line + 7);
+	uint32_t no = 0;
+
+	if (*str == '0' || *str == '1')
+		str++;
+
+	gtop_parse_hex(str, &no);
+	return no;
+}
+
+static int
+debugfs_database_cmp_pid(const void *a, const void *b)
+{
+	const struct debugfs_db_process *pa = a;
+	const struct debugfs_db_process *pb = b;
+
+	if (pa->pid != pb->pid)
+		return pa->pid < pb->pid ? -1 : 1;
+	return pa->order < pb->order ? -1 : (pa->order > pb->order);
+}
+
+static int
+debugfs_database_cmp_ctx(const void *a, const void *b)
+{
+	const struct debugfs_db_ctx *ca = a;
+	const struct debugfs_db_ctx *cb = b;
+
+	if (ca->ctx != cb->ctx)
+		return ca->ctx < cb->ctx ? -1 : 1;
+	return ca->pid < cb->pid ? -1 : (ca->pid > cb->pid);
+}
+
+/*
+ * sort processes by pid, galcore lists them in the order of its hash table
+ */
+static void
+debugfs_database_index(struct debugfs_database *db)
+{
+	for (uint32_t i = 1; i < db->procs_no; i++) {
+		if (debugfs_database_cmp_pid(&db->procs[i - 1], &db->procs[i]) > 0) {
+			qsort(db->procs, db->procs_no, sizeof(*db->procs),
+			      debugfs_database_cmp_pid);
+			break;
+		}
+	}
+}
+
+/*
+ * the context to pid map, only out of the last entry of each pid
+ */
+static void
+debugfs_database_index_ctx(struct debugfs_database *db)
+{
+	uint32_t nr = 0;
+
+	for (uint32_t i = 0; i < db->procs_no; i++) {
+		const struct debugfs_db_process *proc = &db->procs[i];
+
+		if (i + 1 < db->procs_no && db->procs[i + 1].pid == proc->pid)
+			continue;
+
+		for (uint32_t j = 0; j < proc->ctx_no; j++) {
+			db->by_ctx[nr].ctx = db->ctx[proc->first + j];
+			db->by_ctx[nr].pid = proc->pid;
+			nr++;
+		}
+	}
+
+	qsort(db->by_ctx, nr, sizeof(*db->by_ctx), debugfs_database_cmp_ctx);
+	db->by_ctx_no = nr;
+	db->by_ctx_valid = true;
+}
+
+int
+debugfs_database_parse(struct debugfs_database *db, struct gtop_lines *lines)
+{
+	struct debugfs_db_process *proc = NULL;
+	uint32_t nr_ctx = 0;
+	char *line;
+
+	db->procs_no = 0;
+	db->ctx_no = 0;
+	db->by_ctx_no = 0;
+	db->by_ctx_valid = false;
+
+	while ((line = gtop_lines_next(lines)) != NULL) {
+		if (!strncmp(line, "Process:", 8)) {
+			struct debugfs_db_process entry;
+
+			/* contexts following an entry we can't read go nowhere */
+			proc = NULL;
+			if (!debugfs_database_parse_process(line, &entry))
+				continue;
+
+			if (db->procs_no == db->procs_size &&
+			    debugfs_database_grow_procs(db) < 0)
+				goto err;
+
+			entry.first = nr_ctx;
+			entry.order = db->procs_no;
+			entry.sum = debugfs_database_sum(DEBUGFS_DATABASE_SUM_BASIS, line);
+
+			proc = &db->procs[db->procs_no++];
+			*proc = entry;
+			continue;
+		}
+
+		if (proc)
+			proc->sum = debugfs_database_sum(proc->sum, line);
+
+		if (proc && !strncmp(line, "Context", 7)) {
+			uint32_t no = debugfs_database_parse_context(line);
+
+			if (!no)
+				continue;
+
+			if (nr_ctx == db->ctx_size &&
+			    debugfs_database_grow_ctx(db) < 0)
+				goto err;
+
+			db->ctx[nr_ctx++] = no;
+			proc->ctx_no++;
+		}
+	}
+
+	db->ctx_no = nr_ctx;
+	debugfs_database_index(db);
+	return db->procs_no;
+
+err:
+	db->procs_no = 0;
+	return -1;
+}
+
+void
+debugfs_database_free(struct debugfs_database *db)
+{
+	free(db->procs);
+	free(db->ctx);
+	free(db->by_ctx);
+
+	memset(db, 0, sizeof(*db));
+}
+
+const struct debugfs_db_process *
+debugfs_database_find_pid(const struct debugfs_database *db, uint32_t pid)
+{
+	uint32_t lo = 0, hi = db->procs_no;
+
+	/* first entry past pid, the one before is its last entry */
+	while (lo < hi) {
+		uint32_t mid = lo + (hi - lo) / 2;
+
+		if (db->procs[mid].pid <= pid)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	if (lo == 0 || db->procs[lo - 1].pid != pid)
+		return NULL;
+
+	return &db->procs[lo - 1];
+}
+
+bool
+debugfs_database_find_ctx(struct debugfs_database *db, uint32_t ctx,
+			  uint32_t *pid)
+{
+	uint32_t lo, hi;
+
+	if (!db->by_ctx_valid)
+		debugfs_database_index_ctx(db);
+
+	lo = 0;
+	hi = db->by_ctx_no;
+
+	while (lo < hi) {
+		uint32_t mid = lo + (hi - lo) / 2;
+
+		if (db->by_ctx[mid].ctx < ctx)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	if (lo == db->by_ctx_no || db->by_ctx[lo].ctx != ctx)
+		return false;
+
+	*pid = db->by_ctx[lo].pid;
+	return true;
+}
@@ -0,0 +1,149 @@
+/*
+ * Copyright NXP 2017
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sub license,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#ifndef __GPUTOP_DATABASE_H
+#define __GPUTOP_DATABASE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct gtop_lines;
+
+/* process names longer than this are truncated, they still prefix-match */
+#define DEBUGFS_DATABASE_NAME_LEN	64
+
+/**
+ * debugfs_db_process:
+ *
+ * A Process: entry of the database, with its contexts at
+ * ctx[first] .. ctx[first + ctx_no - 1] of the database.
+ */
+struct debugfs_db_process {
+	uint32_t pid;
+	char name[DEBUGFS_DATABASE_NAME_LEN];
+
+	uint32_t first;
+	uint32_t ctx_no;
+
+	/* order in the file, the last entry of a pid is the one that counts */
+	uint32_t order;
+
+	/*
+	 * hash of all the lines of the entry, they list what the process
+	 * allocated so it changes with them
+	 */
+	uint32_t sum;
+};
+
+struct debugfs_db_ctx {
+	uint32_t ctx;
+	uint32_t pid;
+};
+
+/**
+ * debugfs_database:
+ *
+ * The debugfs database file parsed in one pass, indexed both ways: processes
+ * are sorted by pid and contexts by context number, so that looking up the
+ * contexts of a client, or the client of a context, is a binary search.
+ * Contexts are only sorted once one is looked up, refreshing the database
+ * doesn't pay for it otherwise.
+ *
+ * Storage is kept across debugfs_database_parse() calls, so refreshing it
+ * doesn't allocate once it has grown to the size of the database.
+ */
+struct debugfs_database {
+	struct debugfs_db_process *procs;
+	uint32_t procs_no;
+	uint32_t procs_size;
+
+	/* contexts of each process, in file order */
+	uint32_t *ctx;
+	uint32_t ctx_no;
+	uint32_t ctx_size;
+
+	/*
+	 * contexts of the last entry of each pid, sorted by number, with
+	 * their pid; built by debugfs_database_find_ctx()
+	 */
+	struct debugfs_db_ctx *by_ctx;
+	uint32_t by_ctx_no;
+	bool by_ctx_valid;
+};
+
+/**
+ * debugfs_database_parse:
+ *
+ * (Re)build db from the lines of the database. Returns the number of
+ * processes found, -1 if we ran out of memory.
+ */
+int
+debugfs_database_parse(struct debugfs_database *db, struct gtop_lines *lines);
+
+/**
+ * debugfs_database_free:
+ *
+ * Free all memory held by db.
+ */
+void
+debugfs_database_free(struct debugfs_database *db);
+
+/**
+ * debugfs_database_find_pid:
+ *
+ * The entry of pid, NULL if pid has none.
+ */
+const struct debugfs_db_process *
+debugfs_database_find_pid(const struct debugfs_database *db, uint32_t pid);
+
+/**
+ * debugfs_database_contexts:
+ *
+ * The contexts of proc, proc->ctx_no of them.
+ */
+static inline const uint32_t *
+debugfs_database_contexts(const struct debugfs_database *db,
+			  const struct debugfs_db_process *proc)
+{
+	return db->ctx + proc->first;
+}
+
+/**
+ * debugfs_database_find_ctx:
+ *
+ * Store in pid the process owning context ctx. False if ctx isn't in the
+ * database. The first look-up after a parse sorts the contexts.
+ */
+bool
+debugfs_database_find_ctx(struct debugfs_database *db, uint32_t ctx,
+			  uint32_t *pid);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __GPUTOP_DATABASE_H */
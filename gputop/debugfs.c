@@ -28,209 +28,284 @@
 #include <fcntl.h>
 #include <stdlib.h>
 #include <inttypes.h>
-#include <assert.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <errno.h>
 
 #include "gpuperfcnt/gpuperfcnt_debugfs.h"
 #include "debugfs.h"
+#include "parse.h"
 
-int
-debugfs_get_contexts(struct debugfs_client *clients, const char *path)
-{
-	FILE *file = NULL;
-	char buf[1024];
-	bool found_process = false;
-	struct debugfs_client *client = NULL;
+/* smallest buffer of a source, grows twice as large from there */
+#define DEBUGFS_SOURCE_MIN	4096
 
-	if (!path) {
-		file = debugfs_fopen("database", "r");
+/**
+ * debugfs_source:
+ *
+ * A file we read on every refresh. It is opened once and re-read from the
+ * start with pread(), into a buffer kept across reads. Once it can't be
+ * opened it is considered missing and not tried again.
+ */
+struct debugfs_source {
+	/* under debugfs, unless it is an absolute path */
+	const char *name;
+	/* tried when name can't be opened */
+	const char *alt;
+	/* we write to it before reading */
+	bool write;
+
+	/* debugfs ones are opened by libgpuperfcnt */
+	FILE *file;
+	int fd;
+
+	char *buf;
+	size_t size;
+
+	bool missing;
+};
+
+enum debugfs_source_id {
+	DEBUGFS_SOURCE_CLIENTS,
+	DEBUGFS_SOURCE_DATABASE,
+	DEBUGFS_SOURCE_CLK,
+	DEBUGFS_SOURCE_GOVERN,
+	DEBUGFS_SOURCE_CONTIGUOUS,
+	DEBUGFS_SOURCE_VIDMEM,
+	DEBUGFS_SOURCE_NR,
+};
+
+static struct debugfs_source sources[DEBUGFS_SOURCE_NR] = {
+	[DEBUGFS_SOURCE_CLIENTS] = { .name = "clients", .fd = -1 },
+	[DEBUGFS_SOURCE_DATABASE] = { .name = "database", .fd = -1 },
+	[DEBUGFS_SOURCE_CLK] = { .name = "clk", .fd = -1 },
+	/* newer version 6.2.4.p2 have gpu_govern */
+	[DEBUGFS_SOURCE_GOVERN] = {
+		.name = "/sys/bus/platform/drivers/galcore/gpu_mode",
+		.alt = "/sys/bus/platform/drivers/galcore/gpu_govern",
+		.fd = -1,
+	},
+	[DEBUGFS_SOURCE_CONTIGUOUS] = {
+		.name = "/sys/module/galcore/parameters/contiguousSize",
+		.fd = -1,
+	},
+	/* replies with the memory of the pid written to it */
+	[DEBUGFS_SOURCE_VIDMEM] = { .name = "vidmem", .write = true, .fd = -1 },
+};
+
+static int
+debugfs_source_open(struct debugfs_source *src)
+{
+	if (src->name[0] == '/') {
+		src->fd = open(src->name, O_RDONLY);
+		if (src->fd < 0 && src->alt)
+			src->fd = open(src->alt, O_RDONLY);
 	} else {
-		file = fopen(path, "r");
+		src->file = debugfs_fopen(src->name, src->write ? "w+" : "r");
+		if (src->file)
+			src->fd = fileno(src->file);
 	}
 
-	if (!file)
+	if (src->fd < 0) {
+		src->missing = true;
 		return -1;
+	}
+
+	return 0;
+}
+
+/*
+ * the whole content of src, NUL-terminated, valid until the next read
+ */
+static char *
+debugfs_source_read(struct debugfs_source *src, size_t *len)
+{
+	*len = 0;
+
+	if (src->missing)
+		return NULL;
 
-	memset(buf, 0, sizeof(char) * 1024);
-
-	while ((fgets(buf, 1024, file)) != NULL) {
-		char *line = buf;
-
-		/* check if this is the process we're interested in */
-		if (strncmp(line, "Process:", 8) == 0) {
-
-			uint32_t pid, err;
-
-
-			char *name = calloc(512, sizeof(char));
-			err = sscanf(line, "Process: %d   %[a-zA-Z0-9-]s\n", &pid, name);
-
-			if (name && err == 2) {
-
-				list_for_each(client, clients->head) {
-					if (client->pid == pid &&
-					    !strncmp(client->name, name, strlen(name))) {
-						/* 
-						 * This automatically stops at
-						 * the right client, but we
-						 * have to reset the no of
-						 * contexts.
-						 */
-						client->ctx_no = 0;
-						found_process = true;
-						break;
-					} else {
-						/* 
-						 * It could be that other
-						 * process follow this one so
-						 * we might get invalid
-						 * contexts
-						 */
-						found_process = false;
-					}
-				}
-
-			}
-			free(name);
+	if (src->fd < 0 && debugfs_source_open(src) < 0)
+		return NULL;
+
+	for (;;) {
+		ssize_t nr;
+
+		/* either the first read, or it didn't fit */
+		if (src->size == 0 || *len == src->size - 1) {
+			size_t size = src->size ? src->size * 2 : DEBUGFS_SOURCE_MIN;
+			char *buf = realloc(src->buf, size);
+
+			if (!buf)
+				return NULL;
+
+			src->buf = buf;
+			src->size = size;
 		}
 
-		/* go to next line if we didn't found our process */
-		if (!found_process)
-			continue;
+		nr = pread(src->fd, src->buf, src->size - 1, 0);
+		if (nr < 0) {
+			if (errno == EINTR)
+				continue;
+			return NULL;
+		}
 
-		if (!strncmp(line, "Context", 7)) {
-			char *str = line;
-			uint32_t no = 0;
+		*len = nr;
+		if (*len < src->size - 1)
+			break;
+	}
 
-			/* skip context */
-			str += 7;
+	src->buf[*len] = '\0';
+	return src->buf;
+}
 
-			/* skip white-space */
-			while (str && (*str == ' ' || *str == '\t'))
-					str++;
+static void
+debugfs_source_close(struct debugfs_source *src)
+{
+	if (src->file)
+		fclose(src->file);
+	else if (src->fd >= 0)
+		close(src->fd);
+
+	free(src->buf);
+
+	src->file = NULL;
+	src->fd = -1;
+	src->buf = NULL;
+	src->size = 0;
+	src->missing = false;
+}
 
-			/* we might need to get this value 0 -> GPU0, 1 -> GPU1 */
-			if (*str == '0' || *str == '1')
-				str++;
+void
+debugfs_close_sources(void)
+{
+	for (int i = 0; i < DEBUGFS_SOURCE_NR; i++)
+		debugfs_source_close(&sources[i]);
+}
 
-			/* skip white-space */
-			while (str && (*str == ' ' || *str == '\t'))
-					str++;
+/*
+ * lines of source id, or of the file at path if given, in which case file
+ * is set and has to be closed by the caller
+ */
+static int
+debugfs_lines(struct gtop_lines *lines, enum debugfs_source_id id,
+	      const char *path, FILE **file, char *buf, size_t size)
+{
+	*file = NULL;
 
-			sscanf(str, "%x", &no);
+	if (path) {
+		*file = fopen(path, "r");
+		if (!*file)
+			return -1;
 
-			/* save it if we found a valid ctx */
-			if (no) {
-				assert(client != NULL);
+		gtop_lines_init(lines, *file, buf, size);
+	} else {
+		size_t len = 0;
+		char *data = debugfs_source_read(&sources[id], &len);
 
-				if (client->ctx == NULL) {
-					client->ctx = calloc(512, sizeof(uint32_t));
-				}
+		if (!data)
+			return -1;
 
-				client->ctx[client->ctx_no++] = no;
-			}
-		}
+		gtop_lines_init_buf(lines, data, len);
 	}
 
-	fclose(file);
 	return 0;
 }
 
 int
-debugfs_get_current_ctx(struct debugfs_client *client, const char *path)
+debugfs_get_database(struct debugfs_database *db, const char *path)
 {
+	struct gtop_lines lines;
+	char buf[GTOP_LINE_LEN];
 	FILE *file;
-	char buf[1024];
-	bool found_process = false;
-	int __nr = 0;
-
-	if (!path) {
-		file = debugfs_fopen("database", "r");
-	} else {
-		file = fopen(path, "r");
-	}
+	int nr;
 
-	if (!file)
+	if (debugfs_lines(&lines, DEBUGFS_SOURCE_DATABASE, path, &file,
+			  buf, sizeof(buf)) < 0)
 		return -1;
 
-	memset(buf, 0, sizeof(char) * 1024);
-
-	while ((fgets(buf, 1024, file)) != NULL) {
-		char *line = buf;
-
-		/* check if this is the process we're interested in */
-		if (strncmp(line, "Process:", 8) == 0) {
-			uint32_t pid, err;
-
-			char *name = calloc(512, sizeof(char));
-			err = sscanf(line, "Process: %d   %[a-zA-Z0-9-]s\n", &pid, name);
-
-			if (name && err == 2) {
-				if (client->pid == pid &&
-				    !strncmp(client->name, name, strlen(name))) {
-					client->ctx_no = 0;
-					found_process = true;
-				} else {
-					/* it could be that other process
-					 * follow this one so we might get
-					 * invalid contexts */
-					found_process = false;
-				}
-			}
-			free(name);
-		}
+	nr = debugfs_database_parse(db, &lines);
 
-		/* go to next line if we didn't found our process */
-		if (!found_process)
-			continue;
+	if (file)
+		fclose(file);
+	return nr;
+}
 
-		if (!strncmp(line, "Context", 7)) {
-			char *str = line;
-			uint32_t no = 0;
+/*
+ * copy the contexts db has for client, if the name matches
+ */
+static int
+debugfs_copy_contexts(struct debugfs_client *client,
+		      const struct debugfs_database *db, struct gtop_arena *arena)
+{
+	const struct debugfs_db_process *proc;
 
-			/* skip context */
-			str += 7;
+	client->ctx_no = 0;
 
-			/* skip white-space */
-			while (str && (*str == ' ' || *str == '\t'))
-					str++;
+	proc = debugfs_database_find_pid(db, client->pid);
+	if (!proc || !proc->ctx_no)
+		return 0;
 
-			/* we might need to get this value 0 -> GPU0, 1 -> GPU1 */
-			if (*str == '0' || *str == '1')
-				str++;
+	if (strncmp(client->name, proc->name, strlen(proc->name)))
+		return 0;
 
-			/* skip white-space */
-			while (str && (*str == ' ' || *str == '\t'))
-					str++;
+	client->ctx = gtop_arena_alloc(arena, proc->ctx_no * sizeof(uint32_t));
+	if (!client->ctx)
+		return -1;
 
-			sscanf(str, "%x", &no);
+	memcpy(client->ctx, debugfs_database_contexts(db, proc),
+	       proc->ctx_no * sizeof(uint32_t));
+	client->ctx_no = proc->ctx_no;
 
-			/* save it if we found a valid ctx */
-			if (no) {
-				if (client->ctx == NULL) {
-					client->ctx = calloc(10, sizeof(uint32_t));
-				}
+	return 0;
+}
 
-				assert(__nr < 10);
+int
+debugfs_get_contexts_from(struct debugfs_client *clients,
+			  const struct debugfs_database *db,
+			  struct gtop_arena *arena)
+{
+	struct debugfs_client *client = NULL;
 
-				client->ctx[__nr] = no;
-				__nr++;
-			}
-		}
+	list_for_each(client, clients->head) {
+		if (debugfs_copy_contexts(client, db, arena) < 0)
+			return -1;
 	}
 
-	client->ctx_no = __nr;
-
-	fclose(file);
 	return 0;
 }
 
+int
+debugfs_get_contexts(struct debugfs_client *clients, const char *path,
+		     struct gtop_arena *arena)
+{
+	struct debugfs_database db = {};
+	int ret = -1;
+
+	if (debugfs_get_database(&db, path) >= 0)
+		ret = debugfs_get_contexts_from(clients, &db, arena);
+
+	debugfs_database_free(&db);
+	return ret;
+}
+
+int
+debugfs_get_current_ctx(struct debugfs_client *client, const char *path,
+			struct gtop_arena *arena)
+{
+	struct debugfs_database db = {};
+	int ret = -1;
+
+	if (debugfs_get_database(&db, path) >= 0)
+		ret = debugfs_copy_contexts(client, &db, arena);
+
+	debugfs_database_free(&db);
+	return ret;
+}
+
 int
 debugfs_get_vid_mem(struct debugfs_vid_mem_client *client, pid_t pid)
 {
 	FILE *file = NULL;
-	char buf[1024];
 	char pid_str[128];
 
 	memset(client, 0, sizeof(*client));
@@ -249,82 +324,53 @@ debugfs_get_vid_mem(struct debugfs_vid_mem_client *client, pid_t pid)
 	debugfs_reopen(file, "r");
 #endif
 
-	while ((fgets(buf, 1024, file)) != NULL) {
-		char *line = buf;
-
-		if (!strncmp(line, "All-Types", strlen("All-Types")))
-			continue;
+	struct gtop_lines lines;
+	char buf[GTOP_LINE_LEN];
 
-		/* QNX doesn't know about %ms so we need to allocate by
-		 * ourselves */
-		char *name = calloc(512, sizeof(char));
+	gtop_lines_init(&lines, file, buf, sizeof(buf));
+	debugfs_parse_vid_mem(client, &lines);
 
-		if (!strncmp(line, "Index", strlen("Index"))) {
-			sscanf(line, "%[a-zA-Z0-9-] %u", name, &client->index);
-		}
-
-		if (!strncmp(line, "Vertex", strlen("Vertex"))) {
-			sscanf(line, "%[a-zA-Z0-9-] %u", name, &client->vertex);
-		}
-
-		if (!strncmp(line, "Texture", strlen("Texture"))) {
-			sscanf(line, "%[a-zA-Z0-9-] %u", name, &client->texture);
-		}
-
-		if (!strncmp(line, "RenderTarget", strlen("RenderTarget"))) {
-			sscanf(line, "%[a-zA-Z0-9-] %u", name, &client->render_target);
-		}
-
-		if (!strncmp(line, "Depth", strlen("Depth"))) {
-			sscanf(line, "%[a-zA-Z0-9-] %u", name, &client->depth);
-		}
-
-		if (!strncmp(line, "Bitmap", strlen("Bitmap"))) {
-			sscanf(line, "%[a-zA-Z0-9-] %u", name, &client->bitmap);
-		}
-
-		if (!strncmp(line, "TileStatus", strlen("TileStatus"))) {
-			sscanf(line, "%[a-zA-Z0-9-] %u", name, &client->tile_status);
-		}
-
-		if (!strncmp(line, "Image", strlen("Image"))) {
-			sscanf(line, "%[a-zA-Z0-9-] %u", name, &client->image);
-		}
-
-		if (!strncmp(line, "Mask", strlen("Mask"))) {
-			sscanf(line, "%[a-zA-Z0-9-] %u", name, &client->mask);
-		}
+	fclose(file);
+	return 0;
+}
 
-		if (!strncmp(line, "Scissor", strlen("Scissor"))) {
-			sscanf(line, "%[a-zA-Z0-9-] %u", name, &client->scissor);
-		}
+int
+debugfs_get_vid_mem_batch(const uint32_t *pids, uint32_t nr,
+			  struct debugfs_vid_mem_client *clients)
+{
+#if defined __QNX__ || defined __QNXTO__
+	/* vidmem has to be re-opened between writing and reading */
+	for (uint32_t i = 0; i < nr; i++) {
+		if (debugfs_get_vid_mem(&clients[i], pids[i]) < 0)
+			return -1;
+	}
+#else
+	struct debugfs_source *src = &sources[DEBUGFS_SOURCE_VIDMEM];
 
-		if (!strncmp(line, "HZ", strlen("HZ"))) {
-			sscanf(line, "%[a-zA-Z0-9-] %u", name, &client->hz);
-		}
+	if (src->missing || (src->fd < 0 && debugfs_source_open(src) < 0))
+		return -1;
 
-		if (!strncmp(line, "ICache", strlen("ICache"))) {
-			sscanf(line, "%[a-zA-Z0-9-] %u", name, &client->i_cache);
-		}
+	for (uint32_t i = 0; i < nr; i++) {
+		struct gtop_lines lines;
+		char pid_str[16];
+		size_t len;
+		char *data;
+		int n;
 
-		if (!strncmp(line, "TxDesc", strlen("TxDesc"))) {
-			sscanf(line, "%[a-zA-Z0-9-] %u", name, &client->tx_desc);
-		}
+		memset(&clients[i], 0, sizeof(clients[i]));
 
-		if (!strncmp(line, "Fence", strlen("Fence"))) {
-			sscanf(line, "%[a-zA-Z0-9-] %u", name, &client->fence);
-		}
+		n = snprintf(pid_str, sizeof(pid_str), "%u", pids[i]);
+		if (pwrite(src->fd, pid_str, n, 0) != n)
+			return -1;
 
-		if (!strncmp(line, "TFBHeader", strlen("TFBHeader"))) {
-			sscanf(line, "%[a-zA-Z0-9-] %u", name, &client->tfbheader);
-		}
+		data = debugfs_source_read(src, &len);
+		if (!data)
+			return -1;
 
-		if (name) {
-			free(name);
-		}
+		gtop_lines_init_buf(&lines, data, len);
+		debugfs_parse_vid_mem(&clients[i], &lines);
 	}
-
-	fclose(file);
+#endif
 	return 0;
 }
 
@@ -350,7 +396,7 @@ debugfs_print_contexts(struct debugfs_client *clients)
 
 /*
  * struct debugfs_client clients;
- * vivante_get_current_clients(&clients);
+ * vivante_get_current_clients(&clients, NULL, &arena);
  *
  * struct debugfs_client *curr = clients.head;
  * for (; curr != NULL; curr = curr->next) {
@@ -359,149 +405,48 @@ debugfs_print_contexts(struct debugfs_client *clients)
  *
  */
 int
-debugfs_get_current_clients(struct debugfs_client *clients, const char *path)
+debugfs_get_current_clients(struct debugfs_client *clients, const char *path,
+			    struct gtop_arena *arena)
 {
-	FILE *file = NULL;
-	char buf[1024];
+	struct gtop_lines lines;
+	char buf[GTOP_LINE_LEN];
+	FILE *file;
 	int i = 0;
 
 	memset(clients, 0, sizeof(*clients));
 
-	if (!path) {
-		file = debugfs_fopen("clients", "r");
-	} else {
-		file = fopen(path, "r");
-	}
-
-	if (!file)
+	if (debugfs_lines(&lines, DEBUGFS_SOURCE_CLIENTS, path, &file,
+			  buf, sizeof(buf)) < 0)
 		return 0;
 
-	memset(buf, 0, sizeof(char) * 1024);
-
-	while ((fgets(buf, 1024, file)) != NULL) {
-		char *line = buf;
-
-		/* skip PID and -- */
-		if (*line == 'P' || *line == '-') {
-			continue;
-		}
+	i = debugfs_parse_clients(clients, &lines, arena);
 
-		struct debugfs_client *client;
-		int err;
-
-		client = calloc(1, sizeof(*client));
-
-		client->name = calloc(512, sizeof(char));
-		err = sscanf(line, "%d  %[a-zA-Z0-9-]s\n", &client->pid, client->name);
-
-		/* it could be we have garbage in clients */
-		if (err != 2) {
-			free(client);
-			continue;
-		}
-
-		client->next = clients->head;
-		clients->head = client;
-
-
-		i++;
-	}
-
-	fclose(file);
+	if (file)
+		fclose(file);
 	return i;
 }
 
-void
-debugfs_free_clients(struct debugfs_client *clients)
-{
-	struct debugfs_client *it = clients->head;
-
-	while (it) {
-		/* save next so we can remove the current node */
-		struct debugfs_client *it_next = it->next;
-
-		/* free all storage */
-		free(it->ctx);
-		free(it->name);
-		free(it);
-
-		it = it_next;
-	}
-
-	memset(clients, 0, sizeof(*clients));
-}
-
 /*
  * returns current clock
  */
 int
 debugfs_get_gpu_clocks(struct debugfs_clock *clocks, const char *path)
 {
-	FILE *file = NULL;
-	char buf[1024];
-
-	if (!path) {
-		file = debugfs_fopen("clk", "r");
-	} else {
-		file = fopen(path, "r");
-	}
+	struct gtop_lines lines;
+	char buf[GTOP_LINE_LEN];
+	FILE *file;
+	int ret;
 
-	if (!file)
+	if (debugfs_lines(&lines, DEBUGFS_SOURCE_CLK, path, &file,
+			  buf, sizeof(buf)) < 0)
 		return -1;
 
-	memset(buf, 0, sizeof(buf));
-	while ((fgets(buf, 1024, file)) != NULL) {
-		char *line = buf;
-
-		if (!strncmp(line, "gpu", 3)) {
-			int core = -1;
-			unsigned int clock_freq = 0;
-
-			int err = sscanf(line, "gpu%d mc clock: %u HZ.", &core, &clock_freq);
-			if (err == 2) {
-				if (core == 0) {
-					if (clock_freq) {
-						clocks->gpu_core_0 = clock_freq;
-						/* no need to test for shader */
-						continue;
-					}
-				} else if (core == 1) {
-					if (clock_freq) {
-						clocks->gpu_core_1 = clock_freq;
-						/* no need to test for shader */
-						continue;
-					}
-				}
-			}
-
-			core = -1;
-			clock_freq = 0;
-			err = sscanf(line, "gpu%d sh clock: %u HZ.", &core, &clock_freq);
-			if (err == 2) {
-				if (core == 0) {
-					if (clock_freq) {
-						clocks->shader_core_0 = clock_freq;
-					}
-				} else if (core == 1) {
-					if (clock_freq) {
-						clocks->shader_core_1 = clock_freq;
-					}
-				}
-
-			}
-
-
-		}
-
-	}
-
-	/* verify that we got data */
-	if (clocks->gpu_core_0 == 0 || clocks->shader_core_0 == 0)
-		return -1;
+	ret = debugfs_parse_gpu_clocks(clocks, &lines);
 
-	fclose(file);
+	if (file)
+		fclose(file);
 
-	return 0;
+	return ret;
 }
 
 /*
@@ -510,140 +455,23 @@ debugfs_get_gpu_clocks(struct debugfs_clock *clocks, const char *path)
 int
 debugfs_get_current_gpu_governor(struct debugfs_govern *governor)
 {
-	FILE *file = NULL;
-	char buf[1024];
-	/* no need to allocate each time */
-	static struct debugfs_govern *__governor = NULL;
-	unsigned int __governor_index = 0;
-
-	const char path[] = "/sys/bus/platform/drivers/galcore/gpu_mode";
-	/* newer version 6.2.4.p2 */
-	const char path2[] = "/sys/bus/platform/drivers/galcore/gpu_govern";
-	file = fopen(path, "r");
-
-	if (!file) {
-		file = fopen(path2, "r");
-		if (!file)
-			return -1;
-	}
-
-	memset(buf, 0, sizeof(buf));
-	unsigned int modes = 0;
-
-	while ((fgets(buf, 1024, file)) != NULL) {
-		char *line = buf;
-
-
-		if (!strncmp(line, "GPU support", 11)) {
-			int err = sscanf(line, "GPU support %d modes", &modes);
-			assert(err == 1);
-			assert(modes != 0);
-
-			if (__governor == NULL)
-				__governor = calloc(modes, sizeof(struct debugfs_govern));
-			else
-				memset(__governor, 0, sizeof(*__governor));
-			continue;
-		}
-
-		assert(modes != 0);
-
-		/* overdrive:      core_clk frequency: 800000000   shader_clk frequency: 1000000000	 */
-		char *naming_mode = calloc(1024, sizeof(char));
-		int err = sscanf(line, "%[a-zA-Z0-9-]s", naming_mode);
-		assert(err == 1 || naming_mode != NULL);
-
-
-		if (!strncmp(naming_mode, "overdrive", 9) ||
-		    !strncmp(naming_mode, "nominal", 7) ||
-		    !strncmp(naming_mode, "underdrive", 10)) {
-
-			char *n_line = line + strlen(naming_mode);
-
-			/* eat whitespace */
-			while (n_line && *n_line) {
-				if (*n_line == ' ' || *n_line == '\t')
-					n_line++;
-				else
-					break;
-			}
-
-			unsigned long int core_clock_freq = 0;
-			unsigned long int shader_clock_freq = 0;
-
-			int rv = sscanf(n_line, "%*[^c]core_clk frequency: %lu%*[^s]shader_clk frequency: %lu", &core_clock_freq, &shader_clock_freq);
-			if (rv != 2) {
-				fprintf(stderr, "reading core-freq(%lu) and shader-freq(%lu) failed: %s\n", core_clock_freq, shader_clock_freq, n_line);
-				assert(!"exit");
-				return -1;
-			}
-
-			__governor[__governor_index].gpu_core_freq = core_clock_freq;
-			__governor[__governor_index].shader_core_freq = shader_clock_freq;
-
-			if (!strncmp(naming_mode, "overdrive", 9))
-			       __governor[__governor_index].governor = OVERDRIVE;
-			else if (!strncmp(naming_mode, "nominal", 7))
-				__governor[__governor_index].governor = NOMINAL;
-			else if (!strncmp(naming_mode, "underdrive", 10))
-				__governor[__governor_index].governor = UNDERDRIVE;
-
-
-			/* fail if we coudn't find a proper type */
-			assert(__governor->governor != 0);
-			/* fail if more have been added */
-			assert(__governor_index <= modes);
-
-			__governor_index++;
-
-			if (naming_mode)
-				free(naming_mode);
+	struct gtop_lines lines;
+	FILE *file;
 
-			/* go to next line */
-			continue;
-		}
+	if (debugfs_lines(&lines, DEBUGFS_SOURCE_GOVERN, NULL, &file, NULL, 0) < 0)
+		return -1;
 
-		/* now we need to find out which one of those we are currently running */
-		if (!strncmp(line, "Currently", 9)) {
-
-			unsigned int current_mode_enum = 0;
-			/* check if indeed we found it, we might have failed parsing? */
-			int found = 0;
-
-			char *current_mode = calloc(1024, sizeof(char));
-			int err = sscanf(line, "Currently GPU runs on mode %[a-zA-Z0-9-]s", current_mode);
-			assert(err == 1);
-
-			if (!strncmp(current_mode, "overdrive", 9))
-				current_mode_enum = OVERDRIVE;
-			else if (!strncmp(current_mode, "nominal", 7))
-				current_mode_enum = NOMINAL;
-			else if (!strncmp(current_mode, "underdrive", 10))
-				current_mode_enum = UNDERDRIVE;
-
-
-			/* go over what we've got and determine which one to use */
-			for (size_t i = 0; i < modes; i++) {
-				if (current_mode_enum == __governor[i].governor) {
-					governor->governor = current_mode_enum;
-					governor->gpu_core_freq = __governor[i].gpu_core_freq;
-					governor->shader_core_freq = __governor[i].shader_core_freq;
-					found = 1;
-					break;
-				}
-			}
-
-			if (current_mode)
-				free(current_mode);
-
-			/* just in we case we didn't find something relevant */
-			assert(found == 1);
-		}
+	return debugfs_parse_governor(governor, &lines);
+}
 
-	}
+int
+debugfs_get_contiguous_size(uint32_t *size)
+{
+	size_t len = 0;
+	char *data = debugfs_source_read(&sources[DEBUGFS_SOURCE_CONTIGUOUS], &len);
 
-	fclose(file);
+	if (!data || !gtop_parse_u32(data, size))
+		return -1;
 
 	return 0;
 }
-
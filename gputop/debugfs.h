@@ -24,6 +24,12 @@
 #ifndef __GPUTOP_DEBUGFS_H
 #define __GPUTOP_DEBUGFS_H
 
+#include "database.h"
+#include "arena.h"
+
+/* client names longer than this are truncated, the way the database's are */
+#define DEBUGFS_CLIENT_NAME_LEN		DEBUGFS_DATABASE_NAME_LEN
+
 /**
  * debugfs_client:
  *
@@ -46,6 +52,15 @@ struct debugfs_client {
 	struct debugfs_client *head;
 };
 
+/* vidmem fields we don't know about, kept as they come */
+#define DEBUGFS_VID_MEM_EXTRA		8
+#define DEBUGFS_VID_MEM_NAME_LEN	16
+
+struct debugfs_vid_mem_field {
+	char name[DEBUGFS_VID_MEM_NAME_LEN];
+	uint32_t value;
+};
+
 struct debugfs_vid_mem_client {
 	uint32_t index;
 	uint32_t vertex;
@@ -62,6 +77,10 @@ struct debugfs_vid_mem_client {
 	uint32_t tx_desc;
 	uint32_t fence;
 	uint32_t tfbheader;
+
+	/* newer drivers may report more types */
+	struct debugfs_vid_mem_field extra[DEBUGFS_VID_MEM_EXTRA];
+	uint32_t extra_no;
 };
 
 struct debugfs_clock {
@@ -96,31 +115,49 @@ struct debugfs_govern {
 /**
  * gpuperf_debugfs_get_current_clients:
  *
- * Method to retrieve all the clients current associated with vivante GPU
+ * Method to retrieve all the clients current associated with vivante GPU.
+ * The list is allocated from arena, and is gone once it is reset.
  */
 int
-debugfs_get_current_clients(struct debugfs_client *clients, const char *path);
+debugfs_get_current_clients(struct debugfs_client *clients, const char *path,
+			    struct gtop_arena *arena);
 
 /**
- * gpuperf_debugfs_free_clients:
+ * debugfs_get_current_ctx:
  *
- * Free all memory allocated by vivante_get_current_clients().
+ * Get the contexts of a single client, allocated from arena. Parses the
+ * whole database, use debugfs_get_database() to look up more than one.
  */
-void
-debugfs_free_clients(struct debugfs_client *clients);
+int
+debugfs_get_current_ctx(struct debugfs_client *client, const char *path,
+			struct gtop_arena *arena);
+
 
 /**
- *
+ * \brief: get all contexts at once from database, allocated from arena.
  */
 int
-debugfs_get_current_ctx(struct debugfs_client *client, const char *path);
+debugfs_get_contexts(struct debugfs_client *clients, const char *path,
+		     struct gtop_arena *arena);
 
+/**
+ * debugfs_get_database:
+ *
+ * Parse the database (or the file at path) into db, in one pass. Returns
+ * the number of processes in it, -1 on failure.
+ */
+int
+debugfs_get_database(struct debugfs_database *db, const char *path);
 
 /**
- * \brief: get all contexts at once from database.
+ * debugfs_get_contexts_from:
+ *
+ * Same as debugfs_get_contexts(), out of an already parsed database.
  */
 int
-debugfs_get_contexts(struct debugfs_client *clients, const char *path);
+debugfs_get_contexts_from(struct debugfs_client *clients,
+			  const struct debugfs_database *db,
+			  struct gtop_arena *arena);
 
 
 /**
@@ -132,6 +169,17 @@ debugfs_print_contexts(struct debugfs_client *clients);
 int
 debugfs_get_vid_mem(struct debugfs_vid_mem_client *client, pid_t pid);
 
+/**
+ * debugfs_get_vid_mem_batch:
+ *
+ * Video memory of nr pids at once, into clients, going over the same
+ * vidmem file descriptor for all of them. Cheaper than calling
+ * debugfs_get_vid_mem() for each.
+ */
+int
+debugfs_get_vid_mem_batch(const uint32_t *pids, uint32_t nr,
+			  struct debugfs_vid_mem_client *clients);
+
 /**
  *
  */
@@ -144,4 +192,22 @@ debugfs_get_gpu_clocks(struct debugfs_clock *clocks, const char *path);
 int
 debugfs_get_current_gpu_governor(struct debugfs_govern *governor);
 
+/**
+ * debugfs_get_contiguous_size:
+ *
+ * Size of galcore's contiguous memory pool, in bytes.
+ */
+int
+debugfs_get_contiguous_size(uint32_t *size);
+
+/**
+ * debugfs_close_sources:
+ *
+ * The clients, database, clk, vidmem and governor files (and
+ * contiguousSize) are kept open once read, for the next refresh. Close
+ * them.
+ */
+void
+debugfs_close_sources(void);
+
 #endif
@@ -0,0 +1,274 @@
+/*
+ * Copyright NXP 2017
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sub license,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <math.h>
+
+#include "ftrace.h"
+
+#define GTOP_FTRACE_MAX_RECORDS		64
+#define GTOP_FTRACE_PREFIX_LEN		(GTOP_METRIC_NAME_LEN + 32)
+
+enum gtop_ftrace_kind {
+	/* a metric as it is */
+	GTOP_FTRACE_METRIC,
+	/* 100 - the IDLE state of a DMA engine */
+	GTOP_FTRACE_DMA_BUSY,
+	/* only when it changes */
+	GTOP_FTRACE_GOVERNOR,
+};
+
+struct gtop_ftrace_record {
+	enum gtop_ftrace_kind kind;
+	uint32_t metric;
+
+	/* "C|<pid>|gpu.<name>|", formatted once */
+	char prefix[GTOP_FTRACE_PREFIX_LEN];
+	size_t prefix_len;
+};
+
+struct gtop_ftrace {
+	int fd;
+
+	struct gtop_ftrace_record records[GTOP_FTRACE_MAX_RECORDS];
+	uint32_t nr_records;
+
+	/* last governor level written, -1 for none */
+	int64_t governor;
+
+	char buf[GTOP_FTRACE_BUF_SIZE];
+	float values[GTOP_METRIC_NR];
+};
+
+static int
+gtop_ftrace_add(struct gtop_ftrace *ftrace, enum gtop_ftrace_kind kind,
+		uint32_t metric, const char *name)
+{
+	struct gtop_ftrace_record *record;
+	char *p;
+	int len;
+
+	if (ftrace->nr_records == GTOP_FTRACE_MAX_RECORDS) {
+		fprintf(stderr, "Too many ftrace records, %s not added\n", name);
+		return -1;
+	}
+
+	record = &ftrace->records[ftrace->nr_records];
+	len = snprintf(record->prefix, sizeof(record->prefix), "C|%d|gpu.%s|",
+		       (int) getpid(), name);
+	if (len < 0 || (size_t) len >= sizeof(record->prefix))
+		return -1;
+
+	/* '|' separates fields, spaces would only be confusing */
+	for (p = record->prefix + len - 2; p > record->prefix && *p != '|'; p--)
+		if (*p == ' ')
+			*p = '_';
+
+	record->kind = kind;
+	record->metric = metric;
+	record->prefix_len = len;
+	ftrace->nr_records++;
+
+	return 0;
+}
+
+static int
+gtop_ftrace_add_metrics(struct gtop_ftrace *ftrace,
+			const struct gtop_snapshot_names *names, const char *metrics)
+{
+	char name[GTOP_METRIC_NAME_LEN];
+
+	while (*metrics) {
+		size_t len = strcspn(metrics, ",");
+		int m;
+
+		snprintf(name, sizeof(name), "%.*s", (int) len, metrics);
+
+		m = gtop_snapshot_metric_find(names, name);
+		if (m < 0) {
+			fprintf(stderr, "Unknown metric %s\n", name);
+			return -1;
+		}
+
+		if (gtop_ftrace_add(ftrace, GTOP_FTRACE_METRIC, m, name) < 0)
+			return -1;
+
+		metrics += len;
+		if (*metrics == ',')
+			metrics++;
+	}
+
+	return 0;
+}
+
+struct gtop_ftrace *
+gtop_ftrace_open(const char *path, const struct gtop_snapshot_names *names,
+		 const char *metrics)
+{
+	char name[GTOP_METRIC_NAME_LEN];
+	struct gtop_ftrace *ftrace;
+	uint32_t i;
+
+	ftrace = calloc(1, sizeof(*ftrace));
+	if (!ftrace)
+		return NULL;
+
+	ftrace->governor = -1;
+
+	if (path) {
+		ftrace->fd = open(path, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+	} else {
+		path = GTOP_FTRACE_DEFAULT_PATH;
+		ftrace->fd = open(path, O_WRONLY | O_CLOEXEC);
+		if (ftrace->fd < 0) {
+			path = GTOP_FTRACE_DEBUGFS_PATH;
+			ftrace->fd = open(path, O_WRONLY | O_CLOEXEC);
+		}
+	}
+
+	if (ftrace->fd < 0) {
+		fprintf(stderr, "Failed to open %s: %s\n", path, strerror(errno));
+		free(ftrace);
+		return NULL;
+	}
+
+	for (i = 0; i < GTOP_SNAPSHOT_MAX_CORES; i++) {
+		snprintf(name, sizeof(name), "core%u", i);
+		gtop_ftrace_add(ftrace, GTOP_FTRACE_METRIC, GTOP_METRIC_CORES + i, name);
+	}
+
+	for (i = 0; i < GTOP_SNAPSHOT_MAX_DMA_STATES; i++) {
+		const char *state = names->dma_states[i];
+		const char *slash = strrchr(state, '/');
+
+		if (!slash || strcmp(slash, "/IDLE"))
+			continue;
+
+		snprintf(name, sizeof(name), "dma.%.*s", (int) (slash - state), state);
+		gtop_ftrace_add(ftrace, GTOP_FTRACE_DMA_BUSY, GTOP_METRIC_DMA_STATES + i, name);
+	}
+
+	gtop_ftrace_add(ftrace, GTOP_FTRACE_GOVERNOR,
+			GTOP_METRIC_SCALARS + GTOP_METRIC_GOVERNOR, "governor");
+
+	if (metrics && gtop_ftrace_add_metrics(ftrace, names, metrics) < 0) {
+		gtop_ftrace_close(ftrace);
+		return NULL;
+	}
+
+	return ftrace;
+}
+
+void
+gtop_ftrace_close(struct gtop_ftrace *ftrace)
+{
+	if (!ftrace)
+		return;
+
+	close(ftrace->fd);
+	free(ftrace);
+}
+
+/* counters are integers for trace viewers */
+static size_t
+gtop_ftrace_format(char *buf, int64_t value)
+{
+	char tmp[24];
+	size_t n = 0, len = 0;
+	uint64_t v = value < 0 ? -(uint64_t) value : (uint64_t) value;
+
+	do {
+		tmp[n++] = '0' + v % 10;
+		v /= 10;
+	} while (v);
+
+	if (value < 0)
+		buf[len++] = '-';
+	while (n)
+		buf[len++] = tmp[--n];
+
+	return len;
+}
+
+int
+gtop_ftrace_write(struct gtop_ftrace *ftrace, const struct gtop_snapshot *snap)
+{
+	uint32_t i;
+
+	gtop_snapshot_metrics(snap, ftrace->values);
+
+	for (i = 0; i < ftrace->nr_records; i++) {
+		const struct gtop_ftrace_record *record = &ftrace->records[i];
+		float value = ftrace->values[record->metric];
+		size_t len;
+		int64_t v;
+
+		if (isnan(value))
+			continue;
+
+		if (record->kind == GTOP_FTRACE_DMA_BUSY)
+			value = 100.0f - value;
+
+		v = llroundf(value);
+
+		if (record->kind == GTOP_FTRACE_GOVERNOR) {
+			if (v == ftrace->governor)
+				continue;
+			ftrace->governor = v;
+		}
+
+		/* the kernel makes one event of a write, it's one record each */
+		memcpy(ftrace->buf, record->prefix, record->prefix_len);
+		len = record->prefix_len;
+		len += gtop_ftrace_format(ftrace->buf + len, v);
+		ftrace->buf[len++] = '\n';
+
+		if (write(ftrace->fd, ftrace->buf, len) < 0)
+			return -1;
+	}
+
+	return 0;
+}
+
+int
+gtop_ftrace_instant(struct gtop_ftrace *ftrace, const char *name)
+{
+	int len;
+
+	len = snprintf(ftrace->buf, sizeof(ftrace->buf), "I|%d|gpu.%s\n",
+		       (int) getpid(), name);
+	if (len < 0)
+		return -1;
+	if ((size_t) len >= sizeof(ftrace->buf))
+		len = sizeof(ftrace->buf) - 1;
+
+	if (write(ftrace->fd, ftrace->buf, len) < 0)
+		return -1;
+
+	return 0;
+}
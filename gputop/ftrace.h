@@ -0,0 +1,82 @@
+/*
+ * Copyright NXP 2017
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sub license,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#ifndef __GPUTOP_FTRACE_H
+#define __GPUTOP_FTRACE_H
+
+#include <stdint.h>
+
+#include "snapshot.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define GTOP_FTRACE_DEFAULT_PATH	"/sys/kernel/tracing/trace_marker"
+#define GTOP_FTRACE_DEBUGFS_PATH	"/sys/kernel/debug/tracing/trace_marker"
+
+/* what a single write to trace_marker can hold, the kernel's TRACE_BUF_SIZE */
+#define GTOP_FTRACE_BUF_SIZE		1024
+
+struct gtop_ftrace;
+
+/**
+ * gtop_ftrace_open:
+ *
+ * Open the trace_marker file at path (NULL for the default one, tracefs or
+ * debugfs) and prepare the records for the per-core busy percentage, the
+ * non-idle percentage of each DMA engine, the governor level and, if not
+ * NULL, the comma-separated list of metric names in metrics (e.g.
+ * "ctr1.<counter>"). Returns NULL on error.
+ */
+struct gtop_ftrace *
+gtop_ftrace_open(const char *path, const struct gtop_snapshot_names *names,
+		 const char *metrics);
+
+void
+gtop_ftrace_close(struct gtop_ftrace *ftrace);
+
+/**
+ * gtop_ftrace_write:
+ *
+ * Write the records for a snapshot, one write() each as the kernel makes
+ * a single trace event of a write. Each record is an atrace counter line,
+ * "C|<pid>|gpu.<name>|<value>", so trace viewers show one counter track per
+ * name. The governor is only written when it changes.
+ */
+int
+gtop_ftrace_write(struct gtop_ftrace *ftrace, const struct gtop_snapshot *snap);
+
+/**
+ * gtop_ftrace_instant:
+ *
+ * Write an atrace instant event, "I|<pid>|gpu.<name>", e.g. for clients
+ * arriving or exiting.
+ */
+int
+gtop_ftrace_instant(struct gtop_ftrace *ftrace, const char *name);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __GPUTOP_FTRACE_H */
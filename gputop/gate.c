@@ -0,0 +1,277 @@
+/*
+ * Copyright NXP 2017
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sub license,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <fnmatch.h>
+#include <math.h>
+
+#include "gate.h"
+#include "compare.h"
+#include "util.h"
+
+#define GTOP_GATE_LINE_LEN	256
+
+enum gtop_gate_op {
+	GTOP_GATE_RISE,
+	GTOP_GATE_DROP,
+	GTOP_GATE_BELOW,
+	GTOP_GATE_ABOVE,
+};
+
+static const char *gtop_gate_ops[] = {
+	[GTOP_GATE_RISE]	= "rise",
+	[GTOP_GATE_DROP]	= "drop",
+	[GTOP_GATE_BELOW]	= "below",
+	[GTOP_GATE_ABOVE]	= "above",
+};
+
+struct gtop_gate_rule {
+	char metric[GTOP_METRIC_NAME_LEN];
+	enum gtop_gate_op op;
+	double limit;
+	bool percent;
+};
+
+struct gtop_gate {
+	struct gtop_report baseline;
+	struct gtop_report run;
+
+	FILE *f;
+	int verbose;
+
+	uint32_t checks;
+	uint32_t failed;
+};
+
+static int
+gtop_gate_parse(const char *line, struct gtop_gate_rule *rule)
+{
+	char metric[GTOP_GATE_LINE_LEN], op[16], limit[32], *end;
+	size_t i;
+
+	if (sscanf(line, "%255s %15s %31s", metric, op, limit) != 3 ||
+	    strlen(metric) >= sizeof(rule->metric))
+		return -1;
+
+	for (i = 0; i < ARRAY_SIZE(gtop_gate_ops); i++)
+		if (!strcmp(op, gtop_gate_ops[i]))
+			break;
+	if (i == ARRAY_SIZE(gtop_gate_ops))
+		return -1;
+
+	strcpy(rule->metric, metric);
+	rule->op = i;
+	rule->limit = strtod(limit, &end);
+	rule->percent = *end == '%';
+
+	if (end == limit || (*end && strcmp(end, "%")) ||
+	    (rule->percent && rule->op >= GTOP_GATE_BELOW))
+		return -1;
+
+	return 0;
+}
+
+/*
+ * check one metric, -1 if there's nothing to check it against
+ */
+static int
+gtop_gate_metric(struct gtop_gate *gate, const struct gtop_gate_rule *rule,
+		 uint32_t m, const char *name)
+{
+	struct gtop_compare cmp;
+	double value;
+	bool ok;
+
+	if (rule->op >= GTOP_GATE_BELOW) {
+		if (!gate->run.metrics[m].count)
+			return -1;
+
+		value = gtop_compare_mean(&gate->run, m);
+		ok = rule->op == GTOP_GATE_BELOW ? value < rule->limit : value > rule->limit;
+
+		gate->checks++;
+		if (!ok)
+			gate->failed++;
+		if (!ok || gate->verbose)
+			fprintf(gate->f, "%s %s %s %g: %.2f\n", ok ? "PASS" : "FAIL",
+				name, gtop_gate_ops[rule->op], rule->limit, value);
+		return 0;
+	}
+
+	/* rise and drop go from the baseline to the run */
+	if (gtop_compare_metric(&gate->baseline, &gate->run, m, 0.95, &cmp) < 0)
+		return -1;
+
+	/* from a baseline of 0, any rise is infinitely many % of it */
+	if (!cmp.a && !isnan(cmp.diff))
+		cmp.change = cmp.diff > 0 ? INFINITY : cmp.diff < 0 ? -INFINITY : 0;
+
+	value = rule->percent ? cmp.change : cmp.diff;
+	if (rule->op == GTOP_GATE_DROP)
+		value = -value;
+	ok = value <= rule->limit;
+
+	gate->checks++;
+	if (!ok)
+		gate->failed++;
+	if (!ok || gate->verbose)
+		fprintf(gate->f, "%s %s %s %g%s: %.2f -> %.2f (%+.2f, %+.1f%%, +/- %.2f)\n",
+			ok ? "PASS" : "FAIL", name, gtop_gate_ops[rule->op], rule->limit,
+			rule->percent ? "%" : "", cmp.a, cmp.b, cmp.diff, cmp.change,
+			(cmp.high - cmp.low) / 2);
+
+	return 0;
+}
+
+/*
+ * rules are written with the baseline's names
+ */
+static int
+gtop_gate_rule(struct gtop_gate *gate, const struct gtop_gate_rule *rule)
+{
+	const struct gtop_report *report = rule->op >= GTOP_GATE_BELOW ?
+		&gate->run : &gate->baseline;
+	char name[GTOP_METRIC_NAME_LEN];
+	uint32_t m, matched = 0;
+
+	for (m = 0; m < GTOP_METRIC_NR; m++) {
+		if (!gtop_snapshot_metric_name(&report->names, m, name, sizeof(name)) ||
+		    fnmatch(rule->metric, name, 0))
+			continue;
+
+		if (gtop_gate_metric(gate, rule, m, name) == 0)
+			matched++;
+	}
+
+	if (!matched) {
+		fprintf(gate->f, "FAIL %s %s: no such metric in both recordings\n",
+			rule->metric, gtop_gate_ops[rule->op]);
+		gate->checks++;
+		gate->failed++;
+	}
+
+	return 0;
+}
+
+int
+gtop_gate_check(const char *rules_path, const char *baseline, const char *path,
+		FILE *f, int verbose)
+{
+	char line[GTOP_GATE_LINE_LEN];
+	struct gtop_gate_rule rule;
+	struct gtop_gate *gate;
+	uint32_t nr = 0;
+	FILE *rules;
+	int ret = GTOP_GATE_ERROR;
+
+	rules = fopen(rules_path, "r");
+	if (!rules) {
+		fprintf(stderr, "Failed to open %s\n", rules_path);
+		return GTOP_GATE_ERROR;
+	}
+
+	gate = calloc(1, sizeof(*gate));
+	if (!gate)
+		goto out_rules;
+
+	gate->f = f;
+	gate->verbose = verbose;
+
+	if (gtop_report_build(&gate->baseline, baseline, 0, 0, UINT64_MAX, 0.0) < 0)
+		goto out_gate;
+	if (gtop_report_build(&gate->run, path, 0, 0, UINT64_MAX, 0.0) < 0)
+		goto out_baseline;
+
+	/* too little was sampled, that says nothing about performance */
+	if (gate->baseline.nr_snapshots < 2 || gate->run.nr_snapshots < 2) {
+		fprintf(stderr, "%s: fewer than 2 snapshots to check\n",
+			gate->baseline.nr_snapshots < 2 ? baseline : path);
+		goto out_run;
+	}
+
+	while (fgets(line, sizeof(line), rules)) {
+		char *p = line + strspn(line, " \t");
+
+		nr++;
+		if (*p == '#' || *p == '\n' || !*p)
+			continue;
+
+		if (gtop_gate_parse(p, &rule) < 0) {
+			fprintf(stderr, "%s:%u: invalid rule\n", rules_path, nr);
+			goto out_run;
+		}
+
+		gtop_gate_rule(gate, &rule);
+	}
+
+	fprintf(f, "%u of %u checks failed\n", gate->failed, gate->checks);
+	ret = gate->failed ? GTOP_GATE_FAIL : GTOP_GATE_PASS;
+
+out_run:
+	gtop_report_fini(&gate->run);
+out_baseline:
+	gtop_report_fini(&gate->baseline);
+out_gate:
+	free(gate);
+out_rules:
+	fclose(rules);
+	return ret;
+}
+
+static void
+gtop_gate_usage(void)
+{
+	fprintf(stderr, "Usage: gputop gate [-v] <rules> <baseline> <recording>\n");
+	fprintf(stderr, "  -v            Print every check, not only the failed ones\n");
+}
+
+int
+gtop_gate_main(int argc, char **argv)
+{
+	int c, verbose = 0;
+
+	optind = 1;
+	while ((c = getopt(argc, argv, "vh")) != -1) {
+		switch (c) {
+		case 'v':
+			verbose = 1;
+			break;
+		case 'h':
+		default:
+			gtop_gate_usage();
+			return GTOP_GATE_ERROR;
+		}
+	}
+
+	if (optind != argc - 3) {
+		gtop_gate_usage();
+		return GTOP_GATE_ERROR;
+	}
+
+	return gtop_gate_check(argv[optind], argv[optind + 1], argv[optind + 2],
+			       stdout, verbose);
+}
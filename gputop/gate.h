@@ -0,0 +1,76 @@
+/*
+ * Copyright NXP 2017
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sub license,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#ifndef __GPUTOP_GATE_H
+#define __GPUTOP_GATE_H
+
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * A rules file has one check per line, # starts a comment:
+ *
+ *	<metric> rise <n>[%]	mean must not go up by more than n, or n%
+ *	<metric> drop <n>[%]	mean must not go down by more than n, or n%
+ *	<metric> below <n>	mean must stay below n
+ *	<metric> above <n>	mean must stay above n
+ *
+ * rise and drop are against the baseline recording, below and above only
+ * look at the new one. Any rise from a baseline mean of 0 is infinitely
+ * many %. Metrics are named as printed by -C and may be
+ * shell patterns (e.g. "ctr1.*"), a rule then applies to every match.
+ * Values are in the units of `gputop compare`: % for occupancy and DMA
+ * states, MB/s for DDR, events/s for counters.
+ */
+#define GTOP_GATE_PASS		0
+#define GTOP_GATE_FAIL		1
+#define GTOP_GATE_ERROR		2
+
+/**
+ * gtop_gate_check:
+ *
+ * Evaluate the rules at rules_path on the recording at path against the
+ * one at baseline. Prints a line per failed check (per check with verbose)
+ * and a summary to f. Returns GTOP_GATE_PASS, GTOP_GATE_FAIL or
+ * GTOP_GATE_ERROR, usable as an exit status; a recording with fewer
+ * than 2 snapshots is an error.
+ */
+int
+gtop_gate_check(const char *rules_path, const char *baseline, const char *path,
+		FILE *f, int verbose);
+
+/**
+ * gtop_gate_main:
+ *
+ * `gputop gate`, gtop_gate_check() on recordings made earlier.
+ */
+int
+gtop_gate_main(int argc, char **argv);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __GPUTOP_GATE_H */
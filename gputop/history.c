@@ -0,0 +1,354 @@
+/*
+ * Copyright NXP 2017
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sub license,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "history.h"
+
+#define GTOP_HISTORY_SEC	1000000000ULL
+
+struct gtop_history_ring {
+	/* period (ns) covered by one entry, 0 for one entry per snapshot */
+	uint64_t resolution;
+	/* nominal span, before being shrunk to fit the budget */
+	uint64_t span;
+
+	uint32_t nr_slots;
+	/* next slot to be written, and how many are in use */
+	uint32_t head;
+	uint32_t used;
+
+	/* start of the period of each slot */
+	uint64_t *start;
+
+	/* nr_slots * nr_metrics, values for the raw tier, rollups otherwise */
+	float *values;
+	struct gtop_rollup *rollups;
+
+	/* period being accumulated, it goes into the ring once it's over */
+	bool open;
+	uint64_t open_start;
+	struct gtop_rollup *acc;
+};
+
+struct gtop_history {
+	uint32_t nr_metrics;
+	/* metric id -> column, -1 for metrics not kept */
+	int16_t column[GTOP_METRIC_NR];
+	uint16_t metric[GTOP_METRIC_NR];
+
+	uint64_t interval;
+	uint64_t last;
+	size_t size;
+
+	struct gtop_history_ring tiers[GTOP_HISTORY_NR_TIERS];
+
+	float scratch[GTOP_METRIC_NR];
+};
+
+static size_t
+gtop_history_row_size(const struct gtop_history *history, enum gtop_history_tier tier)
+{
+	size_t row = sizeof(uint64_t);
+
+	if (tier == GTOP_HISTORY_RAW)
+		row += history->nr_metrics * sizeof(float);
+	else
+		row += history->nr_metrics * sizeof(struct gtop_rollup);
+
+	return row;
+}
+
+struct gtop_history *
+gtop_history_create(size_t size, const struct gtop_snapshot_names *names,
+		    uint64_t interval)
+{
+	struct gtop_history *history;
+	char name[GTOP_METRIC_NAME_LEN];
+	size_t fixed, wanted = 0;
+	uint32_t m, t;
+
+	history = calloc(1, sizeof(*history));
+	if (!history)
+		return NULL;
+
+	for (m = 0; m < GTOP_METRIC_NR; m++) {
+		history->column[m] = -1;
+		if (gtop_snapshot_metric_name(names, m, name, sizeof(name))) {
+			history->metric[history->nr_metrics] = m;
+			history->column[m] = history->nr_metrics++;
+		}
+	}
+
+	if (!interval)
+		interval = GTOP_HISTORY_SEC;
+	history->interval = interval;
+
+	history->tiers[GTOP_HISTORY_RAW].span = 60 * GTOP_HISTORY_SEC;
+	history->tiers[GTOP_HISTORY_RAW].nr_slots = 60 * GTOP_HISTORY_SEC / interval;
+
+	history->tiers[GTOP_HISTORY_SECONDS].resolution = GTOP_HISTORY_SEC;
+	history->tiers[GTOP_HISTORY_SECONDS].span = 3600 * GTOP_HISTORY_SEC;
+
+	history->tiers[GTOP_HISTORY_MINUTES].resolution = 60 * GTOP_HISTORY_SEC;
+	history->tiers[GTOP_HISTORY_MINUTES].span = 24 * 3600 * GTOP_HISTORY_SEC;
+
+	/* accumulators and the structure itself are always there */
+	fixed = sizeof(*history) +
+		(GTOP_HISTORY_NR_TIERS - 1) * history->nr_metrics * sizeof(struct gtop_rollup);
+
+	for (t = 0; t < GTOP_HISTORY_NR_TIERS; t++) {
+		struct gtop_history_ring *ring = &history->tiers[t];
+
+		if (ring->resolution)
+			ring->nr_slots = ring->span / ring->resolution;
+		if (!ring->nr_slots)
+			ring->nr_slots = 1;
+
+		wanted += ring->nr_slots * gtop_history_row_size(history, t);
+	}
+
+	/* shrink every tier by the same factor to stay within the budget */
+	if (size && size > fixed && wanted > size - fixed) {
+		double factor = (double) (size - fixed) / (double) wanted;
+
+		for (t = 0; t < GTOP_HISTORY_NR_TIERS; t++) {
+			struct gtop_history_ring *ring = &history->tiers[t];
+
+			ring->nr_slots = ring->nr_slots * factor;
+			if (!ring->nr_slots)
+				ring->nr_slots = 1;
+		}
+	} else if (size && size <= fixed) {
+		for (t = 0; t < GTOP_HISTORY_NR_TIERS; t++)
+			history->tiers[t].nr_slots = 1;
+	}
+
+	history->size = fixed;
+
+	for (t = 0; t < GTOP_HISTORY_NR_TIERS; t++) {
+		struct gtop_history_ring *ring = &history->tiers[t];
+		size_t cells = (size_t) ring->nr_slots * history->nr_metrics;
+
+		ring->start = calloc(ring->nr_slots, sizeof(uint64_t));
+
+		if (t == GTOP_HISTORY_RAW) {
+			ring->values = calloc(cells, sizeof(float));
+		} else {
+			ring->rollups = calloc(cells, sizeof(struct gtop_rollup));
+			ring->acc = calloc(history->nr_metrics, sizeof(struct gtop_rollup));
+		}
+
+		if (!ring->start || (!ring->values && !ring->rollups) ||
+		    (t != GTOP_HISTORY_RAW && !ring->acc)) {
+			gtop_history_destroy(history);
+			return NULL;
+		}
+
+		history->size += ring->nr_slots * gtop_history_row_size(history, t);
+	}
+
+	if (history->size < fixed + wanted)
+		fprintf(stderr, "History within %zuK keeps %.0fs of snapshots, "
+			"%.0fmin of seconds and %.1fh of minutes; %zuK keeps them all\n",
+			size / 1024,
+			gtop_history_span(history, GTOP_HISTORY_RAW) / 1e9,
+			gtop_history_span(history, GTOP_HISTORY_SECONDS) / 60e9,
+			gtop_history_span(history, GTOP_HISTORY_MINUTES) / 3600e9,
+			(fixed + wanted + 1023) / 1024);
+
+	return history;
+}
+
+void
+gtop_history_destroy(struct gtop_history *history)
+{
+	uint32_t t;
+
+	if (!history)
+		return;
+
+	for (t = 0; t < GTOP_HISTORY_NR_TIERS; t++) {
+		free(history->tiers[t].start);
+		free(history->tiers[t].values);
+		free(history->tiers[t].rollups);
+		free(history->tiers[t].acc);
+	}
+
+	free(history);
+}
+
+static void
+gtop_history_ring_push(struct gtop_history_ring *ring, uint64_t start)
+{
+	ring->start[ring->head] = start;
+	ring->head = (ring->head + 1) % ring->nr_slots;
+
+	if (ring->used < ring->nr_slots)
+		ring->used++;
+}
+
+void
+gtop_history_add(struct gtop_history *history, const struct gtop_snapshot *snap)
+{
+	uint32_t c, t;
+
+	gtop_snapshot_metrics(snap, history->scratch);
+	history->last = snap->timestamp;
+
+	for (t = 0; t < GTOP_HISTORY_NR_TIERS; t++) {
+		struct gtop_history_ring *ring = &history->tiers[t];
+		uint64_t period;
+
+		if (t == GTOP_HISTORY_RAW) {
+			float *row = &ring->values[(size_t) ring->head * history->nr_metrics];
+
+			for (c = 0; c < history->nr_metrics; c++)
+				row[c] = history->scratch[history->metric[c]];
+
+			gtop_history_ring_push(ring, snap->timestamp);
+			continue;
+		}
+
+		period = snap->timestamp - snap->timestamp % ring->resolution;
+
+		/* the previous period is over, move it into the ring */
+		if (ring->open && period != ring->open_start) {
+			memcpy(&ring->rollups[(size_t) ring->head * history->nr_metrics],
+			       ring->acc, history->nr_metrics * sizeof(struct gtop_rollup));
+			gtop_history_ring_push(ring, ring->open_start);
+
+			memset(ring->acc, 0, history->nr_metrics * sizeof(struct gtop_rollup));
+		}
+
+		ring->open = true;
+		ring->open_start = period;
+
+		for (c = 0; c < history->nr_metrics; c++) {
+			float value = history->scratch[history->metric[c]];
+
+			if (!isnan(value))
+				gtop_rollup_add(&ring->acc[c], value);
+		}
+	}
+}
+
+size_t
+gtop_history_size(const struct gtop_history *history)
+{
+	return history->size;
+}
+
+uint64_t
+gtop_history_span(const struct gtop_history *history, enum gtop_history_tier tier)
+{
+	const struct gtop_history_ring *ring = &history->tiers[tier];
+
+	if (ring->resolution)
+		return ring->nr_slots * ring->resolution;
+
+	return ring->nr_slots * history->interval;
+}
+
+uint32_t
+gtop_history_count(const struct gtop_history *history, enum gtop_history_tier tier)
+{
+	const struct gtop_history_ring *ring = &history->tiers[tier];
+
+	return ring->used + (ring->open ? 1 : 0);
+}
+
+bool
+gtop_history_get(const struct gtop_history *history, enum gtop_history_tier tier,
+		 uint32_t idx, uint32_t metric, uint64_t *timestamp,
+		 struct gtop_rollup *rollup)
+{
+	const struct gtop_history_ring *ring;
+	uint32_t slot;
+	int c;
+
+	if (tier >= GTOP_HISTORY_NR_TIERS || metric >= GTOP_METRIC_NR)
+		return false;
+
+	ring = &history->tiers[tier];
+	c = history->column[metric];
+
+	if (c < 0 || idx >= gtop_history_count(history, tier))
+		return false;
+
+	memset(rollup, 0, sizeof(*rollup));
+
+	/* the one still being filled comes last */
+	if (idx == ring->used) {
+		*timestamp = ring->open_start;
+		*rollup = ring->acc[c];
+		return true;
+	}
+
+	slot = (ring->head + ring->nr_slots - ring->used + idx) % ring->nr_slots;
+	*timestamp = ring->start[slot];
+
+	if (tier == GTOP_HISTORY_RAW) {
+		float value = ring->values[(size_t) slot * history->nr_metrics + c];
+
+		if (!isnan(value))
+			gtop_rollup_add(rollup, value);
+	} else {
+		*rollup = ring->rollups[(size_t) slot * history->nr_metrics + c];
+	}
+
+	return true;
+}
+
+bool
+gtop_history_query(const struct gtop_history *history, uint32_t metric,
+		   uint64_t span, struct gtop_rollup *rollup)
+{
+	uint64_t since = history->last > span ? history->last - span : 0;
+	enum gtop_history_tier tier;
+	uint32_t idx, count;
+
+	memset(rollup, 0, sizeof(*rollup));
+
+	/* finest tier reaching back far enough, or the coarsest one */
+	for (tier = GTOP_HISTORY_RAW; tier < GTOP_HISTORY_MINUTES; tier++)
+		if (gtop_history_span(history, tier) >= span)
+			break;
+
+	count = gtop_history_count(history, tier);
+	for (idx = count; idx > 0; idx--) {
+		struct gtop_rollup entry;
+		uint64_t timestamp;
+
+		if (!gtop_history_get(history, tier, idx - 1, metric, &timestamp, &entry))
+			return false;
+		if (timestamp < since)
+			break;
+
+		gtop_rollup_merge(rollup, &entry);
+	}
+
+	return rollup->count != 0;
+}
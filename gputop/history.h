@@ -0,0 +1,171 @@
+/*
+ * Copyright NXP 2017
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sub license,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __GPUTOP_HISTORY_H
+#define __GPUTOP_HISTORY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "snapshot.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * history tiers, from finest to coarsest: every snapshot for the last
+ * minute, 1s rollups for the last hour, 1min rollups for the last day
+ */
+enum gtop_history_tier {
+	GTOP_HISTORY_RAW,
+	GTOP_HISTORY_SECONDS,
+	GTOP_HISTORY_MINUTES,
+
+	GTOP_HISTORY_NR_TIERS,
+};
+
+/**
+ * gtop_rollup:
+ *
+ * Statistics for one metric over a period. count is 0 if the metric wasn't
+ * sampled at all in that period.
+ */
+struct gtop_rollup {
+	float min;
+	float max;
+	float sum;
+	uint32_t count;
+};
+
+static inline float
+gtop_rollup_mean(const struct gtop_rollup *r)
+{
+	return r->count ? r->sum / r->count : 0.0f;
+}
+
+static inline void
+gtop_rollup_add(struct gtop_rollup *r, float value)
+{
+	if (!r->count || value < r->min)
+		r->min = value;
+	if (!r->count || value > r->max)
+		r->max = value;
+
+	r->sum += value;
+	r->count++;
+}
+
+static inline void
+gtop_rollup_merge(struct gtop_rollup *r, const struct gtop_rollup *other)
+{
+	if (!other->count)
+		return;
+
+	if (!r->count || other->min < r->min)
+		r->min = other->min;
+	if (!r->count || other->max > r->max)
+		r->max = other->max;
+
+	r->sum += other->sum;
+	r->count += other->count;
+}
+
+struct gtop_history;
+
+/**
+ * gtop_history_create:
+ *
+ * Create a store that never uses more than size bytes, 0 for what the
+ * nominal spans need. Only the metrics that have a name in names are kept.
+ * interval is the expected time between two snapshots (ns), used to size
+ * the raw tier. If size is too small for the nominal spans, every tier is
+ * shrunk by the same factor, and a warning tells by how much.
+ */
+struct gtop_history *
+gtop_history_create(size_t size, const struct gtop_snapshot_names *names,
+		    uint64_t interval);
+
+void
+gtop_history_destroy(struct gtop_history *history);
+
+/**
+ * gtop_history_add:
+ *
+ * Add a snapshot to all tiers.
+ */
+void
+gtop_history_add(struct gtop_history *history, const struct gtop_snapshot *snap);
+
+/**
+ * gtop_history_size:
+ *
+ * Bytes actually used by the store.
+ */
+size_t
+gtop_history_size(const struct gtop_history *history);
+
+/**
+ * gtop_history_span:
+ *
+ * How far back (ns) a tier reaches once full.
+ */
+uint64_t
+gtop_history_span(const struct gtop_history *history, enum gtop_history_tier tier);
+
+/**
+ * gtop_history_count:
+ *
+ * Number of entries held in a tier, including the one still being filled.
+ */
+uint32_t
+gtop_history_count(const struct gtop_history *history, enum gtop_history_tier tier);
+
+/**
+ * gtop_history_get:
+ *
+ * Entry idx of a tier for a metric, 0 being the oldest. timestamp is set to
+ * the start of the period. Returns false if idx or metric are out of range
+ * or the metric is not kept.
+ */
+bool
+gtop_history_get(const struct gtop_history *history, enum gtop_history_tier tier,
+		 uint32_t idx, uint32_t metric, uint64_t *timestamp,
+		 struct gtop_rollup *rollup);
+
+/**
+ * gtop_history_query:
+ *
+ * Statistics of a metric over the last span ns, using the finest tier that
+ * covers it. Returns false if nothing has been recorded for it.
+ */
+bool
+gtop_history_query(const struct gtop_history *history, uint32_t metric,
+		   uint64_t span, struct gtop_rollup *rollup);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __GPUTOP_HISTORY_H */
@@ -0,0 +1,44 @@
+/*
+ * Copyright NXP 2017
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sub license,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+/*
+ * entry point for host builds, without libgpuperfcnt: only the offline
+ * subcommands are available
+ */
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "tools.h"
+
+int main(int argc, char *argv[])
+{
+	const struct gtop_tool *tool;
+
+	if (argc > 1 && (tool = gtop_tool_find(argv[1])))
+		return tool->main(argc - 1, argv + 1);
+
+	fprintf(stderr, "Usage: %s <command> [args]\n", argv[0]);
+	fprintf(stderr, "Built without libgpuperfcnt, available commands:\n");
+	gtop_tools_help(stderr);
+
+	return EXIT_FAILURE;
+}
@@ -0,0 +1,569 @@
+/*
+ * Copyright NXP 2017
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sub license,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <math.h>
+#include <time.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "markers.h"
+#include "sockpath.h"
+
+#define GTOP_MARKERS_BUF_SIZE	4096
+
+struct gtop_markers_range {
+	char name[GTOP_RECORD_RANGE_NAME_LEN];
+	uint64_t count;
+
+	/* instance being accumulated */
+	bool open;
+	uint64_t begin;
+	uint32_t samples;
+	uint32_t busy;
+	uint32_t nr_counters[2];
+	uint64_t counters[2][GTOP_SNAPSHOT_MAX_COUNTERS];
+
+	/* costs of the last instances, GTOP_MARKERS_HISTORY rows */
+	float *history;
+	uint32_t head;
+	uint32_t used;
+};
+
+struct gtop_markers {
+	int fd;
+	/* wakes up the reader when we're done */
+	int stop[2];
+	pthread_t reader;
+	bool reader_started;
+	/* everything below, between the reader and the sampling loop */
+	pthread_mutex_t lock;
+
+	bool fifo;
+	/* our own writer, so the FIFO doesn't hit EOF between applications */
+	int fifo_wr;
+	char *path;
+
+	/* partial line read from the FIFO */
+	char buf[GTOP_MARKERS_BUF_SIZE];
+	size_t buf_len;
+
+	struct gtop_markers_range ranges[GTOP_MARKERS_MAX_RANGES];
+	uint32_t nr_ranges;
+
+	struct gtop_record_range pending[GTOP_MARKERS_PENDING];
+	uint32_t pending_head;
+	uint32_t pending_nr;
+
+	float scratch[GTOP_MARKERS_HISTORY];
+};
+
+static uint64_t
+gtop_markers_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void *
+gtop_markers_read(void *arg);
+
+struct gtop_markers *
+gtop_markers_create(const char *path)
+{
+	struct gtop_markers *markers;
+	struct sockaddr_un addr;
+	struct stat st;
+
+	markers = calloc(1, sizeof(*markers));
+	if (!markers)
+		return NULL;
+
+	markers->fd = -1;
+	markers->fifo_wr = -1;
+	markers->stop[0] = markers->stop[1] = -1;
+	pthread_mutex_init(&markers->lock, NULL);
+
+	if (!stat(path, &st) && S_ISFIFO(st.st_mode)) {
+		markers->fifo = true;
+		markers->fd = open(path, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+		if (markers->fd >= 0)
+			markers->fifo_wr = open(path, O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+
+		if (markers->fd < 0 || markers->fifo_wr < 0) {
+			fprintf(stderr, "Failed to open %s: %s\n", path, strerror(errno));
+			goto err;
+		}
+
+		goto start;
+	}
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+
+	if (strlen(path) >= sizeof(addr.sun_path)) {
+		fprintf(stderr, "Socket path %s too long\n", path);
+		goto err;
+	}
+	strcpy(addr.sun_path, path);
+
+	markers->fd = socket(AF_UNIX, SOCK_DGRAM, 0);
+	if (markers->fd < 0) {
+		fprintf(stderr, "Failed to create socket: %s\n", strerror(errno));
+		goto err;
+	}
+
+	/* another gputop listens there, or path is someone else's */
+	if (gtop_sockpath_claim(path, SOCK_DGRAM) < 0)
+		goto err;
+
+	if (bind(markers->fd, (struct sockaddr *) &addr, sizeof(addr)) < 0) {
+		fprintf(stderr, "Failed to bind %s: %s\n", path, strerror(errno));
+		goto err;
+	}
+
+	markers->path = strdup(path);
+	if (!markers->path)
+		goto err;
+
+start:
+	if (pipe(markers->stop) < 0) {
+		fprintf(stderr, "Failed to create pipe: %s\n", strerror(errno));
+		goto err;
+	}
+
+	if (pthread_create(&markers->reader, NULL, gtop_markers_read, markers)) {
+		fprintf(stderr, "Failed to start the marker reader\n");
+		goto err;
+	}
+	markers->reader_started = true;
+
+	return markers;
+
+err:
+	gtop_markers_destroy(markers);
+	return NULL;
+}
+
+void
+gtop_markers_destroy(struct gtop_markers *markers)
+{
+	uint32_t i;
+
+	if (!markers)
+		return;
+
+	if (markers->reader_started) {
+		(void) !write(markers->stop[1], "", 1);
+		pthread_join(markers->reader, NULL);
+	}
+	if (markers->stop[0] >= 0) {
+		close(markers->stop[0]);
+		close(markers->stop[1]);
+	}
+
+	if (markers->fd >= 0)
+		close(markers->fd);
+	if (markers->fifo_wr >= 0)
+		close(markers->fifo_wr);
+
+	if (markers->path) {
+		unlink(markers->path);
+		free(markers->path);
+	}
+
+	for (i = 0; i < markers->nr_ranges; i++)
+		free(markers->ranges[i].history);
+
+	pthread_mutex_destroy(&markers->lock);
+	free(markers);
+}
+
+static struct gtop_markers_range *
+gtop_markers_get(struct gtop_markers *markers, const char *name)
+{
+	struct gtop_markers_range *range;
+	uint32_t i;
+
+	for (i = 0; i < markers->nr_ranges; i++)
+		if (!strcmp(markers->ranges[i].name, name))
+			return &markers->ranges[i];
+
+	if (markers->nr_ranges == GTOP_MARKERS_MAX_RANGES)
+		return NULL;
+
+	range = &markers->ranges[markers->nr_ranges];
+	memset(range, 0, sizeof(*range));
+
+	range->history = malloc(GTOP_MARKERS_HISTORY * GTOP_MARKERS_NR_COSTS * sizeof(float));
+	if (!range->history)
+		return NULL;
+
+	snprintf(range->name, sizeof(range->name), "%s", name);
+	markers->nr_ranges++;
+
+	return range;
+}
+
+static void
+gtop_markers_begin(struct gtop_markers_range *range, uint64_t now)
+{
+	range->open = true;
+	range->begin = now;
+	range->samples = 0;
+	range->busy = 0;
+	memset(range->nr_counters, 0, sizeof(range->nr_counters));
+	memset(range->counters, 0, sizeof(range->counters));
+}
+
+static void
+gtop_markers_end(struct gtop_markers *markers, struct gtop_markers_range *range,
+		 uint64_t now)
+{
+	struct gtop_record_range *pending;
+	float *costs;
+	uint32_t p, c, n = 0;
+
+	if (!range->open)
+		return;
+
+	range->open = false;
+	range->count++;
+
+	costs = &range->history[range->head * GTOP_MARKERS_NR_COSTS];
+	range->head = (range->head + 1) % GTOP_MARKERS_HISTORY;
+	if (range->used < GTOP_MARKERS_HISTORY)
+		range->used++;
+
+	/* drop the oldest one nobody took */
+	if (markers->pending_nr == GTOP_MARKERS_PENDING) {
+		markers->pending_head = (markers->pending_head + 1) % GTOP_MARKERS_PENDING;
+		markers->pending_nr--;
+	}
+	pending = &markers->pending[(markers->pending_head + markers->pending_nr) %
+				    GTOP_MARKERS_PENDING];
+	markers->pending_nr++;
+
+	memset(pending, 0, offsetof(struct gtop_record_range, counters));
+	memcpy(pending->name, range->name, sizeof(pending->name));
+	pending->begin = range->begin;
+	pending->end = now;
+	pending->samples = range->samples;
+	pending->busy = range->busy;
+
+	costs[GTOP_MARKERS_COST_DURATION] = (now - range->begin) / 1e6;
+	costs[GTOP_MARKERS_COST_BUSY] = range->samples ?
+		100.0f * range->busy / range->samples : NAN;
+
+	for (p = 0; p < 2; p++) {
+		pending->nr_counters[p] = range->nr_counters[p];
+
+		for (c = 0; c < GTOP_SNAPSHOT_MAX_COUNTERS; c++) {
+			float value = c < range->nr_counters[p] ? range->counters[p][c] : NAN;
+
+			costs[GTOP_MARKERS_COST_COUNTERS + p * GTOP_SNAPSHOT_MAX_COUNTERS + c] = value;
+			if (c < range->nr_counters[p])
+				pending->counters[n++] = value;
+		}
+	}
+}
+
+static void
+gtop_markers_line(struct gtop_markers *markers, char *line, uint64_t now)
+{
+	struct gtop_markers_range *range;
+	char *name;
+	size_t len = strlen(line);
+
+	while (len && (line[len - 1] == '\r' || line[len - 1] == ' '))
+		line[--len] = '\0';
+
+	if (!len)
+		return;
+
+	if (line[0] == 'F' && len == 1) {
+		range = gtop_markers_get(markers, GTOP_MARKERS_FRAME);
+		if (range) {
+			gtop_markers_end(markers, range, now);
+			gtop_markers_begin(range, now);
+		}
+		return;
+	}
+
+	if ((line[0] != 'B' && line[0] != 'E') || line[1] != ' ')
+		return;
+
+	name = line + 2;
+	if (strlen(name) >= GTOP_RECORD_RANGE_NAME_LEN)
+		name[GTOP_RECORD_RANGE_NAME_LEN - 1] = '\0';
+
+	range = gtop_markers_get(markers, name);
+	if (!range)
+		return;
+
+	if (line[0] == 'B')
+		gtop_markers_begin(range, now);
+	else
+		gtop_markers_end(markers, range, now);
+}
+
+static void
+gtop_markers_lines(struct gtop_markers *markers, char *buf, size_t len,
+		   uint64_t now)
+{
+	char *line = buf, *end;
+
+	buf[len] = '\0';
+
+	while ((end = strchr(line, '\n'))) {
+		*end = '\0';
+		gtop_markers_line(markers, line, now);
+		line = end + 1;
+	}
+
+	/* datagrams don't need a trailing new line */
+	if (!markers->fifo) {
+		gtop_markers_line(markers, line, now);
+		return;
+	}
+
+	markers->buf_len = strlen(line);
+	if (markers->buf_len == sizeof(markers->buf) - 1)
+		markers->buf_len = 0;
+	memmove(markers->buf, line, markers->buf_len);
+}
+
+/*
+ * drain what is there, timestamped as of now
+ */
+static void
+gtop_markers_drain(struct gtop_markers *markers)
+{
+	char dgram[GTOP_MARKERS_BUF_SIZE];
+	uint64_t now = gtop_markers_now();
+	ssize_t n;
+
+	pthread_mutex_lock(&markers->lock);
+
+	if (markers->fifo) {
+		while ((n = read(markers->fd, markers->buf + markers->buf_len,
+				 sizeof(markers->buf) - 1 - markers->buf_len)) > 0)
+			gtop_markers_lines(markers, markers->buf,
+					   markers->buf_len + n, now);
+	} else {
+		while ((n = recv(markers->fd, dgram, sizeof(dgram) - 1, MSG_DONTWAIT)) >= 0)
+			gtop_markers_lines(markers, dgram, n, now);
+	}
+
+	pthread_mutex_unlock(&markers->lock);
+}
+
+static void *
+gtop_markers_read(void *arg)
+{
+	struct gtop_markers *markers = arg;
+	struct pollfd fds[2] = {
+		{ .fd = markers->fd, .events = POLLIN },
+		{ .fd = markers->stop[0], .events = POLLIN },
+	};
+
+	for (;;) {
+		if (poll(fds, 2, -1) < 0) {
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+
+		if (fds[1].revents)
+			break;
+
+		if (fds[0].revents & POLLIN)
+			gtop_markers_drain(markers);
+		else if (fds[0].revents)
+			break;
+	}
+
+	return NULL;
+}
+
+void
+gtop_markers_sample(struct gtop_markers *markers,
+		    const struct gtop_markers_sample *sample)
+{
+	uint32_t i, p, c;
+
+	pthread_mutex_lock(&markers->lock);
+
+	for (i = 0; i < markers->nr_ranges; i++) {
+		struct gtop_markers_range *range = &markers->ranges[i];
+
+		if (!range->open)
+			continue;
+
+		range->samples++;
+		if (sample->busy)
+			range->busy++;
+
+		for (p = 0; p < 2; p++) {
+			uint32_t nr = sample->nr_counters[p];
+
+			if (nr > GTOP_SNAPSHOT_MAX_COUNTERS)
+				nr = GTOP_SNAPSHOT_MAX_COUNTERS;
+			if (nr > range->nr_counters[p])
+				range->nr_counters[p] = nr;
+
+			for (c = 0; c < nr; c++)
+				range->counters[p][c] += sample->counters[p][c];
+		}
+	}
+
+	pthread_mutex_unlock(&markers->lock);
+}
+
+uint32_t
+gtop_markers_take(struct gtop_markers *markers, struct gtop_record_range *ranges,
+		  uint32_t max)
+{
+	uint32_t n = 0;
+
+	pthread_mutex_lock(&markers->lock);
+	while (n < max && markers->pending_nr) {
+		ranges[n++] = markers->pending[markers->pending_head];
+		markers->pending_head = (markers->pending_head + 1) % GTOP_MARKERS_PENDING;
+		markers->pending_nr--;
+	}
+	pthread_mutex_unlock(&markers->lock);
+
+	return n;
+}
+
+uint32_t
+gtop_markers_nr_ranges(struct gtop_markers *markers)
+{
+	uint32_t n;
+
+	pthread_mutex_lock(&markers->lock);
+	n = markers->nr_ranges;
+	pthread_mutex_unlock(&markers->lock);
+
+	return n;
+}
+
+const char *
+gtop_markers_range(struct gtop_markers *markers, uint32_t idx,
+		   uint64_t *count)
+{
+	const char *name = NULL;
+
+	pthread_mutex_lock(&markers->lock);
+	if (idx < markers->nr_ranges) {
+		*count = markers->ranges[idx].count;
+		/* names don't change once in */
+		name = markers->ranges[idx].name;
+	}
+	pthread_mutex_unlock(&markers->lock);
+
+	return name;
+}
+
+static int
+gtop_markers_cmp(const void *a, const void *b)
+{
+	float fa = *(const float *) a;
+	float fb = *(const float *) b;
+
+	return fa < fb ? -1 : fa > fb;
+}
+
+double
+gtop_markers_percentile(struct gtop_markers *markers, uint32_t idx,
+			uint32_t cost, double p)
+{
+	const struct gtop_markers_range *range;
+	uint32_t i, n = 0, rank;
+	double value = NAN;
+
+	if (cost >= GTOP_MARKERS_NR_COSTS)
+		return NAN;
+
+	pthread_mutex_lock(&markers->lock);
+	if (idx >= markers->nr_ranges)
+		goto out;
+
+	range = &markers->ranges[idx];
+	for (i = 0; i < range->used; i++) {
+		float v = range->history[i * GTOP_MARKERS_NR_COSTS + cost];
+
+		if (!isnan(v))
+			markers->scratch[n++] = v;
+	}
+
+	if (!n)
+		goto out;
+
+	qsort(markers->scratch, n, sizeof(float), gtop_markers_cmp);
+
+	rank = ceil(p / 100.0 * n);
+	value = markers->scratch[rank ? rank - 1 : 0];
+out:
+	pthread_mutex_unlock(&markers->lock);
+	return value;
+}
+
+double
+gtop_markers_mean(struct gtop_markers *markers, uint32_t idx, uint32_t cost)
+{
+	const struct gtop_markers_range *range;
+	double sum = 0.0;
+	uint32_t i, n = 0;
+
+	if (cost >= GTOP_MARKERS_NR_COSTS)
+		return NAN;
+
+	pthread_mutex_lock(&markers->lock);
+	if (idx < markers->nr_ranges) {
+		range = &markers->ranges[idx];
+		for (i = 0; i < range->used; i++) {
+			float value = range->history[i * GTOP_MARKERS_NR_COSTS + cost];
+
+			if (!isnan(value)) {
+				sum += value;
+				n++;
+			}
+		}
+	}
+	pthread_mutex_unlock(&markers->lock);
+
+	return n ? sum / n : NAN;
+}
@@ -0,0 +1,149 @@
+/*
+ * Copyright NXP 2017
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sub license,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#ifndef __GPUTOP_MARKERS_H
+#define __GPUTOP_MARKERS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "snapshot.h"
+#include "record.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Applications send markers as text lines, one or more per datagram (or
+ * written to the FIFO):
+ *
+ *	B <name>	begin range name
+ *	E <name>	end range name
+ *	F		end the current frame and begin the next one
+ *
+ * Markers are read by a thread of their own and timestamped on arrival.
+ * Frames are a range called "frame".
+ */
+#define GTOP_MARKERS_FRAME		"frame"
+
+#define GTOP_MARKERS_MAX_RANGES		16
+/* instances of each range kept for percentiles */
+#define GTOP_MARKERS_HISTORY		128
+/* completed ranges waiting to be recorded */
+#define GTOP_MARKERS_PENDING		256
+
+/* what is known about a range instance */
+enum gtop_markers_cost {
+	/* ms */
+	GTOP_MARKERS_COST_DURATION,
+	/* % of the samples with core 0 busy */
+	GTOP_MARKERS_COST_BUSY,
+	/* counter deltas, part 1 then part 2 */
+	GTOP_MARKERS_COST_COUNTERS,
+
+	GTOP_MARKERS_NR_COSTS = GTOP_MARKERS_COST_COUNTERS +
+		2 * GTOP_SNAPSHOT_MAX_COUNTERS,
+};
+
+/**
+ * gtop_markers_sample:
+ *
+ * What one sample found: core 0 busy or not and, for the counters sampled,
+ * how much they moved since the previous sample.
+ */
+struct gtop_markers_sample {
+	uint64_t timestamp;
+	bool busy;
+
+	uint32_t nr_counters[2];
+	const uint64_t *counters[2];
+};
+
+struct gtop_markers;
+
+/**
+ * gtop_markers_create:
+ *
+ * Listen for markers at path: a FIFO if path is one, a unix datagram
+ * socket created there otherwise.
+ */
+struct gtop_markers *
+gtop_markers_create(const char *path);
+
+void
+gtop_markers_destroy(struct gtop_markers *markers);
+
+/**
+ * gtop_markers_sample:
+ *
+ * Attribute a sample to the ranges open right now.
+ */
+void
+gtop_markers_sample(struct gtop_markers *markers,
+		    const struct gtop_markers_sample *sample);
+
+/**
+ * gtop_markers_take:
+ *
+ * Move up to max ranges completed since the last call to ranges. Ranges
+ * completed while nobody took them are dropped, oldest first.
+ */
+uint32_t
+gtop_markers_take(struct gtop_markers *markers, struct gtop_record_range *ranges,
+		  uint32_t max);
+
+uint32_t
+gtop_markers_nr_ranges(struct gtop_markers *markers);
+
+/**
+ * gtop_markers_range:
+ *
+ * Name of range idx, and how many instances of it have completed.
+ */
+const char *
+gtop_markers_range(struct gtop_markers *markers, uint32_t idx,
+		   uint64_t *count);
+
+/**
+ * gtop_markers_percentile:
+ *
+ * p-th percentile (0-100) of a cost over the last GTOP_MARKERS_HISTORY
+ * instances of range idx. NaN if there are none.
+ */
+double
+gtop_markers_percentile(struct gtop_markers *markers, uint32_t idx,
+			uint32_t cost, double p);
+
+/**
+ * gtop_markers_mean:
+ *
+ * Mean of a cost over the same instances.
+ */
+double
+gtop_markers_mean(struct gtop_markers *markers, uint32_t idx, uint32_t cost);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __GPUTOP_MARKERS_H */
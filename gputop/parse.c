@@ -0,0 +1,435 @@
+/*
+ * Copyright NXP 2017
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sub license,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "parse.h"
+
+void
+gtop_lines_init(struct gtop_lines *lines, FILE *file, char *buf, size_t size)
+{
+	memset(lines, 0, sizeof(*lines));
+
+	lines->file = file;
+	lines->buf = buf;
+	lines->size = size;
+}
+
+void
+gtop_lines_init_buf(struct gtop_lines *lines, char *buf, size_t len)
+{
+	memset(lines, 0, sizeof(*lines));
+
+	lines->buf = buf;
+	lines->size = len + 1;
+	lines->len = len;
+	lines->eof = true;
+}
+
+char *
+gtop_lines_next(struct gtop_lines *lines)
+{
+	for (;;) {
+		char *line = lines->buf + lines->pos;
+		char *nl = memchr(line, '\n', lines->len - lines->pos);
+
+		if (nl) {
+			*nl = '\0';
+			lines->pos = nl - lines->buf + 1;
+
+			if (lines->skip) {
+				lines->skip = false;
+				continue;
+			}
+			return line;
+		}
+
+		if (lines->eof) {
+			/* last line, without a new line */
+			if (lines->pos == lines->len || lines->skip)
+				return NULL;
+
+			lines->buf[lines->len] = '\0';
+			lines->pos = lines->len;
+			return line;
+		}
+
+		/* keep the start of the line, and read more after it */
+		if (lines->pos) {
+			memmove(lines->buf, line, lines->len - lines->pos);
+			lines->len -= lines->pos;
+			lines->pos = 0;
+		}
+
+		/* doesn't fit, return what we have and drop the rest */
+		if (lines->len == lines->size - 1) {
+			lines->buf[lines->len] = '\0';
+			lines->pos = lines->len;
+
+			if (lines->skip)
+				continue;
+
+			lines->skip = true;
+			return lines->buf;
+		}
+
+		size_t nr = fread(lines->buf + lines->len, 1,
+				  lines->size - 1 - lines->len, lines->file);
+		if (nr == 0)
+			lines->eof = true;
+
+		lines->len += nr;
+	}
+}
+
+const char *
+gtop_parse_ws(const char *str)
+{
+	while (*str == ' ' || *str == '\t')
+		str++;
+	return str;
+}
+
+const char *
+gtop_parse_literal(const char *str, const char *lit)
+{
+	str = gtop_parse_ws(str);
+
+	while (*lit) {
+		if (*str++ != *lit++)
+			return NULL;
+	}
+
+	return str;
+}
+
+const char *
+gtop_parse_u64(const char *str, uint64_t *val)
+{
+	uint64_t v = 0;
+
+	str = gtop_parse_ws(str);
+	if (*str < '0' || *str > '9')
+		return NULL;
+
+	while (*str >= '0' && *str <= '9')
+		v = v * 10 + (*str++ - '0');
+
+	*val = v;
+	return str;
+}
+
+const char *
+gtop_parse_u32(const char *str, uint32_t *val)
+{
+	uint64_t v;
+
+	str = gtop_parse_u64(str, &v);
+	if (str)
+		*val = v;
+
+	return str;
+}
+
+static int
+gtop_parse_xdigit(char c)
+{
+	if (c >= '0' && c <= '9')
+		return c - '0';
+	if (c >= 'a' && c <= 'f')
+		return c - 'a' + 10;
+	if (c >= 'A' && c <= 'F')
+		return c - 'A' + 10;
+	return -1;
+}
+
+const char *
+gtop_parse_hex(const char *str, uint32_t *val)
+{
+	uint32_t v = 0;
+	int d;
+
+	str = gtop_parse_ws(str);
+	if (str[0] == '0' && (str[1] == 'x' || str[1] == 'X') &&
+	    gtop_parse_xdigit(str[2]) >= 0)
+		str += 2;
+
+	if (gtop_parse_xdigit(*str) < 0)
+		return NULL;
+
+	while ((d = gtop_parse_xdigit(*str)) >= 0) {
+		v = (v << 4) | d;
+		str++;
+	}
+
+	*val = v;
+	return str;
+}
+
+static bool
+gtop_parse_is_ident(char c)
+{
+	return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+	       (c >= '0' && c <= '9') || c == '-';
+}
+
+const char *
+gtop_parse_ident(const char *str, char *dst, size_t size)
+{
+	size_t len = 0;
+
+	str = gtop_parse_ws(str);
+	if (!gtop_parse_is_ident(*str))
+		return NULL;
+
+	for (; gtop_parse_is_ident(*str); str++) {
+		if (len < size - 1)
+			dst[len++] = *str;
+	}
+
+	dst[len] = '\0';
+	return str;
+}
+
+int
+debugfs_parse_clients(struct debugfs_client *clients, struct gtop_lines *lines,
+		      struct gtop_arena *arena)
+{
+	char *line;
+	int i = 0;
+
+	while ((line = gtop_lines_next(lines)) != NULL) {
+		struct debugfs_client *client;
+		const char *str;
+		char name[DEBUGFS_CLIENT_NAME_LEN];
+		uint32_t pid;
+
+		/* skip PID and -- */
+		if (*line == 'P' || *line == '-')
+			continue;
+
+		/* it could be we have garbage in clients */
+		if (!(str = gtop_parse_u32(line, &pid)) ||
+		    !gtop_parse_ident(str, name, sizeof(name)))
+			continue;
+
+		client = gtop_arena_alloc(arena, sizeof(*client));
+		if (!client)
+			break;
+
+		client->pid = pid;
+		client->name = gtop_arena_strdup(arena, name);
+		if (!client->name)
+			break;
+
+		client->next = clients->head;
+		clients->head = client;
+
+		i++;
+	}
+
+	return i;
+}
+
+/*
+ * sorted by name, for bsearch()
+ */
+static const struct debugfs_vid_mem_type {
+	const char *name;
+	size_t offset;
+} debugfs_vid_mem_types[] = {
+	{ "Bitmap",		offsetof(struct debugfs_vid_mem_client, bitmap) },
+	{ "Depth",		offsetof(struct debugfs_vid_mem_client, depth) },
+	{ "Fence",		offsetof(struct debugfs_vid_mem_client, fence) },
+	{ "HZ",			offsetof(struct debugfs_vid_mem_client, hz) },
+	{ "ICache",		offsetof(struct debugfs_vid_mem_client, i_cache) },
+	{ "Image",		offsetof(struct debugfs_vid_mem_client, image) },
+	{ "Index",		offsetof(struct debugfs_vid_mem_client, index) },
+	{ "Mask",		offsetof(struct debugfs_vid_mem_client, mask) },
+	{ "RenderTarget",	offsetof(struct debugfs_vid_mem_client, render_target) },
+	{ "Scissor",		offsetof(struct debugfs_vid_mem_client, scissor) },
+	{ "TFBHeader",		offsetof(struct debugfs_vid_mem_client, tfbheader) },
+	{ "Texture",		offsetof(struct debugfs_vid_mem_client, texture) },
+	{ "TileStatus",		offsetof(struct debugfs_vid_mem_client, tile_status) },
+	{ "TxDesc",		offsetof(struct debugfs_vid_mem_client, tx_desc) },
+	{ "Vertex",		offsetof(struct debugfs_vid_mem_client, vertex) },
+};
+
+static int
+debugfs_vid_mem_type_cmp(const void *key, const void *elem)
+{
+	const struct debugfs_vid_mem_type *type = elem;
+
+	return strcmp(key, type->name);
+}
+
+int
+debugfs_parse_vid_mem(struct debugfs_vid_mem_client *client, struct gtop_lines *lines)
+{
+	char *line;
+
+	while ((line = gtop_lines_next(lines)) != NULL) {
+		const struct debugfs_vid_mem_type *type;
+		const char *str;
+		char name[DEBUGFS_VID_MEM_NAME_LEN];
+		uint32_t value;
+
+		if (!(str = gtop_parse_ident(line, name, sizeof(name))) ||
+		    !gtop_parse_u32(str, &value))
+			continue;
+
+		/* that's the sum of all the others */
+		if (!strcmp(name, "All-Types"))
+			continue;
+
+		type = bsearch(name, debugfs_vid_mem_types,
+			       sizeof(debugfs_vid_mem_types) / sizeof(debugfs_vid_mem_types[0]),
+			       sizeof(debugfs_vid_mem_types[0]), debugfs_vid_mem_type_cmp);
+		if (type) {
+			*(uint32_t *) ((char *) client + type->offset) = value;
+			continue;
+		}
+
+		if (client->extra_no < DEBUGFS_VID_MEM_EXTRA) {
+			struct debugfs_vid_mem_field *field = &client->extra[client->extra_no++];
+
+			memcpy(field->name, name, sizeof(field->name));
+			field->value = value;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * gpu<core> mc clock: <freq> HZ.
+ * gpu<core> sh clock: <freq> HZ.
+ */
+int
+debugfs_parse_gpu_clocks(struct debugfs_clock *clocks, struct gtop_lines *lines)
+{
+	char *line;
+
+	while ((line = gtop_lines_next(lines)) != NULL) {
+		const char *str;
+		uint32_t core, clock_freq;
+		char type[4];
+
+		if (!(str = gtop_parse_literal(line, "gpu")) ||
+		    !(str = gtop_parse_u32(str, &core)) ||
+		    !(str = gtop_parse_ident(str, type, sizeof(type))) ||
+		    !(str = gtop_parse_literal(str, "clock:")) ||
+		    !gtop_parse_u32(str, &clock_freq))
+			continue;
+
+		if (!clock_freq || core > 1)
+			continue;
+
+		if (!strcmp(type, "mc")) {
+			if (core == 0)
+				clocks->gpu_core_0 = clock_freq;
+			else
+				clocks->gpu_core_1 = clock_freq;
+		} else if (!strcmp(type, "sh")) {
+			if (core == 0)
+				clocks->shader_core_0 = clock_freq;
+			else
+				clocks->shader_core_1 = clock_freq;
+		}
+	}
+
+	/* verify that we got data */
+	if (clocks->gpu_core_0 == 0 || clocks->shader_core_0 == 0)
+		return -1;
+
+	return 0;
+}
+
+static enum governor
+debugfs_parse_governor_name(const char *name)
+{
+	if (!strncmp(name, "overdrive", 9))
+		return OVERDRIVE;
+	else if (!strncmp(name, "nominal", 7))
+		return NOMINAL;
+	else if (!strncmp(name, "underdrive", 10))
+		return UNDERDRIVE;
+
+	return 0;
+}
+
+/*
+ * overdrive:      core_clk frequency: 800000000   shader_clk frequency: 1000000000
+ * ...
+ * Currently GPU runs on mode overdrive
+ */
+int
+debugfs_parse_governor(struct debugfs_govern *governor, struct gtop_lines *lines)
+{
+	struct debugfs_govern modes[OVERDRIVE] = {};
+	char *line;
+
+	while ((line = gtop_lines_next(lines)) != NULL) {
+		const char *str;
+		char name[16];
+		enum governor mode;
+		uint32_t core_clock_freq, shader_clock_freq;
+
+		/* we've seen all the modes by now */
+		if ((str = gtop_parse_literal(line, "Currently GPU runs on mode"))) {
+			if (!gtop_parse_ident(str, name, sizeof(name)))
+				return -1;
+
+			mode = debugfs_parse_governor_name(name);
+			if (!mode || !modes[mode - 1].governor)
+				return -1;
+
+			*governor = modes[mode - 1];
+			return 0;
+		}
+
+		if (!(str = gtop_parse_ident(line, name, sizeof(name))))
+			continue;
+
+		mode = debugfs_parse_governor_name(name);
+		if (!mode)
+			continue;
+
+		if (!(str = strstr(str, "core_clk frequency:")) ||
+		    !(str = gtop_parse_u32(str + strlen("core_clk frequency:"), &core_clock_freq)) ||
+		    !(str = strstr(str, "shader_clk frequency:")) ||
+		    !gtop_parse_u32(str + strlen("shader_clk frequency:"), &shader_clock_freq)) {
+			fprintf(stderr, "reading core-freq and shader-freq failed: %s\n", line);
+			return -1;
+		}
+
+		modes[mode - 1].governor = mode;
+		modes[mode - 1].gpu_core_freq = core_clock_freq;
+		modes[mode - 1].shader_core_freq = shader_clock_freq;
+	}
+
+	return -1;
+}
@@ -0,0 +1,187 @@
+/*
+ * Copyright NXP 2017
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sub license,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#ifndef __GPUTOP_PARSE_H
+#define __GPUTOP_PARSE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+#include "debugfs.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* enough for any line of the debugfs/sysfs files we read */
+#define GTOP_LINE_LEN		1024
+
+/**
+ * gtop_lines:
+ *
+ * Reads lines of file into a buffer owned by the caller, usually on the
+ * stack, so that parsing never allocates. Lines longer than the buffer are
+ * truncated. Without a file, lines are those of a buffer already read.
+ */
+struct gtop_lines {
+	FILE *file;
+	char *buf;
+	size_t size;
+
+	/* start of the next line, end of what has been read */
+	size_t pos;
+	size_t len;
+
+	bool eof;
+	/* dropping what's left of a line too long */
+	bool skip;
+};
+
+/**
+ * gtop_lines_init:
+ *
+ * Read file through buf, of size bytes.
+ */
+void
+gtop_lines_init(struct gtop_lines *lines, FILE *file, char *buf, size_t size);
+
+/**
+ * gtop_lines_init_buf:
+ *
+ * Go over the len bytes already in buf, splitting them in place. buf[len]
+ * has to be writable.
+ */
+void
+gtop_lines_init_buf(struct gtop_lines *lines, char *buf, size_t len);
+
+/**
+ * gtop_lines_next:
+ *
+ * The next line, without its new line, NULL once file has been read. It is
+ * valid until the next call.
+ */
+char *
+gtop_lines_next(struct gtop_lines *lines);
+
+/*
+ * The tokenizers below skip leading blanks, and return where the token ends
+ * or NULL if str doesn't start with one.
+ */
+
+/**
+ * gtop_parse_ws:
+ *
+ * Skip blanks.
+ */
+const char *
+gtop_parse_ws(const char *str);
+
+/**
+ * gtop_parse_literal:
+ *
+ * Match lit.
+ */
+const char *
+gtop_parse_literal(const char *str, const char *lit);
+
+/**
+ * gtop_parse_u64:
+ *
+ * A decimal number.
+ */
+const char *
+gtop_parse_u64(const char *str, uint64_t *val);
+
+/**
+ * gtop_parse_u32:
+ *
+ * A decimal number, truncated to 32-bit.
+ */
+const char *
+gtop_parse_u32(const char *str, uint32_t *val);
+
+/**
+ * gtop_parse_hex:
+ *
+ * An hexadecimal number, with or without 0x.
+ */
+const char *
+gtop_parse_hex(const char *str, uint32_t *val);
+
+/**
+ * gtop_parse_ident:
+ *
+ * An identifier, [a-zA-Z0-9-]+, copied to dst and truncated to size - 1
+ * characters.
+ */
+const char *
+gtop_parse_ident(const char *str, char *dst, size_t size);
+
+/*
+ * Parsers of the debugfs/sysfs files, over their lines. debugfs.c reads
+ * them.
+ */
+
+/**
+ * debugfs_parse_clients:
+ *
+ * Parse the clients file, returns the number of clients found. Clients are
+ * allocated from arena.
+ */
+int
+debugfs_parse_clients(struct debugfs_client *clients, struct gtop_lines *lines,
+		      struct gtop_arena *arena);
+
+/**
+ * debugfs_parse_vid_mem:
+ *
+ * Parse the reply of vidmem, after the pid has been written to it. Types
+ * we don't know about go in client->extra.
+ */
+int
+debugfs_parse_vid_mem(struct debugfs_vid_mem_client *client, struct gtop_lines *lines);
+
+/**
+ * debugfs_parse_gpu_clocks:
+ *
+ * Parse clk, -1 if it misses the clocks of the first core.
+ */
+int
+debugfs_parse_gpu_clocks(struct debugfs_clock *clocks, struct gtop_lines *lines);
+
+/**
+ * debugfs_parse_governor:
+ *
+ * Parse gpu_govern (or gpu_mode), -1 if the current mode isn't one of the
+ * modes it lists.
+ */
+int
+debugfs_parse_governor(struct debugfs_govern *governor, struct gtop_lines *lines);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __GPUTOP_PARSE_H */
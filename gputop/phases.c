@@ -0,0 +1,570 @@
+/*
+ * Copyright NXP 2017
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sub license,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <math.h>
+
+#include "phases.h"
+#include "record.h"
+#include "json.h"
+
+/*
+ * CUSUM parameters, in standard deviations: drifts smaller than K are
+ * ignored, H is how much has to pile up. H is high because several hundred
+ * metrics are tested at once and any of them can start a phase.
+ */
+#define GTOP_PHASES_K			0.5
+#define GTOP_PHASES_H			12.0
+
+/* what a metric has to move by at least to count, see gtop_phases_scale() */
+#define GTOP_PHASES_MIN_BUSY		2.0
+#define GTOP_PHASES_MIN_RATE		0.1
+
+/* running statistics of a metric over the current phase */
+struct gtop_phases_metric {
+	uint32_t n;
+	double mean;
+	double m2;
+
+	/* CUSUM up and down, and for how many snapshots they've been above 0 */
+	double up;
+	double down;
+	uint32_t up_run;
+	uint32_t down_run;
+};
+
+struct gtop_phases_recent {
+	uint64_t timestamp;
+	uint64_t interval;
+	float values[GTOP_METRIC_NR];
+};
+
+struct gtop_phases {
+	/* ring of phases, first is the oldest */
+	struct gtop_phase phases[GTOP_PHASES_MAX];
+	uint32_t first;
+	uint32_t nr;
+	/* number of the oldest phase kept */
+	uint32_t seq;
+
+	struct gtop_phases_metric metrics[GTOP_METRIC_NR];
+
+	/* the last snapshots, where a change can be moved back to */
+	struct gtop_phases_recent recent[GTOP_PHASES_LOOKBACK];
+	uint32_t head;
+	uint32_t nr_recent;
+};
+
+/* occupancy, DDR and counters are tested, DMA states and the rest aren't */
+static bool
+gtop_phases_tested(uint32_t m)
+{
+	return m < GTOP_METRIC_DMA_STATES ||
+		(m >= GTOP_METRIC_DDR && m < GTOP_METRIC_SCALARS);
+}
+
+/*
+ * the spread of a metric, floored so that one that barely moved in a
+ * phase doesn't make the next wiggle a change
+ */
+static double
+gtop_phases_scale(uint32_t m, const struct gtop_phases_metric *metric)
+{
+	double sd = metric->n > 1 ? sqrt(metric->m2 / (metric->n - 1)) : 0.0;
+	double min;
+
+	if (m < GTOP_METRIC_DMA_STATES)
+		min = GTOP_PHASES_MIN_BUSY;
+	else
+		min = GTOP_PHASES_MIN_RATE * fabs(metric->mean) + 1.0;
+
+	return sd > min ? sd : min;
+}
+
+static void
+gtop_phases_learn(struct gtop_phases_metric *metric, double value)
+{
+	double delta = value - metric->mean;
+
+	metric->n++;
+	metric->mean += delta / metric->n;
+	metric->m2 += delta * (value - metric->mean);
+}
+
+/* returns how far back the change started, 0 if there's none */
+static uint32_t
+gtop_phases_test(struct gtop_phases_metric *metric, uint32_t m, double value)
+{
+	double z = (value - metric->mean) / gtop_phases_scale(m, metric);
+	uint32_t run = 0;
+
+	metric->up += z - GTOP_PHASES_K;
+	if (metric->up > 0.0) {
+		metric->up_run++;
+	} else {
+		metric->up = 0.0;
+		metric->up_run = 0;
+	}
+
+	metric->down -= z + GTOP_PHASES_K;
+	if (metric->down > 0.0) {
+		metric->down_run++;
+	} else {
+		metric->down = 0.0;
+		metric->down_run = 0;
+	}
+
+	if (metric->up > GTOP_PHASES_H)
+		run = metric->up_run;
+	if (metric->down > GTOP_PHASES_H && metric->down_run > run)
+		run = metric->down_run;
+
+	return run;
+}
+
+static struct gtop_phase *
+gtop_phases_current(struct gtop_phases *phases)
+{
+	return &phases->phases[(phases->first + phases->nr - 1) % GTOP_PHASES_MAX];
+}
+
+static struct gtop_phase *
+gtop_phases_open(struct gtop_phases *phases, uint64_t begin)
+{
+	struct gtop_phase *phase;
+
+	if (phases->nr == GTOP_PHASES_MAX) {
+		phases->first = (phases->first + 1) % GTOP_PHASES_MAX;
+		phases->seq++;
+	} else {
+		phases->nr++;
+	}
+
+	phase = gtop_phases_current(phases);
+	memset(phase, 0, sizeof(*phase));
+	phase->begin = phase->end = begin;
+
+	memset(phases->metrics, 0, sizeof(phases->metrics));
+
+	return phase;
+}
+
+/* add (sign 1) or take away (sign -1) a snapshot from a phase */
+static void
+gtop_phases_account(struct gtop_phase *phase, const float *values,
+		    uint64_t interval, int sign)
+{
+	uint32_t m;
+
+	for (m = 0; m < GTOP_METRIC_NR; m++) {
+		double value = values[m];
+
+		if (isnan(value))
+			continue;
+		/* rates add up as what they amounted to */
+		if (m >= GTOP_METRIC_DDR && m < GTOP_METRIC_SCALARS)
+			value *= interval / 1e9;
+		phase->sum[m] += sign * value;
+		phase->count[m] += sign;
+	}
+
+	phase->nr_snapshots += sign;
+	phase->time += sign * (int64_t) interval;
+}
+
+static void
+gtop_phases_learn_all(struct gtop_phases *phases, const float *values)
+{
+	uint32_t m;
+
+	for (m = 0; m < GTOP_METRIC_NR; m++)
+		if (gtop_phases_tested(m) && !isnan(values[m]))
+			gtop_phases_learn(&phases->metrics[m], values[m]);
+}
+
+/*
+ * close the current phase run snapshots ago: the recent ones after that
+ * move to a new phase
+ */
+static struct gtop_phase *
+gtop_phases_split(struct gtop_phases *phases, uint32_t run)
+{
+	struct gtop_phase *old = gtop_phases_current(phases), *phase;
+	uint32_t i, moved = run - 1;
+	uint64_t begin;
+
+	/* the snapshot that made the test fire isn't in yet */
+	if (moved > phases->nr_recent)
+		moved = phases->nr_recent;
+	if (moved > old->nr_snapshots - GTOP_PHASES_MIN_SNAPSHOTS)
+		moved = old->nr_snapshots - GTOP_PHASES_MIN_SNAPSHOTS;
+
+	if (moved) {
+		const struct gtop_phases_recent *r =
+			&phases->recent[(phases->head + GTOP_PHASES_LOOKBACK - moved) %
+					GTOP_PHASES_LOOKBACK];
+		begin = r->timestamp - r->interval;
+	} else {
+		begin = old->end;
+	}
+	old->end = begin;
+
+	/* if the oldest phase has to make room it isn't this one */
+	phase = gtop_phases_open(phases, begin);
+
+	for (i = moved; i > 0; i--) {
+		const struct gtop_phases_recent *r =
+			&phases->recent[(phases->head + GTOP_PHASES_LOOKBACK - i) %
+					GTOP_PHASES_LOOKBACK];
+
+		gtop_phases_account(old, r->values, r->interval, -1);
+		gtop_phases_account(phase, r->values, r->interval, 1);
+		gtop_phases_learn_all(phases, r->values);
+		phase->end = r->timestamp;
+	}
+
+	return phase;
+}
+
+struct gtop_phases *
+gtop_phases_create(void)
+{
+	return calloc(1, sizeof(struct gtop_phases));
+}
+
+void
+gtop_phases_destroy(struct gtop_phases *phases)
+{
+	free(phases);
+}
+
+bool
+gtop_phases_add(struct gtop_phases *phases, const struct gtop_snapshot *snap)
+{
+	struct gtop_phases_recent *recent = &phases->recent[phases->head];
+	struct gtop_phase *phase;
+	uint32_t m, run = 0;
+	bool split = false;
+
+	gtop_snapshot_metrics(snap, recent->values);
+	recent->timestamp = snap->timestamp;
+	recent->interval = snap->interval;
+
+	if (!phases->nr)
+		gtop_phases_open(phases, snap->timestamp - snap->interval);
+	phase = gtop_phases_current(phases);
+
+	if (phase->nr_snapshots >= GTOP_PHASES_MIN_SNAPSHOTS) {
+		for (m = 0; m < GTOP_METRIC_NR; m++) {
+			struct gtop_phases_metric *metric = &phases->metrics[m];
+			uint32_t r;
+
+			if (!gtop_phases_tested(m) || isnan(recent->values[m]) ||
+			    metric->n < GTOP_PHASES_MIN_SNAPSHOTS)
+				continue;
+
+			/* the metric that noticed last tells best when it happened */
+			r = gtop_phases_test(metric, m, recent->values[m]);
+			if (r && (!run || r < run))
+				run = r;
+		}
+	}
+
+	if (run) {
+		phase = gtop_phases_split(phases, run);
+		split = true;
+	}
+
+	gtop_phases_account(phase, recent->values, snap->interval, 1);
+	gtop_phases_learn_all(phases, recent->values);
+	phase->end = snap->timestamp;
+
+	phases->head = (phases->head + 1) % GTOP_PHASES_LOOKBACK;
+	if (phases->nr_recent < GTOP_PHASES_LOOKBACK - 1)
+		phases->nr_recent++;
+
+	return split;
+}
+
+uint32_t
+gtop_phases_count(const struct gtop_phases *phases)
+{
+	return phases->nr;
+}
+
+const struct gtop_phase *
+gtop_phases_get(const struct gtop_phases *phases, uint32_t idx, uint32_t *seq)
+{
+	if (idx >= phases->nr)
+		return NULL;
+
+	if (seq)
+		*seq = phases->seq + idx;
+
+	return &phases->phases[(phases->first + idx) % GTOP_PHASES_MAX];
+}
+
+double
+gtop_phase_mean(const struct gtop_phase *phase, uint32_t metric)
+{
+	if (metric >= GTOP_METRIC_NR || !phase->count[metric])
+		return NAN;
+
+	if (metric >= GTOP_METRIC_DDR && metric < GTOP_METRIC_SCALARS)
+		return phase->time ? phase->sum[metric] * 1e9 / phase->time : NAN;
+
+	return phase->sum[metric] / phase->count[metric];
+}
+
+double
+gtop_phase_utilization(const struct gtop_phase *phase)
+{
+	double sum = 0.0;
+	uint32_t c, n = 0;
+
+	for (c = 0; c < GTOP_SNAPSHOT_MAX_CORES; c++) {
+		double busy = gtop_phase_mean(phase, GTOP_METRIC_CORES + c);
+
+		if (isnan(busy))
+			continue;
+		sum += busy;
+		n++;
+	}
+
+	return n ? sum / n : NAN;
+}
+
+double
+gtop_phase_bandwidth(const struct gtop_phase *phase)
+{
+	double mb = 0.0;
+	uint32_t m;
+	bool any = false;
+
+	for (m = GTOP_METRIC_DDR; m < GTOP_METRIC_COUNTERS(0); m++) {
+		if (!phase->count[m])
+			continue;
+		mb += phase->sum[m];
+		any = true;
+	}
+
+	if (!any || !phase->time)
+		return NAN;
+
+	return mb * 1e9 / phase->time;
+}
+
+uint32_t
+gtop_phase_top_modules(const struct gtop_phase *phase, uint32_t *modules,
+		       uint32_t max)
+{
+	uint32_t m, i, n = 0;
+
+	for (m = GTOP_METRIC_MODULES; m < GTOP_METRIC_DMA_STATES; m++) {
+		double busy = gtop_phase_mean(phase, m);
+
+		if (isnan(busy) || busy <= 0.0)
+			continue;
+
+		/* insertion into the max busiest so far */
+		for (i = n; i > 0 && gtop_phase_mean(phase, modules[i - 1]) < busy; i--)
+			if (i < max)
+				modules[i] = modules[i - 1];
+		if (i < max) {
+			modules[i] = m;
+			if (n < max)
+				n++;
+		}
+	}
+
+	return n;
+}
+
+/*
+ * gputop phases
+ */
+
+struct gtop_phases_print {
+	const struct gtop_record_file *file;
+	bool json;
+	uint32_t printed;
+};
+
+static void
+gtop_phases_print(struct gtop_phases_print *print, const struct gtop_phase *phase,
+		  uint32_t seq)
+{
+	const struct gtop_snapshot_names *names = &print->file->names;
+	char name[GTOP_PHASES_TOP_MODULES][GTOP_METRIC_NAME_LEN];
+	uint32_t modules[GTOP_PHASES_TOP_MODULES];
+	uint32_t i, n = gtop_phase_top_modules(phase, modules, GTOP_PHASES_TOP_MODULES);
+	double start = (phase->begin - print->file->header.start) / 1e9;
+	double duration = (phase->end - phase->begin) / 1e9;
+
+	/* as query and gate rules name them */
+	for (i = 0; i < n; i++)
+		if (!gtop_snapshot_metric_name(names, modules[i], name[i], sizeof(name[i])))
+			name[i][0] = '\0';
+
+	if (print->json) {
+		fprintf(stdout, "%s\n    {\"phase\": %u, \"start\": ",
+			print->printed ? "," : "", seq);
+		gtop_json_number(stdout, start);
+		fprintf(stdout, ", \"duration\": ");
+		gtop_json_number(stdout, duration);
+		fprintf(stdout, ", \"snapshots\": %u, \"utilization\": ", phase->nr_snapshots);
+		gtop_json_number(stdout, gtop_phase_utilization(phase));
+		fprintf(stdout, ", \"bandwidth\": ");
+		gtop_json_number(stdout, gtop_phase_bandwidth(phase));
+		fprintf(stdout, ", \"modules\": {");
+		for (i = 0; i < n; i++) {
+			fprintf(stdout, "%s", i ? ", " : "");
+			gtop_json_string(stdout, name[i]);
+			fprintf(stdout, ": ");
+			gtop_json_number(stdout, gtop_phase_mean(phase, modules[i]));
+		}
+		fprintf(stdout, "}}");
+	} else {
+		if (!print->printed)
+			fprintf(stdout, "%5s %10s %10s %7s %10s  %s\n", "PHASE", "START(s)",
+				"LENGTH(s)", "BUSY%", "DDR(MB/s)", "BUSIEST MODULES");
+		fprintf(stdout, "%5u %10.3f %10.3f %7.1f %10.1f ", seq, start, duration,
+			gtop_phase_utilization(phase), gtop_phase_bandwidth(phase));
+		for (i = 0; i < n; i++)
+			fprintf(stdout, " %s %.0f%%", name[i], gtop_phase_mean(phase, modules[i]));
+		fprintf(stdout, "\n");
+	}
+
+	print->printed++;
+}
+
+static void
+gtop_phases_usage(void)
+{
+	fprintf(stderr, "Usage: gputop phases [-s start] [-e end] [-J] <recording>\n");
+	fprintf(stderr, "  -s <secs>     Start that many seconds into the recording\n");
+	fprintf(stderr, "  -e <secs>     Stop that many seconds into the recording\n");
+	fprintf(stderr, "  -J            Print JSON\n");
+}
+
+int
+gtop_phases_main(int argc, char **argv)
+{
+	struct gtop_phases_print print = {};
+	struct gtop_record_cursor cursor;
+	struct gtop_record_index index;
+	struct gtop_record_entry entry;
+	struct gtop_record_file file;
+	struct gtop_snapshot snap;
+	struct gtop_phases *phases;
+	const struct gtop_phase *phase;
+	const void *payload;
+	uint64_t from = 0, to = UINT64_MAX;
+	uint32_t seq;
+	off_t begin;
+	int c, ret;
+
+	optind = 1;
+	while ((c = getopt(argc, argv, "s:e:Jh")) != -1) {
+		switch (c) {
+		case 's':
+			if (gtop_record_parse_time(optarg, &from) < 0)
+				return EXIT_FAILURE;
+			break;
+		case 'e':
+			if (gtop_record_parse_time(optarg, &to) < 0)
+				return EXIT_FAILURE;
+			break;
+		case 'J':
+			print.json = true;
+			break;
+		case 'h':
+		default:
+			gtop_phases_usage();
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (optind != argc - 1) {
+		gtop_phases_usage();
+		return EXIT_FAILURE;
+	}
+
+	if (gtop_record_open(&file, argv[optind]) < 0)
+		return EXIT_FAILURE;
+	print.file = &file;
+
+	gtop_record_window(&file.header, &from, &to);
+
+	if (gtop_record_index_load(&index, &file) < 0) {
+		gtop_record_file_close(&file);
+		return EXIT_FAILURE;
+	}
+	begin = gtop_record_index_seek(&index, from);
+	gtop_record_index_fini(&index);
+
+	phases = gtop_phases_create();
+	if (!phases || gtop_record_cursor_init(&cursor, &file, begin) < 0) {
+		gtop_phases_destroy(phases);
+		gtop_record_file_close(&file);
+		return EXIT_FAILURE;
+	}
+
+	if (print.json)
+		fprintf(stdout, "{\n  \"phases\": [");
+
+	while ((ret = gtop_record_cursor_next(&cursor, &entry, &payload)) > 0) {
+		if (entry.type != GTOP_RECORD_SNAPSHOT || entry.size < sizeof(snap) ||
+		    entry.timestamp < from)
+			continue;
+		if (entry.timestamp > to)
+			break;
+
+		memcpy(&snap, payload, sizeof(snap));
+		/* the phase before the new one won't change anymore */
+		if (gtop_phases_add(phases, &snap) && gtop_phases_count(phases) > 1) {
+			phase = gtop_phases_get(phases, gtop_phases_count(phases) - 2, &seq);
+			gtop_phases_print(&print, phase, seq);
+		}
+	}
+
+	if (gtop_phases_count(phases)) {
+		phase = gtop_phases_get(phases, gtop_phases_count(phases) - 1, &seq);
+		gtop_phases_print(&print, phase, seq);
+	}
+
+	if (print.json)
+		fprintf(stdout, "\n  ]\n}\n");
+
+	if (ret < 0)
+		fprintf(stderr, "Failed to read %s\n", argv[optind]);
+
+	gtop_record_cursor_fini(&cursor);
+	gtop_phases_destroy(phases);
+	gtop_record_file_close(&file);
+
+	return ret < 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,156 @@
+/*
+ * Copyright NXP 2017
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sub license,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#ifndef __GPUTOP_PHASES_H
+#define __GPUTOP_PHASES_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "snapshot.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Phases split a run where the GPU starts behaving differently: the core
+ * and module occupancy, the DDR traffic and the counter rates of every
+ * snapshot go through a two-sided CUSUM test against the mean of the
+ * current phase, and a new phase starts when one of them drifts away for
+ * long enough. The snapshots that made the test fire are moved to the new
+ * phase so that it starts where the change happened rather than where it
+ * was noticed.
+ *
+ * Updating is linear in the number of metrics and never allocates, so it
+ * can keep up with any snapshot rate.
+ */
+
+/* phases kept, older ones are dropped */
+#define GTOP_PHASES_MAX			32
+/* snapshots a phase has before its mean is trusted, and at least */
+#define GTOP_PHASES_MIN_SNAPSHOTS	4
+/* how far back a change can be moved */
+#define GTOP_PHASES_LOOKBACK		16
+/* dominant modules reported per phase */
+#define GTOP_PHASES_TOP_MODULES		3
+
+/**
+ * gtop_phase:
+ *
+ * One phase: where it starts and ends, and the sum of every metric over its
+ * snapshots; for DDR and counters, of what they amounted to (MB, events).
+ */
+struct gtop_phase {
+	/** CLOCK_MONOTONIC (ns) at the start of the first snapshot interval */
+	uint64_t begin;
+	/** and at the end of the last one */
+	uint64_t end;
+	/** sum of the snapshot intervals (ns) */
+	uint64_t time;
+	uint32_t nr_snapshots;
+
+	double sum[GTOP_METRIC_NR];
+	uint32_t count[GTOP_METRIC_NR];
+};
+
+struct gtop_phases;
+
+struct gtop_phases *
+gtop_phases_create(void);
+
+void
+gtop_phases_destroy(struct gtop_phases *phases);
+
+/**
+ * gtop_phases_add:
+ *
+ * Account for a snapshot. Returns true if it made a new phase start, in
+ * which case the one before it is complete.
+ */
+bool
+gtop_phases_add(struct gtop_phases *phases, const struct gtop_snapshot *snap);
+
+/**
+ * gtop_phases_count:
+ *
+ * How many phases are kept, the current one included.
+ */
+uint32_t
+gtop_phases_count(const struct gtop_phases *phases);
+
+/**
+ * gtop_phases_get:
+ *
+ * Phase idx, 0 being the oldest kept and gtop_phases_count() - 1 the current
+ * one. seq gets its number since the start of the run.
+ */
+const struct gtop_phase *
+gtop_phases_get(const struct gtop_phases *phases, uint32_t idx, uint32_t *seq);
+
+/**
+ * gtop_phase_mean:
+ *
+ * Mean of a metric over the snapshots of a phase, NaN if it never had one.
+ * DDR and counters are rates over the whole phase.
+ */
+double
+gtop_phase_mean(const struct gtop_phase *phase, uint32_t metric);
+
+/**
+ * gtop_phase_utilization:
+ *
+ * Mean busy percentage of the 3D cores over the phase.
+ */
+double
+gtop_phase_utilization(const struct gtop_phase *phase);
+
+/**
+ * gtop_phase_bandwidth:
+ *
+ * DDR traffic (MB/s) over the phase, NaN without DDR counters.
+ */
+double
+gtop_phase_bandwidth(const struct gtop_phase *phase);
+
+/**
+ * gtop_phase_top_modules:
+ *
+ * Up to max modules (metric ids), busiest first. Returns how many.
+ */
+uint32_t
+gtop_phase_top_modules(const struct gtop_phase *phase, uint32_t *modules,
+		       uint32_t max);
+
+/**
+ * gtop_phases_main:
+ *
+ * `gputop phases`, the phases of a recording.
+ */
+int
+gtop_phases_main(int argc, char **argv);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __GPUTOP_PHASES_H */
@@ -0,0 +1,203 @@
+/*
+ * Copyright NXP 2017
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sub license,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "procwatch.h"
+
+#ifdef __linux__
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include <linux/connector.h>
+#include <linux/cn_proc.h>
+
+#define GTOP_PROCWATCH_BUF_SIZE	4096
+
+struct gtop_procwatch {
+	int fd;
+};
+
+static int
+gtop_procwatch_listen(int fd, enum proc_cn_mcast_op op)
+{
+	union {
+		struct nlmsghdr nl;
+		char buf[NLMSG_SPACE(sizeof(struct cn_msg) + sizeof(op))];
+	} msg;
+	struct cn_msg *cn = NLMSG_DATA(&msg.nl);
+
+	memset(&msg, 0, sizeof(msg));
+
+	msg.nl.nlmsg_len = NLMSG_LENGTH(sizeof(*cn) + sizeof(op));
+	msg.nl.nlmsg_type = NLMSG_DONE;
+	msg.nl.nlmsg_pid = getpid();
+
+	cn->id.idx = CN_IDX_PROC;
+	cn->id.val = CN_VAL_PROC;
+	cn->len = sizeof(op);
+	memcpy(cn->data, &op, sizeof(op));
+
+	return send(fd, &msg, msg.nl.nlmsg_len, 0) < 0 ? -1 : 0;
+}
+
+struct gtop_procwatch *
+gtop_procwatch_create(void)
+{
+	struct gtop_procwatch *watch;
+	struct sockaddr_nl addr;
+	int fd;
+
+	fd = socket(PF_NETLINK, SOCK_DGRAM, NETLINK_CONNECTOR);
+	if (fd < 0)
+		return NULL;
+
+	memset(&addr, 0, sizeof(addr));
+	addr.nl_family = AF_NETLINK;
+	addr.nl_groups = CN_IDX_PROC;
+
+	if (bind(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0 ||
+	    gtop_procwatch_listen(fd, PROC_CN_MCAST_LISTEN) < 0 ||
+	    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) < 0 ||
+	    fcntl(fd, F_SETFD, FD_CLOEXEC) < 0) {
+		close(fd);
+		return NULL;
+	}
+
+	watch = calloc(1, sizeof(*watch));
+	if (!watch) {
+		close(fd);
+		return NULL;
+	}
+
+	watch->fd = fd;
+	return watch;
+}
+
+void
+gtop_procwatch_destroy(struct gtop_procwatch *watch)
+{
+	if (!watch)
+		return;
+
+	gtop_procwatch_listen(watch->fd, PROC_CN_MCAST_IGNORE);
+	close(watch->fd);
+	free(watch);
+}
+
+static bool
+gtop_procwatch_event(const struct proc_event *ev)
+{
+	switch (ev->what) {
+	case PROC_EVENT_FORK:
+		/* a new thread isn't a new process */
+		return ev->event_data.fork.child_pid == ev->event_data.fork.child_tgid;
+	case PROC_EVENT_EXEC:
+		return true;
+	case PROC_EVENT_EXIT:
+		return ev->event_data.exit.process_pid == ev->event_data.exit.process_tgid;
+	default:
+		return false;
+	}
+}
+
+bool
+gtop_procwatch_changed(struct gtop_procwatch *watch)
+{
+	union {
+		struct nlmsghdr nl;
+		char buf[GTOP_PROCWATCH_BUF_SIZE];
+	} msg;
+	bool changed = false;
+
+	for (;;) {
+		struct sockaddr_nl from;
+		socklen_t from_len = sizeof(from);
+		struct nlmsghdr *nl;
+		ssize_t len;
+
+		len = recvfrom(watch->fd, &msg, sizeof(msg), 0,
+			       (struct sockaddr *) &from, &from_len);
+		if (len < 0) {
+			if (errno == EINTR)
+				continue;
+			/* the kernel dropped some, we can't tell which */
+			if (errno == ENOBUFS) {
+				changed = true;
+				continue;
+			}
+			break;
+		}
+
+		/* only the kernel talks on this group; once changed, just drain */
+		if (from.nl_pid != 0 || changed)
+			continue;
+
+		for (nl = &msg.nl; NLMSG_OK(nl, (size_t) len); nl = NLMSG_NEXT(nl, len)) {
+			const struct cn_msg *cn = NLMSG_DATA(nl);
+
+			if (nl->nlmsg_type == NLMSG_ERROR || nl->nlmsg_type == NLMSG_NOOP)
+				continue;
+			if (cn->id.idx != CN_IDX_PROC || cn->id.val != CN_VAL_PROC ||
+			    cn->len < sizeof(struct proc_event))
+				continue;
+
+			if (gtop_procwatch_event((const struct proc_event *) cn->data)) {
+				changed = true;
+				break;
+			}
+		}
+	}
+
+	return changed;
+}
+
+#else
+
+struct gtop_procwatch *
+gtop_procwatch_create(void)
+{
+	return NULL;
+}
+
+void
+gtop_procwatch_destroy(struct gtop_procwatch *watch)
+{
+	(void) watch;
+}
+
+bool
+gtop_procwatch_changed(struct gtop_procwatch *watch)
+{
+	(void) watch;
+	return true;
+}
+
+#endif
@@ -0,0 +1,64 @@
+/*
+ * Copyright NXP 2017
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sub license,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#ifndef __GPUTOP_PROCWATCH_H
+#define __GPUTOP_PROCWATCH_H
+
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Processes starting and exiting, as told by the kernel's process events
+ * connector. Only processes count, threads coming and going don't.
+ */
+struct gtop_procwatch;
+
+/**
+ * gtop_procwatch_create:
+ *
+ * Subscribe to process events. NULL if the connector isn't there (not
+ * Linux, built without CONFIG_PROC_EVENTS) or we may not listen to it
+ * (it needs CAP_NET_ADMIN).
+ */
+struct gtop_procwatch *
+gtop_procwatch_create(void);
+
+void
+gtop_procwatch_destroy(struct gtop_procwatch *watch);
+
+/**
+ * gtop_procwatch_changed:
+ *
+ * Whether a process forked, exec'ed or exited since the last call. Events
+ * the kernel had to drop count as changes. Doesn't block.
+ */
+bool
+gtop_procwatch_changed(struct gtop_procwatch *watch);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __GPUTOP_PROCWATCH_H */
@@ -0,0 +1,318 @@
+/*
+ * Copyright NXP 2017
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sub license,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <math.h>
+
+#include "query.h"
+#include "record.h"
+
+struct gtop_query {
+	struct gtop_record_file file;
+	struct gtop_record_index index;
+	struct gtop_record_cursor cursor;
+
+	int metric;
+	/* timestamps looked at */
+	uint64_t from;
+	uint64_t to;
+
+	/* thresholds, NaN if not given */
+	double above;
+	double below;
+
+	/* extrema so far, and when */
+	float min;
+	float max;
+	uint64_t min_ts;
+	uint64_t max_ts;
+
+	float values[GTOP_METRIC_NR];
+	uint32_t decoded;
+};
+
+static bool
+gtop_query_match(const struct gtop_query *q, float value)
+{
+	return !isnan(value) &&
+		(isnan(q->above) || value > q->above) &&
+		(isnan(q->below) || value < q->below);
+}
+
+static void
+gtop_query_extrema(struct gtop_query *q, float min, float max, uint64_t ts)
+{
+	if (isnan(min))
+		return;
+
+	if (isnan(q->min) || min < q->min) {
+		q->min = min;
+		q->min_ts = ts;
+	}
+	if (isnan(q->max) || max > q->max) {
+		q->max = max;
+		q->max_ts = ts;
+	}
+}
+
+/*
+ * go through the snapshots in [begin, end), printing the ones that match
+ * or keeping the extrema
+ */
+static int
+gtop_query_decode(struct gtop_query *q, off_t begin, off_t end, bool print)
+{
+	struct gtop_record_entry entry;
+	struct gtop_snapshot snap;
+	const void *payload;
+	int ret = 0;
+
+	q->cursor.offset = begin;
+	q->decoded++;
+
+	while (q->cursor.offset < end &&
+	       (ret = gtop_record_cursor_next(&q->cursor, &entry, &payload)) > 0) {
+		float value;
+
+		if (entry.type != GTOP_RECORD_SNAPSHOT || entry.size < sizeof(snap) ||
+		    entry.timestamp < q->from || entry.timestamp > q->to)
+			continue;
+
+		memcpy(&snap, payload, sizeof(snap));
+		gtop_snapshot_metrics(&snap, q->values);
+		value = q->values[q->metric];
+
+		if (!print) {
+			gtop_query_extrema(q, value, value, snap.timestamp);
+		} else if (gtop_query_match(q, value)) {
+			fprintf(stdout, "%.3f %g\n",
+				(snap.timestamp - q->file.header.start) / 1e9, value);
+		}
+	}
+
+	return ret < 0 ? -1 : 0;
+}
+
+/*
+ * where a summarized extreme is, found by decoding its block
+ */
+static void
+gtop_query_locate(struct gtop_query *q, uint32_t block, float value, uint64_t *ts)
+{
+	struct gtop_record_index_block *b = &q->index.blocks[block];
+	float min = q->min, max = q->max;
+	uint64_t min_ts = q->min_ts, max_ts = q->max_ts;
+	uint64_t found = 0;
+
+	q->min = q->max = NAN;
+	if (gtop_query_decode(q, b->offset, b->end, false) == 0 &&
+	    (q->min == value || q->max == value))
+		found = q->min == value ? q->min_ts : q->max_ts;
+
+	q->min = min;
+	q->max = max;
+	q->min_ts = min_ts;
+	q->max_ts = max_ts;
+	*ts = found;
+}
+
+static int
+gtop_query_run(struct gtop_query *q, bool print)
+{
+	struct gtop_record_block *summary;
+	uint32_t i, min_block = UINT32_MAX, max_block = UINT32_MAX;
+	int err = 0;
+
+	summary = malloc(sizeof(*summary));
+	if (!summary)
+		return -1;
+
+	for (i = gtop_record_index_find(&q->index, q->from);
+	     i < q->index.nr_blocks && q->index.blocks[i].first <= q->to && !err; i++) {
+		const struct gtop_record_index_block *b = &q->index.blocks[i];
+		bool inside = b->first >= q->from && b->last <= q->to;
+		float min, max;
+
+		if (gtop_record_index_summary(&q->index, &q->file, i, summary) < 0) {
+			err = -1;
+			break;
+		}
+		min = summary->range[q->metric][0];
+		max = summary->range[q->metric][1];
+
+		if (print) {
+			/* nothing in there can match */
+			if (isnan(min) ||
+			    (!isnan(q->above) && max <= q->above) ||
+			    (!isnan(q->below) && min >= q->below))
+				continue;
+			err = gtop_query_decode(q, b->offset, b->end, true);
+		} else if (inside) {
+			if (!isnan(min) && (isnan(q->min) || min < q->min))
+				min_block = i;
+			if (!isnan(max) && (isnan(q->max) || max > q->max))
+				max_block = i;
+			gtop_query_extrema(q, min, max, 0);
+		} else if (!isnan(min) &&
+			   (isnan(q->min) || min < q->min || max > q->max)) {
+			float old_min = q->min, old_max = q->max;
+
+			err = gtop_query_decode(q, b->offset, b->end, false);
+			if (q->min != old_min)
+				min_block = UINT32_MAX;
+			if (q->max != old_max)
+				max_block = UINT32_MAX;
+		}
+	}
+
+	/* what the index doesn't cover yet */
+	if (!err && gtop_record_index_find(&q->index, q->to) == q->index.nr_blocks) {
+		float old_min = q->min, old_max = q->max;
+
+		err = gtop_query_decode(q, q->index.tail, q->file.size, print);
+		if (q->min != old_min)
+			min_block = UINT32_MAX;
+		if (q->max != old_max)
+			max_block = UINT32_MAX;
+	}
+
+	if (!err && min_block != UINT32_MAX)
+		gtop_query_locate(q, min_block, q->min, &q->min_ts);
+	if (!err && max_block != UINT32_MAX)
+		gtop_query_locate(q, max_block, q->max, &q->max_ts);
+
+	free(summary);
+	return err;
+}
+
+static void
+gtop_query_usage(void)
+{
+	fprintf(stderr, "Usage: gputop query [-s start] [-e end] [-a value] [-b value] [-v] <recording> <metric>\n");
+	fprintf(stderr, "  -s <secs>     Start that many seconds into the recording\n");
+	fprintf(stderr, "  -e <secs>     Stop that many seconds into the recording\n");
+	fprintf(stderr, "  -a <value>    Print the snapshots where metric is above value\n");
+	fprintf(stderr, "  -b <value>    Print the snapshots where metric is below value\n");
+	fprintf(stderr, "  -v            Tell how many blocks were read\n");
+	fprintf(stderr, "Without -a or -b, print the min and max of metric.\n");
+}
+
+int
+gtop_query_main(int argc, char **argv)
+{
+	struct gtop_query *q;
+	uint64_t from = 0, to = UINT64_MAX;
+	bool verbose = false, print;
+	int c, ret = EXIT_FAILURE;
+
+	q = calloc(1, sizeof(*q));
+	if (!q)
+		return EXIT_FAILURE;
+
+	q->above = q->below = NAN;
+	q->min = q->max = NAN;
+
+	optind = 1;
+	while ((c = getopt(argc, argv, "s:e:a:b:vh")) != -1) {
+		switch (c) {
+		case 's':
+			if (gtop_record_parse_time(optarg, &from) < 0)
+				goto out_free;
+			break;
+		case 'e':
+			if (gtop_record_parse_time(optarg, &to) < 0)
+				goto out_free;
+			break;
+		case 'a':
+			q->above = atof(optarg);
+			break;
+		case 'b':
+			q->below = atof(optarg);
+			break;
+		case 'v':
+			verbose = true;
+			break;
+		case 'h':
+		default:
+			gtop_query_usage();
+			goto out_free;
+		}
+	}
+
+	if (optind != argc - 2) {
+		gtop_query_usage();
+		goto out_free;
+	}
+	print = !isnan(q->above) || !isnan(q->below);
+
+	if (gtop_record_open(&q->file, argv[optind]) < 0)
+		goto out_free;
+
+	q->metric = gtop_snapshot_metric_find(&q->file.names, argv[optind + 1]);
+	if (q->metric < 0) {
+		fprintf(stderr, "No metric %s in %s\n", argv[optind + 1], argv[optind]);
+		goto out_close;
+	}
+
+	gtop_record_window(&q->file.header, &from, &to);
+	q->from = from;
+	q->to = to;
+
+	if (gtop_record_index_load(&q->index, &q->file) < 0)
+		goto out_close;
+	if (gtop_record_cursor_init(&q->cursor, &q->file, 0) < 0)
+		goto out_index;
+
+	if (gtop_query_run(q, print) < 0) {
+		fprintf(stderr, "Failed to read %s\n", argv[optind]);
+		goto out_cursor;
+	}
+
+	if (!print && isnan(q->min)) {
+		fprintf(stdout, "%s: no samples\n", argv[optind + 1]);
+	} else if (!print) {
+		fprintf(stdout, "min %g at %.3f\n", q->min,
+			(q->min_ts - q->file.header.start) / 1e9);
+		fprintf(stdout, "max %g at %.3f\n", q->max,
+			(q->max_ts - q->file.header.start) / 1e9);
+	}
+
+	if (verbose)
+		fprintf(stderr, "%u of %u blocks read\n", q->decoded, q->index.nr_blocks);
+
+	ret = EXIT_SUCCESS;
+out_cursor:
+	gtop_record_cursor_fini(&q->cursor);
+out_index:
+	gtop_record_index_fini(&q->index);
+out_close:
+	gtop_record_file_close(&q->file);
+out_free:
+	free(q);
+	return ret;
+}
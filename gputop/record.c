@@ -0,0 +1,660 @@
+/*
+ * Copyright NXP 2017
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sub license,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <math.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "record.h"
+
+#define GTOP_RECORD_CURSOR_SIZE	(256 * 1024)
+
+/* how far back from the end to look for the last block, at first */
+#define GTOP_RECORD_TAIL_SIZE	(1024 * 1024)
+
+struct gtop_record {
+	FILE *f;
+	bool failed;
+
+	/* where the next entry goes */
+	off_t offset;
+
+	/* block being summarized */
+	struct gtop_record_block block;
+	float values[GTOP_METRIC_NR];
+	off_t last_block;
+};
+
+struct gtop_record *
+gtop_record_create(const char *path, const struct gtop_snapshot_names *names,
+		   uint64_t interval)
+{
+	struct gtop_record_header header = {
+		.magic = GTOP_RECORD_MAGIC,
+		.version_major = GTOP_RECORD_VERSION_MAJOR,
+		.version_minor = GTOP_RECORD_VERSION_MINOR,
+		.header_size = sizeof(struct gtop_record_header),
+		.names_size = sizeof(struct gtop_snapshot_names),
+		.snapshot_size = sizeof(struct gtop_snapshot),
+		.interval = interval,
+	};
+	struct gtop_record *rec;
+	struct timespec ts;
+
+	rec = calloc(1, sizeof(*rec));
+	if (!rec)
+		return NULL;
+
+	rec->f = fopen(path, "wb");
+	if (!rec->f) {
+		fprintf(stderr, "Failed to create %s: %s\n", path, strerror(errno));
+		free(rec);
+		return NULL;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	header.start = ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#ifdef CLOCK_BOOTTIME
+	if (!clock_gettime(CLOCK_BOOTTIME, &ts))
+		header.boottime = ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#endif
+
+	if (fwrite(&header, sizeof(header), 1, rec->f) != 1 ||
+	    fwrite(names, sizeof(*names), 1, rec->f) != 1 ||
+	    fflush(rec->f)) {
+		fprintf(stderr, "Failed to write %s: %s\n", path, strerror(errno));
+		gtop_record_close(rec);
+		return NULL;
+	}
+
+	rec->offset = sizeof(header) + sizeof(*names);
+	rec->block.offset = rec->offset;
+
+	return rec;
+}
+
+static int
+gtop_record_append(struct gtop_record *rec, uint32_t type, uint64_t timestamp,
+		   const void *payload, size_t size)
+{
+	static const char pad[GTOP_RECORD_ALIGN];
+	struct gtop_record_entry entry = {
+		.sync = GTOP_RECORD_SYNC,
+		.type = type,
+		.size = size,
+		.timestamp = timestamp,
+	};
+	size_t padding = gtop_record_padded(size) - size;
+
+	if (rec->failed)
+		return -1;
+
+	if (fwrite(&entry, sizeof(entry), 1, rec->f) != 1 ||
+	    (size && fwrite(payload, size, 1, rec->f) != 1) ||
+	    (padding && fwrite(pad, padding, 1, rec->f) != 1)) {
+		fprintf(stderr, "Failed to write recording: %s\n", strerror(errno));
+		rec->failed = true;
+		return -1;
+	}
+
+	rec->offset += sizeof(entry) + size + padding;
+	return 0;
+}
+
+/*
+ * write the summary of the current block, and start the next one
+ */
+static int
+gtop_record_end_block(struct gtop_record *rec)
+{
+	struct gtop_record_block *block = &rec->block;
+	off_t offset = rec->offset;
+
+	if (!block->nr_snapshots)
+		return 0;
+
+	block->prev = rec->last_block;
+	block->nr_metrics = GTOP_METRIC_NR;
+
+	if (gtop_record_append(rec, GTOP_RECORD_BLOCK, block->last, block,
+			       gtop_record_block_size(block)) < 0)
+		return -1;
+
+	rec->last_block = offset;
+
+	memset(block, 0, offsetof(struct gtop_record_block, range));
+	block->offset = rec->offset;
+
+	return 0;
+}
+
+static void
+gtop_record_summarize(struct gtop_record *rec, const struct gtop_snapshot *snap)
+{
+	struct gtop_record_block *block = &rec->block;
+	uint32_t m;
+
+	gtop_snapshot_metrics(snap, rec->values);
+
+	for (m = 0; m < GTOP_METRIC_NR; m++) {
+		float value = rec->values[m];
+
+		if (!block->nr_snapshots || isnan(block->range[m][0])) {
+			block->range[m][0] = value;
+			block->range[m][1] = value;
+		} else if (!isnan(value)) {
+			if (value < block->range[m][0])
+				block->range[m][0] = value;
+			if (value > block->range[m][1])
+				block->range[m][1] = value;
+		}
+	}
+
+	if (!block->nr_snapshots)
+		block->first = snap->timestamp;
+	block->last = snap->timestamp;
+	block->nr_snapshots++;
+}
+
+int
+gtop_record_write(struct gtop_record *rec, uint32_t type, uint64_t timestamp,
+		  const void *payload, size_t size)
+{
+	if (type == GTOP_RECORD_SNAPSHOT && size >= sizeof(struct gtop_snapshot)) {
+		/* entries that come with a snapshot stay in its block */
+		if (rec->block.nr_snapshots == GTOP_RECORD_BLOCK_SNAPSHOTS &&
+		    gtop_record_end_block(rec) < 0)
+			return -1;
+
+		gtop_record_summarize(rec, payload);
+	}
+
+	return gtop_record_append(rec, type, timestamp, payload, size);
+}
+
+void
+gtop_record_flush(struct gtop_record *rec)
+{
+	if (!rec->failed && fflush(rec->f)) {
+		fprintf(stderr, "Failed to write recording: %s\n", strerror(errno));
+		rec->failed = true;
+	}
+}
+
+void
+gtop_record_close(struct gtop_record *rec)
+{
+	if (!rec)
+		return;
+
+	gtop_record_end_block(rec);
+	fclose(rec->f);
+	free(rec);
+}
+
+static int
+gtop_record_pread(int fd, void *buf, size_t size, off_t offset, size_t *nread)
+{
+	char *p = buf;
+
+	*nread = 0;
+	while (*nread < size) {
+		ssize_t n = pread(fd, p + *nread, size - *nread, offset + *nread);
+
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n < 0)
+			return -1;
+		if (n == 0)
+			break;
+
+		*nread += n;
+	}
+
+	return 0;
+}
+
+int
+gtop_record_open(struct gtop_record_file *file, const char *path)
+{
+	struct stat st;
+	size_t nread;
+
+	memset(file, 0, sizeof(*file));
+
+	file->fd = open(path, O_RDONLY);
+	if (file->fd < 0) {
+		fprintf(stderr, "Failed to open %s: %s\n", path, strerror(errno));
+		return -1;
+	}
+
+	if (fstat(file->fd, &st) < 0 ||
+	    gtop_record_pread(file->fd, &file->header, sizeof(file->header), 0, &nread) < 0) {
+		fprintf(stderr, "Failed to read %s: %s\n", path, strerror(errno));
+		goto err;
+	}
+	file->size = st.st_size;
+
+	if (nread < GTOP_RECORD_HEADER_MIN_SIZE || file->header.magic != GTOP_RECORD_MAGIC) {
+		fprintf(stderr, "%s is not a gputop recording\n", path);
+		goto err;
+	}
+
+	if (file->header.version_major != GTOP_RECORD_VERSION_MAJOR ||
+	    file->header.header_size < GTOP_RECORD_HEADER_MIN_SIZE ||
+	    file->header.names_size != sizeof(file->names) ||
+	    file->header.snapshot_size != sizeof(struct gtop_snapshot)) {
+		fprintf(stderr, "%s: unsupported recording version %u.%u\n", path,
+			file->header.version_major, file->header.version_minor);
+		goto err;
+	}
+
+	/* fields added after the version that wrote it */
+	if (file->header.header_size < sizeof(file->header))
+		memset((char *) &file->header + file->header.header_size, 0,
+		       sizeof(file->header) - file->header.header_size);
+
+	if (gtop_record_pread(file->fd, &file->names, sizeof(file->names),
+			      file->header.header_size, &nread) < 0 ||
+	    nread < sizeof(file->names)) {
+		fprintf(stderr, "%s: truncated recording\n", path);
+		goto err;
+	}
+
+	file->data_offset = file->header.header_size + file->header.names_size;
+	return 0;
+
+err:
+	close(file->fd);
+	file->fd = -1;
+	return -1;
+}
+
+void
+gtop_record_file_close(struct gtop_record_file *file)
+{
+	if (file->fd >= 0)
+		close(file->fd);
+	file->fd = -1;
+}
+
+int
+gtop_record_cursor_init(struct gtop_record_cursor *cursor,
+			const struct gtop_record_file *file, off_t offset)
+{
+	memset(cursor, 0, sizeof(*cursor));
+
+	cursor->file = file;
+	cursor->offset = offset < file->data_offset ? file->data_offset : offset;
+
+	cursor->buf_size = GTOP_RECORD_CURSOR_SIZE;
+	cursor->buf = malloc(cursor->buf_size);
+	if (!cursor->buf)
+		return -1;
+
+	return 0;
+}
+
+void
+gtop_record_cursor_fini(struct gtop_record_cursor *cursor)
+{
+	free(cursor->buf);
+	cursor->buf = NULL;
+}
+
+/*
+ * make [offset, offset + len) available in the buffer, NULL if the file
+ * ends before that
+ */
+static const char *
+gtop_record_cursor_get(struct gtop_record_cursor *cursor, off_t offset, size_t len)
+{
+	size_t want;
+
+	if (offset >= cursor->buf_offset &&
+	    offset + (off_t) len <= cursor->buf_offset + (off_t) cursor->buf_len)
+		return cursor->buf + (offset - cursor->buf_offset);
+
+	if (len > cursor->buf_size) {
+		char *buf = realloc(cursor->buf, len);
+
+		if (!buf)
+			return NULL;
+
+		cursor->buf = buf;
+		cursor->buf_size = len;
+	}
+
+	want = cursor->buf_size;
+	if (offset + (off_t) want > cursor->file->size)
+		want = cursor->file->size > offset ? cursor->file->size - offset : 0;
+
+	cursor->buf_offset = offset;
+	if (gtop_record_pread(cursor->file->fd, cursor->buf, want, offset,
+			      &cursor->buf_len) < 0)
+		cursor->buf_len = 0;
+
+	if (cursor->buf_len < len)
+		return NULL;
+
+	return cursor->buf;
+}
+
+/*
+ * 1 if a complete entry starts at offset, 0 if not
+ */
+static int
+gtop_record_cursor_peek(struct gtop_record_cursor *cursor, off_t offset,
+			struct gtop_record_entry *entry)
+{
+	const char *p;
+
+	p = gtop_record_cursor_get(cursor, offset, sizeof(*entry));
+	if (!p)
+		return 0;
+
+	memcpy(entry, p, sizeof(*entry));
+
+	if (entry->sync != GTOP_RECORD_SYNC || !entry->type ||
+	    entry->size > GTOP_RECORD_MAX_PAYLOAD)
+		return 0;
+
+	if (offset + (off_t) (sizeof(*entry) + gtop_record_padded(entry->size)) >
+	    cursor->file->size)
+		return 0;
+
+	return 1;
+}
+
+int
+gtop_record_cursor_sync(struct gtop_record_cursor *cursor)
+{
+	const struct gtop_record_file *file = cursor->file;
+	struct gtop_record_entry entry, next;
+	off_t offset;
+
+	offset = file->data_offset +
+		gtop_record_padded(cursor->offset - file->data_offset);
+
+	for (; offset + (off_t) sizeof(entry) <= file->size; offset += GTOP_RECORD_ALIGN) {
+		off_t end;
+
+		if (!gtop_record_cursor_peek(cursor, offset, &entry))
+			continue;
+
+		/* payloads may contain the sync word, check what follows */
+		end = offset + sizeof(entry) + gtop_record_padded(entry.size);
+		if (end + (off_t) sizeof(next) > file->size ||
+		    gtop_record_cursor_peek(cursor, end, &next)) {
+			cursor->offset = offset;
+			return 0;
+		}
+	}
+
+	cursor->offset = file->size;
+	return -1;
+}
+
+int
+gtop_record_cursor_next(struct gtop_record_cursor *cursor,
+			struct gtop_record_entry *entry, const void **payload)
+{
+	size_t len;
+	const char *p;
+
+	if (!gtop_record_cursor_peek(cursor, cursor->offset, entry))
+		return 0;
+
+	len = sizeof(*entry) + gtop_record_padded(entry->size);
+	p = gtop_record_cursor_get(cursor, cursor->offset, len);
+	if (!p)
+		return -1;
+
+	*payload = p + sizeof(*entry);
+	cursor->offset += len;
+
+	return 1;
+}
+
+/*
+ * offset of the last block entry at or after from, 0 if there's none
+ */
+static off_t
+gtop_record_last_block(const struct gtop_record_file *file, off_t from)
+{
+	struct gtop_record_cursor cursor;
+	struct gtop_record_entry entry;
+	const void *payload;
+	off_t offset, last = 0;
+
+	if (gtop_record_cursor_init(&cursor, file, from) < 0)
+		return 0;
+
+	if (gtop_record_cursor_sync(&cursor) == 0) {
+		for (offset = cursor.offset;
+		     gtop_record_cursor_next(&cursor, &entry, &payload) > 0;
+		     offset = cursor.offset)
+			if (entry.type == GTOP_RECORD_BLOCK)
+				last = offset;
+	}
+
+	gtop_record_cursor_fini(&cursor);
+	return last;
+}
+
+/*
+ * the part of a block entry the index needs, 0 if there isn't one at offset
+ */
+static int
+gtop_record_block_read(const struct gtop_record_file *file, off_t offset,
+		       struct gtop_record_block *block, size_t size)
+{
+	struct gtop_record_entry entry;
+	size_t nread;
+
+	if (gtop_record_pread(file->fd, &entry, sizeof(entry), offset, &nread) < 0 ||
+	    nread < sizeof(entry) || entry.sync != GTOP_RECORD_SYNC ||
+	    entry.type != GTOP_RECORD_BLOCK ||
+	    entry.size < offsetof(struct gtop_record_block, range))
+		return 0;
+
+	if (size > entry.size)
+		size = entry.size;
+
+	if (gtop_record_pread(file->fd, block, size, offset + sizeof(entry), &nread) < 0 ||
+	    nread < size)
+		return 0;
+
+	return 1;
+}
+
+int
+gtop_record_index_load(struct gtop_record_index *index,
+		       const struct gtop_record_file *file)
+{
+	struct gtop_record_block block;
+	off_t from, offset;
+	uint32_t nr = 0, i;
+
+	memset(index, 0, sizeof(*index));
+	index->tail = file->data_offset;
+
+	/* before 1.4, summaries were in other units: walk those files instead */
+	if (file->header.version_minor < 4)
+		return 0;
+
+	/* blocks are never far apart, the last one is near the end */
+	from = file->size;
+	do {
+		from = from - file->data_offset > GTOP_RECORD_TAIL_SIZE ?
+			from - GTOP_RECORD_TAIL_SIZE : file->data_offset;
+		offset = gtop_record_last_block(file, from);
+	} while (!offset && from > file->data_offset);
+
+	if (!offset)
+		return 0;
+
+	/* walk back, filling the array from its end */
+	for (; offset; offset = block.prev) {
+		struct gtop_record_index_block *b;
+
+		if (!gtop_record_block_read(file, offset, &block,
+					    offsetof(struct gtop_record_block, range)) ||
+		    (block.prev && (off_t) block.prev >= offset)) {
+			fprintf(stderr, "Corrupted recording index\n");
+			gtop_record_index_fini(index);
+			return -1;
+		}
+
+		if (nr == index->nr_blocks) {
+			size_t size = nr ? nr * 2 : 64;
+
+			/* keep what's filled so far at the end */
+			b = malloc(size * sizeof(*b));
+			if (!b) {
+				gtop_record_index_fini(index);
+				return -1;
+			}
+			memcpy(b + size - nr, index->blocks, nr * sizeof(*b));
+			free(index->blocks);
+			index->blocks = b;
+			index->nr_blocks = size;
+		}
+
+		b = &index->blocks[index->nr_blocks - ++nr];
+		b->offset = block.offset;
+		b->end = offset;
+		b->first = block.first;
+		b->last = block.last;
+
+		if (nr == 1) {
+			struct gtop_record_entry entry;
+			size_t nread;
+
+			if (gtop_record_pread(file->fd, &entry, sizeof(entry), offset, &nread) < 0)
+				entry.size = 0;
+			index->tail = offset + sizeof(entry) + gtop_record_padded(entry.size);
+		}
+	}
+
+	/* move them to the front */
+	memmove(index->blocks, index->blocks + index->nr_blocks - nr,
+		nr * sizeof(*index->blocks));
+	index->nr_blocks = nr;
+
+	for (i = 1; i < nr; i++) {
+		if (index->blocks[i].first < index->blocks[i - 1].last) {
+			fprintf(stderr, "Corrupted recording index\n");
+			gtop_record_index_fini(index);
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+void
+gtop_record_index_fini(struct gtop_record_index *index)
+{
+	free(index->blocks);
+	index->blocks = NULL;
+	index->nr_blocks = 0;
+}
+
+uint32_t
+gtop_record_index_find(const struct gtop_record_index *index, uint64_t timestamp)
+{
+	uint32_t lo = 0, hi = index->nr_blocks;
+
+	while (lo < hi) {
+		uint32_t mid = lo + (hi - lo) / 2;
+
+		if (index->blocks[mid].last < timestamp)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return lo;
+}
+
+off_t
+gtop_record_index_seek(const struct gtop_record_index *index, uint64_t timestamp)
+{
+	uint32_t i = gtop_record_index_find(index, timestamp);
+
+	if (i < index->nr_blocks)
+		return index->blocks[i].offset;
+
+	return index->tail;
+}
+
+int
+gtop_record_index_summary(const struct gtop_record_index *index,
+			  const struct gtop_record_file *file, uint32_t idx,
+			  struct gtop_record_block *block)
+{
+	uint32_t m;
+
+	if (idx >= index->nr_blocks ||
+	    !gtop_record_block_read(file, index->blocks[idx].end, block, sizeof(*block)))
+		return -1;
+
+	/* metrics this version doesn't know about, or that one didn't */
+	if (block->nr_metrics > GTOP_METRIC_NR)
+		block->nr_metrics = GTOP_METRIC_NR;
+	for (m = block->nr_metrics; m < GTOP_METRIC_NR; m++)
+		block->range[m][0] = block->range[m][1] = NAN;
+
+	return 0;
+}
+
+int
+gtop_record_parse_time(const char *arg, uint64_t *ns)
+{
+	char *end;
+	double secs = strtod(arg, &end);
+
+	if (end == arg || *end || !(secs >= 0) || secs > 1e9) {
+		fprintf(stderr, "Invalid time %s\n", arg);
+		return -1;
+	}
+
+	*ns = secs * 1e9;
+	return 0;
+}
+
+void
+gtop_record_window(const struct gtop_record_header *header, uint64_t *from,
+		   uint64_t *to)
+{
+	*from = header->start + *from < *from ? UINT64_MAX : header->start + *from;
+	*to = header->start + *to < *to ? UINT64_MAX : header->start + *to;
+}
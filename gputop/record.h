@@ -0,0 +1,423 @@
+/*
+ * Copyright NXP 2017
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sub license,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#ifndef __GPUTOP_RECORD_H
+#define __GPUTOP_RECORD_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+#include "snapshot.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * A recording is a header, the names once, and a stream of entries:
+ *
+ *	struct gtop_record_header
+ *	struct gtop_snapshot_names
+ *	struct gtop_record_entry + payload, padded to 8 bytes
+ *	...
+ *
+ * Every entry starts with GTOP_RECORD_SYNC so a reader dropped in the middle
+ * of a file (see gtop_record_cursor_sync()) can find the next one without
+ * walking from the start. All fields are in host byte order; the magic tells
+ * if the file comes from a host with a different one.
+ *
+ * Since 1.2, every GTOP_RECORD_BLOCK_SNAPSHOTS snapshots are followed by a
+ * GTOP_RECORD_BLOCK entry summarizing them and pointing back to the
+ * previous one. Together they are a sparse time index, written as the
+ * recording grows, so a recording cut short is indexed up to its last
+ * complete block (see gtop_record_index_load()).
+ *
+ * Since 1.3, clients arriving and exiting are GTOP_RECORD_CLIENT_EVENT
+ * entries, timestamped when they were noticed.
+ *
+ * Since 1.4, snapshot counters are events over the interval (see
+ * GTOP_SNAPSHOT_COUNTER_EVENTS) and block summaries hold DDR and counters as
+ * rates, like gtop_snapshot_metrics().
+ *
+ * Since 1.5, the first collect isn't recorded: it only covered the sampling
+ * window, so older files start with a warm-up snapshot readers may drop.
+ */
+#define GTOP_RECORD_MAGIC		0x52505447	/* "GTPR" */
+#define GTOP_RECORD_VERSION_MAJOR	1
+#define GTOP_RECORD_VERSION_MINOR	5
+
+#define GTOP_RECORD_SYNC		0x5a4e5953	/* "SYNZ" */
+#define GTOP_RECORD_ALIGN		8
+
+/* largest payload a reader accepts */
+#define GTOP_RECORD_MAX_PAYLOAD		(1024 * 1024)
+
+/* per-client memory entries kept in one GTOP_RECORD_CLIENTS */
+#define GTOP_RECORD_MAX_CLIENTS		256
+#define GTOP_RECORD_CLIENT_NAME_LEN	32
+
+struct gtop_record_header {
+	uint32_t magic;
+	uint16_t version_major;
+	uint16_t version_minor;
+
+	uint32_t header_size;
+	uint32_t names_size;
+	uint32_t snapshot_size;
+	uint32_t reserved;
+
+	/* CLOCK_MONOTONIC (ns) when the recording started */
+	uint64_t start;
+	/* nominal time between two snapshots (ns) */
+	uint64_t interval;
+
+	/* 1.1: CLOCK_BOOTTIME (ns) at the same time as start, 0 if unknown */
+	uint64_t boottime;
+};
+
+/* size of a 1.0 header, without boottime */
+#define GTOP_RECORD_HEADER_MIN_SIZE	offsetof(struct gtop_record_header, boottime)
+
+enum gtop_record_type {
+	/* payload is a struct gtop_snapshot */
+	GTOP_RECORD_SNAPSHOT = 1,
+	/* payload is an array of struct gtop_record_client */
+	GTOP_RECORD_CLIENTS,
+	/* payload is a struct gtop_record_range, trimmed after its counters */
+	GTOP_RECORD_RANGE,
+	/* payload is a struct gtop_record_block, trimmed after its metrics */
+	GTOP_RECORD_BLOCK,
+	/* payload is a struct gtop_record_client_event */
+	GTOP_RECORD_CLIENT_EVENT,
+};
+
+struct gtop_record_entry {
+	uint32_t sync;
+	uint32_t type;
+	/* payload size, without padding */
+	uint32_t size;
+	uint32_t reserved;
+	/* CLOCK_MONOTONIC (ns) */
+	uint64_t timestamp;
+};
+
+/**
+ * gtop_record_client:
+ *
+ * Video memory (bytes) used by one client at the time of the entry.
+ */
+struct gtop_record_client {
+	uint32_t pid;
+	uint32_t reserved0;
+
+	uint64_t total;
+	uint64_t reserved;
+	uint64_t contiguous;
+	uint64_t _virtual;
+	uint64_t non_paged;
+
+	char name[GTOP_RECORD_CLIENT_NAME_LEN];
+};
+
+enum gtop_client_event_type {
+	GTOP_CLIENT_ARRIVED = 1,
+	GTOP_CLIENT_EXITED,
+};
+
+/**
+ * gtop_record_client_event:
+ *
+ * A client started or stopped using the GPU, the entry timestamp being the
+ * scan that noticed it.
+ */
+struct gtop_record_client_event {
+	uint32_t pid;
+	/* enum gtop_client_event_type */
+	uint32_t type;
+
+	char name[GTOP_RECORD_CLIENT_NAME_LEN];
+};
+
+#define GTOP_RECORD_RANGE_NAME_LEN	32
+
+/**
+ * gtop_record_range:
+ *
+ * A frame or named range sent by an application, with what the GPU did
+ * while it was open: the samples taken, how many found core 0 busy, and
+ * the counter deltas, nr_counters[0] for part 1 then nr_counters[1] for
+ * part 2. The entry timestamp is the end of the range.
+ */
+struct gtop_record_range {
+	char name[GTOP_RECORD_RANGE_NAME_LEN];
+
+	uint64_t begin;
+	uint64_t end;
+
+	uint32_t samples;
+	uint32_t busy;
+
+	uint32_t nr_counters[2];
+	float counters[2 * GTOP_SNAPSHOT_MAX_COUNTERS];
+};
+
+static inline size_t
+gtop_record_range_size(const struct gtop_record_range *range)
+{
+	return offsetof(struct gtop_record_range, counters) +
+		(range->nr_counters[0] + range->nr_counters[1]) * sizeof(float);
+}
+
+/* snapshots summarized by a GTOP_RECORD_BLOCK */
+#define GTOP_RECORD_BLOCK_SNAPSHOTS	64
+
+/**
+ * gtop_record_block:
+ *
+ * Summary of the entries from offset up to the block entry itself: the
+ * timestamps of its first and last snapshot, and the min and max of each
+ * metric over its snapshots (NaN if a metric wasn't sampled). Offsets are
+ * from the start of the file.
+ */
+struct gtop_record_block {
+	/* offset of the previous block entry, 0 for the first one */
+	uint64_t prev;
+	uint64_t offset;
+
+	uint64_t first;
+	uint64_t last;
+
+	uint32_t nr_snapshots;
+	uint32_t nr_metrics;
+
+	float range[GTOP_METRIC_NR][2];
+};
+
+static inline size_t
+gtop_record_block_size(const struct gtop_record_block *block)
+{
+	return offsetof(struct gtop_record_block, range) +
+		block->nr_metrics * sizeof(block->range[0]);
+}
+
+static inline size_t
+gtop_record_padded(size_t size)
+{
+	return (size + GTOP_RECORD_ALIGN - 1) & ~((size_t) GTOP_RECORD_ALIGN - 1);
+}
+
+struct gtop_record;
+
+/**
+ * gtop_record_create:
+ *
+ * Create (or truncate) path and write the header and names.
+ */
+struct gtop_record *
+gtop_record_create(const char *path, const struct gtop_snapshot_names *names,
+		   uint64_t interval);
+
+/**
+ * gtop_record_write:
+ *
+ * Append an entry. Snapshots are also summarized, and a GTOP_RECORD_BLOCK
+ * is appended after every GTOP_RECORD_BLOCK_SNAPSHOTS of them. Returns -1 if it couldn't be written, in which case the
+ * recording stops growing but stays readable up to the last full entry.
+ */
+int
+gtop_record_write(struct gtop_record *rec, uint32_t type, uint64_t timestamp,
+		  const void *payload, size_t size);
+
+/**
+ * gtop_record_flush:
+ *
+ * Push what has been written so far to the file.
+ */
+void
+gtop_record_flush(struct gtop_record *rec);
+
+/**
+ * gtop_record_close:
+ *
+ * Summarize the last, incomplete, block and close the recording.
+ */
+void
+gtop_record_close(struct gtop_record *rec);
+
+/**
+ * gtop_record_file:
+ *
+ * A recording opened for reading. The fd is only used with pread(), so it
+ * can be shared by several threads, each with its own cursor.
+ */
+struct gtop_record_file {
+	int fd;
+	off_t size;
+	off_t data_offset;
+
+	struct gtop_record_header header;
+	struct gtop_snapshot_names names;
+};
+
+int
+gtop_record_open(struct gtop_record_file *file, const char *path);
+
+void
+gtop_record_file_close(struct gtop_record_file *file);
+
+/**
+ * gtop_record_cursor:
+ *
+ * Reads entries sequentially through a private buffer.
+ */
+struct gtop_record_cursor {
+	const struct gtop_record_file *file;
+	off_t offset;
+
+	char *buf;
+	size_t buf_size;
+	off_t buf_offset;
+	size_t buf_len;
+};
+
+int
+gtop_record_cursor_init(struct gtop_record_cursor *cursor,
+			const struct gtop_record_file *file, off_t offset);
+
+void
+gtop_record_cursor_fini(struct gtop_record_cursor *cursor);
+
+/**
+ * gtop_record_cursor_sync:
+ *
+ * Move the cursor to the first entry starting at or after its offset.
+ * Returns -1 if there is none.
+ */
+int
+gtop_record_cursor_sync(struct gtop_record_cursor *cursor);
+
+/**
+ * gtop_record_cursor_next:
+ *
+ * Read the entry at the cursor and move past it. payload points into the
+ * cursor buffer and stays valid until the next call. Returns 1 for an
+ * entry, 0 at the end of the recording (or at a truncated entry), -1 on
+ * error.
+ */
+int
+gtop_record_cursor_next(struct gtop_record_cursor *cursor,
+			struct gtop_record_entry *entry, const void **payload);
+
+/**
+ * gtop_record_parse_time:
+ *
+ * Parse seconds (fractions allowed) from the start of a recording, as given
+ * on the command line, into ns.
+ */
+int
+gtop_record_parse_time(const char *arg, uint64_t *ns);
+
+/**
+ * gtop_record_window:
+ *
+ * Turn from and to, in ns from the start of the recording as given by
+ * gtop_record_parse_time(), into timestamps of the recording, saturating
+ * at UINT64_MAX.
+ */
+void
+gtop_record_window(const struct gtop_record_header *header, uint64_t *from,
+		   uint64_t *to);
+
+/**
+ * gtop_record_index_block:
+ *
+ * Where a block is and what it covers: entries in [offset, end), end being
+ * the offset of its GTOP_RECORD_BLOCK entry.
+ */
+struct gtop_record_index_block {
+	off_t offset;
+	off_t end;
+
+	uint64_t first;
+	uint64_t last;
+};
+
+/**
+ * gtop_record_index:
+ *
+ * Blocks of a recording in file order. Entries from tail on aren't in any
+ * block: the recording is still growing, or was cut short.
+ */
+struct gtop_record_index {
+	struct gtop_record_index_block *blocks;
+	uint32_t nr_blocks;
+
+	off_t tail;
+};
+
+/**
+ * gtop_record_index_load:
+ *
+ * Find the last complete block and walk back from it. Costs a read per
+ * block, not per entry. Recordings older than 1.2 load with no blocks.
+ */
+int
+gtop_record_index_load(struct gtop_record_index *index,
+		       const struct gtop_record_file *file);
+
+void
+gtop_record_index_fini(struct gtop_record_index *index);
+
+/**
+ * gtop_record_index_find:
+ *
+ * First block with snapshots at or after timestamp, nr_blocks if there's
+ * none. Binary search.
+ */
+uint32_t
+gtop_record_index_find(const struct gtop_record_index *index, uint64_t timestamp);
+
+/**
+ * gtop_record_index_seek:
+ *
+ * Offset to start reading from to see every entry at or after timestamp.
+ */
+off_t
+gtop_record_index_seek(const struct gtop_record_index *index, uint64_t timestamp);
+
+/**
+ * gtop_record_index_summary:
+ *
+ * Read the summary of block idx.
+ */
+int
+gtop_record_index_summary(const struct gtop_record_index *index,
+			  const struct gtop_record_file *file, uint32_t idx,
+			  struct gtop_record_block *block);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __GPUTOP_RECORD_H */
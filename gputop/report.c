@@ -0,0 +1,1038 @@
+/*
+ * Copyright NXP 2017
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sub license,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <math.h>
+#include <pthread.h>
+
+#include "report.h"
+#include "json.h"
+
+/* 1 zero bin, then 16 bins per power of two from 2^-8 to 2^56 */
+#define GTOP_REPORT_SUB_BINS		16
+#define GTOP_REPORT_MIN_EXP		-7
+#define GTOP_REPORT_MAX_EXP		56
+#define GTOP_REPORT_BINS \
+	(1 + (GTOP_REPORT_MAX_EXP - GTOP_REPORT_MIN_EXP + 1) * GTOP_REPORT_SUB_BINS)
+
+/* don't bother with a thread for less than this */
+#define GTOP_REPORT_MIN_CHUNK		(4 * 1024 * 1024)
+
+#define GTOP_REPORT_DEFAULT_TOP		10
+
+static const char *gtop_report_governors[GTOP_REPORT_GOVERNORS] = {
+	"unknown", "underdrive", "nominal", "overdrive",
+};
+
+struct gtop_report_part {
+	const struct gtop_record_file *file;
+	off_t begin;
+	off_t end;
+	/* begin is known to be an entry */
+	bool aligned;
+	/* the next snapshot is the warm-up of a recording before 1.5 */
+	bool warmup;
+	/* timestamps kept */
+	uint64_t from;
+	uint64_t to;
+
+	const struct gtop_classifier *classifier;
+
+	struct gtop_report report;
+	int err;
+};
+
+static uint32_t
+gtop_report_bin(float value)
+{
+	int exp, sub;
+	float m;
+
+	if (!(value > 0.0f))
+		return 0;
+
+	m = frexpf(value, &exp);
+	if (exp < GTOP_REPORT_MIN_EXP)
+		return 0;
+	if (exp > GTOP_REPORT_MAX_EXP)
+		return GTOP_REPORT_BINS - 1;
+
+	sub = (m - 0.5f) * 2 * GTOP_REPORT_SUB_BINS;
+	if (sub >= GTOP_REPORT_SUB_BINS)
+		sub = GTOP_REPORT_SUB_BINS - 1;
+
+	return 1 + (exp - GTOP_REPORT_MIN_EXP) * GTOP_REPORT_SUB_BINS + sub;
+}
+
+/* middle of a bin */
+static double
+gtop_report_bin_value(uint32_t bin)
+{
+	int exp, sub;
+
+	if (!bin)
+		return 0.0;
+
+	exp = (bin - 1) / GTOP_REPORT_SUB_BINS + GTOP_REPORT_MIN_EXP;
+	sub = (bin - 1) % GTOP_REPORT_SUB_BINS;
+
+	return ldexp(0.5 + (sub + 0.5) / (2.0 * GTOP_REPORT_SUB_BINS), exp);
+}
+
+static int
+gtop_report_metric_add(struct gtop_report_metric *metric, float value)
+{
+	if (!metric->hist) {
+		metric->hist = calloc(GTOP_REPORT_BINS, sizeof(uint32_t));
+		if (!metric->hist)
+			return -1;
+	}
+
+	if (!metric->count || value < metric->min)
+		metric->min = value;
+	if (!metric->count || value > metric->max)
+		metric->max = value;
+
+	metric->count++;
+	metric->sum += value;
+	metric->sum_sq += (double) value * value;
+	metric->hist[gtop_report_bin(value)]++;
+
+	return 0;
+}
+
+static int
+gtop_report_metric_merge(struct gtop_report_metric *metric,
+			 const struct gtop_report_metric *other)
+{
+	uint32_t i;
+
+	if (!other->count)
+		return 0;
+
+	if (!metric->hist) {
+		metric->hist = calloc(GTOP_REPORT_BINS, sizeof(uint32_t));
+		if (!metric->hist)
+			return -1;
+	}
+
+	if (!metric->count || other->min < metric->min)
+		metric->min = other->min;
+	if (!metric->count || other->max > metric->max)
+		metric->max = other->max;
+
+	metric->count += other->count;
+	metric->sum += other->sum;
+	metric->sum_sq += other->sum_sq;
+
+	for (i = 0; i < GTOP_REPORT_BINS; i++)
+		metric->hist[i] += other->hist[i];
+
+	return 0;
+}
+
+double
+gtop_report_mean(const struct gtop_report_metric *metric)
+{
+	return metric->count ? metric->sum / metric->count : NAN;
+}
+
+double
+gtop_report_rate(const struct gtop_report *report, uint32_t m)
+{
+	if (m < GTOP_METRIC_DDR || m >= GTOP_METRIC_SCALARS || !report->totals_time[m])
+		return NAN;
+
+	return report->totals[m] * 1e9 / report->totals_time[m];
+}
+
+/* sum of the weights, the intervals in s */
+static double
+gtop_report_rate_weight(const struct gtop_report *report, uint32_t m)
+{
+	return report->totals_time[m] / 1e9;
+}
+
+double
+gtop_report_rate_stddev(const struct gtop_report *report, uint32_t m)
+{
+	double rate = gtop_report_rate(report, m), w, var;
+
+	if (isnan(rate))
+		return NAN;
+
+	w = gtop_report_rate_weight(report, m);
+	if (w * w <= report->totals_time_sq[m])
+		return NAN;
+
+	/* unbiased, with the weights taken as how much each rate counts */
+	var = (report->rates_sq[m] - rate * rate * w) /
+		(w - report->totals_time_sq[m] / w);
+
+	return var > 0.0 ? sqrt(var) : 0.0;
+}
+
+double
+gtop_report_rate_count(const struct gtop_report *report, uint32_t m)
+{
+	double w = gtop_report_rate_weight(report, m);
+
+	if (!report->totals_time_sq[m])
+		return 0.0;
+
+	return w * w / report->totals_time_sq[m];
+}
+
+double
+gtop_report_stddev(const struct gtop_report_metric *metric)
+{
+	double mean, var;
+
+	if (metric->count < 2)
+		return NAN;
+
+	mean = metric->sum / metric->count;
+	var = (metric->sum_sq - mean * metric->sum) / (metric->count - 1);
+
+	return var > 0.0 ? sqrt(var) : 0.0;
+}
+
+double
+gtop_report_percentile(const struct gtop_report_metric *metric, double p)
+{
+	uint64_t rank, seen = 0;
+	double value;
+	uint32_t i;
+
+	if (!metric->count)
+		return NAN;
+
+	rank = ceil(p / 100.0 * metric->count);
+	if (rank < 1)
+		rank = 1;
+
+	for (i = 0; i < GTOP_REPORT_BINS; i++) {
+		seen += metric->hist[i];
+		if (seen >= rank)
+			break;
+	}
+
+	value = gtop_report_bin_value(i);
+
+	/* the bin may be wider than what was actually seen */
+	if (value < metric->min)
+		value = metric->min;
+	if (value > metric->max)
+		value = metric->max;
+
+	return value;
+}
+
+static int
+gtop_report_client_cmp_key(const struct gtop_report_client *client, uint32_t pid,
+			   const char *name)
+{
+	if (client->pid != pid)
+		return client->pid < pid ? -1 : 1;
+
+	return strncmp(client->name, name, sizeof(client->name));
+}
+
+static struct gtop_report_client *
+gtop_report_client_get(struct gtop_report *report, uint32_t pid, const char *name)
+{
+	struct gtop_report_client *client;
+	uint32_t lo = 0, hi = report->nr_clients;
+	int cmp;
+
+	while (lo < hi) {
+		uint32_t mid = lo + (hi - lo) / 2;
+
+		client = &report->clients[report->client_index[mid]];
+		cmp = gtop_report_client_cmp_key(client, pid, name);
+		if (!cmp)
+			return client;
+
+		if (cmp < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	/* grow by powers of two */
+	if (!(report->nr_clients & (report->nr_clients - 1))) {
+		size_t nr = report->nr_clients ? report->nr_clients * 2 : 16;
+		uint32_t *index;
+
+		client = realloc(report->clients, nr * sizeof(*client));
+		if (!client)
+			return NULL;
+		report->clients = client;
+
+		index = realloc(report->client_index, nr * sizeof(*index));
+		if (!index)
+			return NULL;
+		report->client_index = index;
+	}
+
+	/* the new client goes at the end, its index where the search stopped */
+	memmove(&report->client_index[lo + 1], &report->client_index[lo],
+		(report->nr_clients - lo) * sizeof(*report->client_index));
+	report->client_index[lo] = report->nr_clients;
+
+	client = &report->clients[report->nr_clients++];
+	memset(client, 0, sizeof(*client));
+
+	client->pid = pid;
+	strncpy(client->name, name, sizeof(client->name) - 1);
+
+	return client;
+}
+
+static int
+gtop_report_add_clients(struct gtop_report *report, uint64_t timestamp,
+			const struct gtop_record_client *entries, uint32_t nr)
+{
+	struct gtop_report_client *client;
+	uint32_t i;
+
+	for (i = 0; i < nr; i++) {
+		client = gtop_report_client_get(report, entries[i].pid, entries[i].name);
+		if (!client)
+			return -1;
+
+		if (!client->samples)
+			client->first = timestamp;
+		client->last = timestamp;
+
+		client->samples++;
+		client->sum += entries[i].total;
+		if (entries[i].total > client->peak)
+			client->peak = entries[i].total;
+	}
+
+	return 0;
+}
+
+static struct gtop_report_range *
+gtop_report_range_get(struct gtop_report *report, const char *name)
+{
+	struct gtop_report_range *range;
+	uint32_t i;
+
+	for (i = 0; i < report->nr_ranges; i++) {
+		range = &report->ranges[i];
+		if (!strncmp(range->name, name, sizeof(range->name)))
+			return range;
+	}
+
+	/* grow by powers of two */
+	if (!(report->nr_ranges & (report->nr_ranges - 1))) {
+		size_t nr = report->nr_ranges ? report->nr_ranges * 2 : 4;
+
+		range = realloc(report->ranges, nr * sizeof(*range));
+		if (!range)
+			return NULL;
+		report->ranges = range;
+	}
+
+	range = &report->ranges[report->nr_ranges++];
+	memset(range, 0, sizeof(*range));
+
+	strncpy(range->name, name, sizeof(range->name) - 1);
+
+	return range;
+}
+
+static int
+gtop_report_add_range(struct gtop_report *report,
+		      const struct gtop_record_range *entry)
+{
+	struct gtop_report_range *range;
+
+	range = gtop_report_range_get(report, entry->name);
+	if (!range)
+		return -1;
+
+	if (gtop_report_metric_add(&range->duration,
+				   (entry->end - entry->begin) / 1e6) < 0)
+		return -1;
+
+	if (entry->samples &&
+	    gtop_report_metric_add(&range->busy,
+				   100.0f * entry->busy / entry->samples) < 0)
+		return -1;
+
+	return 0;
+}
+
+static int
+gtop_report_add_snapshot(struct gtop_report *report, const struct gtop_snapshot *snap,
+			 const struct gtop_classifier *classifier)
+{
+	struct gtop_classification result;
+	float values[GTOP_METRIC_NR];
+	uint32_t m, governor = 0;
+
+	gtop_snapshot_metrics(snap, values);
+
+	for (m = 0; m < GTOP_METRIC_NR; m++) {
+		if (isnan(values[m]))
+			continue;
+		if (gtop_report_metric_add(&report->metrics[m], values[m]) < 0)
+			return -1;
+	}
+
+	for (m = GTOP_METRIC_DDR; m < GTOP_METRIC_SCALARS; m++) {
+		double w = snap->interval / 1e9;
+
+		if (isnan(values[m]))
+			continue;
+		report->totals[m] += gtop_snapshot_total(snap, m);
+		report->totals_time[m] += snap->interval;
+		report->rates_sq[m] += w * values[m] * values[m];
+		report->totals_time_sq[m] += w * w;
+	}
+
+	if ((snap->valid & GTOP_SNAPSHOT_GOVERNOR) && snap->governor < GTOP_REPORT_GOVERNORS)
+		governor = snap->governor;
+	report->governor_time[governor] += snap->interval;
+
+	gtop_classify(classifier, snap, &result);
+	report->verdict_time[result.verdict] += snap->interval;
+
+	if (!report->nr_snapshots)
+		report->first = snap->timestamp;
+	report->last = snap->timestamp;
+
+	report->nr_snapshots++;
+	report->duration += snap->interval;
+
+	return 0;
+}
+
+static int
+gtop_report_merge(struct gtop_report *report, const struct gtop_report *other)
+{
+	struct gtop_report_client *client;
+	uint32_t i;
+
+	for (i = 0; i < GTOP_METRIC_NR; i++) {
+		if (gtop_report_metric_merge(&report->metrics[i], &other->metrics[i]) < 0)
+			return -1;
+		report->totals[i] += other->totals[i];
+		report->totals_time[i] += other->totals_time[i];
+		report->rates_sq[i] += other->rates_sq[i];
+		report->totals_time_sq[i] += other->totals_time_sq[i];
+	}
+
+	for (i = 0; i < GTOP_REPORT_GOVERNORS; i++)
+		report->governor_time[i] += other->governor_time[i];
+	for (i = 0; i < GTOP_VERDICT_NR; i++)
+		report->verdict_time[i] += other->verdict_time[i];
+
+	/* parts are merged in order, other comes after report */
+	if (other->nr_snapshots) {
+		if (!report->nr_snapshots)
+			report->first = other->first;
+		report->last = other->last;
+	}
+
+	report->nr_snapshots += other->nr_snapshots;
+	report->duration += other->duration;
+
+	for (i = 0; i < other->nr_clients; i++) {
+		const struct gtop_report_client *c = &other->clients[i];
+
+		client = gtop_report_client_get(report, c->pid, c->name);
+		if (!client)
+			return -1;
+
+		if (!client->samples)
+			client->first = c->first;
+		client->last = c->last;
+
+		client->samples += c->samples;
+		client->sum += c->sum;
+		if (c->peak > client->peak)
+			client->peak = c->peak;
+	}
+
+	for (i = 0; i < other->nr_ranges; i++) {
+		const struct gtop_report_range *r = &other->ranges[i];
+		struct gtop_report_range *range;
+
+		range = gtop_report_range_get(report, r->name);
+		if (!range ||
+		    gtop_report_metric_merge(&range->duration, &r->duration) < 0 ||
+		    gtop_report_metric_merge(&range->busy, &r->busy) < 0)
+			return -1;
+	}
+
+	return 0;
+}
+
+static void *
+gtop_report_part_run(void *data)
+{
+	struct gtop_report_part *part = data;
+	struct gtop_record_cursor cursor;
+	struct gtop_record_entry entry;
+	struct gtop_snapshot snap;
+	struct gtop_record_range range;
+	const void *payload;
+	int ret = 0;
+
+	part->err = -1;
+
+	if (gtop_record_cursor_init(&cursor, part->file, part->begin) < 0)
+		return NULL;
+
+	/* the first part starts on an entry, others look for one */
+	if (!part->aligned &&
+	    gtop_record_cursor_sync(&cursor) < 0) {
+		part->err = 0;
+		goto out;
+	}
+
+	while (cursor.offset < part->end &&
+	       (ret = gtop_record_cursor_next(&cursor, &entry, &payload)) > 0) {
+		if (entry.timestamp < part->from || entry.timestamp > part->to)
+			continue;
+
+		switch (entry.type) {
+		case GTOP_RECORD_SNAPSHOT:
+			if (entry.size < sizeof(snap))
+				break;
+			if (part->warmup) {
+				part->warmup = false;
+				break;
+			}
+			memcpy(&snap, payload, sizeof(snap));
+			if (gtop_report_add_snapshot(&part->report, &snap, part->classifier) < 0)
+				goto out;
+			break;
+		case GTOP_RECORD_CLIENTS:
+			if (gtop_report_add_clients(&part->report, entry.timestamp, payload,
+						    entry.size / sizeof(struct gtop_record_client)) < 0)
+				goto out;
+			break;
+		case GTOP_RECORD_RANGE:
+			if (entry.size < offsetof(struct gtop_record_range, counters))
+				break;
+			memcpy(&range, payload, offsetof(struct gtop_record_range, counters));
+			range.name[sizeof(range.name) - 1] = '\0';
+			if (gtop_report_add_range(&part->report, &range) < 0)
+				goto out;
+			break;
+		default:
+			/* newer entry types, skip them */
+			break;
+		}
+	}
+
+	part->err = ret < 0 ? -1 : 0;
+out:
+	gtop_record_cursor_fini(&cursor);
+	return NULL;
+}
+
+int
+gtop_report_build(struct gtop_report *report, const char *path, unsigned int jobs,
+		  uint64_t from, uint64_t to, double ddr_peak)
+{
+	struct gtop_classifier classifier;
+	struct gtop_report_part *parts;
+	struct gtop_record_index index;
+	struct gtop_record_file file;
+	pthread_t *threads;
+	off_t begin, end, span;
+	uint32_t last;
+	unsigned int i;
+	int err = 0;
+
+	memset(report, 0, sizeof(*report));
+
+	if (gtop_record_open(&file, path) < 0)
+		return -1;
+
+	report->header = file.header;
+	report->names = file.names;
+	gtop_classifier_init(&classifier, &report->names, ddr_peak);
+
+	if (gtop_record_index_load(&index, &file) < 0) {
+		gtop_record_file_close(&file);
+		return -1;
+	}
+
+	gtop_record_window(&file.header, &from, &to);
+
+	/* only the blocks that overlap [from, to] */
+	begin = gtop_record_index_seek(&index, from);
+	end = file.size;
+	last = gtop_record_index_find(&index, to);
+	if (last + 1 < index.nr_blocks)
+		end = index.blocks[last + 1].offset;
+	else if (last + 1 == index.nr_blocks)
+		end = index.tail;
+	gtop_record_index_fini(&index);
+
+	if (!jobs) {
+		long nr = sysconf(_SC_NPROCESSORS_ONLN);
+		jobs = nr > 0 ? nr : 1;
+	}
+
+	span = end > begin ? end - begin : 0;
+	if ((off_t) jobs > span / GTOP_REPORT_MIN_CHUNK)
+		jobs = span / GTOP_REPORT_MIN_CHUNK;
+	if (!jobs)
+		jobs = 1;
+
+	parts = calloc(jobs, sizeof(*parts));
+	threads = calloc(jobs, sizeof(*threads));
+	if (!parts || !threads) {
+		err = -1;
+		goto out;
+	}
+
+	for (i = 0; i < jobs; i++) {
+		parts[i].file = &file;
+		parts[i].begin = begin + span * i / jobs;
+		parts[i].end = begin + span * (i + 1) / jobs;
+		parts[i].aligned = !i;
+		parts[i].warmup = !i && begin <= file.data_offset &&
+				  file.header.version_minor < 5;
+		parts[i].from = from;
+		parts[i].to = to;
+		parts[i].classifier = &classifier;
+	}
+
+	/* the calling thread takes the first part */
+	for (i = 1; i < jobs; i++) {
+		if (pthread_create(&threads[i], NULL, gtop_report_part_run, &parts[i])) {
+			fprintf(stderr, "Failed to start report thread\n");
+			jobs = i;
+			err = -1;
+			break;
+		}
+	}
+
+	gtop_report_part_run(&parts[0]);
+
+	for (i = 0; i < jobs; i++) {
+		if (i)
+			pthread_join(threads[i], NULL);
+
+		if (parts[i].err < 0 || gtop_report_merge(report, &parts[i].report) < 0)
+			err = -1;
+
+		gtop_report_fini(&parts[i].report);
+	}
+
+	if (err < 0)
+		fprintf(stderr, "Failed to read %s\n", path);
+
+	/* callers sort clients their own way */
+	free(report->client_index);
+	report->client_index = NULL;
+
+out:
+	free(threads);
+	free(parts);
+	gtop_record_file_close(&file);
+
+	if (err < 0)
+		gtop_report_fini(report);
+
+	return err;
+}
+
+void
+gtop_report_fini(struct gtop_report *report)
+{
+	uint32_t i;
+
+	for (i = 0; i < GTOP_METRIC_NR; i++) {
+		free(report->metrics[i].hist);
+		report->metrics[i].hist = NULL;
+	}
+
+	free(report->clients);
+	report->clients = NULL;
+	report->nr_clients = 0;
+	free(report->client_index);
+	report->client_index = NULL;
+
+	for (i = 0; i < report->nr_ranges; i++) {
+		free(report->ranges[i].duration.hist);
+		free(report->ranges[i].busy.hist);
+	}
+	free(report->ranges);
+	report->ranges = NULL;
+	report->nr_ranges = 0;
+}
+
+static int
+gtop_report_client_cmp(const void *a, const void *b)
+{
+	const struct gtop_report_client *ca = a;
+	const struct gtop_report_client *cb = b;
+
+	if (ca->peak != cb->peak)
+		return ca->peak < cb->peak ? 1 : -1;
+
+	return ca->pid < cb->pid ? -1 : ca->pid > cb->pid;
+}
+
+static double
+gtop_report_seconds(uint64_t ns)
+{
+	return ns / 1e9;
+}
+
+static void
+gtop_report_print_stats(const struct gtop_report *report, const char *title,
+			uint32_t from, uint32_t to)
+{
+	char name[GTOP_METRIC_NAME_LEN];
+	bool header = false;
+	uint32_t m;
+
+	for (m = from; m < to; m++) {
+		const struct gtop_report_metric *metric = &report->metrics[m];
+
+		if (!metric->count ||
+		    !gtop_snapshot_metric_name(&report->names, m, name, sizeof(name)))
+			continue;
+
+		if (!header) {
+			fprintf(stdout, "\n%-40s %10s %10s %10s %10s %10s\n", title,
+				"mean", "p50", "p90", "p99", "max");
+			header = true;
+		}
+
+		fprintf(stdout, " %-39s %10.2f %10.2f %10.2f %10.2f %10.2f\n", name,
+			gtop_report_mean(metric),
+			gtop_report_percentile(metric, 50),
+			gtop_report_percentile(metric, 90),
+			gtop_report_percentile(metric, 99),
+			metric->max);
+	}
+}
+
+static void
+gtop_report_print_totals(const struct gtop_report *report, const char *title,
+			 const char *rate, uint32_t from, uint32_t to)
+{
+	char name[GTOP_METRIC_NAME_LEN], p99[16], max[16];
+	bool header = false;
+	uint32_t m;
+
+	/* the distribution is one of rates */
+	snprintf(p99, sizeof(p99), "p99 %s", rate);
+	snprintf(max, sizeof(max), "max %s", rate);
+
+	for (m = from; m < to; m++) {
+		const struct gtop_report_metric *metric = &report->metrics[m];
+
+		if (!metric->count ||
+		    !gtop_snapshot_metric_name(&report->names, m, name, sizeof(name)))
+			continue;
+
+		if (!header) {
+			fprintf(stdout, "\n%-40s %16s %12s %12s %12s\n", title,
+				"total", rate, p99, max);
+			header = true;
+		}
+
+		fprintf(stdout, " %-39s %16.0f %12.2f %12.2f %12.2f\n", name,
+			report->totals[m], gtop_report_rate(report, m),
+			gtop_report_percentile(metric, 99), metric->max);
+	}
+}
+
+static void
+gtop_report_print_text(const struct gtop_report *report, const char *path,
+		       uint32_t top)
+{
+	double secs = gtop_report_seconds(report->duration);
+	uint32_t i;
+
+	fprintf(stdout, "Recording: %s\n", path);
+	fprintf(stdout, "Duration: %.1fs, %" PRIu64 " snapshots, %.3fs interval\n",
+		secs, report->nr_snapshots,
+		gtop_report_seconds(report->header.interval));
+
+	gtop_report_print_stats(report, "Occupancy (% busy)",
+				GTOP_METRIC_CORES, GTOP_METRIC_DMA_STATES);
+	gtop_report_print_stats(report, "DMA states (% of samples)",
+				GTOP_METRIC_DMA_STATES, GTOP_METRIC_DDR);
+	gtop_report_print_totals(report, "Counters (events)", "events/s",
+				 GTOP_METRIC_COUNTERS(0), GTOP_METRIC_SCALARS);
+	gtop_report_print_totals(report, "DDR (MB)", "MB/s",
+				 GTOP_METRIC_DDR, GTOP_METRIC_COUNTERS(0));
+	gtop_report_print_stats(report, "Other",
+				GTOP_METRIC_SCALARS, GTOP_METRIC_NR);
+
+	fprintf(stdout, "\n%-40s %10s %10s\n", "Governor residency", "time(s)", "%");
+	for (i = 0; i < GTOP_REPORT_GOVERNORS; i++) {
+		if (!report->governor_time[i])
+			continue;
+
+		fprintf(stdout, " %-39s %10.1f %10.2f\n", gtop_report_governors[i],
+			gtop_report_seconds(report->governor_time[i]),
+			100.0 * report->governor_time[i] / report->duration);
+	}
+
+	fprintf(stdout, "\n%-40s %10s %10s\n", "Bottleneck", "time(s)", "%");
+	for (i = 0; i < GTOP_VERDICT_NR; i++) {
+		if (!report->verdict_time[i])
+			continue;
+
+		fprintf(stdout, " %-39s %10.1f %10.2f\n", gtop_verdict_name(i),
+			gtop_report_seconds(report->verdict_time[i]),
+			100.0 * report->verdict_time[i] / report->duration);
+	}
+
+	fprintf(stdout, "\n%-32s %7s %12s %12s %10s\n", "Top memory clients",
+		"PID", "peak(kB)", "mean(kB)", "seen(s)");
+	for (i = 0; i < report->nr_clients && i < top; i++) {
+		const struct gtop_report_client *client = &report->clients[i];
+
+		fprintf(stdout, " %-31s %7u %12" PRIu64 " %12.0f %10.1f\n",
+			client->name, client->pid, client->peak / 1024,
+			client->sum / client->samples / 1024,
+			gtop_report_seconds(client->last - client->first));
+	}
+
+	if (!report->nr_ranges)
+		return;
+
+	fprintf(stdout, "\n%-32s %8s %10s %10s %10s %10s %10s\n", "Application ranges",
+		"count", "p50(ms)", "p90(ms)", "p99(ms)", "max(ms)", "busy(%)");
+	for (i = 0; i < report->nr_ranges; i++) {
+		const struct gtop_report_range *range = &report->ranges[i];
+
+		fprintf(stdout, " %-31s %8" PRIu64 " %10.2f %10.2f %10.2f %10.2f %10.2f\n",
+			range->name, range->duration.count,
+			gtop_report_percentile(&range->duration, 50),
+			gtop_report_percentile(&range->duration, 90),
+			gtop_report_percentile(&range->duration, 99),
+			range->duration.max, gtop_report_mean(&range->busy));
+	}
+}
+
+static void
+gtop_report_print_json(const struct gtop_report *report, const char *path,
+		       uint32_t top)
+{
+	char name[GTOP_METRIC_NAME_LEN];
+	double secs = gtop_report_seconds(report->duration);
+	bool first = true;
+	uint32_t i, m;
+
+	fprintf(stdout, "{\n  \"recording\": ");
+	gtop_json_string(stdout, path);
+	fprintf(stdout, ",\n  \"duration\": ");
+	gtop_json_number(stdout, secs);
+	fprintf(stdout, ",\n  \"snapshots\": %" PRIu64 ",\n  \"interval\": ",
+		report->nr_snapshots);
+	gtop_json_number(stdout, gtop_report_seconds(report->header.interval));
+
+	fprintf(stdout, ",\n  \"metrics\": {");
+	for (m = 0; m < GTOP_METRIC_NR; m++) {
+		const struct gtop_report_metric *metric = &report->metrics[m];
+
+		if (!metric->count ||
+		    !gtop_snapshot_metric_name(&report->names, m, name, sizeof(name)))
+			continue;
+
+		fprintf(stdout, "%s\n    ", first ? "" : ",");
+		first = false;
+
+		gtop_json_string(stdout, name);
+		fprintf(stdout, ": { \"count\": %" PRIu64 ", \"min\": ", metric->count);
+		gtop_json_number(stdout, metric->min);
+		fprintf(stdout, ", \"mean\": ");
+		gtop_json_number(stdout, gtop_report_mean(metric));
+		fprintf(stdout, ", \"stddev\": ");
+		gtop_json_number(stdout, gtop_report_stddev(metric));
+		fprintf(stdout, ", \"p50\": ");
+		gtop_json_number(stdout, gtop_report_percentile(metric, 50));
+		fprintf(stdout, ", \"p90\": ");
+		gtop_json_number(stdout, gtop_report_percentile(metric, 90));
+		fprintf(stdout, ", \"p99\": ");
+		gtop_json_number(stdout, gtop_report_percentile(metric, 99));
+		fprintf(stdout, ", \"max\": ");
+		gtop_json_number(stdout, metric->max);
+		/* only amounts add up */
+		if (m >= GTOP_METRIC_DDR && m < GTOP_METRIC_SCALARS) {
+			fprintf(stdout, ", \"total\": ");
+			gtop_json_number(stdout, report->totals[m]);
+			fprintf(stdout, ", \"rate\": ");
+			gtop_json_number(stdout, gtop_report_rate(report, m));
+		}
+		fprintf(stdout, " }");
+	}
+
+	fprintf(stdout, "\n  },\n  \"governor\": {");
+	first = true;
+	for (i = 0; i < GTOP_REPORT_GOVERNORS; i++) {
+		if (!report->governor_time[i])
+			continue;
+
+		fprintf(stdout, "%s\n    \"%s\": ", first ? "" : ",",
+			gtop_report_governors[i]);
+		gtop_json_number(stdout, gtop_report_seconds(report->governor_time[i]));
+		first = false;
+	}
+
+	fprintf(stdout, "\n  },\n  \"bottleneck\": {");
+	first = true;
+	for (i = 0; i < GTOP_VERDICT_NR; i++) {
+		if (!report->verdict_time[i])
+			continue;
+
+		fprintf(stdout, "%s\n    \"%s\": ", first ? "" : ",",
+			gtop_verdict_name(i));
+		gtop_json_number(stdout, gtop_report_seconds(report->verdict_time[i]));
+		first = false;
+	}
+
+	fprintf(stdout, "\n  },\n  \"clients\": [");
+	for (i = 0; i < report->nr_clients && i < top; i++) {
+		const struct gtop_report_client *client = &report->clients[i];
+
+		fprintf(stdout, "%s\n    { \"pid\": %u, \"name\": ", i ? "," : "",
+			client->pid);
+		gtop_json_string(stdout, client->name);
+		fprintf(stdout, ", \"peak\": %" PRIu64 ", \"mean\": ", client->peak);
+		gtop_json_number(stdout, floor(client->sum / client->samples));
+		fprintf(stdout, ", \"seen\": ");
+		gtop_json_number(stdout, gtop_report_seconds(client->last - client->first));
+		fprintf(stdout, " }");
+	}
+
+	fprintf(stdout, "\n  ],\n  \"ranges\": {");
+	for (i = 0; i < report->nr_ranges; i++) {
+		const struct gtop_report_range *range = &report->ranges[i];
+
+		fprintf(stdout, "%s\n    ", i ? "," : "");
+		gtop_json_string(stdout, range->name);
+		fprintf(stdout, ": { \"count\": %" PRIu64 ", \"mean\": ",
+			range->duration.count);
+		gtop_json_number(stdout, gtop_report_mean(&range->duration));
+		fprintf(stdout, ", \"p50\": ");
+		gtop_json_number(stdout, gtop_report_percentile(&range->duration, 50));
+		fprintf(stdout, ", \"p90\": ");
+		gtop_json_number(stdout, gtop_report_percentile(&range->duration, 90));
+		fprintf(stdout, ", \"p99\": ");
+		gtop_json_number(stdout, gtop_report_percentile(&range->duration, 99));
+		fprintf(stdout, ", \"max\": ");
+		gtop_json_number(stdout, range->duration.max);
+		fprintf(stdout, ", \"busy\": ");
+		gtop_json_number(stdout, gtop_report_mean(&range->busy));
+		fprintf(stdout, " }");
+	}
+	fprintf(stdout, "\n  }\n}\n");
+}
+
+static void
+gtop_report_usage(void)
+{
+	fprintf(stderr, "Usage: gputop report [-j jobs] [-n top] [-s start] [-e end] [-M MB/s] [-J] <recording>\n");
+	fprintf(stderr, "  -j <jobs>     Threads to use, one per CPU by default\n");
+	fprintf(stderr, "  -n <top>      Memory clients to list (default %u)\n",
+		GTOP_REPORT_DEFAULT_TOP);
+	fprintf(stderr, "  -s <secs>     Start that many seconds into the recording\n");
+	fprintf(stderr, "  -e <secs>     Stop that many seconds into the recording\n");
+	fprintf(stderr, "  -M <MB/s>     Peak bandwidth of a DDR controller, for bottlenecks\n");
+	fprintf(stderr, "  -J            Print JSON instead of text\n");
+}
+
+int
+gtop_report_main(int argc, char **argv)
+{
+	struct gtop_report report;
+	uint32_t top = GTOP_REPORT_DEFAULT_TOP;
+	unsigned int jobs = 0;
+	uint64_t from = 0, to = UINT64_MAX;
+	double ddr_peak = 0.0;
+	bool json = false;
+	int c;
+
+	optind = 1;
+	while ((c = getopt(argc, argv, "j:n:s:e:M:Jh")) != -1) {
+		switch (c) {
+		case 'j':
+			jobs = atoi(optarg);
+			break;
+		case 'n':
+			top = atoi(optarg);
+			break;
+		case 's':
+			if (gtop_record_parse_time(optarg, &from) < 0)
+				return EXIT_FAILURE;
+			break;
+		case 'e':
+			if (gtop_record_parse_time(optarg, &to) < 0)
+				return EXIT_FAILURE;
+			break;
+		case 'M':
+			ddr_peak = atof(optarg);
+			break;
+		case 'J':
+			json = true;
+			break;
+		case 'h':
+		default:
+			gtop_report_usage();
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (optind != argc - 1) {
+		gtop_report_usage();
+		return EXIT_FAILURE;
+	}
+
+	if (gtop_report_build(&report, argv[optind], jobs, from, to, ddr_peak) < 0)
+		return EXIT_FAILURE;
+
+	qsort(report.clients, report.nr_clients, sizeof(*report.clients),
+	      gtop_report_client_cmp);
+
+	if (json)
+		gtop_report_print_json(&report, argv[optind], top);
+	else
+		gtop_report_print_text(&report, argv[optind], top);
+
+	gtop_report_fini(&report);
+	return EXIT_SUCCESS;
+}
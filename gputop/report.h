@@ -0,0 +1,197 @@
+/*
+ * Copyright NXP 2017
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sub license,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#ifndef __GPUTOP_REPORT_H
+#define __GPUTOP_REPORT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "snapshot.h"
+#include "record.h"
+#include "classify.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* governor levels are 1 based, 0 is for snapshots without one */
+#define GTOP_REPORT_GOVERNORS		4
+
+/**
+ * gtop_report_metric:
+ *
+ * Aggregate of one metric over a recording. The histogram has log-scaled
+ * bins, percentiles taken from it are within ~3% of the real value.
+ */
+struct gtop_report_metric {
+	uint64_t count;
+	float min;
+	float max;
+	double sum;
+	double sum_sq;
+
+	uint32_t *hist;
+};
+
+/**
+ * gtop_report_client:
+ *
+ * Video memory (bytes) of a client, over the snapshots it was seen in.
+ */
+struct gtop_report_client {
+	uint32_t pid;
+	char name[GTOP_RECORD_CLIENT_NAME_LEN];
+
+	uint64_t first;
+	uint64_t last;
+
+	uint64_t samples;
+	uint64_t peak;
+	double sum;
+};
+
+/**
+ * gtop_report_range:
+ *
+ * Instances of an application range (see markers.h): duration in ms and
+ * % of the samples they spanned with core 0 busy.
+ */
+struct gtop_report_range {
+	char name[GTOP_RECORD_RANGE_NAME_LEN];
+
+	struct gtop_report_metric duration;
+	struct gtop_report_metric busy;
+};
+
+struct gtop_report {
+	struct gtop_record_header header;
+	struct gtop_snapshot_names names;
+
+	/* timestamps of the first and last snapshot */
+	uint64_t first;
+	uint64_t last;
+
+	uint64_t nr_snapshots;
+	/* sum of the intervals (ns) */
+	uint64_t duration;
+
+	/* time (ns) spent at each governor level */
+	uint64_t governor_time[GTOP_REPORT_GOVERNORS];
+	/* and with each bottleneck verdict, see classify.h */
+	uint64_t verdict_time[GTOP_VERDICT_NR];
+
+	struct gtop_report_metric metrics[GTOP_METRIC_NR];
+	/* DDR (MB) and counters (events) over the recording, see gtop_snapshot_total() */
+	double totals[GTOP_METRIC_NR];
+	/* and the sum of the intervals (ns) they were sampled in */
+	uint64_t totals_time[GTOP_METRIC_NR];
+	/*
+	 * rate of each interval squared, and the interval (s) squared, summed
+	 * weighted by the interval (s); see gtop_report_rate_stddev()
+	 */
+	double rates_sq[GTOP_METRIC_NR];
+	double totals_time_sq[GTOP_METRIC_NR];
+
+	/* in the order they were first seen */
+	struct gtop_report_client *clients;
+	uint32_t nr_clients;
+	/* while the report is built, clients by pid and name */
+	uint32_t *client_index;
+
+	struct gtop_report_range *ranges;
+	uint32_t nr_ranges;
+};
+
+/**
+ * gtop_report_build:
+ *
+ * Aggregate the recording at path, what happened between from and to (ns
+ * since the recording started). It is split in jobs chunks, each
+ * aggregated by its own thread and merged in order; jobs is capped so that
+ * a chunk is never too small to be worth a thread. 0 for one per CPU.
+ * The time index takes the chunks straight to from. ddr_peak is passed
+ * on to the bottleneck classifier, 0 for its default.
+ */
+int
+gtop_report_build(struct gtop_report *report, const char *path, unsigned int jobs,
+		  uint64_t from, uint64_t to, double ddr_peak);
+
+void
+gtop_report_fini(struct gtop_report *report);
+
+double
+gtop_report_mean(const struct gtop_report_metric *metric);
+
+double
+gtop_report_stddev(const struct gtop_report_metric *metric);
+
+/**
+ * gtop_report_rate:
+ *
+ * Rate (per second) of a DDR or counter metric over the time it was
+ * sampled: its total divided by that time, not the mean of the rates of
+ * each interval. NaN for other metrics.
+ */
+double
+gtop_report_rate(const struct gtop_report *report, uint32_t m);
+
+/**
+ * gtop_report_rate_stddev:
+ *
+ * Spread of the rates of each interval around gtop_report_rate(), each
+ * weighing as much as its interval lasted, as that rate does. NaN for
+ * other metrics or fewer than 2 intervals.
+ */
+double
+gtop_report_rate_stddev(const struct gtop_report *report, uint32_t m);
+
+/**
+ * gtop_report_rate_count:
+ *
+ * How many intervals of the same length gtop_report_rate() is worth, to
+ * take the error of that mean from gtop_report_rate_stddev().
+ */
+double
+gtop_report_rate_count(const struct gtop_report *report, uint32_t m);
+
+/**
+ * gtop_report_percentile:
+ *
+ * Approximate p-th percentile, p between 0 and 100.
+ */
+double
+gtop_report_percentile(const struct gtop_report_metric *metric, double p);
+
+/**
+ * gtop_report_main:
+ *
+ * `gputop report`, prints a summary of a recording.
+ */
+int
+gtop_report_main(int argc, char **argv);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __GPUTOP_REPORT_H */
@@ -0,0 +1,227 @@
+/*
+ * Copyright NXP 2017
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sub license,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include "shm.h"
+
+#define GTOP_SHM_ALIGN(x)	(((x) + 63) & ~63UL)
+
+struct gtop_shm {
+	int fd;
+	bool is_shm;
+	char *name;
+
+	size_t size;
+	struct gtop_shm_header *hdr;
+	struct gtop_snapshot *snap;
+	struct gtop_snapshot_names *names;
+};
+
+static bool
+gtop_shm_is_posix_name(const char *name)
+{
+	return name[0] == '/' && strchr(name + 1, '/') == NULL;
+}
+
+static void
+gtop_shm_unlink(const struct gtop_shm *shm)
+{
+	if (shm->is_shm)
+		shm_unlink(shm->name);
+	else
+		unlink(shm->name);
+}
+
+static int
+gtop_shm_open(const struct gtop_shm *shm, int oflag)
+{
+	if (shm->is_shm)
+		return shm_open(shm->name, oflag, 0644);
+
+	return open(shm->name, oflag, 0644);
+}
+
+/*
+ * an existing segment is only taken over if it was left behind by a gputop
+ * that exited; anything else belongs to someone else
+ */
+static int
+gtop_shm_open_stale(const struct gtop_shm *shm)
+{
+	struct gtop_shm_header *hdr;
+	struct stat st;
+	bool stale;
+	int fd;
+
+	fd = gtop_shm_open(shm, O_RDWR);
+	if (fd < 0) {
+		fprintf(stderr, "Failed to open %s: %s\n", shm->name, strerror(errno));
+		return -1;
+	}
+
+	if (fstat(fd, &st) < 0 || (!shm->is_shm && !S_ISREG(st.st_mode)) ||
+	    (size_t) st.st_size < sizeof(*hdr))
+		goto not_ours;
+
+	hdr = mmap(NULL, sizeof(*hdr), PROT_READ, MAP_SHARED, fd, 0);
+	if (hdr == MAP_FAILED)
+		goto not_ours;
+
+	if (hdr->magic != GTOP_SHM_MAGIC) {
+		munmap(hdr, sizeof(*hdr));
+		goto not_ours;
+	}
+
+	stale = hdr->pid == 0 || (kill(hdr->pid, 0) < 0 && errno == ESRCH);
+	if (!stale)
+		fprintf(stderr, "%s is in use by gputop (pid %u)\n", shm->name, hdr->pid);
+
+	munmap(hdr, sizeof(*hdr));
+	if (stale)
+		return fd;
+
+	close(fd);
+	return -1;
+
+not_ours:
+	fprintf(stderr, "%s exists and isn't a gputop segment\n", shm->name);
+	close(fd);
+	return -1;
+}
+
+struct gtop_shm *
+gtop_shm_create(const char *name)
+{
+	struct gtop_shm *shm;
+	size_t snapshot_offset, names_offset;
+	void *addr;
+
+	shm = calloc(1, sizeof(*shm));
+	if (!shm)
+		return NULL;
+
+	shm->name = strdup(name);
+	shm->is_shm = gtop_shm_is_posix_name(name);
+
+#if defined __ANDROID__ || defined ANDROID
+	/* bionic doesn't provide shm_open() */
+	shm->is_shm = false;
+#endif
+
+	/* from here on, it's ours to unlink */
+	shm->fd = gtop_shm_open(shm, O_RDWR | O_CREAT | O_EXCL);
+	if (shm->fd < 0 && errno == EEXIST) {
+		shm->fd = gtop_shm_open_stale(shm);
+		if (shm->fd < 0)
+			goto err;
+	} else if (shm->fd < 0) {
+		fprintf(stderr, "Failed to open %s: %s\n", name, strerror(errno));
+		goto err;
+	}
+	snapshot_offset = GTOP_SHM_ALIGN(sizeof(struct gtop_shm_header));
+	names_offset = GTOP_SHM_ALIGN(snapshot_offset + sizeof(struct gtop_snapshot));
+	shm->size = names_offset + sizeof(struct gtop_snapshot_names);
+
+	if (ftruncate(shm->fd, shm->size) < 0) {
+		fprintf(stderr, "Failed to size %s: %s\n", name, strerror(errno));
+		goto err_close;
+	}
+
+	addr = mmap(NULL, shm->size, PROT_READ | PROT_WRITE, MAP_SHARED, shm->fd, 0);
+	if (addr == MAP_FAILED) {
+		fprintf(stderr, "Failed to map %s: %s\n", name, strerror(errno));
+		goto err_close;
+	}
+
+	memset(addr, 0, shm->size);
+
+	shm->hdr = addr;
+	shm->snap = (struct gtop_snapshot *) ((char *) addr + snapshot_offset);
+	shm->names = (struct gtop_snapshot_names *) ((char *) addr + names_offset);
+
+	shm->hdr->version_major = GTOP_SHM_VERSION_MAJOR;
+	shm->hdr->version_minor = GTOP_SHM_VERSION_MINOR;
+	shm->hdr->header_size = sizeof(struct gtop_shm_header);
+	shm->hdr->snapshot_offset = snapshot_offset;
+	shm->hdr->snapshot_size = sizeof(struct gtop_snapshot);
+	shm->hdr->names_offset = names_offset;
+	shm->hdr->names_size = sizeof(struct gtop_snapshot_names);
+	shm->hdr->pid = getpid();
+
+	/* readers check the magic first, so set it last */
+	__atomic_store_n(&shm->hdr->magic, GTOP_SHM_MAGIC, __ATOMIC_RELEASE);
+
+	return shm;
+
+err_close:
+	close(shm->fd);
+	gtop_shm_unlink(shm);
+err:
+	free(shm->name);
+	free(shm);
+	return NULL;
+}
+
+void
+gtop_shm_destroy(struct gtop_shm *shm)
+{
+	if (!shm)
+		return;
+
+	munmap(shm->hdr, shm->size);
+	close(shm->fd);
+	gtop_shm_unlink(shm);
+
+	free(shm->name);
+	free(shm);
+}
+
+void
+gtop_shm_set_names(struct gtop_shm *shm, const struct gtop_snapshot_names *names)
+{
+	memcpy(shm->names, names, sizeof(*names));
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+void
+gtop_shm_publish(struct gtop_shm *shm, const struct gtop_snapshot *snap)
+{
+	uint32_t seq = shm->hdr->seq;
+
+	/* odd: readers will retry until we're done */
+	__atomic_store_n(&shm->hdr->seq, seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+
+	memcpy(shm->snap, snap, sizeof(*snap));
+
+	__atomic_store_n(&shm->hdr->seq, seq + 2, __ATOMIC_RELEASE);
+}
@@ -0,0 +1,168 @@
+/*
+ * Copyright NXP 2017
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sub license,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __GPUTOP_SHM_H
+#define __GPUTOP_SHM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "snapshot.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define GTOP_SHM_MAGIC		0x504f5447	/* "GTOP" */
+#define GTOP_SHM_VERSION_MAJOR	1
+#define GTOP_SHM_VERSION_MINOR	1
+
+/* what readers look for, unless told otherwise */
+#define GTOP_SHM_DEFAULT_NAME	"/gputop"
+
+/**
+ * gtop_shm_header:
+ *
+ * Sits at offset 0 of the shared-memory segment and describes where
+ * everything else is. Readers must check magic and version_major, and use
+ * the offsets/sizes from here rather than sizeof() so that newer writers
+ * can append fields (bumping version_minor) without breaking them.
+ *
+ * The snapshot is protected by a sequence lock: seq is odd while the writer
+ * updates it. Names are written once, before the first snapshot.
+ *
+ * Since 1.1, counters are events over the interval, flagged by
+ * GTOP_SNAPSHOT_COUNTER_EVENTS; they were events per 10 ms before.
+ */
+struct gtop_shm_header {
+	uint32_t magic;
+	uint16_t version_major;
+	uint16_t version_minor;
+
+	uint32_t header_size;
+	uint32_t snapshot_offset;
+	uint32_t snapshot_size;
+	uint32_t names_offset;
+	uint32_t names_size;
+
+	/** pid of the publishing gputop */
+	uint32_t pid;
+
+	/** sequence lock, incremented twice per published snapshot */
+	uint32_t seq;
+	uint32_t reserved;
+};
+
+struct gtop_shm;
+
+/**
+ * gtop_shm_create:
+ *
+ * Create (or re-use) and map the segment. A name starting with '/' and
+ * containing no other '/' goes through shm_open(), anything else is taken
+ * as a path to a regular file, for systems without POSIX shared memory.
+ */
+struct gtop_shm *
+gtop_shm_create(const char *name);
+
+/**
+ * gtop_shm_destroy:
+ *
+ * Unmap and remove the segment.
+ */
+void
+gtop_shm_destroy(struct gtop_shm *shm);
+
+/**
+ * gtop_shm_set_names:
+ *
+ * Publish the names belonging to the snapshot arrays.
+ */
+void
+gtop_shm_set_names(struct gtop_shm *shm, const struct gtop_snapshot_names *names);
+
+/**
+ * gtop_shm_publish:
+ *
+ * Copy the snapshot into the segment under the sequence lock.
+ */
+void
+gtop_shm_publish(struct gtop_shm *shm, const struct gtop_snapshot *snap);
+
+/*
+ * Reader side. These only touch the mapping, no system calls are involved
+ * once the segment has been mapped.
+ */
+static inline uint32_t
+gtop_shm_read_begin(const struct gtop_shm_header *hdr)
+{
+	uint32_t seq;
+
+	while ((seq = __atomic_load_n(&hdr->seq, __ATOMIC_ACQUIRE)) & 1)
+		;
+
+	return seq;
+}
+
+static inline bool
+gtop_shm_read_retry(const struct gtop_shm_header *hdr, uint32_t seq)
+{
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	return __atomic_load_n(&hdr->seq, __ATOMIC_RELAXED) != seq;
+}
+
+/**
+ * gtop_shm_read:
+ *
+ * Copy a consistent snapshot out of a mapped segment. Returns false if the
+ * segment isn't one we understand.
+ */
+static inline bool
+gtop_shm_read(const struct gtop_shm_header *hdr, struct gtop_snapshot *snap)
+{
+	const char *base = (const char *) hdr;
+	uint32_t size, seq;
+
+	if (hdr->magic != GTOP_SHM_MAGIC ||
+	    hdr->version_major != GTOP_SHM_VERSION_MAJOR)
+		return false;
+
+	size = hdr->snapshot_size;
+	if (size > sizeof(*snap))
+		size = sizeof(*snap);
+
+	memset(snap, 0, sizeof(*snap));
+	do {
+		seq = gtop_shm_read_begin(hdr);
+		memcpy(snap, base + hdr->snapshot_offset, size);
+	} while (gtop_shm_read_retry(hdr, seq));
+
+	return true;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __GPUTOP_SHM_H */
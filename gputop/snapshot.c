@@ -0,0 +1,217 @@
+/*
+ * Copyright NXP 2017
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sub license,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include <math.h>
+
+#include "snapshot.h"
+
+static const char *gtop_metric_scalar_names[GTOP_METRIC_NR_SCALARS] = {
+	[GTOP_METRIC_GOVERNOR]		= "governor",
+	[GTOP_METRIC_GPU_CORE_FREQ]	= "gpu_core_freq",
+	[GTOP_METRIC_SHADER_CORE_FREQ]	= "shader_core_freq",
+	[GTOP_METRIC_NR_CLIENTS]	= "clients",
+	[GTOP_METRIC_MEM_TOTAL]		= "mem.total",
+	[GTOP_METRIC_MEM_RESERVED]	= "mem.reserved",
+	[GTOP_METRIC_MEM_CONTIGUOUS]	= "mem.contiguous",
+	[GTOP_METRIC_MEM_VIRTUAL]	= "mem.virtual",
+	[GTOP_METRIC_MEM_NON_PAGED]	= "mem.non_paged",
+};
+
+bool
+gtop_snapshot_interval(uint64_t *last, uint64_t now, uint64_t *interval)
+{
+	bool first = !*last;
+
+	*interval = first ? 0 : now - *last;
+	*last = now;
+
+	return !first;
+}
+
+void
+gtop_snapshot_metrics(const struct gtop_snapshot *snap, float *values)
+{
+	uint32_t i;
+
+	for (i = 0; i < GTOP_METRIC_NR; i++)
+		values[i] = NAN;
+
+	if (snap->valid & GTOP_SNAPSHOT_OCCUPANCY) {
+		for (i = 0; i < snap->nr_cores && i < GTOP_SNAPSHOT_MAX_CORES; i++)
+			values[GTOP_METRIC_CORES + i] = snap->core_busy[i];
+		for (i = 0; i < snap->nr_modules && i < GTOP_SNAPSHOT_MAX_MODULES; i++)
+			values[GTOP_METRIC_MODULES + i] = snap->module_busy[i];
+	}
+
+	if (snap->valid & GTOP_SNAPSHOT_DMA) {
+		for (i = 0; i < snap->nr_dma_states && i < GTOP_SNAPSHOT_MAX_DMA_STATES; i++)
+			values[GTOP_METRIC_DMA_STATES + i] = snap->dma_states[i];
+	}
+
+	/* amounts over the interval, as rates */
+	for (i = GTOP_METRIC_DDR; snap->interval && i < GTOP_METRIC_SCALARS; i++)
+		values[i] = gtop_snapshot_total(snap, i) * 1e9 / snap->interval;
+
+	if (snap->valid & GTOP_SNAPSHOT_GOVERNOR) {
+		values[GTOP_METRIC_SCALARS + GTOP_METRIC_GOVERNOR] = snap->governor;
+		values[GTOP_METRIC_SCALARS + GTOP_METRIC_GPU_CORE_FREQ] = snap->gpu_core_freq;
+		values[GTOP_METRIC_SCALARS + GTOP_METRIC_SHADER_CORE_FREQ] = snap->shader_core_freq;
+	}
+
+	if (snap->valid & GTOP_SNAPSHOT_CLIENTS) {
+		values[GTOP_METRIC_SCALARS + GTOP_METRIC_NR_CLIENTS] = snap->nr_clients;
+		values[GTOP_METRIC_SCALARS + GTOP_METRIC_MEM_TOTAL] = snap->mem_total / 1024;
+		values[GTOP_METRIC_SCALARS + GTOP_METRIC_MEM_RESERVED] = snap->mem_reserved / 1024;
+		values[GTOP_METRIC_SCALARS + GTOP_METRIC_MEM_CONTIGUOUS] = snap->mem_contiguous / 1024;
+		values[GTOP_METRIC_SCALARS + GTOP_METRIC_MEM_VIRTUAL] = snap->mem_virtual / 1024;
+		values[GTOP_METRIC_SCALARS + GTOP_METRIC_MEM_NON_PAGED] = snap->mem_non_paged / 1024;
+	}
+}
+
+double
+gtop_snapshot_total(const struct gtop_snapshot *snap, uint32_t metric)
+{
+	uint32_t p, i;
+
+	if (metric >= GTOP_METRIC_DDR && metric < GTOP_METRIC_COUNTERS(0)) {
+		i = metric - GTOP_METRIC_DDR;
+		if (!(snap->valid & GTOP_SNAPSHOT_DDR) || i >= snap->nr_ddr)
+			return NAN;
+
+		return snap->ddr_mb[i];
+	}
+
+	if (metric < GTOP_METRIC_COUNTERS(0) || metric >= GTOP_METRIC_SCALARS)
+		return NAN;
+
+	p = (metric - GTOP_METRIC_COUNTERS(0)) / GTOP_SNAPSHOT_MAX_COUNTERS;
+	i = metric - GTOP_METRIC_COUNTERS(p);
+	if (!(snap->valid & (p == GTOP_SNAPSHOT_PART1 ? GTOP_SNAPSHOT_COUNTERS_PART1 :
+			     GTOP_SNAPSHOT_COUNTERS_PART2)) ||
+	    i >= snap->nr_counters[p])
+		return NAN;
+
+	if (snap->valid & GTOP_SNAPSHOT_COUNTER_EVENTS)
+		return snap->counters[p][i];
+
+	/* written before: events per 10 ms */
+	return (double) snap->counters[p][i] * snap->interval / 1e7;
+}
+
+/*
+ * copy a name so that it can be used as a key: module names have their
+ * description stripped, spaces are replaced
+ */
+static void
+gtop_snapshot_key(char *dst, size_t len, const char *prefix,
+		  const char *name, bool short_name)
+{
+	size_t n = snprintf(dst, len, "%s", prefix);
+
+	for (; *name && n + 1 < len; name++) {
+		if (*name == ' ') {
+			if (short_name)
+				break;
+			dst[n++] = '_';
+		} else {
+			dst[n++] = *name;
+		}
+	}
+
+	dst[n] = '\0';
+}
+
+bool
+gtop_snapshot_metric_name(const struct gtop_snapshot_names *names,
+			  uint32_t metric, char *name, size_t len)
+{
+	uint32_t p;
+
+	name[0] = '\0';
+
+	if (metric < GTOP_METRIC_MODULES) {
+		snprintf(name, len, "core%u", metric - GTOP_METRIC_CORES);
+	} else if (metric < GTOP_METRIC_DMA_STATES) {
+		gtop_snapshot_key(name, len, "occ.",
+				  names->modules[metric - GTOP_METRIC_MODULES], true);
+	} else if (metric < GTOP_METRIC_DDR) {
+		gtop_snapshot_key(name, len, "dma.",
+				  names->dma_states[metric - GTOP_METRIC_DMA_STATES], false);
+	} else if (metric < GTOP_METRIC_COUNTERS(0)) {
+		gtop_snapshot_key(name, len, "ddr.",
+				  names->ddr[metric - GTOP_METRIC_DDR], false);
+	} else if (metric < GTOP_METRIC_SCALARS) {
+		p = (metric - GTOP_METRIC_COUNTERS(0)) / GTOP_SNAPSHOT_MAX_COUNTERS;
+		gtop_snapshot_key(name, len, p == GTOP_SNAPSHOT_PART1 ? "ctr1." : "ctr2.",
+				  names->counters[p][metric - GTOP_METRIC_COUNTERS(p)], false);
+	} else if (metric < GTOP_METRIC_NR) {
+		snprintf(name, len, "%s",
+			 gtop_metric_scalar_names[metric - GTOP_METRIC_SCALARS]);
+	}
+
+	/* only a prefix means there's no name for it */
+	return name[0] && name[strlen(name) - 1] != '.';
+}
+
+int
+gtop_snapshot_metric_find(const struct gtop_snapshot_names *names, const char *name)
+{
+	char key[GTOP_METRIC_NAME_LEN];
+	uint32_t m;
+
+	for (m = 0; m < GTOP_METRIC_NR; m++)
+		if (gtop_snapshot_metric_name(names, m, key, sizeof(key)) &&
+		    !strcmp(key, name))
+			return m;
+
+	return -1;
+}
+
+void
+gtop_snapshot_print(FILE *f, const struct gtop_snapshot *snap,
+		    const struct gtop_snapshot_names *names)
+{
+	float values[GTOP_METRIC_NR];
+	char name[GTOP_METRIC_NAME_LEN];
+	uint32_t m;
+
+	gtop_snapshot_metrics(snap, values);
+
+	fprintf(f, "time=%" PRIu64 ".%03" PRIu64,
+		snap->timestamp / UINT64_C(1000000000),
+		(snap->timestamp / UINT64_C(1000000)) % 1000);
+
+	for (m = 0; m < GTOP_METRIC_NR; m++) {
+		if (isnan(values[m]))
+			continue;
+		if (!gtop_snapshot_metric_name(names, m, name, sizeof(name)))
+			continue;
+
+		if (values[m] == floorf(values[m]))
+			fprintf(f, " %s=%.0f", name, values[m]);
+		else
+			fprintf(f, " %s=%.2f", name, values[m]);
+	}
+}
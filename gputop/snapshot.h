@@ -0,0 +1,227 @@
+/*
+ * Copyright NXP 2017
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sub license,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __GPUTOP_SNAPSHOT_H
+#define __GPUTOP_SNAPSHOT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define GTOP_SNAPSHOT_MAX_MODULES	16
+#define GTOP_SNAPSHOT_MAX_CORES		2
+#define GTOP_SNAPSHOT_MAX_DMA_STATES	48
+#define GTOP_SNAPSHOT_MAX_COUNTERS	128
+#define GTOP_SNAPSHOT_MAX_DDR		4
+
+#define GTOP_SNAPSHOT_NAME_LEN		48
+
+/* counter parts, index into nr_counters/counters */
+#define GTOP_SNAPSHOT_PART1		0
+#define GTOP_SNAPSHOT_PART2		1
+
+/*
+ * which parts of the snapshot hold data sampled in this interval, anything
+ * not set should be ignored by readers
+ */
+enum gtop_snapshot_valid {
+	GTOP_SNAPSHOT_OCCUPANCY		= (1 << 0),
+	GTOP_SNAPSHOT_DMA		= (1 << 1),
+	GTOP_SNAPSHOT_COUNTERS_PART1	= (1 << 2),
+	GTOP_SNAPSHOT_COUNTERS_PART2	= (1 << 3),
+	GTOP_SNAPSHOT_DDR		= (1 << 4),
+	GTOP_SNAPSHOT_GOVERNOR		= (1 << 5),
+	GTOP_SNAPSHOT_CLIENTS		= (1 << 6),
+	/* counters are events over the interval, not per 10 ms as before */
+	GTOP_SNAPSHOT_COUNTER_EVENTS	= (1 << 7),
+};
+
+/**
+ * gtop_snapshot:
+ *
+ * Everything gputop gathered over one display interval. The layout is fixed
+ * (only fixed-width fields, no pointers) so it can be placed as-is in shared
+ * memory or written to a file. Append new fields at the end only.
+ */
+struct gtop_snapshot {
+	/** CLOCK_MONOTONIC (ns) at the end of the interval */
+	uint64_t timestamp;
+	/** length of the interval (ns) */
+	uint64_t interval;
+
+	/** mask of enum gtop_snapshot_valid */
+	uint32_t valid;
+	/** # of samples taken in the interval */
+	uint32_t samples;
+
+	/** busy (non-idle) percentage of each module */
+	uint32_t nr_modules;
+	float module_busy[GTOP_SNAPSHOT_MAX_MODULES];
+
+	/** usage percentage for each 3D core */
+	uint32_t nr_cores;
+	float core_busy[GTOP_SNAPSHOT_MAX_CORES];
+
+	/** percentage of samples in each FE DMA state, all tables flattened */
+	uint32_t nr_dma_states;
+	float dma_states[GTOP_SNAPSHOT_MAX_DMA_STATES];
+
+	/** DDR PMU traffic (MB) over the interval */
+	uint32_t nr_ddr;
+	float ddr_mb[GTOP_SNAPSHOT_MAX_DDR];
+
+	/** enum governor, 0 if not available */
+	uint32_t governor;
+	uint32_t gpu_core_freq;
+	uint32_t shader_core_freq;
+	uint32_t gpu_clock[GTOP_SNAPSHOT_MAX_CORES];
+	uint32_t shader_clock[GTOP_SNAPSHOT_MAX_CORES];
+
+	/** clients attached to the GPU and the sum of their memory (bytes) */
+	uint32_t nr_clients;
+	uint64_t mem_reserved;
+	uint64_t mem_contiguous;
+	uint64_t mem_virtual;
+	uint64_t mem_non_paged;
+	uint64_t mem_total;
+
+	/**
+	 * events counted over the interval; per 10 ms, as displayed, if
+	 * GTOP_SNAPSHOT_COUNTER_EVENTS isn't set
+	 */
+	uint32_t nr_counters[2];
+	uint64_t counters[2][GTOP_SNAPSHOT_MAX_COUNTERS];
+};
+
+/**
+ * gtop_snapshot_names:
+ *
+ * Names for the array entries of struct gtop_snapshot, in the same order.
+ * These do not change while gputop runs so they are kept apart from the
+ * snapshot itself.
+ */
+struct gtop_snapshot_names {
+	char modules[GTOP_SNAPSHOT_MAX_MODULES][GTOP_SNAPSHOT_NAME_LEN];
+	char dma_states[GTOP_SNAPSHOT_MAX_DMA_STATES][GTOP_SNAPSHOT_NAME_LEN];
+	char ddr[GTOP_SNAPSHOT_MAX_DDR][GTOP_SNAPSHOT_NAME_LEN];
+	char counters[2][GTOP_SNAPSHOT_MAX_COUNTERS][GTOP_SNAPSHOT_NAME_LEN];
+};
+
+/*
+ * Metrics are a flat view over a snapshot: every scalar in it gets an id so
+ * that statistics can be kept for all of them alike. Arrays map to fixed
+ * ranges of ids, with the scalars below at the end.
+ */
+enum gtop_metric_scalar {
+	GTOP_METRIC_GOVERNOR,
+	GTOP_METRIC_GPU_CORE_FREQ,
+	GTOP_METRIC_SHADER_CORE_FREQ,
+	GTOP_METRIC_NR_CLIENTS,
+	GTOP_METRIC_MEM_TOTAL,
+	GTOP_METRIC_MEM_RESERVED,
+	GTOP_METRIC_MEM_CONTIGUOUS,
+	GTOP_METRIC_MEM_VIRTUAL,
+	GTOP_METRIC_MEM_NON_PAGED,
+
+	GTOP_METRIC_NR_SCALARS,
+};
+
+#define GTOP_METRIC_CORES		0
+#define GTOP_METRIC_MODULES		(GTOP_METRIC_CORES + GTOP_SNAPSHOT_MAX_CORES)
+#define GTOP_METRIC_DMA_STATES		(GTOP_METRIC_MODULES + GTOP_SNAPSHOT_MAX_MODULES)
+#define GTOP_METRIC_DDR			(GTOP_METRIC_DMA_STATES + GTOP_SNAPSHOT_MAX_DMA_STATES)
+#define GTOP_METRIC_COUNTERS(p)		(GTOP_METRIC_DDR + GTOP_SNAPSHOT_MAX_DDR + \
+					 (p) * GTOP_SNAPSHOT_MAX_COUNTERS)
+#define GTOP_METRIC_SCALARS		GTOP_METRIC_COUNTERS(2)
+#define GTOP_METRIC_NR			(GTOP_METRIC_SCALARS + GTOP_METRIC_NR_SCALARS)
+
+#define GTOP_METRIC_NAME_LEN		(GTOP_SNAPSHOT_NAME_LEN + 8)
+
+/**
+ * gtop_snapshot_interval:
+ *
+ * Interval of a snapshot collected at now (ns): the time since the
+ * previous collect, kept in last (0 before the first one). False for the
+ * first collect, whose counters and DDR totals go back to when they were
+ * enabled rather than to a previous collect; it isn't a snapshot.
+ */
+bool
+gtop_snapshot_interval(uint64_t *last, uint64_t now, uint64_t *interval);
+
+/**
+ * gtop_snapshot_metrics:
+ *
+ * Flatten a snapshot into GTOP_METRIC_NR values. Whatever hasn't been
+ * sampled is NaN. Memory is in kB, DDR in MB/s, counters in events/s and
+ * everything else in snapshot units, so that values don't depend on the
+ * length of the interval.
+ */
+void
+gtop_snapshot_metrics(const struct gtop_snapshot *snap, float *values);
+
+/**
+ * gtop_snapshot_total:
+ *
+ * What a DDR or counter metric amounted to over the interval, in MB or
+ * events. NaN for other metrics, or if it wasn't sampled.
+ */
+double
+gtop_snapshot_total(const struct gtop_snapshot *snap, uint32_t metric);
+
+/**
+ * gtop_snapshot_metric_name:
+ *
+ * Name of a metric, like "occ.FE" or "ddr.imx8_ddr0/read-cycles", usable as
+ * a key. Returns false for ids that have no name, i.e. are never used.
+ */
+bool
+gtop_snapshot_metric_name(const struct gtop_snapshot_names *names,
+			  uint32_t metric, char *name, size_t len);
+
+/**
+ * gtop_snapshot_metric_find:
+ *
+ * Id of the metric called name, -1 if there's none.
+ */
+int
+gtop_snapshot_metric_find(const struct gtop_snapshot_names *names, const char *name);
+
+/**
+ * gtop_snapshot_print:
+ *
+ * Print the valid parts of a snapshot as a line of key=value pairs, without
+ * the newline so that callers can add their own.
+ */
+void
+gtop_snapshot_print(FILE *f, const struct gtop_snapshot *snap,
+		    const struct gtop_snapshot_names *names);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __GPUTOP_SNAPSHOT_H */
@@ -0,0 +1,45 @@
+/*
+ * Copyright NXP 2017
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sub license,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#ifndef __GPUTOP_SOCKPATH_H
+#define __GPUTOP_SOCKPATH_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * gtop_sockpath_claim:
+ *
+ * Make path free to bind a unix socket of type to. A socket nobody listens
+ * on any more (a previous instance died) is removed; a socket someone
+ * answers on, or anything that isn't a socket, is left alone and -1 is
+ * returned, with the reason printed.
+ */
+int
+gtop_sockpath_claim(const char *path, int type);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __GPUTOP_SOCKPATH_H */
@@ -0,0 +1,63 @@
+/*
+ * Copyright NXP 2017
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sub license,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#include <string.h>
+#include <stdio.h>
+
+#include "tools.h"
+#include "report.h"
+#include "trace.h"
+#include "query.h"
+#include "compare.h"
+#include "gate.h"
+#include "phases.h"
+#include "util.h"
+
+static const struct gtop_tool gtop_tools[] = {
+	{ "report", "Summarize a recording", gtop_report_main },
+	{ "trace", "Convert a recording to a Chrome/Perfetto trace", gtop_trace_main },
+	{ "query", "Extrema or threshold crossings of a metric in a recording", gtop_query_main },
+	{ "compare", "Metrics that moved significantly between two recordings", gtop_compare_main },
+	{ "gate", "Check a recording against a baseline and rules", gtop_gate_main },
+	{ "phases", "Split a recording into phases of steady GPU behaviour", gtop_phases_main },
+};
+
+const struct gtop_tool *
+gtop_tool_find(const char *name)
+{
+	size_t i;
+
+	for (i = 0; i < ARRAY_SIZE(gtop_tools); i++)
+		if (!strcmp(gtop_tools[i].name, name))
+			return &gtop_tools[i];
+
+	return NULL;
+}
+
+void
+gtop_tools_help(FILE *f)
+{
+	size_t i;
+
+	for (i = 0; i < ARRAY_SIZE(gtop_tools); i++)
+		fprintf(f, "  %-12s  %s\n", gtop_tools[i].name, gtop_tools[i].desc);
+}
@@ -0,0 +1,59 @@
+/*
+ * Copyright NXP 2017
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sub license,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#ifndef __GPUTOP_TOOLS_H
+#define __GPUTOP_TOOLS_H
+
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * gtop_tool:
+ *
+ * Offline subcommands, `gputop <name> ...`. They work on recordings only,
+ * so they're also available in host builds, without libgpuperfcnt.
+ */
+struct gtop_tool {
+	const char *name;
+	const char *desc;
+	int (*main)(int argc, char **argv);
+};
+
+/**
+ * gtop_tool_find:
+ *
+ * Returns NULL if name is not a subcommand.
+ */
+const struct gtop_tool *
+gtop_tool_find(const char *name);
+
+void
+gtop_tools_help(FILE *f);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __GPUTOP_TOOLS_H */
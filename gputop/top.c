@@ -30,6 +30,7 @@
 #endif
 #include <errno.h>
 #include <time.h>
+#include <math.h>
 #include <sys/ioctl.h>
 #include <sys/select.h>
 #include <signal.h>
@@ -37,10 +38,28 @@
 #include <inttypes.h>
 #include <ctype.h>
 #include <assert.h>
+#include <pthread.h>
 
 #include <termios.h>
 
 #include "debugfs.h"
+#include "clients.h"
+#include "workers.h"
+#include "procwatch.h"
+#include "snapshot.h"
+#include "shm.h"
+#include "daemon.h"
+#include "history.h"
+#include "record.h"
+#include "ftrace.h"
+#include "markers.h"
+#include "gate.h"
+#include "alerts.h"
+#include "phases.h"
+#include "correlate.h"
+#include "classify.h"
+#include "baseline.h"
+#include "tools.h"
 
 #include <gpuperfcnt/gpuperfcnt.h>
 #include <gpuperfcnt/gpuperfcnt_vivante.h>
@@ -103,11 +122,102 @@ static uint32_t selected_ctx = 0;
 /* associated client we're tracking */
 static struct debugfs_client *selected_client = NULL;
 
+/* pid <-> contexts index of the debugfs database, re-parsed on each use */
+static struct debugfs_database ctx_db;
+
+/* clients list, contexts and whatever else debugfs gives us for one refresh */
+static struct gtop_arena refresh_arena;
+
+/* clients of the GPU, kept across scans */
+static struct gtop_clients gpu_clients;
+/* processes starting and exiting, NULL if we poll; see -N */
+static struct gtop_procwatch *procwatch = NULL;
+static bool procwatch_tried = false;
+/* scan at which clients were last read, 0 to read them next time */
+static uint64_t clients_read_scan = 0;
+/* per-client memory and vidmem queries, -j */
+static struct gtop_workers *query_workers = NULL;
+static unsigned int query_threads = GTOP_QUERY_THREADS;
+/*
+ * the perf device isn't to be used from two threads at once: we hold it
+ * except while we sleep or wait for the queries, they take it in turn
+ */
+static pthread_mutex_t dev_lock = PTHREAD_MUTEX_INITIALIZER;
+/* next client event to record and trace */
+static uint64_t client_event_seq = 0;
+/* client events shown at the bottom of the clients page */
+#define GTOP_DISPLAY_CLIENT_EVENTS	4
+
 /* our prg name */
 static const char *prg_name = "gputop";
 
-/* current termios state */
+/* shared-memory segment we publish snapshots to */
+static struct gtop_shm *shm = NULL;
+static const char *shm_name = NULL;
+static struct gtop_snapshot_names snapshot_names;
+
+/* daemon mode, front-ends subscribe over a unix socket */
+static struct gtop_daemon *daemon_srv = NULL;
+static const char *socket_path = NULL;
+
+/* downsampled history of all metrics, bounded to history_size bytes */
+static struct gtop_history *history = NULL;
+static size_t history_size = 0;
+
+/* recording of every snapshot, see gputop report */
+static struct gtop_record *record = NULL;
+static const char *record_path = NULL;
+
+/* GPU samples written to the kernel trace, and what in addition */
+static struct gtop_ftrace *ftrace = NULL;
+static const char *ftrace_path = NULL;
+static const char *ftrace_metrics = NULL;
+
+/* frames and ranges sent by applications */
+static struct gtop_markers *markers = NULL;
+static const char *markers_path = NULL;
+
+/* rules checked on every sample */
+static struct gtop_alerts *alerts = NULL;
+static const char *alerts_path = NULL;
+static struct gtop_phases *phases = NULL;
+static uint64_t phases_start;
+static struct gtop_correlate *correlate = NULL;
+static struct gtop_classifier classifier;
+static double classify_ddr_peak = 0.0;
+/* pinned with 'b', the name waits for the next snapshot */
+static struct gtop_baselines baselines;
+static char baseline_pending[GTOP_BASELINE_NAME_LEN];
+static float baseline_now[GTOP_METRIC_NR];
+static bool baseline_full = false;
+
+/* CI gating: sample, then check the recording against a baseline */
+static const char *gate_rules = NULL;
+static const char *gate_baseline = NULL;
+/* how long to sample (ns), or until which range completes */
+static uint64_t gate_duration = 0;
+static const char *gate_until = NULL;
+/* recording made for the check when -o isn't given */
+static char gate_tmp[PATH_MAX];
+
+/* per-client memory as last gathered, for the recording */
+static struct gtop_record_client record_clients[GTOP_RECORD_MAX_CLIENTS];
+static uint32_t record_clients_nr = 0;
+
+/* what a front-end subscribes to, and how often (ms) */
+static uint32_t connect_streams = ~0U;
+static uint32_t connect_interval = 0;
+/* ns of the daemon's history to ask for, -Q; 0 for snapshots */
+static uint64_t connect_history = 0;
+
+/* client memory as last summed up by the clients page */
+static struct perf_client_memory clients_total;
+static uint32_t clients_total_nr = 0;
+static bool clients_total_fresh = false;
+
+/* current termios state, if there's a tty */
 struct termios tty_old;
+static bool tty_saved = false;
 
 /* this will clear the entire screen, much faster than printing new lines, see
  * console_codes(4) */
@@ -135,6 +245,10 @@ static struct p_page program_pages[] = {
 #if defined HAVE_DDR_PERF && (defined __linux__ || defined __ANDROID__ || defined ANDROID)
 	[PAGE_DDR_PERF]		= { PAGE_DDR_PERF, "DDR" },
 #endif
+	[PAGE_MARKERS]		= { PAGE_MARKERS, "Application markers" },
+	[PAGE_PHASES]		= { PAGE_PHASES, "Phases" },
+	[PAGE_CORRELATION]	= { PAGE_CORRELATION, "DDR correlation" },
+	[PAGE_BASELINE]		= { PAGE_BASELINE, "Baseline" },
 };
 
 struct dma_table dma_tables[] = {
@@ -160,9 +274,35 @@ static struct perf_pmu_ddr perf_pmu_axid_ddrs[] = {
 	{ "imx8_ddr1", { { -1, "axid-read" }, { -1, "axid-write" } } },
   };
 
+/* values read in the last interval, see gtop_read_pmus() */
+static uint64_t perf_pmu_ddr_values[ARRAY_SIZE(perf_pmu_ddrs)][PERF_DDR_PMUS_COUNT];
+
 #endif
 static int gtop_enable_profiling(struct perf_device *dev);
 
+/*
+ * when publishing, recording or keeping history, we sample all streams,
+ * regardless of the page being displayed
+ */
+static bool
+gtop_publishing(void)
+{
+	return shm != NULL || daemon_srv != NULL || history != NULL ||
+		record != NULL || ftrace != NULL || markers != NULL ||
+		alerts != NULL || phases != NULL || correlate != NULL ||
+		FLAG_IS_SET(flags, FLAG_CLASSIFY) ||
+		baselines.nr || baseline_pending[0];
+}
+
+static void
+gtop_keep_client_memory(const struct gtop_record_client *mem)
+{
+	if ((!record && !alerts) || record_clients_nr >= ARRAY_SIZE(record_clients))
+		return;
+
+	record_clients[record_clients_nr++] = *mem;
+}
+
 static uint64_t
 get_ns_time(void)
 {
@@ -176,6 +316,401 @@ get_ns_time(void)
 	return (ts.tv_sec * NSEC_PER_SEC) + ts.tv_nsec;
 }
 
+/*
+ * read clients and the database, then diff them against what we had;
+ * returns the number of clients (ours not counted)
+ */
+static int
+gtop_scan_clients(void)
+{
+	struct debugfs_client clients;
+	bool changed;
+	int ret;
+
+	/* before the first read, so nothing falls in between */
+	if (!procwatch_tried && !FLAG_IS_SET(flags, FLAG_POLL_CLIENTS)) {
+		procwatch = gtop_procwatch_create();
+		procwatch_tried = true;
+	}
+
+	/*
+	 * drain it even when we read anyway, or what queued up until now
+	 * forces another read right after
+	 */
+	changed = !procwatch || gtop_procwatch_changed(procwatch);
+
+	/* no process started or exited, what we read last still holds */
+	if (!changed && clients_read_scan &&
+	    gpu_clients.scan - clients_read_scan < GTOP_PROCWATCH_RESCAN) {
+		gtop_clients_keep(&gpu_clients);
+		return (int) gpu_clients.nr;
+	}
+	clients_read_scan = 0;
+
+	debugfs_get_current_clients(&clients, NULL, &refresh_arena);
+
+	if (debugfs_get_database(&ctx_db, NULL) < 0)
+		return -1;
+
+	ret = gtop_clients_update(&gpu_clients, clients.head, &ctx_db,
+				  prg_name, get_ns_time());
+	if (ret < 0)
+		return -1;
+
+	clients_read_scan = gpu_clients.scan;
+	return (int) gpu_clients.nr;
+}
+
+/*
+ * memory of a client, queried by a worker
+ */
+struct gtop_client_query {
+	struct gtop_work work;
+
+	struct perf_device *dev;
+	uint32_t pid;
+	/* scan it was asked for */
+	uint64_t scan;
+	struct perf_client_memory mem;
+
+	/* queries not in use */
+	struct gtop_client_query *next_free;
+};
+
+/*
+ * vidmem of all the clients that need it, in one go as vidmem only
+ * answers for one pid at a time
+ */
+struct gtop_vid_mem_query {
+	struct gtop_work work;
+
+	uint64_t scan;
+	uint32_t *pids;
+	struct debugfs_vid_mem_client *vid_mem;
+	uint32_t nr;
+	uint32_t size;
+	int ret;
+
+	/* queued and not taken back yet */
+	bool busy;
+};
+
+static struct gtop_client_query *client_queries_free = NULL;
+static struct gtop_vid_mem_query vid_mem_query;
+
+static void
+gtop_client_query_run(struct gtop_work *work)
+{
+	struct gtop_client_query *query = (struct gtop_client_query *) work;
+
+	memset(&query->mem, 0, sizeof(query->mem));
+
+	pthread_mutex_lock(&dev_lock);
+	perf_get_client_memory(&query->mem, query->pid, query->dev);
+	pthread_mutex_unlock(&dev_lock);
+}
+
+static void
+gtop_vid_mem_query_run(struct gtop_work *work)
+{
+	struct gtop_vid_mem_query *query = (struct gtop_vid_mem_query *) work;
+
+	query->ret = debugfs_get_vid_mem_batch(query->pids, query->nr, query->vid_mem);
+}
+
+/*
+ * what the query found, unless the client changed since it was asked
+ */
+static void
+gtop_client_query_done(struct gtop_client_query *query)
+{
+	struct gtop_client *client = gtop_clients_find(&gpu_clients, query->pid);
+	struct gtop_record_client *mem;
+
+	if (!client || client->changed > query->scan) {
+		/* asked again once this one is out of the way */
+		if (client)
+			client->mem_pending = false;
+		return;
+	}
+
+	mem = &client->mem;
+	memset(mem, 0, sizeof(*mem));
+	mem->pid = client->pid;
+	mem->total = query->mem.total;
+	mem->reserved = query->mem.reserved;
+	mem->contiguous = query->mem.contigous;
+	mem->_virtual = query->mem._virtual;
+	mem->non_paged = query->mem.non_paged;
+	memcpy(mem->name, client->name, sizeof(mem->name));
+
+	client->mem_scan = query->scan;
+	client->mem_pending = false;
+}
+
+static void
+gtop_vid_mem_query_done(struct gtop_vid_mem_query *query)
+{
+	for (uint32_t i = 0; i < query->nr; i++) {
+		struct gtop_client *client = gtop_clients_find(&gpu_clients, query->pids[i]);
+
+		if (!client)
+			continue;
+
+		client->vid_mem_pending = false;
+		if (query->ret < 0 || client->changed > query->scan)
+			continue;
+
+		client->vid_mem = query->vid_mem[i];
+		client->vid_mem_scan = query->scan;
+	}
+
+	query->busy = false;
+}
+
+/*
+ * threads are only started once there's something for them
+ */
+static bool
+gtop_start_client_queries(void)
+{
+	if (!query_workers)
+		query_workers = gtop_workers_create(query_threads);
+
+	return query_workers != NULL;
+}
+
+/*
+ * take back what the workers are done with, from this refresh or late
+ * from the previous ones
+ */
+static void
+gtop_take_client_queries(void)
+{
+	struct gtop_work *work;
+
+	while ((work = gtop_workers_take(query_workers)) != NULL) {
+		if (work->run == gtop_vid_mem_query_run) {
+			gtop_vid_mem_query_done(&vid_mem_query);
+			continue;
+		}
+
+		struct gtop_client_query *query = (struct gtop_client_query *) work;
+
+		gtop_client_query_done(query);
+		query->next_free = client_queries_free;
+		client_queries_free = query;
+	}
+}
+
+/*
+ * query memory of the clients whose memory may have changed, concurrently,
+ * and wait for them until the deadline; those not done by then keep what
+ * they had and are marked pending
+ */
+static void
+gtop_query_clients_memory(struct perf_device *dev)
+{
+	uint64_t deadline = get_ns_time() + GTOP_QUERY_DEADLINE;
+
+	if (!gtop_start_client_queries())
+		return;
+
+	gtop_take_client_queries();
+
+	/* queued with no threads, they run right here */
+	pthread_mutex_unlock(&dev_lock);
+
+	for (uint32_t i = 0; i < gpu_clients.nr; i++) {
+		struct gtop_client *client = &gpu_clients.clients[i];
+		struct gtop_client_query *query;
+
+#if !defined __QNXTO__ && !defined __QNX__
+		/* not displayed */
+		if (client->ctx_no == 0)
+			continue;
+#endif
+		if (client->mem_pending ||
+		    !gtop_client_stale(&gpu_clients, client, client->mem_scan))
+			continue;
+
+		query = client_queries_free;
+		if (query)
+			client_queries_free = query->next_free;
+		else if (!(query = calloc(1, sizeof(*query))))
+			break;
+
+		query->work.run = gtop_client_query_run;
+		query->dev = dev;
+		query->pid = client->pid;
+		query->scan = gpu_clients.scan;
+
+		/* never queried, at least say whose it is */
+		if (!client->mem_scan) {
+			client->mem.pid = client->pid;
+			memcpy(client->mem.name, client->name, sizeof(client->mem.name));
+		}
+
+		client->mem_pending = true;
+		gtop_workers_queue(query_workers, &query->work);
+	}
+
+	gtop_workers_wait(query_workers, deadline);
+	pthread_mutex_lock(&dev_lock);
+
+	gtop_take_client_queries();
+}
+
+/*
+ * same for vidmem, with a single query for all of them
+ */
+static void
+gtop_query_clients_vid_mem(void)
+{
+	struct gtop_vid_mem_query *query = &vid_mem_query;
+	uint64_t deadline = get_ns_time() + GTOP_QUERY_DEADLINE;
+
+	if (!gtop_start_client_queries())
+		return;
+
+	gtop_take_client_queries();
+
+	/* the last one is still going, wait for it */
+	if (query->busy)
+		goto wait;
+
+	if (gpu_clients.nr > query->size) {
+		uint32_t size = query->size ? query->size : 16;
+		struct debugfs_vid_mem_client *vid_mem;
+		uint32_t *pids;
+
+		while (size < gpu_clients.nr)
+			size *= 2;
+
+		pids = realloc(query->pids, size * sizeof(*pids));
+		if (!pids)
+			return;
+		query->pids = pids;
+
+		vid_mem = realloc(query->vid_mem, size * sizeof(*vid_mem));
+		if (!vid_mem)
+			return;
+		query->vid_mem = vid_mem;
+		query->size = size;
+	}
+
+	/* only ask for the ones that changed */
+	query->nr = 0;
+	for (uint32_t i = 0; i < gpu_clients.nr; i++) {
+		struct gtop_client *client = &gpu_clients.clients[i];
+
+		if (!gtop_client_stale(&gpu_clients, client, client->vid_mem_scan))
+			continue;
+
+		query->pids[query->nr++] = client->pid;
+		client->vid_mem_pending = true;
+	}
+
+	if (!query->nr)
+		return;
+
+	query->work.run = gtop_vid_mem_query_run;
+	query->scan = gpu_clients.scan;
+	query->busy = true;
+	gtop_workers_queue(query_workers, &query->work);
+
+wait:
+	pthread_mutex_unlock(&dev_lock);
+	gtop_workers_wait(query_workers, deadline);
+	pthread_mutex_lock(&dev_lock);
+
+	gtop_take_client_queries();
+}
+
+/*
+ * queries in flight are waited for, then their memory freed
+ */
+static void
+gtop_fini_client_queries(void)
+{
+	if (!query_workers)
+		return;
+
+	pthread_mutex_unlock(&dev_lock);
+	gtop_workers_wait(query_workers, 0);
+	pthread_mutex_lock(&dev_lock);
+	gtop_take_client_queries();
+
+	gtop_workers_destroy(query_workers);
+	query_workers = NULL;
+
+	while (client_queries_free) {
+		struct gtop_client_query *query = client_queries_free;
+
+		client_queries_free = query->next_free;
+		free(query);
+	}
+
+	free(vid_mem_query.pids);
+	free(vid_mem_query.vid_mem);
+	memset(&vid_mem_query, 0, sizeof(vid_mem_query));
+}
+
+static void
+gtop_display_client_events(void)
+{
+	uint64_t now = get_ns_time();
+	uint64_t seq = gpu_clients.nr_events;
+	uint32_t shown = 0;
+
+	while (seq > 0 && shown < GTOP_DISPLAY_CLIENT_EVENTS) {
+		const struct gtop_record_client_event *event;
+		uint64_t ts;
+
+		event = gtop_clients_event(&gpu_clients, --seq, &ts);
+		if (!event)
+			break;
+
+		if (!shown)
+			fprintf(stdout, "\n\n%sRecent:%s", bold_color, regular_color);
+
+		fprintf(stdout, " %c%u %.*s (%.0fs ago)",
+			event->type == GTOP_CLIENT_ARRIVED ? '+' : '-',
+			event->pid, (int) sizeof(event->name), event->name,
+			(double) (now - ts) / NSEC_PER_SEC);
+		shown++;
+	}
+}
+
+/*
+ * client events not yet written to the recording or ftrace
+ */
+static void
+gtop_publish_client_events(void)
+{
+	const struct gtop_record_client_event *event;
+	uint64_t ts;
+
+	/* some got dropped, we were too slow */
+	if (gpu_clients.nr_events - client_event_seq > GTOP_CLIENTS_EVENTS)
+		client_event_seq = gpu_clients.nr_events - GTOP_CLIENTS_EVENTS;
+
+	for (; (event = gtop_clients_event(&gpu_clients, client_event_seq, &ts)) != NULL;
+	     client_event_seq++) {
+		if (record)
+			gtop_record_write(record, GTOP_RECORD_CLIENT_EVENT, ts,
+					  event, sizeof(*event));
+		if (ftrace) {
+			char name[GTOP_RECORD_CLIENT_NAME_LEN + 32];
+
+			snprintf(name, sizeof(name), "client %s %.*s (%u)",
+				 event->type == GTOP_CLIENT_ARRIVED ? "arrived" : "exited",
+				 (int) sizeof(event->name), event->name, event->pid);
+			gtop_ftrace_instant(ftrace, name);
+		}
+	}
+}
+
 /*
  * format uint64_t
  */
@@ -226,6 +761,7 @@ tty_init(struct termios *tty_o)
 		fprintf(stderr, "Please use -f option when running in batch mode\n");
 		exit(EXIT_FAILURE);
 	}
+	tty_saved = true;
 
 	new_tty = *tty_o;
 
@@ -248,7 +784,8 @@ tty_init(struct termios *tty_o)
 static void
 tty_reset(struct termios *tty_o)
 {
-	tcsetattr(STDIN_FILENO, TCSAFLUSH, tty_o);
+	if (tty_saved)
+		tcsetattr(STDIN_FILENO, TCSAFLUSH, tty_o);
 }
 
 static int
@@ -264,13 +801,17 @@ get_input_char(void)
 	struct timeval tval = {};
 	tval.tv_sec = DELAY_SECS;
 	tval.tv_usec = DELAY_NSECS / 1000;
+	pthread_mutex_unlock(&dev_lock);
 	rc = select(STDIN_FILENO + 1, &fds, NULL, NULL, &tval);
+	pthread_mutex_lock(&dev_lock);
 #else
 	struct timespec ts = {};
 	/* one second time out */
 	ts.tv_sec = DELAY_SECS;
 	ts.tv_nsec = DELAY_NSECS;
+	pthread_mutex_unlock(&dev_lock);
 	rc = pselect(STDIN_FILENO + 1, &fds, NULL, NULL, &ts, NULL);
+	pthread_mutex_lock(&dev_lock);
 #endif
 
 	return (rc < 0) ? 0 : rc;
@@ -279,7 +820,9 @@ get_input_char(void)
 static void
 delay(void)
 {
+	pthread_mutex_unlock(&dev_lock);
 	nanosleep(&(struct timespec) { .tv_sec = DELAY_SECS, .tv_nsec = DELAY_NSECS }, NULL);
+	pthread_mutex_lock(&dev_lock);
 }
 
 /*
@@ -373,6 +916,45 @@ gtop_display_interactive_mode_perf(const struct gtop_data *gtop,
 	}
 }
 
+/*
+ * min/avg/max usage of each core over the last minute, hour and day
+ */
+static void
+gtop_display_history_usage(void)
+{
+	static const struct {
+		const char *name;
+		uint64_t span;
+	} spans[] = {
+		{ "1m", 60ULL * NSEC_PER_SEC },
+		{ "1h", 3600ULL * NSEC_PER_SEC },
+		{ "24h", 24ULL * 3600ULL * NSEC_PER_SEC },
+	};
+	struct gtop_rollup rollup;
+	uint32_t core, nr_cores = gtop_info.cores[0] > 1 ? 2 : 1;
+	size_t i;
+
+	fprintf(stdout, "\n");
+	fprintf(stdout, "%s USAGE%28s", bold_color, "");
+	for (i = 0; i < ARRAY_SIZE(spans); i++)
+		fprintf(stdout, " %-20s", spans[i].name);
+	fprintf(stdout, "%s\n", regular_color);
+
+	for (core = 0; core < nr_cores; core++) {
+		fprintf(stdout, " CORE%u (min/avg/max)%14s", core, "");
+
+		for (i = 0; i < ARRAY_SIZE(spans); i++) {
+			if (gtop_history_query(history, GTOP_METRIC_CORES + core,
+					       spans[i].span, &rollup))
+				fprintf(stdout, " %5.1f/%5.1f/%5.1f%%  ", rollup.min,
+					gtop_rollup_mean(&rollup), rollup.max);
+			else
+				fprintf(stdout, " %-20s", "-");
+		}
+		fprintf(stdout, "\n");
+	}
+}
+
 static void
 gtop_display_interactive_mode_occupancy(const struct vivante_gpu_state *st)
 {
@@ -411,6 +993,9 @@ gtop_display_interactive_mode_occupancy(const struct vivante_gpu_state *st)
 		fprintf(stdout, " IDLE1%28s %.2f%%\n", "", cycles_idle_percent_core1);
 		fprintf(stdout, " USAGE%28s %.2f%%\n", "", 100.0f - cycles_idle_percent_core1);
 	}
+
+	if (history)
+		gtop_display_history_usage();
 }
 
 
@@ -584,11 +1169,9 @@ gtop_display_drv_info(struct perf_device *dev, struct gtop_hw_drv_info *ginfo, s
 static void
 gtop_display_vid_mem_usage(struct perf_device *dev, struct gtop_hw_drv_info *ginfo)
 {
-	struct debugfs_client clients;
-	struct debugfs_client *curr_client;
-	struct debugfs_vid_mem_client vid_mem_client;
 	struct gtop_clocks_governor governor = {};
 	uint32_t scale_factor = 1024;
+	uint32_t i;
 
 	int nr_clients = 0;
 
@@ -596,13 +1179,16 @@ gtop_display_vid_mem_usage(struct perf_device *dev, struct gtop_hw_drv_info *gin
 
 	gtop_display_drv_info(dev, ginfo, governor);
 
-	nr_clients = debugfs_get_current_clients(&clients, NULL);
+	nr_clients = gtop_scan_clients();
 
 	/* if not clients are attached bail out */
-	if (!nr_clients) {
+	if (nr_clients <= 0) {
 		return;
 	}
 
+	/* the ones that changed, in the background */
+	gtop_query_clients_vid_mem();
+
 	fprintf(stdout, "%s", underlined_color);
 	fprintf(stdout, "%6s %5s %5s %5s %5s %5s %5s %5s %5s %5s %5s %5s %5s %5s %5s %5s", 
 			"PID", "IN", "VE", "TE", "RT", "DE",
@@ -611,66 +1197,69 @@ gtop_display_vid_mem_usage(struct perf_device *dev, struct gtop_hw_drv_info *gin
 	fprintf(stdout, "\n");
 
 	fprintf(stdout, "%s", regular_color);
-	list_for_each(curr_client, clients.head) {
-		/* skip our program from attached programs */
-		if (!strncmp(curr_client->name, prg_name, strlen(prg_name)))
-			continue;
-
-		int ret = debugfs_get_vid_mem(&vid_mem_client, curr_client->pid);
-		if (ret == -1)
-			goto out_exit;
+	for (i = 0; i < gpu_clients.nr; i++) {
+		/* scaled for display only */
+		struct debugfs_vid_mem_client scaled = gpu_clients.clients[i].vid_mem;
+		struct debugfs_vid_mem_client *vid_mem_client = &scaled;
 
 		/* scale them when their are too bigger */
-		if (vid_mem_client.index > scale_factor)
-			vid_mem_client.index /= scale_factor;
-		if (vid_mem_client.vertex > scale_factor)
-			vid_mem_client.vertex /= scale_factor;
-		if (vid_mem_client.texture > scale_factor)
-			vid_mem_client.texture /= scale_factor;
-		if (vid_mem_client.render_target > scale_factor)
-			vid_mem_client.render_target /= scale_factor;
-		if (vid_mem_client.depth > scale_factor)
-			vid_mem_client.depth /= scale_factor;
-		if (vid_mem_client.bitmap > scale_factor)
-			vid_mem_client.bitmap /= scale_factor;
-		if (vid_mem_client.tile_status > scale_factor)
-			vid_mem_client.tile_status /= scale_factor;
-		if (vid_mem_client.image > scale_factor)
-			vid_mem_client.image /= scale_factor;
-		if (vid_mem_client.mask > scale_factor)
-			vid_mem_client.mask /= scale_factor;
-		if (vid_mem_client.scissor > scale_factor)
-			vid_mem_client.scissor /= scale_factor;
-		if (vid_mem_client.hz > scale_factor)
-			vid_mem_client.hz /= scale_factor;
-		if (vid_mem_client.i_cache > scale_factor)
-			vid_mem_client.i_cache /= scale_factor;
-		if (vid_mem_client.tx_desc > scale_factor)
-			vid_mem_client.tx_desc /= scale_factor;
-		if (vid_mem_client.fence > scale_factor)
-			vid_mem_client.fence /= scale_factor;
-		if (vid_mem_client.tfbheader > scale_factor)
-			vid_mem_client.tfbheader /= scale_factor;
-
-		fprintf(stdout, "%6u ",
-				curr_client->pid);
+		if (vid_mem_client->index > scale_factor)
+			vid_mem_client->index /= scale_factor;
+		if (vid_mem_client->vertex > scale_factor)
+			vid_mem_client->vertex /= scale_factor;
+		if (vid_mem_client->texture > scale_factor)
+			vid_mem_client->texture /= scale_factor;
+		if (vid_mem_client->render_target > scale_factor)
+			vid_mem_client->render_target /= scale_factor;
+		if (vid_mem_client->depth > scale_factor)
+			vid_mem_client->depth /= scale_factor;
+		if (vid_mem_client->bitmap > scale_factor)
+			vid_mem_client->bitmap /= scale_factor;
+		if (vid_mem_client->tile_status > scale_factor)
+			vid_mem_client->tile_status /= scale_factor;
+		if (vid_mem_client->image > scale_factor)
+			vid_mem_client->image /= scale_factor;
+		if (vid_mem_client->mask > scale_factor)
+			vid_mem_client->mask /= scale_factor;
+		if (vid_mem_client->scissor > scale_factor)
+			vid_mem_client->scissor /= scale_factor;
+		if (vid_mem_client->hz > scale_factor)
+			vid_mem_client->hz /= scale_factor;
+		if (vid_mem_client->i_cache > scale_factor)
+			vid_mem_client->i_cache /= scale_factor;
+		if (vid_mem_client->tx_desc > scale_factor)
+			vid_mem_client->tx_desc /= scale_factor;
+		if (vid_mem_client->fence > scale_factor)
+			vid_mem_client->fence /= scale_factor;
+		if (vid_mem_client->tfbheader > scale_factor)
+			vid_mem_client->tfbheader /= scale_factor;
+
+		/* still being queried, that's from an earlier refresh */
+		fprintf(stdout, "%c%5u ", gpu_clients.clients[i].vid_mem_pending ? '*' : ' ',
+			gpu_clients.clients[i].pid);
 		/* display */
 		fprintf(stdout, "%5u %5u %5u %5u %5u %5u %5u %5u %5u %5u %5u %5u %5u %5u %5u",
-				vid_mem_client.index, vid_mem_client.vertex,
-				vid_mem_client.texture, vid_mem_client.render_target,
-				vid_mem_client.depth, vid_mem_client.bitmap,
-				vid_mem_client.tile_status, vid_mem_client.image,
-				vid_mem_client.mask, vid_mem_client.scissor,
-				vid_mem_client.hz, vid_mem_client.i_cache,
-				vid_mem_client.tx_desc, vid_mem_client.fence,
-				vid_mem_client.tfbheader);
+				vid_mem_client->index, vid_mem_client->vertex,
+				vid_mem_client->texture, vid_mem_client->render_target,
+				vid_mem_client->depth, vid_mem_client->bitmap,
+				vid_mem_client->tile_status, vid_mem_client->image,
+				vid_mem_client->mask, vid_mem_client->scissor,
+				vid_mem_client->hz, vid_mem_client->i_cache,
+				vid_mem_client->tx_desc, vid_mem_client->fence,
+				vid_mem_client->tfbheader);
+
+		/* types the driver added after these, by name */
+		for (uint32_t j = 0; j < vid_mem_client->extra_no; j++) {
+			uint32_t value = vid_mem_client->extra[j].value;
+
+			if (value > scale_factor)
+				value /= scale_factor;
+			fprintf(stdout, " %s:%u", vid_mem_client->extra[j].name, value);
+		}
 		fprintf(stdout, "\n");
 	}
 
 	fprintf(stdout, "\nN: If value is bigger than %u, assume kBytes, otherwise Bytes\n", scale_factor);
-out_exit:
-	/* free all resources */
-	debugfs_free_clients(&clients);
 }
 
 #if defined HAVE_DDR_PERF && (defined __linux__ || defined __ANDROID__ || defined ANDROID)
@@ -745,6 +1334,47 @@ gtop_disable_pmus(void)
 	}
 }
 
+static void
+gtop_start_pmus(void)
+{
+	if (!perf_ddr_enabled) {
+		gtop_configure_pmus();
+		gtop_enable_pmus();
+		perf_ddr_enabled = 1;
+	}
+}
+
+/*
+ * read and reset all PMUs once per interval, so that both the display and
+ * the snapshot see the same values
+ */
+static void
+gtop_read_pmus(void)
+{
+	unsigned int i, j;
+
+	for_all_pmus(perf_pmu_ddrs, i, j) {
+		int fd = PMU_GET_FD(perf_pmu_ddrs, i, j);
+		if (fd > 0) {
+			perf_pmu_ddr_values[i][j] = perf_event_pmu_read(fd);
+			perf_event_pmu_reset(fd);
+		}
+	}
+}
+
+static double
+gtop_pmu_ddr_mb(unsigned int i, unsigned int j)
+{
+	const char *event_name = PMU_GET_EVENT_NAME(perf_pmu_ddrs, i, j);
+	uint64_t counter_val = perf_pmu_ddr_values[i][j];
+
+	/* axid events count bytes, the others 16-byte bursts */
+	if (!strncmp(event_name, "axid", 4))
+		return counter_val / (1024.0 * 1024.0);
+
+	return counter_val * 16 / (1024.0 * 1024.0);
+}
+
 static inline void
 gtop_display_white_space(size_t amount)
 {
@@ -756,11 +1386,8 @@ static void
 gtop_display_perf_pmus(void)
 {
 	unsigned int i, j;
-	if (!perf_ddr_enabled) {
-		gtop_configure_pmus();
-		gtop_enable_pmus();
-		perf_ddr_enabled = 1;
-	}
+
+	gtop_start_pmus();
 
 	fprintf(stdout, "\n");
 	fprintf(stdout, "%s%5s", underlined_color, "");
@@ -788,7 +1415,6 @@ gtop_display_perf_pmus(void)
 	for_all_pmus(perf_pmu_ddrs, i, j) {
 		int fd = PMU_GET_FD(perf_pmu_ddrs, i, j);
 		if (fd > 0) {
-			uint64_t counter_val = perf_event_pmu_read(fd);
 			const char *type_name = PMU_GET_TYPE_NAME(perf_pmu_ddrs, i);
 			const char *event_name = PMU_GET_EVENT_NAME(perf_pmu_ddrs, j, j);
 
@@ -796,7 +1422,7 @@ gtop_display_perf_pmus(void)
 			snprintf(buf, sizeof(buf), "%s/%s", type_name, event_name);
 
 			size_t buf_len = strlen(buf);
-			double display_value = (double) counter_val * 16 / (1024 * 1024);
+			double display_value = gtop_pmu_ddr_mb(i, j);
 			
 			/* how much we need the remove from default value */
 			size_t adjust_float = 0;
@@ -819,8 +1445,6 @@ gtop_display_perf_pmus(void)
 			/* 0.123 -> 4 chars */
 			fprintf(stdout, "%.2f", display_value);
 
-			perf_event_pmu_reset(fd);
-
 			p++;
 		}
 	}
@@ -831,11 +1455,8 @@ static void
 gtop_display_perf_pmus_short(void)
 {
 	unsigned int i, j;
-	if (!perf_ddr_enabled) {
-		gtop_configure_pmus();
-		gtop_enable_pmus();
-		perf_ddr_enabled = 1;
-	}
+
+	gtop_start_pmus();
 
 	fprintf(stdout, "\n");
 
@@ -864,17 +1485,11 @@ gtop_display_perf_pmus_short(void)
 			int fd = PMU_GET_FD(perf_pmu_ddrs, i, j);
 			if (fd > 0) {
 				const char *event_name = PMU_GET_EVENT_NAME(perf_pmu_ddrs, i, j);
-				uint64_t counter_val = perf_event_pmu_read(fd);
-				double display_value;
-				if(!strncmp(event_name, "axid",4))
-						display_value = counter_val  / (1024.0*1024.0);
-				else
-						display_value = counter_val *16  / (1024.0*1024.0);
+				double display_value = gtop_pmu_ddr_mb(i, j);
 
 				fprintf(stdout, "%s:%.2f", event_name, display_value);
 				if (j < (ARRAY_SIZE(perf_pmu_ddrs[i].events) - 1))
 						fprintf(stdout, ",");
-				perf_event_pmu_reset(fd);
 			}
 		}
 		fprintf(stdout, "\n");
@@ -887,26 +1502,29 @@ gtop_display_perf_pmus_short(void)
 static void
 gtop_display_clients(struct perf_device *dev, struct gtop_hw_drv_info *ginfo)
 {
-	struct debugfs_client clients;
-	struct debugfs_client *curr_client;
 	struct perf_client_memory client_total = {};
 	struct gtop_clocks_governor governor = {};
 
 	int nr_clients = 0;
+	uint32_t nr_shown = 0;
 
 	/* get and display clocks */
 	gtop_get_clocks_governor(&governor);
 	gtop_display_drv_info(dev, ginfo, governor);
 
-	nr_clients = debugfs_get_current_clients(&clients, NULL);
+	/* contexts come along, from one pass over the database */
+	nr_clients = gtop_scan_clients();
+	record_clients_nr = 0;
 
-	/* if not clients are attached bail out */
-	if (!nr_clients) {
+	if (nr_clients < 0)
 		return;
-	}
 
-	/* get all the contexts once to speed up display */
-	if (debugfs_get_contexts(&clients, NULL) < 0) {
+	/* if not clients are attached bail out */
+	if (!nr_clients) {
+		memset(&clients_total, 0, sizeof(clients_total));
+		clients_total_nr = 0;
+		clients_total_fresh = true;
+		gtop_display_client_events();
 		return;
 	}
 
@@ -914,6 +1532,8 @@ gtop_display_clients(struct perf_device *dev, struct gtop_hw_drv_info *ginfo)
 	gtop_display_perf_pmus_short();
 #endif
 
+	gtop_query_clients_memory(dev);
+
 	/* draw with bold */
 	fprintf(stdout, "%s", underlined_color);
 
@@ -932,15 +1552,9 @@ gtop_display_clients(struct perf_device *dev, struct gtop_hw_drv_info *ginfo)
 	/* reset drawing */
 	fprintf(stdout, "%s", regular_color);
 
-	list_for_each(curr_client, clients.head) {
-
-		/* skip our program from attached programs */
-		if (!strncmp(curr_client->name, prg_name, strlen(prg_name)))
-			continue;
-
-		struct perf_client_memory cmem = {};
-
-		/* get contexts for this client */
+	for (uint32_t i = 0; i < gpu_clients.nr; i++) {
+		struct gtop_client *curr_client = &gpu_clients.clients[i];
+		const struct gtop_record_client *cmem;
 
 		/* 
 		 * skip also programs that do not have CTXs.
@@ -951,24 +1565,28 @@ gtop_display_clients(struct perf_device *dev, struct gtop_hw_drv_info *ginfo)
 			continue;
 #endif
 
-		perf_get_client_memory(&cmem, curr_client->pid, dev);
+		cmem = &curr_client->mem;
 
-		fprintf(stdout, "%1s%7u%1s", "",
+		/* still being queried, that's from an earlier refresh */
+		fprintf(stdout, "%1s%7u%1s", curr_client->mem_pending ? "*" : "",
 				curr_client->pid, "");
 
 		fprintf(stdout, "%1s%8"PRIu64"%3s%8"PRIu64"%3s%8"PRIu64"%5s%8"PRIu64"%3s%8"PRIu64,
-				"", cmem.reserved / (1024), 
-				"", cmem.contigous / (1024), 
-				"", cmem._virtual / (1024), 
-				"", cmem.non_paged / (1024), 
-				"", cmem.total / (1024));
+				"", cmem->reserved / (1024), 
+				"", cmem->contiguous / (1024), 
+				"", cmem->_virtual / (1024), 
+				"", cmem->non_paged / (1024), 
+				"", cmem->total / (1024));
+
+		gtop_keep_client_memory(cmem);
 
 		/* compute total amount */
-		client_total.total += cmem.total;
-		client_total.reserved += cmem.reserved;
-		client_total.contigous += cmem.contigous;
-		client_total._virtual += cmem._virtual;
-		client_total.non_paged += cmem.non_paged;
+		client_total.total += cmem->total;
+		client_total.reserved += cmem->reserved;
+		client_total.contigous += cmem->contiguous;
+		client_total._virtual += cmem->_virtual;
+		client_total.non_paged += cmem->non_paged;
+		nr_shown++;
 
 		fprintf(stdout, "   %14s", curr_client->name);
 
@@ -984,6 +1602,10 @@ gtop_display_clients(struct perf_device *dev, struct gtop_hw_drv_info *ginfo)
 		fprintf(stdout, "\n");
 	}
 
+	/* keep them around for the snapshot */
+	clients_total = client_total;
+	clients_total_nr = nr_shown;
+	clients_total_fresh = true;
 
 	fprintf(stdout, "\n%s", bold_color);
 	fprintf(stdout, "TOT: ");
@@ -996,22 +1618,11 @@ gtop_display_clients(struct perf_device *dev, struct gtop_hw_drv_info *ginfo)
 			client_total.total / (1024));
 
 #if !defined __QNXNTO__ && !defined __QNX__
-	char cmdline[512];
 	uint32_t contigousSize;
-	FILE *file;
 
-	file = fopen("/sys/module/galcore/parameters/contiguousSize", "rb");
-	if (file == NULL)
+	if (debugfs_get_contiguous_size(&contigousSize) < 0)
 		goto skip;
 
-	memset(cmdline, 0, sizeof(cmdline));
-	size_t nread = fread(cmdline, 1, sizeof(cmdline) - 1, file);
-	fclose(file);
-
-	(void) nread;
-	sscanf(cmdline, "%"PRIu32, &contigousSize);
-
-
 	fprintf(stdout, "\n");
 	fprintf(stdout, "%s", bold_color);
 	fprintf(stdout, "TOT_CON:");
@@ -1020,8 +1631,52 @@ gtop_display_clients(struct perf_device *dev, struct gtop_hw_drv_info *ginfo)
 			"", "", "", "", (contigousSize - client_total.reserved) / (1024));
 skip:
 #endif
-	/* free all resources */
-	debugfs_free_clients(&clients);
+	gtop_display_client_events();
+
+	/* with contexts shown, so is what reading them costs */
+	if (FLAG_IS_SET(flags, FLAG_SHOW_CONTEXTS))
+		fprintf(stdout, "\n\n%sScratch:%s %zu bytes used, %zu peak",
+			bold_color, regular_color,
+			gtop_arena_in_use(&refresh_arena), refresh_arena.peak);
+}
+
+/*
+ * sums up client memory the same way gtop_display_clients() does, for when
+ * the clients page isn't displayed
+ */
+static uint32_t
+gtop_get_clients_total(struct perf_device *dev, struct perf_client_memory *total)
+{
+	uint32_t nr = 0;
+
+	memset(total, 0, sizeof(*total));
+	record_clients_nr = 0;
+
+	if (gtop_scan_clients() <= 0)
+		return 0;
+
+	gtop_query_clients_memory(dev);
+
+	for (uint32_t i = 0; i < gpu_clients.nr; i++) {
+		struct gtop_client *client = &gpu_clients.clients[i];
+		const struct gtop_record_client *cmem;
+
+#if !defined __QNXTO__ && !defined __QNX__
+		if (client->ctx_no == 0)
+			continue;
+#endif
+		cmem = &client->mem;
+		gtop_keep_client_memory(cmem);
+
+		total->total += cmem->total;
+		total->reserved += cmem->reserved;
+		total->contigous += cmem->contiguous;
+		total->_virtual += cmem->_virtual;
+		total->non_paged += cmem->non_paged;
+		nr++;
+	}
+
+	return nr;
 }
 
 static void
@@ -1043,6 +1698,218 @@ gtop_check_profiler_state(void)
 	}
 }
 
+/*
+ * per-range costs, over the last GTOP_MARKERS_HISTORY instances of each
+ */
+static void
+gtop_display_markers(void)
+{
+	const uint32_t top = 8;
+	uint32_t r, p, c, i;
+
+	if (!markers) {
+		fprintf(stdout, " No marker channel, see -a\n");
+		return;
+	}
+
+	fprintf(stdout, "%s", underlined_color);
+	fprintf(stdout, " %-31s %8s %10s %10s %10s %10s %10s\n", "RANGE", "COUNT",
+		"p50(ms)", "p90(ms)", "p99(ms)", "BUSY p50", "BUSY p99");
+	fprintf(stdout, "%s", regular_color);
+
+	for (r = 0; r < gtop_markers_nr_ranges(markers); r++) {
+		uint64_t count;
+		const char *name = gtop_markers_range(markers, r, &count);
+
+		fprintf(stdout, " %-31s %8" PRIu64 " %10.2f %10.2f %10.2f %9.1f%% %9.1f%%\n",
+			name, count,
+			gtop_markers_percentile(markers, r, GTOP_MARKERS_COST_DURATION, 50),
+			gtop_markers_percentile(markers, r, GTOP_MARKERS_COST_DURATION, 90),
+			gtop_markers_percentile(markers, r, GTOP_MARKERS_COST_DURATION, 99),
+			gtop_markers_percentile(markers, r, GTOP_MARKERS_COST_BUSY, 50),
+			gtop_markers_percentile(markers, r, GTOP_MARKERS_COST_BUSY, 99));
+	}
+
+	/* the most expensive counters of each range */
+	for (r = 0; r < gtop_markers_nr_ranges(markers); r++) {
+		uint32_t best[8], nr_best = 0;
+		double best_mean[8];
+		uint64_t count;
+		const char *name = gtop_markers_range(markers, r, &count);
+
+		for (c = GTOP_MARKERS_COST_COUNTERS; c < GTOP_MARKERS_NR_COSTS; c++) {
+			double mean = gtop_markers_mean(markers, r, c);
+
+			if (isnan(mean) || mean <= 0)
+				continue;
+
+			/* keep the top ones sorted */
+			for (i = nr_best; i > 0 && best_mean[i - 1] < mean; i--) {
+				if (i < top) {
+					best[i] = best[i - 1];
+					best_mean[i] = best_mean[i - 1];
+				}
+			}
+			if (i < top) {
+				best[i] = c;
+				best_mean[i] = mean;
+				if (nr_best < top)
+					nr_best++;
+			}
+		}
+
+		if (!nr_best)
+			continue;
+
+		fprintf(stdout, "\n%s", underlined_color);
+		fprintf(stdout, " %-40s %14s %14s %14s\n", name, "MEAN", "p50", "p99");
+		fprintf(stdout, "%s", regular_color);
+
+		for (i = 0; i < nr_best; i++) {
+			c = best[i] - GTOP_MARKERS_COST_COUNTERS;
+			p = c / GTOP_SNAPSHOT_MAX_COUNTERS;
+
+			fprintf(stdout, " %-40.40s %14.0f %14.0f %14.0f\n",
+				snapshot_names.counters[p][c % GTOP_SNAPSHOT_MAX_COUNTERS],
+				best_mean[i],
+				gtop_markers_percentile(markers, r, best[i], 50),
+				gtop_markers_percentile(markers, r, best[i], 99));
+		}
+	}
+}
+
+/*
+ * the last phases found, the current one (still growing) at the bottom
+ */
+static void
+gtop_display_phases(void)
+{
+	const uint32_t rows = 16;
+	uint32_t modules[GTOP_PHASES_TOP_MODULES];
+	char name[GTOP_METRIC_NAME_LEN];
+	uint32_t i, m, n, seq, count;
+
+	if (!phases) {
+		fprintf(stdout, " Phases are not tracked, see -P\n");
+		return;
+	}
+
+	fprintf(stdout, "%s", underlined_color);
+	fprintf(stdout, " %5s %10s %10s %7s %10s  %-40s\n", "PHASE", "START(s)",
+		"LENGTH(s)", "BUSY%", "DDR(MB/s)", "BUSIEST MODULES");
+	fprintf(stdout, "%s", regular_color);
+
+	count = gtop_phases_count(phases);
+	for (i = count > rows ? count - rows : 0; i < count; i++) {
+		const struct gtop_phase *phase = gtop_phases_get(phases, i, &seq);
+
+		fprintf(stdout, " %5u%s %9.1f %10.1f %7.1f %10.1f ", seq,
+			i == count - 1 ? "*" : " ",
+			(int64_t) (phase->begin - phases_start) / 1e9,
+			(phase->end - phase->begin) / 1e9,
+			gtop_phase_utilization(phase), gtop_phase_bandwidth(phase));
+
+		n = gtop_phase_top_modules(phase, modules, GTOP_PHASES_TOP_MODULES);
+		for (m = 0; m < n; m++)
+			if (gtop_snapshot_metric_name(&snapshot_names, modules[m],
+						      name, sizeof(name)))
+				fprintf(stdout, " %s %.0f%%", name,
+					gtop_phase_mean(phase, modules[m]));
+		fprintf(stdout, "\n");
+	}
+}
+
+/*
+ * for each DDR event, the counters and modules that move the most with it
+ */
+static void
+gtop_display_correlation(void)
+{
+	const uint32_t top = 8;
+	uint32_t metrics[8];
+	double r[8];
+	char name[GTOP_METRIC_NAME_LEN];
+	uint32_t d, i, n;
+	bool any = false;
+
+	if (!correlate) {
+		fprintf(stdout, " Correlations are not tracked, see -L\n");
+		return;
+	}
+
+	for (d = GTOP_METRIC_DDR; d < GTOP_METRIC_COUNTERS(0); d++) {
+		n = gtop_correlate_top(correlate, d, metrics, r, top);
+		if (!n)
+			continue;
+		any = true;
+
+		gtop_snapshot_metric_name(&snapshot_names, d, name, sizeof(name));
+		fprintf(stdout, "%s", underlined_color);
+		fprintf(stdout, " %-48s %10s %10s\n", name, "PEARSON", "SPEARMAN");
+		fprintf(stdout, "%s", regular_color);
+
+		for (i = 0; i < n; i++) {
+			gtop_snapshot_metric_name(&snapshot_names, metrics[i], name, sizeof(name));
+			fprintf(stdout, " %-48s %10.2f %10.2f\n", name, r[i],
+				gtop_correlate_spearman(correlate, d, metrics[i]));
+		}
+		fprintf(stdout, "\n");
+	}
+
+	if (!any)
+		fprintf(stdout, " No DDR traffic to correlate yet\n");
+	else
+		fprintf(stdout, " Over %u intervals, Spearman over the last %u\n",
+			gtop_correlate_samples(correlate), GTOP_CORRELATE_WINDOW);
+}
+
+/*
+ * every metric against the active baseline, significant changes in bold
+ */
+static void
+gtop_display_baseline(void)
+{
+	const struct gtop_baseline *baseline = gtop_baselines_active(&baselines);
+	struct gtop_baseline_delta delta;
+	char name[GTOP_METRIC_NAME_LEN];
+	uint32_t m;
+
+	if (baseline_pending[0])
+		fprintf(stdout, " Pinning %s with the next interval\n", baseline_pending);
+	if (baseline_full)
+		fprintf(stdout, " No room for more than %u baselines\n", GTOP_BASELINES_MAX);
+	if (!baseline) {
+		fprintf(stdout, " No baseline pinned, press b to pin the current interval\n");
+		return;
+	}
+
+	fprintf(stdout, " Baseline %s (%u of %u), pinned %.1fs ago, n for the next one\n\n",
+		baseline->name, baselines.active + 1, baselines.nr,
+		(get_ns_time() - baseline->timestamp) / 1e9);
+
+	fprintf(stdout, "%s", underlined_color);
+	fprintf(stdout, " %-48s %12s %12s %12s %8s\n", "METRIC (rates per second)",
+		"BASELINE", "NOW", "DELTA", "CHANGE");
+	fprintf(stdout, "%s", regular_color);
+
+	for (m = 0; m < GTOP_METRIC_NR; m++) {
+		if (!gtop_baseline_compare(baseline, baseline_now, m, &delta))
+			continue;
+		if (delta.base == 0.0 && delta.now == 0.0)
+			continue;
+		if (!gtop_snapshot_metric_name(&snapshot_names, m, name, sizeof(name)))
+			continue;
+
+		fprintf(stdout, "%s %-48s %12.6g %12.6g %+12.6g", delta.significant ?
+			bold_color : "", name, delta.base, delta.now, delta.delta);
+		if (isnan(delta.change))
+			fprintf(stdout, " %8s", "-");
+		else
+			fprintf(stdout, " %+7.1f%%", delta.change);
+		fprintf(stdout, "%s\n", delta.significant ? regular_color : "");
+	}
+}
+
 static void
 gtop_display_interactive(struct perf_device *dev, const struct gtop gtop)
 {
@@ -1097,6 +1964,18 @@ gtop_display_interactive(struct perf_device *dev, const struct gtop gtop)
 			gtop_display_perf_pmus();
 			break;
 #endif
+		case MODE_PERF_MARKERS:
+			gtop_display_markers();
+			break;
+		case MODE_PERF_PHASES:
+			gtop_display_phases();
+			break;
+		case MODE_PERF_CORRELATION:
+			gtop_display_correlation();
+			break;
+		case MODE_PERF_BASELINE:
+			gtop_display_baseline();
+			break;
 		default:
 			dprintf("No valid page specified in interactive mode\n");
 			exit(EXIT_FAILURE);
@@ -1127,6 +2006,18 @@ gtop_display_interactive(struct perf_device *dev, const struct gtop gtop)
 			gtop_display_perf_pmus();
 			break;
 #endif
+		case PAGE_MARKERS:
+			gtop_display_markers();
+			break;
+		case PAGE_PHASES:
+			gtop_display_phases();
+			break;
+		case PAGE_CORRELATION:
+			gtop_display_correlation();
+			break;
+		case PAGE_BASELINE:
+			gtop_display_baseline();
+			break;
 		default:
 			dprintf("No valid mode specified in interactive mode\n");
 			exit(EXIT_FAILURE);
@@ -1138,6 +2029,38 @@ gtop_display_interactive(struct perf_device *dev, const struct gtop gtop)
 
 }
 
+/*
+ * pin what 'b' asked for, and keep the latest values for the deltas
+ */
+static void
+gtop_baseline_snapshot(const struct gtop_snapshot *snap)
+{
+	if (baseline_pending[0]) {
+		if (gtop_baselines_pin(&baselines, baseline_pending, snap) < 0)
+			baseline_full = true;
+		baseline_pending[0] = '\0';
+	}
+
+	if (baselines.nr)
+		gtop_baseline_values(snap, baseline_now);
+}
+
+/*
+ * below the page, once the interval it covers has been collected
+ */
+static void
+gtop_display_verdict(const struct gtop_snapshot *snap)
+{
+	struct gtop_classification result;
+
+	gtop_classify(&classifier, snap, &result);
+
+	fprintf(stdout, " Bottleneck: ");
+	gtop_classification_print(stdout, &result);
+	fprintf(stdout, "\n");
+	fflush(stdout);
+}
+
 static struct gtop_data *
 gtop_data_create(enum vivante_profiler_type_counter type,
 		 uint32_t num_perf_counters,
@@ -1175,6 +2098,12 @@ gtop_data_create(enum vivante_profiler_type_counter type,
 		exit(EXIT_FAILURE);
 	}
 
+	gtop->events_per_interval = calloc(total_num_perf_counters, sizeof(uint64_t));
+	if (!gtop->events_per_interval) {
+		dprintf("malloc?\n");
+		exit(EXIT_FAILURE);
+	}
+
 	gtop->events_per_sample_max = calloc(total_num_perf_counters, sizeof(uint64_t));
 	if (!gtop->events_per_sample_max) {
 		dprintf("malloc?\n");
@@ -1216,6 +2145,9 @@ gtop_data_destroy(struct gtop_data *gtop)
 		if (gtop->events_per_sample)
 			free(gtop->events_per_sample);
 
+		if (gtop->events_per_interval)
+			free(gtop->events_per_interval);
+
 		if (gtop->events_per_sample_max)
 			free(gtop->events_per_sample_max);
 
@@ -1377,6 +2309,7 @@ gtop_scale_counters_by(struct gtop_data *gtop, uint64_t diff)
 	/* scale counters by elapsed time */
 	for (c = 0; c < gtop->num_perf_counters; c++) {
 
+		gtop->events_per_interval[c] = gtop->events_per_sample[c];
 		gtop->events_per_sample[c] =
 			(gtop->events_per_sample[c] * USEC_PER_SEC * 10) / diff;
 
@@ -1410,6 +2343,16 @@ gtop_disable_profiling(struct perf_device *dev)
 	return perf_profiler_disable(dev);
 }
 
+/*
+ * exit status for failures: a CI gating a run has to tell a broken device
+ * from a regression, see gate.h
+ */
+static int
+gtop_failure(void)
+{
+	return FLAG_IS_SET(flags, FLAG_GATE) ? GTOP_GATE_ERROR : EXIT_FAILURE;
+}
+
 static int
 gtop_compute_perf(struct perf_device *dev, struct gtop_data *gtop_d)
 {
@@ -1434,7 +2377,7 @@ gtop_compute_perf(struct perf_device *dev, struct gtop_data *gtop_d)
 	err = perf_read_counters_3d(gtop_d->type, gtop_d->counter_data, dev);
 	if (err < 0) {
 		dprintf("reading counters failed!\n");
-		exit(EXIT_FAILURE);
+		exit(gtop_failure());
 	}
 
 	for (c = 0; c < gtop_d->num_perf_counters; c++) {
@@ -1492,13 +2435,19 @@ gtop_check_ctx_is_valid(uint32_t c)
 	struct debugfs_client *curr_client;
 	int nr_clients = 0;
 	bool ctx_found = false;
+	const struct debugfs_db_process *proc;
+	uint32_t pid;
 
-	nr_clients = debugfs_get_current_clients(&clients, NULL);
+	nr_clients = debugfs_get_current_clients(&clients, NULL, &refresh_arena);
 
 	/* if no clients are attached bail out */
 	if (!nr_clients)
 		return ctx_found;
 
+	/* one pass over the database, then it's only a look-up */
+	if (debugfs_get_database(&ctx_db, NULL) < 0 ||
+	    !debugfs_database_find_ctx(&ctx_db, c, &pid))
+		goto out;
 
 	list_for_each(curr_client, clients.head) {
 
@@ -1506,54 +2455,52 @@ gtop_check_ctx_is_valid(uint32_t c)
 		if (!strncmp(curr_client->name, prg_name, strlen(prg_name)))
 			continue;
 
-		/* get contexts for this client */
-		debugfs_get_current_ctx(curr_client, NULL);
+		if (curr_client->pid != pid)
+			continue;
 
-		for (size_t ctx = 0; ctx < curr_client->ctx_no; ctx++) {
+		/* the database entry should be the same program */
+		proc = debugfs_database_find_pid(&ctx_db, pid);
+		if (strncmp(curr_client->name, proc->name, strlen(proc->name)))
+			continue;
 
-			if (curr_client->ctx[ctx] == c) {
-				size_t name_len;
+		size_t name_len;
 
-				ctx_found = true;
+		ctx_found = true;
 
-				name_len = strlen(curr_client->name);
+		name_len = strlen(curr_client->name);
 
 try_again:
-				/*
-				 * if this is the first time, or we're modifying it
-				 * allocate some space for it
-				 */
-				if (selected_client == NULL) {
-
-					selected_client = malloc(sizeof(*selected_client));
-					memset(selected_client, 0, sizeof(*selected_client));
+		/*
+		 * if this is the first time, or we're modifying it
+		 * allocate some space for it
+		 */
+		if (selected_client == NULL) {
 
-					selected_client->name = malloc(name_len + 1);
-					memset(selected_client->name, 0, name_len + 1);
+			selected_client = malloc(sizeof(*selected_client));
+			memset(selected_client, 0, sizeof(*selected_client));
 
-				} else {
+			selected_client->name = malloc(name_len + 1);
+			memset(selected_client->name, 0, name_len + 1);
 
-					/* if it is not NULL, free it first and try again */
-					if (selected_client->name)
-						free(selected_client->name);
+		} else {
 
-					memset(selected_client, 0, sizeof(*selected_client));
-					free(selected_client);
-					selected_client = NULL;
-					goto try_again;
-				}
+			/* if it is not NULL, free it first and try again */
+			if (selected_client->name)
+				free(selected_client->name);
 
-				/* copy the info over */
-				selected_client->pid = curr_client->pid;
-				memcpy(selected_client->name, curr_client->name, name_len);
-			}
+			memset(selected_client, 0, sizeof(*selected_client));
+			free(selected_client);
+			selected_client = NULL;
+			goto try_again;
 		}
 
+		/* copy the info over */
+		selected_client->pid = curr_client->pid;
+		memcpy(selected_client->name, curr_client->name, name_len);
+		break;
 	}
 
-	/* free all resources */
-	debugfs_free_clients(&clients);
-
+out:
 	return ctx_found;
 }
 
@@ -1591,6 +2538,36 @@ out:
 	return c_ctx;
 }
 
+/*
+ * name the baseline to pin, the next snapshot is what gets pinned
+ */
+static void
+gtop_get_baseline_from_keyboard(void)
+{
+	char name[GTOP_BASELINE_NAME_LEN];
+	ssize_t n;
+
+	/* restore back tty so we can get a line */
+	tty_reset(&tty_old);
+
+	fprintf(stdout, "# Baseline name (empty for base%u): ", baselines.nr);
+	fflush(stdout);
+	n = read(STDIN_FILENO, name, sizeof(name) - 1);
+	if (n < 0)
+		n = 0;
+	while (n > 0 && isspace((unsigned char) name[n - 1]))
+		n--;
+	name[n] = '\0';
+
+	if (name[0])
+		snprintf(baseline_pending, sizeof(baseline_pending), "%s", name);
+	else
+		snprintf(baseline_pending, sizeof(baseline_pending), "base%u", baselines.nr);
+
+	/* go back into canonical mode */
+	tty_init(&tty_old);
+}
+
 static void
 gtop_get_no_samples_from_keyboard(void)
 {
@@ -1607,94 +2584,234 @@ gtop_get_no_samples_from_keyboard(void)
 	tty_init(&tty_old);
 }
 
+/*
+ * what gtop_compute() samples, as a mask of enum gtop_snapshot_valid: the
+ * page being displayed and, when publishing, everything else we can
+ */
+static uint32_t
+gtop_compute_mask(void)
+{
+	uint32_t mask = 0;
+	unsigned int view;
+
+	/* modes and pages are in the same order */
+	if (FLAG_IS_SET(flags, FLAG_MODE))
+		view = mode;
+	else
+		view = curr_page;
+
+	switch (view) {
+	case PAGE_COUNTER_PART1:
+		mask |= GTOP_SNAPSHOT_COUNTERS_PART1;
+		break;
+	case PAGE_COUNTER_PART2:
+		mask |= GTOP_SNAPSHOT_COUNTERS_PART2;
+		break;
+	case PAGE_DMA:
+		mask |= GTOP_SNAPSHOT_DMA;
+		break;
+	case PAGE_OCCUPANCY:
+		mask |= GTOP_SNAPSHOT_OCCUPANCY;
+		break;
+	case PAGE_VID_MEM_USAGE:
+	case PAGE_SHOW_CLIENTS:
+#if defined HAVE_DDR_PERF && (defined __linux__ || defined __ANDROID__ || defined ANDROID)
+	case PAGE_DDR_PERF:
+#endif
+	case PAGE_MARKERS:
+	case PAGE_PHASES:
+	case PAGE_CORRELATION:
+	case PAGE_BASELINE:
+		break;
+	default:
+		dprintf("Invalid page view specified!\n");
+		exit(EXIT_FAILURE);
+	}
+
+	if (gtop_publishing()) {
+		mask |= GTOP_SNAPSHOT_OCCUPANCY | GTOP_SNAPSHOT_DMA;
+
+		/* counters are only meaningful once we track a context */
+		if (selected_ctx)
+			mask |= GTOP_SNAPSHOT_COUNTERS_PART1 |
+				GTOP_SNAPSHOT_COUNTERS_PART2;
+	}
+
+	return mask;
+}
+
+/* counters as of the previous sample, to hand out deltas to markers and alerts */
+static uint64_t sample_last[2][GTOP_SNAPSHOT_MAX_COUNTERS];
+static uint64_t sample_delta[2][GTOP_SNAPSHOT_MAX_COUNTERS];
+static uint64_t sample_time;
+/* what alerts get from every sample */
+static float sample_values[GTOP_METRIC_NR];
+
+static uint32_t
+gtop_sample_nr_counters(const struct gtop *gtop, int p)
+{
+	static const uint32_t valid[2] = {
+		GTOP_SNAPSHOT_COUNTERS_PART1, GTOP_SNAPSHOT_COUNTERS_PART2
+	};
+	const struct gtop_data *d = gtop->perf_data[VIV_PROF_COUNTER_PART1 + p];
+
+	if (!(gtop_compute_mask() & valid[p]) || !d)
+		return 0;
+
+	return d->num_perf_counters < GTOP_SNAPSHOT_MAX_COUNTERS ?
+		d->num_perf_counters : GTOP_SNAPSHOT_MAX_COUNTERS;
+}
+
+static void
+gtop_sample_init(const struct gtop *gtop)
+{
+	uint32_t c;
+	int p;
+
+	for (p = 0; p < 2; p++)
+		for (c = 0; c < gtop_sample_nr_counters(gtop, p); c++)
+			sample_last[p][c] =
+				gtop->perf_data[VIV_PROF_COUNTER_PART1 + p]->events_per_sample[c];
+
+	sample_time = get_ns_time();
+}
+
+/*
+ * hand what the last sample saw to the ranges open right now, and to
+ * the alerts: core busy (0 or 100%) and counter rates
+ */
+static void
+gtop_sample_take(const struct gtop *gtop)
+{
+	struct gtop_markers_sample sample = {
+		.timestamp = get_ns_time(),
+		/* idle cycles were reset just before being read */
+		.busy = (gtop->sampled & GTOP_SNAPSHOT_OCCUPANCY) &&
+			!gtop->st.idle_cycles_core0,
+	};
+	uint64_t elapsed = sample.timestamp - sample_time;
+	uint32_t c, m;
+	int p;
+
+	sample_time = sample.timestamp;
+
+	for (m = 0; alerts && m < GTOP_METRIC_NR; m++)
+		sample_values[m] = NAN;
+
+	for (p = 0; p < 2; p++) {
+		const uint64_t *events;
+
+		sample.nr_counters[p] = gtop_sample_nr_counters(gtop, p);
+		sample.counters[p] = sample_delta[p];
+		if (!sample.nr_counters[p])
+			continue;
+
+		events = gtop->perf_data[VIV_PROF_COUNTER_PART1 + p]->events_per_sample;
+		for (c = 0; c < sample.nr_counters[p]; c++) {
+			sample_delta[p][c] = events[c] - sample_last[p][c];
+			sample_last[p][c] = events[c];
+
+			/* events/s, as gtop_snapshot_metrics() has them */
+			if (alerts && elapsed)
+				sample_values[GTOP_METRIC_COUNTERS(p) + c] =
+					(double) sample_delta[p][c] * NSEC_PER_SEC / elapsed;
+		}
+	}
+
+	if (markers)
+		gtop_markers_sample(markers, &sample);
+
+	if (alerts) {
+		if (gtop->sampled & GTOP_SNAPSHOT_OCCUPANCY) {
+			sample_values[GTOP_METRIC_CORES] = sample.busy ? 100.0f : 0.0f;
+			if (gtop_info.cores[0] > 1)
+				sample_values[GTOP_METRIC_CORES + 1] =
+					gtop->st.idle_cycles_core1 ? 0.0f : 100.0f;
+		}
+		gtop_alerts_update(alerts, sample_values, sample.timestamp);
+	}
+}
+
+/*
+ * the rest, once per interval
+ */
+static void
+gtop_alerts_snapshot(const struct gtop_snapshot *snap)
+{
+	float *values = sample_values;
+	uint32_t m;
+
+	gtop_snapshot_metrics(snap, values);
+
+	/* already seen on every sample */
+	for (m = GTOP_METRIC_CORES; m < GTOP_METRIC_MODULES; m++)
+		values[m] = NAN;
+	for (m = GTOP_METRIC_COUNTERS(0); m < GTOP_METRIC_SCALARS; m++)
+		values[m] = NAN;
+
+	gtop_alerts_update(alerts, values, snap->timestamp);
+	gtop_alerts_clients(alerts, record_clients, record_clients_nr, snap->timestamp);
+}
+
 static int
 gtop_compute(struct perf_device *dev, struct gtop *gtop)
 {
 	int s;
 	struct timespec interval = {};
 	int err = 0;
+	uint32_t mask;
 
 	interval.tv_sec = 0;
 	interval.tv_nsec = (USEC_PER_SEC / samples);
 
+	gtop->sampled = 0;
 
 	/* bail early in case we just display clients */
 	if (mode == MODE_PERF_SHOW_CLIENTS &&
-	    curr_page == MODE_PERF_SHOW_CLIENTS)
+	    curr_page == MODE_PERF_SHOW_CLIENTS && !gtop_publishing())
 		return 0;
 
+	mask = gtop_compute_mask();
+
 	/* clear every time gpu state so we get % values correctly */
 	memset(&gtop->st, 0, sizeof(struct vivante_gpu_state));
 
 	if (FLAG_IS_SET(flags, FLAG_SHOW_BATCH_CONTEXTS))
 		samples = 1;
 
+	if (markers || alerts)
+		gtop_sample_init(gtop);
+
 	/* in batch mode we just run it once */
 	for (s = 0; s < samples; s++) {
 
-		if (FLAG_IS_SET(flags, FLAG_MODE)) {
-			switch (mode) {
-			case MODE_PERF_COUNTER_PART1:
-				err = gtop_compute_perf(dev, gtop->perf_data[VIV_PROF_COUNTER_PART1]);
-				break;
-			case MODE_PERF_COUNTER_PART2:
-				err = gtop_compute_perf(dev, gtop->perf_data[VIV_PROF_COUNTER_PART2]);
-				break;
-			case MODE_PERF_DMA:
-				err = gtop_compute_mode_dma(dev, &gtop->st);
-				break;
-			case MODE_PERF_OCCUPANCY:
-				err = gtop_compute_mode_occupancy(dev, &gtop->st);
-				break;
-			case MODE_PERF_VID_MEM_USAGE:
-			case MODE_PERF_SHOW_CLIENTS:
-#if defined HAVE_DDR_PERF && (defined __linux__  || defined __ANDROID__ || defined ANDROID)
-			case MODE_PERF_DDR:
-				break;
-#else
-				break;
-#endif
+		if (mask & GTOP_SNAPSHOT_COUNTERS_PART1)
+			err = gtop_compute_perf(dev, gtop->perf_data[VIV_PROF_COUNTER_PART1]);
 
-			default:
-				dprintf("Invalid mode specified\n");
-				exit(EXIT_FAILURE);
-			}
-		} else {
-			switch (curr_page) {
-			case PAGE_COUNTER_PART1:
-				err = gtop_compute_perf(dev, gtop->perf_data[VIV_PROF_COUNTER_PART1]);
-				break;
-			case PAGE_COUNTER_PART2:
-				err = gtop_compute_perf(dev, gtop->perf_data[VIV_PROF_COUNTER_PART2]);
-				break;
-			case PAGE_DMA:
-				err = gtop_compute_mode_dma(dev, &gtop->st);
-				break;
-			case PAGE_OCCUPANCY:
-				err = gtop_compute_mode_occupancy(dev, &gtop->st);
-				break;
-			case MODE_PERF_VID_MEM_USAGE:
-			case MODE_PERF_SHOW_CLIENTS:
-#if defined HAVE_DDR_PERF && (defined __linux__ || defined __ANDROID__ || defined ANDROID)
-			case MODE_PERF_DDR:
-				break;
-#else
-				break;
-#endif
-			default:
-				dprintf("Invalid page view specified!\n");
-				exit(EXIT_FAILURE);
-			}
-		}
+		if (!err && (mask & GTOP_SNAPSHOT_COUNTERS_PART2))
+			err = gtop_compute_perf(dev, gtop->perf_data[VIV_PROF_COUNTER_PART2]);
+
+		if (!err && (mask & GTOP_SNAPSHOT_DMA))
+			err = gtop_compute_mode_dma(dev, &gtop->st);
+
+		if (!err && (mask & GTOP_SNAPSHOT_OCCUPANCY))
+			err = gtop_compute_mode_occupancy(dev, &gtop->st);
 
 		if (err < 0) {
 			return err;
 		}
 
+		gtop->sampled = mask;
+
+		if (markers || alerts)
+			gtop_sample_take(gtop);
+
 		if (FLAG_IS_SET(flags, FLAG_SHOW_BATCH_CONTEXTS))
 			return 0;
 
+		pthread_mutex_unlock(&dev_lock);
 		nanosleep(&interval, NULL);
+		pthread_mutex_lock(&dev_lock);
 	}
 	
 	return 0;
@@ -1703,17 +2820,10 @@ gtop_compute(struct perf_device *dev, struct gtop *gtop)
 static void
 gtop_scale_counters(struct gtop *gtop, uint64_t diff)
 {
-	if (FLAG_IS_SET(flags, FLAG_MODE)) {
-		if (mode == MODE_PERF_COUNTER_PART1)
-			gtop_scale_counters_by(gtop->perf_data[VIV_PROF_COUNTER_PART1], diff);
-		if (mode == MODE_PERF_COUNTER_PART2)
-			gtop_scale_counters_by(gtop->perf_data[VIV_PROF_COUNTER_PART2], diff);
-	} else {
-		if (curr_page == PAGE_COUNTER_PART1)
-			gtop_scale_counters_by(gtop->perf_data[VIV_PROF_COUNTER_PART1], diff);
-		if (curr_page == PAGE_COUNTER_PART2)
-			gtop_scale_counters_by(gtop->perf_data[VIV_PROF_COUNTER_PART2], diff);
-	}
+	if (gtop->sampled & GTOP_SNAPSHOT_COUNTERS_PART1)
+		gtop_scale_counters_by(gtop->perf_data[VIV_PROF_COUNTER_PART1], diff);
+	if (gtop->sampled & GTOP_SNAPSHOT_COUNTERS_PART2)
+		gtop_scale_counters_by(gtop->perf_data[VIV_PROF_COUNTER_PART2], diff);
 }
 
 
@@ -1729,6 +2839,8 @@ gtop_display_interactive_help(void)
 #else
 	fprintf(stdout, " Arrows (<-|->) to navigate between pages         | Use 0-5 to switch directly\n");
 #endif
+	fprintf(stdout, " Use 7 for application markers, 8 for phases, 9 for DDR correlation\n");
+	fprintf(stdout, " Use b to pin a baseline, n to switch baselines, d for the deltas\n");
 	fprintf(stdout, " Use SPACE to specify a context (for PART1|PART2) | Use p to pause display\n");
 	fprintf(stdout, " Use x to show application's GPU id contexts      | Use q<ESC> to quit\n");
 	fprintf(stdout, " Use r to change between TIME/MIN/AVERAGE/MAX values of counters\n");
@@ -1923,6 +3035,24 @@ gtop_check_keyboard(struct perf_device *dev)
 		curr_page = PAGE_DDR_PERF;
 		break;
 #endif
+	case KEY_7:
+		curr_page = PAGE_MARKERS;
+		break;
+	case KEY_8:
+		curr_page = PAGE_PHASES;
+		break;
+	case KEY_9:
+		curr_page = PAGE_CORRELATION;
+		break;
+	case KEY_B:
+		gtop_get_baseline_from_keyboard();
+		break;
+	case KEY_N:
+		gtop_baselines_next(&baselines);
+		break;
+	case KEY_D:
+		curr_page = PAGE_BASELINE;
+		break;
 	case KEY_X:
 		if (FLAG_IS_SET(flags, FLAG_SHOW_CONTEXTS))
 			REMOVE_FLAG(flags, FLAG_SHOW_CONTEXTS);
@@ -1948,7 +3078,8 @@ gtop_check_keyboard(struct perf_device *dev)
 
 	/* disable profiler when not in counter page */
 	if ((curr_page == PAGE_SHOW_CLIENTS ||
-	     curr_page == PAGE_VID_MEM_USAGE) && profiler_state.enabled) {
+	     curr_page == PAGE_VID_MEM_USAGE) && profiler_state.enabled &&
+	    !gtop_publishing()) {
 		gtop_disable_profiling(dev);
 		perf_profiler_stop(dev);
 		profiler_state.enabled = false;
@@ -1957,7 +3088,8 @@ gtop_check_keyboard(struct perf_device *dev)
 #if defined HAVE_DDR_PERF && (defined __linux__ || defined __ANDROID__ || defined ANDROID)
 	/* disable reading DDR perf PMUs */
 	if ((curr_page != PAGE_SHOW_CLIENTS ||
-	     curr_page != PAGE_DDR_PERF) && perf_ddr_enabled) {
+	     curr_page != PAGE_DDR_PERF) && perf_ddr_enabled &&
+	    !gtop_publishing()) {
 		gtop_disable_pmus();
 		perf_ddr_enabled = 0;
 	}
@@ -1966,6 +3098,232 @@ gtop_check_keyboard(struct perf_device *dev)
 }
 
 
+static void
+gtop_snapshot_copy_name(char *dst, const char *src)
+{
+	size_t len;
+
+	snprintf(dst, GTOP_SNAPSHOT_NAME_LEN, "%s", src);
+
+	/* module names are padded for display */
+	len = strlen(dst);
+	while (len && dst[len - 1] == ' ')
+		dst[--len] = '\0';
+}
+
+static void
+gtop_snapshot_names_init(struct perf_device *dev, struct gtop_snapshot_names *names)
+{
+	enum vivante_profiler_type_counter types[2] = {
+		VIV_PROF_COUNTER_PART1, VIV_PROF_COUNTER_PART2
+	};
+	size_t i, t, n = 0;
+
+	memset(names, 0, sizeof(*names));
+
+	for (i = 0; i < NUM_VIV_IDLE_MODULES && i < GTOP_SNAPSHOT_MAX_MODULES; i++)
+		gtop_snapshot_copy_name(names->modules[i],
+					vivante_idle_module_names[i].name);
+
+	for (t = 0; t < NUM_DMA_TABLES; t++) {
+		for (i = 0; i < (size_t) dma_tables[t].data_size; i++) {
+			if (n >= GTOP_SNAPSHOT_MAX_DMA_STATES)
+				break;
+			snprintf(names->dma_states[n++], GTOP_SNAPSHOT_NAME_LEN, "%s/%s",
+				 dma_tables[t].title, dma_tables[t].data_names[i]);
+		}
+	}
+
+#if defined HAVE_DDR_PERF && (defined __linux__ || defined __ANDROID__ || defined ANDROID)
+	unsigned int k, j;
+
+	gtop_set_perf_pmus_ddr();
+
+	n = 0;
+	for_all_pmus(perf_pmu_ddrs, k, j) {
+		if (n >= GTOP_SNAPSHOT_MAX_DDR)
+			break;
+		snprintf(names->ddr[n++], GTOP_SNAPSHOT_NAME_LEN, "%s/%s",
+			 PMU_GET_TYPE_NAME(perf_pmu_ddrs, k),
+			 PMU_GET_EVENT_NAME(perf_pmu_ddrs, k, j));
+	}
+#endif
+
+	for (t = 0; t < 2; t++) {
+		uint32_t c, nr = perf_get_num_counters(types[t], dev);
+
+		for (c = 0; c < nr && c < GTOP_SNAPSHOT_MAX_COUNTERS; c++) {
+			struct perf_counter_info *info =
+				perf_get_counter_info(types[t], c, dev);
+			if (info)
+				gtop_snapshot_copy_name(names->counters[t][c], info->desc);
+		}
+	}
+}
+
+/*
+ * fill the snapshot from what has been sampled/displayed in this interval,
+ * which ended at timestamp
+ */
+static void
+gtop_snapshot_collect(struct perf_device *dev, const struct gtop *gtop,
+		      uint64_t timestamp, uint64_t diff, struct gtop_snapshot *snap)
+{
+	struct gtop_clocks_governor governor = {};
+	size_t i, t, n;
+
+	memset(snap, 0, sizeof(*snap));
+
+	snap->timestamp = timestamp;
+	snap->interval = diff;
+	snap->samples = samples;
+	snap->valid = gtop->sampled;
+
+	if (snap->valid & GTOP_SNAPSHOT_OCCUPANCY) {
+		const struct vivante_gpu_state *st = &gtop->st;
+
+		for (i = 0; i < NUM_VIV_IDLE_MODULES && i < GTOP_SNAPSHOT_MAX_MODULES; i++) {
+			double percent = 100.0f * (double) st->viv_idle_states[i] /
+				(double) samples;
+
+			if (vivante_idle_module_names[i].inv)
+				percent = 100.0f - percent;
+
+			snap->module_busy[i] = percent;
+		}
+		snap->nr_modules = i;
+
+		snap->nr_cores = 1;
+		snap->core_busy[0] = 100.0f - 100.0f *
+			(double) st->total_idle_cycles_core0 / (double) samples;
+
+		if (gtop_info.cores[0] > 1) {
+			snap->nr_cores = 2;
+			snap->core_busy[1] = 100.0f - 100.0f *
+				(double) st->total_idle_cycles_core1 / (double) samples;
+		}
+	}
+
+	if (snap->valid & GTOP_SNAPSHOT_DMA) {
+		n = 0;
+		for (t = 0; t < NUM_DMA_TABLES; t++) {
+			struct dma_table *table = &dma_tables[t];
+
+			attach_gpu_state_to_dma_table(table, (struct vivante_gpu_state *) &gtop->st);
+			for (i = 0; i < (size_t) table->data_size; i++) {
+				if (n >= GTOP_SNAPSHOT_MAX_DMA_STATES)
+					break;
+				snap->dma_states[n++] = 100.0f *
+					((double) table->data[i] / (double) samples);
+			}
+		}
+		snap->nr_dma_states = n;
+	}
+
+	for (t = 0; t < 2; t++) {
+		const struct gtop_data *d = gtop->perf_data[t == 0 ?
+			VIV_PROF_COUNTER_PART1 : VIV_PROF_COUNTER_PART2];
+		uint32_t valid = t == 0 ? GTOP_SNAPSHOT_COUNTERS_PART1 :
+			GTOP_SNAPSHOT_COUNTERS_PART2;
+
+		if (!(snap->valid & valid))
+			continue;
+
+		for (i = 0; i < d->num_perf_counters && i < GTOP_SNAPSHOT_MAX_COUNTERS; i++)
+			snap->counters[t][i] = d->events_per_interval[i];
+		snap->nr_counters[t] = i;
+		snap->valid |= GTOP_SNAPSHOT_COUNTER_EVENTS;
+	}
+
+#if defined HAVE_DDR_PERF && (defined __linux__ || defined __ANDROID__ || defined ANDROID)
+	if (perf_ddr_enabled) {
+		unsigned int k, j;
+
+		n = 0;
+		for_all_pmus(perf_pmu_ddrs, k, j) {
+			if (n >= GTOP_SNAPSHOT_MAX_DDR)
+				break;
+			snap->ddr_mb[n++] = gtop_pmu_ddr_mb(k, j);
+		}
+		snap->nr_ddr = n;
+		snap->valid |= GTOP_SNAPSHOT_DDR;
+	}
+#endif
+
+	gtop_get_clocks_governor(&governor);
+	if (governor.governor.governor) {
+		snap->governor = governor.governor.governor;
+		snap->gpu_core_freq = governor.governor.gpu_core_freq;
+		snap->shader_core_freq = governor.governor.shader_core_freq;
+		snap->valid |= GTOP_SNAPSHOT_GOVERNOR;
+	}
+	snap->gpu_clock[0] = governor.clock.gpu_core_0;
+	snap->gpu_clock[1] = governor.clock.gpu_core_1;
+	snap->shader_clock[0] = governor.clock.shader_core_0;
+	snap->shader_clock[1] = governor.clock.shader_core_1;
+
+	/* re-use what the clients page gathered, if it has been displayed */
+	if (!clients_total_fresh)
+		clients_total_nr = gtop_get_clients_total(dev, &clients_total);
+	clients_total_fresh = false;
+
+	snap->nr_clients = clients_total_nr;
+	snap->mem_reserved = clients_total.reserved;
+	snap->mem_contiguous = clients_total.contigous;
+	snap->mem_virtual = clients_total._virtual;
+	snap->mem_non_paged = clients_total.non_paged;
+	snap->mem_total = clients_total.total;
+	snap->valid |= GTOP_SNAPSHOT_CLIENTS;
+}
+
+/*
+ * append the ranges completed since the last interval to the recording
+ */
+static void
+gtop_record_ranges(void)
+{
+	static struct gtop_record_range ranges[16];
+	uint32_t i, n;
+
+	while ((n = gtop_markers_take(markers, ranges, ARRAY_SIZE(ranges)))) {
+		for (i = 0; i < n; i++)
+			gtop_record_write(record, GTOP_RECORD_RANGE, ranges[i].end,
+					  &ranges[i], gtop_record_range_size(&ranges[i]));
+	}
+}
+
+/*
+ * nobody looks at the screen
+ */
+static bool
+gtop_headless(void)
+{
+	return daemon_srv != NULL || FLAG_IS_SET(flags, FLAG_GATE);
+}
+
+/*
+ * sampled for long enough, or the application said so
+ */
+static bool
+gtop_gate_done(uint64_t start)
+{
+	uint32_t i;
+	uint64_t count;
+	const char *name;
+
+	if (gate_duration && get_ns_time() - start >= gate_duration)
+		return true;
+
+	if (!gate_until || !markers)
+		return false;
+
+	for (i = 0; (name = gtop_markers_range(markers, i, &count)); i++)
+		if (!strcmp(name, gate_until))
+			return count > 0;
+
+	return false;
+}
+
 /*
  * retrieve PART1 and PART2
  */
@@ -1973,11 +3331,14 @@ static void
 gtop_retrieve_perf_counters(struct perf_device *dev, bool batch)
 {
 	struct gtop gtop = {};
+	struct gtop_snapshot snap;
 
 	uint32_t num_perf_counters_part1;
 	uint32_t num_perf_counters_part2;
 
-	uint64_t begin_time, end_time, diff;
+	uint64_t last_collect = 0, collect_time = 0, diff = 0, start_time;
+	uint64_t published = 0;
+	bool collected = false;
 
 	num_perf_counters_part1 = perf_get_num_counters(VIV_PROF_COUNTER_PART1, dev);
 	num_perf_counters_part2 = perf_get_num_counters(VIV_PROF_COUNTER_PART2, dev);
@@ -1990,13 +3351,17 @@ gtop_retrieve_perf_counters(struct perf_device *dev, bool batch)
 		gtop_data_create(VIV_PROF_COUNTER_PART2, num_perf_counters_part2, 0);
 
 
-	fprintf(stdout, "%s", clear_screen);
+	if (!gtop_headless())
+		fprintf(stdout, "%s", clear_screen);
 
-	begin_time = get_ns_time();
+	start_time = get_ns_time();
 	while (1) {
 		if (sig_recv)
 			goto out;
 
+		/* what the last refresh read from debugfs is gone */
+		gtop_arena_reset(&refresh_arena);
+
 		if (paused) {
 			goto show_hw_counters;
 		}
@@ -2008,31 +3373,84 @@ gtop_retrieve_perf_counters(struct perf_device *dev, bool batch)
 		/* retrieve the counters, or read registers */
 		gtop_compute(dev, &gtop);
 
-show_hw_counters:
-		end_time = get_ns_time();
-		diff = end_time - begin_time;
+#if defined HAVE_DDR_PERF && (defined __linux__ || defined __ANDROID__ || defined ANDROID)
+		if (gtop_publishing())
+			gtop_start_pmus();
+		if (perf_ddr_enabled)
+			gtop_read_pmus();
+#endif
 
-		if (!paused) {
-			gtop_scale_counters(&gtop, diff);
-		}
+		/*
+		 * counters and DDR totals go back to the previous collect, and
+		 * so does the interval; the first one has nothing to go back to
+		 * and is only shown, against the time it took
+		 */
+		collect_time = get_ns_time();
+		collected = gtop_snapshot_interval(&last_collect, collect_time, &diff);
+		if (!collected)
+			diff = collect_time - start_time;
+
+		gtop_scale_counters(&gtop, diff);
+
+show_hw_counters:
 
 		/* figure out if we got anything from keyboard, or if we're
 		 * running batched */
-		if (batch) {
+		if (daemon_srv) {
+			pthread_mutex_unlock(&dev_lock);
+			gtop_daemon_poll(daemon_srv, DELAY_SECS * MSEC_PER_SEC +
+					 DELAY_NSECS / (NSEC_PER_SEC / MSEC_PER_SEC));
+			pthread_mutex_lock(&dev_lock);
+		} else if (batch) {
 			delay();
 		} else {
 			if (gtop_check_keyboard(dev) < 0)
 				goto out;
 		}
 
+		if (!gtop_headless())
+			gtop_display_interactive(dev, gtop);
+
+		if (gtop_publishing() && !paused && collected) {
+			gtop_snapshot_collect(dev, &gtop, collect_time, diff, &snap);
+			published++;
+			if (shm)
+				gtop_shm_publish(shm, &snap);
+			if (daemon_srv)
+				gtop_daemon_publish(daemon_srv, &snap);
+			if (history)
+				gtop_history_add(history, &snap);
+			gtop_publish_client_events();
+			if (record) {
+				gtop_record_write(record, GTOP_RECORD_SNAPSHOT,
+						  snap.timestamp, &snap, sizeof(snap));
+				gtop_record_write(record, GTOP_RECORD_CLIENTS,
+						  snap.timestamp, record_clients,
+						  record_clients_nr * sizeof(record_clients[0]));
+				if (markers)
+					gtop_record_ranges();
+				gtop_record_flush(record);
+			}
+			if (ftrace)
+				gtop_ftrace_write(ftrace, &snap);
+			if (alerts)
+				gtop_alerts_snapshot(&snap);
+			if (phases)
+				gtop_phases_add(phases, &snap);
+			if (correlate)
+				gtop_correlate_add(correlate, &snap);
+			if (FLAG_IS_SET(flags, FLAG_CLASSIFY) && !gtop_headless())
+				gtop_display_verdict(&snap);
+			gtop_baseline_snapshot(&snap);
+		}
 
-		gtop_display_interactive(dev, gtop);
+		/* rise and drop rules need two snapshots to compare */
+		if (FLAG_IS_SET(flags, FLAG_GATE) && published >= 2 &&
+		    gtop_gate_done(start_time))
+			goto out;
 
 		if (FLAG_IS_SET(flags, FLAG_SHOW_BATCH_CONTEXTS))
 			goto out;
-
-		begin_time = end_time;
-
 	}
 
 out:
@@ -2058,13 +3476,47 @@ void help(void)
 #if defined HAVE_DDR_PERF && (defined __linux__ || defined __ANDROID__ || defined ANDROID)
 	dprintf("                ddr	    Show Kernel PMUs related to memory bandwidth\n");
 #endif
+	dprintf("                markers     Per-frame and per-range costs, see -a\n");
+	dprintf("                phases      Phases of the run and what each one costs, see -P\n");
+	dprintf("                correlation What moves with DDR bandwidth, see -L\n");
+	dprintf("                baseline    Deltas against a baseline pinned with 'b'\n");
 	dprintf("  -c <ctx>      Specify context to track\n");
 	dprintf("  -b            Show batch (instantaneous of requested mode)\n");
 	dprintf("  -f            Read counters in batch mode\n");
 	dprintf("  -x            Display contexts in memory viewing page\n");
+	dprintf("  -S <name>     Publish snapshots to shared-memory, e.g. %s\n", GTOP_SHM_DEFAULT_NAME);
+	dprintf("  -D <socket>   Run as daemon, serving snapshots on a unix socket\n");
+	dprintf("  -C <socket>   Subscribe to a daemon and print what it sends\n");
+	dprintf("  -F <streams>  Streams to subscribe to with -C, comma separated:\n");
+	dprintf("                occupancy,dma,counters,ddr,governor,clients\n");
+	dprintf("  -R <ms>       Minimum time between snapshots with -C\n");
+	dprintf("  -Q <secs>     With -C, print min/avg/max of every metric over the last secs\n");
+	dprintf("                of the daemon's history (see -H) and exit\n");
+	dprintf("  -H <size>     Keep a downsampled history within size bytes (K/M suffix, 0 for the full spans)\n");
+	dprintf("  -o <file>     Record every snapshot to file, see '%s report'\n", prg_name);
+	dprintf("  -t            Write GPU samples to the ftrace trace_marker\n");
+	dprintf("  -T <path>     Same as -t, with another trace_marker (or plain file)\n");
+	dprintf("  -K <metrics>  Additional metrics for -t, comma separated\n");
+	dprintf("  -a <path>     Receive frame/range markers from applications (FIFO or socket)\n");
+	dprintf("  -A <rules>    Check alert rules on every sample\n");
+	dprintf("  -P            Split the run into phases as it goes (page 8)\n");
+	dprintf("  -L            Correlate counters and module occupancy with DDR traffic (page 9)\n");
+	dprintf("  -V            Tell what the GPU is bound by, every interval\n");
+	dprintf("  -M <MB/s>     Peak bandwidth of a DDR controller for -V (default %.0f)\n",
+		GTOP_CLASSIFY_DEFAULT_PEAK);
+	dprintf("  -g <rules>    Sample, then check against -B, exit 1 if a rule fails\n");
+	dprintf("  -B <file>     Baseline recording for -g\n");
+	dprintf("  -d <secs>     Sample that long for -g\n");
+	dprintf("  -U <range>    Sample until the application completes range, for -g\n");
+	dprintf("  -j <threads>  Threads querying client memory (default %d, at most %d, 0 for none)\n",
+		GTOP_QUERY_THREADS, GTOP_WORKERS_MAX);
+	dprintf("  -N            Read the clients list every refresh, not on process events\n");
 	dprintf("  -i		Ignore errors when opening a connection with the driver\n");
 	dprintf("  -v            Show version\n");
 	dprintf("  -h            Show this help message\n");
+	dprintf("\n");
+	dprintf("  %s <command> [args], offline commands:\n", prg_name);
+	gtop_tools_help(stderr);
 
 	exit(EXIT_FAILURE);
 }
@@ -2078,12 +3530,80 @@ show_version(void)
 	exit(EXIT_SUCCESS);
 }
 
+static const struct {
+	const char *name;
+	uint32_t mask;
+} stream_names[] = {
+	{ "occupancy",	GTOP_SNAPSHOT_OCCUPANCY },
+	{ "dma",	GTOP_SNAPSHOT_DMA },
+	{ "counters",	GTOP_SNAPSHOT_COUNTERS_PART1 | GTOP_SNAPSHOT_COUNTERS_PART2 },
+	{ "ddr",	GTOP_SNAPSHOT_DDR },
+	{ "governor",	GTOP_SNAPSHOT_GOVERNOR },
+	{ "clients",	GTOP_SNAPSHOT_CLIENTS },
+};
+
+static uint32_t
+parse_streams(const char *str)
+{
+	uint32_t mask = 0;
+
+	while (*str) {
+		size_t len = strcspn(str, ",");
+		size_t i;
+
+		for (i = 0; i < ARRAY_SIZE(stream_names); i++) {
+			if (strlen(stream_names[i].name) == len &&
+			    !strncmp(str, stream_names[i].name, len))
+				break;
+		}
+
+		if (i == ARRAY_SIZE(stream_names)) {
+			dprintf("Unknown stream %.*s\n", (int) len, str);
+			help();
+		}
+
+		mask |= stream_names[i].mask;
+
+		str += len;
+		if (*str == ',')
+			str++;
+	}
+
+	return mask;
+}
+
+/*
+ * size in bytes, with an optional K or M suffix
+ */
+static size_t
+parse_size(const char *str)
+{
+	char *end;
+	unsigned long size;
+
+	size = strtoul(str, &end, 10);
+	if (*end == 'K' || *end == 'k') {
+		size *= 1024;
+		end++;
+	} else if (*end == 'M' || *end == 'm') {
+		size *= 1024 * 1024;
+		end++;
+	}
+
+	if (end == str || *end) {
+		dprintf("Invalid size %s\n", str);
+		help();
+	}
+
+	return size;
+}
+
 static void
 parse_args(int argc, char **argv)
 {
 	int c;
 
-	while ((c = getopt(argc, argv, "m:hc:xbvfi")) != -1) {
+	while ((c = getopt(argc, argv, "m:hc:xbvfiS:D:C:F:R:Q:H:o:tT:K:a:g:B:d:U:A:PLVM:j:N")) != -1) {
 		switch (c) {
 		case 'm':
 			SET_FLAG(flags, FLAG_MODE);
@@ -2104,6 +3624,14 @@ parse_args(int argc, char **argv)
 			} else if (!strncmp(optarg, "ddr", strlen("ddr"))) {
 				mode = MODE_PERF_DDR;
 #endif
+			} else if (!strncmp(optarg, "markers", strlen("markers"))) {
+				mode = MODE_PERF_MARKERS;
+			} else if (!strncmp(optarg, "phases", strlen("phases"))) {
+				mode = MODE_PERF_PHASES;
+			} else if (!strncmp(optarg, "correlation", strlen("correlation"))) {
+				mode = MODE_PERF_CORRELATION;
+			} else if (!strncmp(optarg, "baseline", strlen("baseline"))) {
+				mode = MODE_PERF_BASELINE;
 			} else {
 				dprintf("Unknown mode %s\n", optarg);
 				help();
@@ -2128,6 +3656,87 @@ parse_args(int argc, char **argv)
 		case 'i':
 			SET_FLAG(flags, FLAG_IGNORE_START_ERRORS);
 			break;
+		case 'S':
+			SET_FLAG(flags, FLAG_PUBLISH_SHM);
+			shm_name = optarg;
+			break;
+		case 'D':
+			SET_FLAG(flags, FLAG_DAEMON);
+			SET_FLAG(flags, FLAG_SHOW_BATCH_PERF);
+			socket_path = optarg;
+			break;
+		case 'C':
+			SET_FLAG(flags, FLAG_CONNECT);
+			socket_path = optarg;
+			break;
+		case 'F':
+			connect_streams = parse_streams(optarg);
+			break;
+		case 'R':
+			connect_interval = atoi(optarg);
+			break;
+		case 'Q':
+			if (gtop_record_parse_time(optarg, &connect_history) < 0)
+				exit(EXIT_FAILURE);
+			break;
+		case 'H':
+			SET_FLAG(flags, FLAG_HISTORY);
+			history_size = parse_size(optarg);
+			break;
+		case 'o':
+			SET_FLAG(flags, FLAG_RECORD);
+			record_path = optarg;
+			break;
+		case 't':
+			SET_FLAG(flags, FLAG_FTRACE);
+			break;
+		case 'T':
+			SET_FLAG(flags, FLAG_FTRACE);
+			ftrace_path = optarg;
+			break;
+		case 'K':
+			ftrace_metrics = optarg;
+			break;
+		case 'a':
+			SET_FLAG(flags, FLAG_MARKERS);
+			markers_path = optarg;
+			break;
+		case 'g':
+			SET_FLAG(flags, FLAG_GATE);
+			SET_FLAG(flags, FLAG_SHOW_BATCH_PERF);
+			gate_rules = optarg;
+			break;
+		case 'B':
+			gate_baseline = optarg;
+			break;
+		case 'd':
+			gate_duration = atof(optarg) * NSEC_PER_SEC;
+			break;
+		case 'U':
+			gate_until = optarg;
+			break;
+		case 'A':
+			SET_FLAG(flags, FLAG_ALERTS);
+			alerts_path = optarg;
+			break;
+		case 'P':
+			SET_FLAG(flags, FLAG_PHASES);
+			break;
+		case 'L':
+			SET_FLAG(flags, FLAG_CORRELATE);
+			break;
+		case 'V':
+			SET_FLAG(flags, FLAG_CLASSIFY);
+			break;
+		case 'M':
+			classify_ddr_peak = atof(optarg);
+			break;
+		case 'j':
+			query_threads = atoi(optarg);
+			break;
+		case 'N':
+			SET_FLAG(flags, FLAG_POLL_CLIENTS);
+			break;
 		case 'h':
 		default:
 			help();
@@ -2179,12 +3788,171 @@ install_sighandler(void)
 
 }
 
+/*
+ * what -Q asked for, a line per metric the daemon has something of
+ */
+static int
+gtop_connect_print_history(const void *buf, const struct gtop_snapshot_names *names)
+{
+	const struct gtop_daemon_history *answer = buf;
+	char name[GTOP_METRIC_NAME_LEN];
+	uint32_t m;
+
+	if (!answer->span) {
+		fprintf(stderr, "No history kept on %s, see -H\n", socket_path);
+		return EXIT_FAILURE;
+	}
+
+	for (m = 0; m < GTOP_METRIC_NR; m++) {
+		const struct gtop_rollup *r = &answer->rollups[m];
+
+		if (!r->count || !gtop_snapshot_metric_name(names, m, name, sizeof(name)))
+			continue;
+
+		fprintf(stdout, "%s min=%g avg=%g max=%g samples=%u\n", name, r->min,
+			gtop_rollup_mean(r), r->max, r->count);
+	}
+
+	return EXIT_SUCCESS;
+}
+
+/*
+ * front-end for a gputop running as daemon: prints each snapshot it sends
+ */
+static int
+gtop_connect(void)
+{
+	struct gtop_daemon_msg msg;
+	struct gtop_snapshot_names *names;
+	struct gtop_snapshot snap;
+	struct gtop_classification result;
+	uint64_t dropped = 0;
+	int ret = EXIT_SUCCESS;
+	void *buf;
+	int fd;
+
+	fd = gtop_daemon_connect(socket_path, connect_streams, connect_interval);
+	if (fd < 0)
+		return EXIT_FAILURE;
+
+	/* names are the biggest message we get */
+	names = calloc(1, sizeof(*names));
+	buf = malloc(sizeof(*names));
+	if (!names || !buf) {
+		free(buf);
+		free(names);
+		close(fd);
+		return EXIT_FAILURE;
+	}
+
+	gtop_classifier_init(&classifier, names, classify_ddr_peak);
+
+	if (connect_history && gtop_daemon_query_history(fd, connect_history) < 0) {
+		free(buf);
+		free(names);
+		close(fd);
+		return EXIT_FAILURE;
+	}
+
+	while (!sig_recv) {
+		if (gtop_daemon_recv(fd, &msg, buf, sizeof(*names)) < 0)
+			break;
+
+		if (msg.type == GTOP_DAEMON_MSG_NAMES) {
+			memcpy(names, buf, sizeof(*names));
+			gtop_classifier_init(&classifier, names, classify_ddr_peak);
+			continue;
+		}
+
+		if (msg.type == GTOP_DAEMON_MSG_HISTORY) {
+			ret = gtop_connect_print_history(buf, names);
+			break;
+		}
+
+		if (msg.type != GTOP_DAEMON_MSG_SNAPSHOT || connect_history)
+			continue;
+
+		memcpy(&snap, buf, sizeof(snap));
+
+		if (msg.dropped != dropped) {
+			fprintf(stdout, "dropped=%" PRIu64 "\n", msg.dropped - dropped);
+			dropped = msg.dropped;
+		}
+
+		gtop_snapshot_print(stdout, &snap, names);
+		if (FLAG_IS_SET(flags, FLAG_CLASSIFY)) {
+			gtop_classify(&classifier, &snap, &result);
+			fprintf(stdout, " bottleneck=%s", gtop_verdict_name(result.verdict));
+		}
+		fprintf(stdout, "\n");
+		fflush(stdout);
+	}
+
+	free(buf);
+	free(names);
+	close(fd);
+	return ret;
+}
+
+static void
+gtop_gate_cleanup(void)
+{
+	if (gate_tmp[0])
+		unlink(gate_tmp);
+}
+
+/*
+ * check the gating options, and record somewhere if -o wasn't given
+ */
+static int
+gtop_gate_init(void)
+{
+	int fd;
+
+	if (!gate_baseline) {
+		fprintf(stderr, "-g needs a baseline recording, see -B\n");
+		return -1;
+	}
+	if (gate_until && !markers_path) {
+		fprintf(stderr, "-U needs application markers, see -a\n");
+		return -1;
+	}
+	if (access(gate_rules, R_OK) < 0 || access(gate_baseline, R_OK) < 0) {
+		fprintf(stderr, "Failed to read %s: %s\n",
+			access(gate_rules, R_OK) < 0 ? gate_rules : gate_baseline,
+			strerror(errno));
+		return -1;
+	}
+
+	if (FLAG_IS_SET(flags, FLAG_RECORD))
+		return 0;
+
+	snprintf(gate_tmp, sizeof(gate_tmp), "%s/gputop-gate-XXXXXX",
+		 getenv("TMPDIR") ? getenv("TMPDIR") : "/tmp");
+	fd = mkstemp(gate_tmp);
+	if (fd < 0) {
+		fprintf(stderr, "Failed to create %s: %s\n", gate_tmp, strerror(errno));
+		gate_tmp[0] = '\0';
+		return -1;
+	}
+	close(fd);
+	atexit(gtop_gate_cleanup);
+
+	SET_FLAG(flags, FLAG_RECORD);
+	record_path = gate_tmp;
+	return 0;
+}
+
 int main(int argc, char *argv[])
 {
+	const struct gtop_tool *tool;
 	struct perf_device *dev = NULL;
-	int err;
+	int err, ret = EXIT_FAILURE;
 	bool batch = false;
 
+	/* offline subcommands don't touch the device at all */
+	if (argc > 1 && (tool = gtop_tool_find(argv[1])))
+		return tool->main(argc - 1, argv + 1);
 
 	memset(&gtop_info, 0, sizeof(struct gtop_hw_drv_info));
 	perf_version = perf_get_library_version();
@@ -2192,21 +3960,35 @@ int main(int argc, char *argv[])
 	parse_args(argc, argv);
 	install_sighandler();
 
-	tty_init(&tty_old);
+	/* front-ends never touch the device, the daemon owns it */
+	if (FLAG_IS_SET(flags, FLAG_CONNECT))
+		return gtop_connect();
+
+	if (FLAG_IS_SET(flags, FLAG_GATE) && gtop_gate_init() < 0)
+		exit(GTOP_GATE_ERROR);
+
+	/* a daemon alone, or any number of others; held until we exit */
+	if (gtop_daemon_lock(FLAG_IS_SET(flags, FLAG_DAEMON) ? socket_path : NULL) < 0)
+		exit(gtop_failure());
+
+	/* gating runs from CI, without a tty */
+	if (!FLAG_IS_SET(flags, FLAG_GATE))
+		tty_init(&tty_old);
+
+	/* ours from here on, see dev_lock */
+	pthread_mutex_lock(&dev_lock);
 
 	dev = perf_init(&vivante_ops);
 	if (!dev) {
 		fprintf(stderr, "perf_init()! failed\n");
-		tty_reset(&tty_old);
-		exit(EXIT_FAILURE);
+		goto out_tty;
 	}
 
 	err = perf_open(VIV_HW_3D, dev);
 	if (err < 0 && err != ERR_KERNEL_MISMATCH) {
 		fprintf(stderr, "Failed to open driver connection: %s\n",
 				perf_get_last_error(dev));
-		tty_reset(&tty_old);
-		exit(EXIT_FAILURE);
+		goto out_tty;
 	}
 
 	/* get driver, hw info */
@@ -2229,8 +4011,7 @@ int main(int argc, char *argv[])
 		} else {
 			fprintf(stderr, "Failed to open driver connection: %s\n",
 					perf_get_last_error(dev));
-			tty_reset(&tty_old);
-			exit(EXIT_FAILURE);
+			goto out;
 		}
 	}
 
@@ -2241,25 +4022,123 @@ int main(int argc, char *argv[])
 		 */
 		if (gtop_is_chip_model(0x7000, dev) && gtop_info.drv_info.build < 150331) {
 			fprintf(stderr, "Reading counters for GC7000 not supported at the moment!\n");
-			tty_reset(&tty_old);
-			perf_exit(dev);
-			exit(EXIT_FAILURE);
+			goto out;
 		}
 
 		if (!gtop_check_ctx_is_valid(selected_ctx)) {
 			fprintf(stderr, "Either application not running or feature not available\n");
-			tty_reset(&tty_old);
-			perf_exit(dev);
-			exit(EXIT_FAILURE);
+			goto out;
 		}
 	}
 
 	if (FLAG_IS_SET(flags, FLAG_SHOW_BATCH_PERF))
 		batch = true;
 
+	if (FLAG_IS_SET(flags, FLAG_PUBLISH_SHM)) {
+		shm = gtop_shm_create(shm_name);
+		if (!shm)
+			goto out;
+	}
+
+	if (FLAG_IS_SET(flags, FLAG_DAEMON)) {
+		daemon_srv = gtop_daemon_create(socket_path);
+		if (!daemon_srv)
+			goto out;
+	}
+
+	if (FLAG_IS_SET(flags, FLAG_HISTORY)) {
+		/* names are needed to know which metrics to keep */
+		gtop_snapshot_names_init(dev, &snapshot_names);
+		history = gtop_history_create(history_size, &snapshot_names,
+					      DELAY_SECS * NSEC_PER_SEC + DELAY_NSECS);
+		if (!history) {
+			dprintf("Failed to allocate history\n");
+			goto out;
+		}
+	}
+
+	if (FLAG_IS_SET(flags, FLAG_RECORD)) {
+		gtop_snapshot_names_init(dev, &snapshot_names);
+		record = gtop_record_create(record_path, &snapshot_names,
+					    DELAY_SECS * NSEC_PER_SEC + DELAY_NSECS);
+		if (!record)
+			goto out;
+	}
+
+	if (FLAG_IS_SET(flags, FLAG_FTRACE)) {
+		gtop_snapshot_names_init(dev, &snapshot_names);
+		ftrace = gtop_ftrace_open(ftrace_path, &snapshot_names, ftrace_metrics);
+		if (!ftrace)
+			goto out;
+	}
+
+	if (FLAG_IS_SET(flags, FLAG_MARKERS)) {
+		markers = gtop_markers_create(markers_path);
+		if (!markers)
+			goto out;
+	}
+
+	if (FLAG_IS_SET(flags, FLAG_ALERTS)) {
+		gtop_snapshot_names_init(dev, &snapshot_names);
+		alerts = gtop_alerts_create(alerts_path, &snapshot_names);
+		if (!alerts)
+			goto out;
+	}
+
+	if (FLAG_IS_SET(flags, FLAG_PHASES)) {
+		phases = gtop_phases_create();
+		if (!phases)
+			goto out;
+		phases_start = get_ns_time();
+	}
+
+	if (FLAG_IS_SET(flags, FLAG_CORRELATE)) {
+		correlate = gtop_correlate_create();
+		if (!correlate)
+			goto out;
+	}
+
+	/* a baseline can start publishing at any time, names have to be there */
+	gtop_snapshot_names_init(dev, &snapshot_names);
+	if (shm)
+		gtop_shm_set_names(shm, &snapshot_names);
+	if (daemon_srv)
+		gtop_daemon_set_names(daemon_srv, &snapshot_names);
+	if (daemon_srv && history)
+		gtop_daemon_set_history(daemon_srv, history);
+	gtop_classifier_init(&classifier, &snapshot_names, classify_ddr_peak);
+
 	gtop_retrieve_perf_counters(dev, batch);
+	ret = EXIT_SUCCESS;
+
+out:
+	gtop_correlate_destroy(correlate);
+	correlate = NULL;
+	gtop_phases_destroy(phases);
+	phases = NULL;
+	gtop_alerts_destroy(alerts);
+	alerts = NULL;
+	gtop_markers_destroy(markers);
+	markers = NULL;
+	gtop_ftrace_close(ftrace);
+	ftrace = NULL;
+	gtop_record_close(record);
+	record = NULL;
+	gtop_history_destroy(history);
+	history = NULL;
+	gtop_daemon_destroy(daemon_srv);
+	daemon_srv = NULL;
+	gtop_shm_destroy(shm);
+	shm = NULL;
 
 	gtop_free_gtop_info(dev, &gtop_info);
+	gtop_fini_client_queries();
+	gtop_procwatch_destroy(procwatch);
+	procwatch = NULL;
+	gtop_clients_fini(&gpu_clients);
+	debugfs_database_free(&ctx_db);
+	gtop_arena_fini(&refresh_arena);
+	debugfs_close_sources();
 
    if (profiler_state.enabled)
    {
@@ -2275,6 +4154,15 @@ int main(int argc, char *argv[])
   }
 #endif
 
+out_tty:
 	tty_reset(&tty_old);
-	return 0;
+
+	if (ret != EXIT_SUCCESS)
+		return gtop_failure();
+
+	if (FLAG_IS_SET(flags, FLAG_GATE))
+		return gtop_gate_check(gate_rules, gate_baseline, record_path,
+				       stdout, 0);
+
+	return EXIT_SUCCESS;
 }
@@ -23,6 +23,8 @@
 #ifndef __TOP_H
 #define __TOP_H
 
+#include "util.h"
+
 #define NSEC_PER_SEC	(1000000000ULL)
 #define USEC_PER_SEC	(1000000ULL)
 #define MSEC_PER_SEC 	(1000ULL)
@@ -62,8 +64,11 @@
 #define KEY_6		0x00000036
 #define KEY_7		0x00000037
 #define KEY_8		0x00000038
+#define KEY_9		0x00000039
 
+#define KEY_B		0x00000062
 #define KEY_D		0x00000064
+#define KEY_N		0x0000006e
 #define KEY_R		0x00000072
 #define KEY_H		0x00000068
 #define KEY_QUESTION_MARK 	0x0000003f
@@ -87,6 +92,16 @@
 #define DELAY_SECS	1
 #define DELAY_NSECS	0
 
+/* threads querying the memory of clients, see -j */
+#define GTOP_QUERY_THREADS	4
+/* client queries not done by then (ns) show what was known before */
+#define GTOP_QUERY_DEADLINE	((DELAY_SECS * NSEC_PER_SEC + DELAY_NSECS) / 2)
+/*
+ * with process events, refreshes after which clients are read anyway: a
+ * process may open the GPU, or create contexts, long after it started
+ */
+#define GTOP_PROCWATCH_RESCAN	30
+
 /* do note these are encoded for VSI */
 enum err_code {
         ERR_NO_ERROR = 0,
@@ -100,8 +115,6 @@ enum err_code {
         ERR_GET_DEBUGFS_INFO = -8,
 };
 
-#define ARRAY_SIZE(a)		(sizeof(a)/sizeof(a[0]))
-
 enum page {
 	PAGE_SHOW_CLIENTS,
 	PAGE_VID_MEM_USAGE,
@@ -112,7 +125,11 @@ enum page {
 #if defined HAVE_DDR_PERF && defined __linux__
 	PAGE_DDR_PERF,		/* DDR PMUs */
 #endif
-	
+	PAGE_MARKERS,		/* application markers */
+	PAGE_PHASES,		/* workload phases */
+	PAGE_CORRELATION,	/* what DDR traffic goes with */
+	PAGE_BASELINE,		/* deltas against a pinned interval */
+
 	PAGE_NO,
 };
 
@@ -126,6 +143,10 @@ enum display_mode {
 #if defined HAVE_DDR_PERF && defined __linux__
 	MODE_PERF_DDR,
 #endif
+	MODE_PERF_MARKERS,
+	MODE_PERF_PHASES,
+	MODE_PERF_CORRELATION,
+	MODE_PERF_BASELINE,
 
 	MODE_PERF_NO,
 };
@@ -148,6 +169,19 @@ enum flags_type {
 	FLAG_SHOW_BATCH_CONTEXTS = 7,
 	FLAG_SHOW_BATCH_PERF = 8,
 	FLAG_IGNORE_START_ERRORS,
+	FLAG_PUBLISH_SHM,
+	FLAG_DAEMON,
+	FLAG_CONNECT,
+	FLAG_HISTORY,
+	FLAG_RECORD,
+	FLAG_FTRACE,
+	FLAG_MARKERS,
+	FLAG_GATE,
+	FLAG_ALERTS,
+	FLAG_PHASES,
+	FLAG_CORRELATE,
+	FLAG_CLASSIFY,
+	FLAG_POLL_CLIENTS,
 };
 
 /* 
@@ -177,6 +211,8 @@ struct gtop_data {
 	uint32_t *counter_data_last;
 
 	uint64_t *events_per_sample;
+	/* events_per_sample over the interval, before scaling */
+	uint64_t *events_per_interval;
 
 	uint64_t *events_per_sample_max;
 	uint64_t *events_per_sample_min;
@@ -188,6 +224,9 @@ struct gtop_data {
 struct gtop {
 	struct vivante_gpu_state st;
 	struct gtop_data **perf_data;
+
+	/* what has been sampled in the last interval, enum gtop_snapshot_valid */
+	uint32_t sampled;
 };
 
 enum dma_table_type {
@@ -0,0 +1,558 @@
+/*
+ * Copyright NXP 2017
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sub license,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <math.h>
+
+#include "trace.h"
+#include "record.h"
+#include "json.h"
+#include "classify.h"
+#include "util.h"
+
+/*
+ * Everything goes in one process. Counters are process wide, DMA engines,
+ * the governor, the bottleneck verdict and each application range each get
+ * a thread, so their slices are in their own track.
+ */
+#define GTOP_TRACE_PID			1
+#define GTOP_TRACE_TID_GOVERNOR		1
+#define GTOP_TRACE_TID_BOTTLENECK	2
+#define GTOP_TRACE_TID_DMA		10
+#define GTOP_TRACE_TID_RANGES		100
+
+#define GTOP_TRACE_MAX_TABLES		8
+#define GTOP_TRACE_MAX_RANGES		32
+
+static const char *gtop_trace_governors[] = {
+	"unknown", "underdrive", "nominal", "overdrive",
+};
+
+/* a track where only one state is active at a time */
+struct gtop_trace_slice {
+	uint32_t tid;
+	char title[GTOP_SNAPSHOT_NAME_LEN];
+
+	/* dma_states this table covers */
+	uint32_t from;
+	uint32_t to;
+
+	/* state being shown, -1 if none, and since when */
+	int32_t state;
+	uint64_t since;
+};
+
+struct gtop_trace {
+	FILE *f;
+	bool first;
+
+	/* added to every timestamp (ns), to move to another clock */
+	uint64_t offset;
+
+	const struct gtop_snapshot_names *names;
+
+	struct gtop_trace_slice tables[GTOP_TRACE_MAX_TABLES];
+	uint32_t nr_tables;
+
+	struct gtop_trace_slice governor;
+
+	struct gtop_classifier classifier;
+	struct gtop_trace_slice bottleneck;
+
+	/* application ranges seen so far, tid is their index */
+	char ranges[GTOP_TRACE_MAX_RANGES][GTOP_RECORD_RANGE_NAME_LEN];
+	uint32_t nr_ranges;
+
+	/* clients of the previous entry */
+	struct gtop_record_client clients[GTOP_RECORD_MAX_CLIENTS];
+	uint32_t nr_clients;
+	/* recorded as events (1.3), no need to tell them from the entries */
+	bool client_events;
+
+	uint64_t last;
+};
+
+static void
+gtop_trace_ts(struct gtop_trace *trace, uint64_t ns)
+{
+	/* trace-event timestamps are in us */
+	fprintf(trace->f, "%.3f", (ns + trace->offset) / 1000.0);
+}
+
+static void
+gtop_trace_begin(struct gtop_trace *trace, char ph, const char *name, uint32_t tid)
+{
+	fprintf(trace->f, "%s\n{\"ph\":\"%c\",\"name\":", trace->first ? "" : ",", ph);
+	gtop_json_string(trace->f, name);
+	fprintf(trace->f, ",\"pid\":%u,\"tid\":%u", GTOP_TRACE_PID, tid);
+
+	trace->first = false;
+}
+
+static void
+gtop_trace_metadata(struct gtop_trace *trace, const char *what, uint32_t tid,
+		    const char *name)
+{
+	gtop_trace_begin(trace, 'M', what, tid);
+	fprintf(trace->f, ",\"args\":{\"name\":");
+	gtop_json_string(trace->f, name);
+	fprintf(trace->f, "}}");
+}
+
+static void
+gtop_trace_slice_end(struct gtop_trace *trace, struct gtop_trace_slice *slice,
+		     const char *name, uint64_t ts)
+{
+	if (slice->state < 0)
+		return;
+
+	gtop_trace_begin(trace, 'X', name, slice->tid);
+	fprintf(trace->f, ",\"ts\":");
+	gtop_trace_ts(trace, slice->since);
+	fprintf(trace->f, ",\"dur\":%.3f}", (ts - slice->since) / 1000.0);
+
+	slice->state = -1;
+}
+
+/* the part after the table title, "Command state/IDLE" -> "IDLE" */
+static const char *
+gtop_trace_dma_state(const struct gtop_trace *trace, uint32_t idx)
+{
+	const char *name = trace->names->dma_states[idx];
+	const char *slash = strchr(name, '/');
+
+	return slash ? slash + 1 : name;
+}
+
+static const char *
+gtop_trace_slice_name(const struct gtop_trace *trace,
+		      const struct gtop_trace_slice *slice)
+{
+	if (slice == &trace->governor)
+		return gtop_trace_governors[slice->state];
+	if (slice == &trace->bottleneck)
+		return gtop_verdict_name(slice->state);
+
+	return gtop_trace_dma_state(trace, slice->state);
+}
+
+static void
+gtop_trace_slice_set(struct gtop_trace *trace, struct gtop_trace_slice *slice,
+		     int32_t state, uint64_t ts)
+{
+	if (state == slice->state)
+		return;
+
+	if (slice->state >= 0)
+		gtop_trace_slice_end(trace, slice, gtop_trace_slice_name(trace, slice), ts);
+
+	slice->state = state;
+	slice->since = ts;
+}
+
+static void
+gtop_trace_init(struct gtop_trace *trace, FILE *f,
+		const struct gtop_snapshot_names *names, uint64_t offset,
+		double ddr_peak)
+{
+	char title[GTOP_SNAPSHOT_NAME_LEN];
+	uint32_t i;
+
+	memset(trace, 0, sizeof(*trace));
+
+	trace->f = f;
+	trace->first = true;
+	trace->offset = offset;
+	trace->names = names;
+
+	trace->governor.tid = GTOP_TRACE_TID_GOVERNOR;
+	trace->governor.state = -1;
+
+	gtop_classifier_init(&trace->classifier, names, ddr_peak);
+	trace->bottleneck.tid = GTOP_TRACE_TID_BOTTLENECK;
+	trace->bottleneck.state = -1;
+
+	/* consecutive states with the same title belong to the same table */
+	for (i = 0; i < GTOP_SNAPSHOT_MAX_DMA_STATES && names->dma_states[i][0]; i++) {
+		struct gtop_trace_slice *table;
+		size_t len = strcspn(names->dma_states[i], "/");
+
+		snprintf(title, sizeof(title), "%.*s", (int) len, names->dma_states[i]);
+
+		table = trace->nr_tables ? &trace->tables[trace->nr_tables - 1] : NULL;
+		if (!table || strcmp(table->title, title)) {
+			if (trace->nr_tables == GTOP_TRACE_MAX_TABLES)
+				break;
+
+			table = &trace->tables[trace->nr_tables];
+			table->tid = GTOP_TRACE_TID_DMA + trace->nr_tables;
+			table->state = -1;
+			table->from = i;
+			strcpy(table->title, title);
+			trace->nr_tables++;
+		}
+		table->to = i + 1;
+	}
+
+	fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+
+	gtop_trace_metadata(trace, "process_name", 0, "GPU");
+	gtop_trace_metadata(trace, "thread_name", GTOP_TRACE_TID_GOVERNOR, "Governor");
+	gtop_trace_metadata(trace, "thread_name", GTOP_TRACE_TID_BOTTLENECK, "Bottleneck");
+	for (i = 0; i < trace->nr_tables; i++)
+		gtop_trace_metadata(trace, "thread_name", trace->tables[i].tid,
+				    trace->tables[i].title);
+}
+
+static void
+gtop_trace_counter(struct gtop_trace *trace, const char *name, uint64_t ts,
+		   double value)
+{
+	gtop_trace_begin(trace, 'C', name, 0);
+	fprintf(trace->f, ",\"ts\":");
+	gtop_trace_ts(trace, ts);
+	fprintf(trace->f, ",\"args\":{\"value\":");
+	gtop_json_number(trace->f, value);
+	fprintf(trace->f, "}}");
+}
+
+static void
+gtop_trace_snapshot(struct gtop_trace *trace, const struct gtop_snapshot *snap)
+{
+	char name[GTOP_METRIC_NAME_LEN];
+	float values[GTOP_METRIC_NR];
+	/* values cover the interval ending at timestamp */
+	uint64_t start = snap->timestamp - snap->interval;
+	struct gtop_classification result;
+	uint32_t m, i, t;
+
+	gtop_snapshot_metrics(snap, values);
+
+	for (m = 0; m < GTOP_METRIC_NR; m++) {
+		double value = values[m];
+
+		/* DMA states are slices */
+		if (m >= GTOP_METRIC_DMA_STATES && m < GTOP_METRIC_DDR)
+			continue;
+		if (isnan(value) ||
+		    !gtop_snapshot_metric_name(trace->names, m, name, sizeof(name)))
+			continue;
+
+		gtop_trace_counter(trace, name, start, value);
+	}
+
+	/* the state each DMA engine spent most of the interval in */
+	for (t = 0; t < trace->nr_tables && (snap->valid & GTOP_SNAPSHOT_DMA); t++) {
+		struct gtop_trace_slice *table = &trace->tables[t];
+		int32_t state = -1;
+
+		for (i = table->from; i < table->to && i < snap->nr_dma_states; i++)
+			if (state < 0 || snap->dma_states[i] > snap->dma_states[state])
+				state = i;
+
+		gtop_trace_slice_set(trace, table, state, start);
+	}
+
+	if ((snap->valid & GTOP_SNAPSHOT_GOVERNOR) && snap->governor < ARRAY_SIZE(gtop_trace_governors))
+		gtop_trace_slice_set(trace, &trace->governor, snap->governor, start);
+
+	gtop_classify(&trace->classifier, snap, &result);
+	gtop_trace_slice_set(trace, &trace->bottleneck,
+			     result.verdict == GTOP_VERDICT_UNKNOWN ? -1 : (int32_t) result.verdict,
+			     start);
+
+	trace->last = snap->timestamp;
+}
+
+static void
+gtop_trace_client_event(struct gtop_trace *trace, const char *what,
+			const struct gtop_record_client *client, uint64_t ts)
+{
+	char name[GTOP_RECORD_CLIENT_NAME_LEN + 32];
+
+	snprintf(name, sizeof(name), "%s %.*s (%u)", what,
+		 GTOP_RECORD_CLIENT_NAME_LEN, client->name, client->pid);
+
+	gtop_trace_begin(trace, 'i', name, 0);
+	fprintf(trace->f, ",\"s\":\"p\",\"ts\":");
+	gtop_trace_ts(trace, ts);
+	fprintf(trace->f, ",\"args\":{\"pid\":%u,\"name\":", client->pid);
+	gtop_json_string(trace->f, client->name);
+	fprintf(trace->f, "}}");
+}
+
+static void
+gtop_trace_range(struct gtop_trace *trace, const struct gtop_record_range *range)
+{
+	char title[GTOP_RECORD_RANGE_NAME_LEN + 8];
+	uint32_t i;
+
+	for (i = 0; i < trace->nr_ranges; i++)
+		if (!strcmp(trace->ranges[i], range->name))
+			break;
+
+	if (i == trace->nr_ranges) {
+		if (i == GTOP_TRACE_MAX_RANGES)
+			return;
+
+		strcpy(trace->ranges[i], range->name);
+		trace->nr_ranges++;
+
+		snprintf(title, sizeof(title), "App: %s", range->name);
+		gtop_trace_metadata(trace, "thread_name", GTOP_TRACE_TID_RANGES + i, title);
+	}
+
+	gtop_trace_begin(trace, 'X', range->name, GTOP_TRACE_TID_RANGES + i);
+	fprintf(trace->f, ",\"ts\":");
+	gtop_trace_ts(trace, range->begin);
+	fprintf(trace->f, ",\"dur\":%.3f,\"args\":{\"busy\":",
+		(range->end - range->begin) / 1000.0);
+	gtop_json_number(trace->f, range->samples ?
+			 100.0 * range->busy / range->samples : NAN);
+	fprintf(trace->f, "}}");
+}
+
+static bool
+gtop_trace_has_client(const struct gtop_record_client *clients, uint32_t nr,
+		      uint32_t pid)
+{
+	uint32_t i;
+
+	for (i = 0; i < nr; i++)
+		if (clients[i].pid == pid)
+			return true;
+
+	return false;
+}
+
+static void
+gtop_trace_clients(struct gtop_trace *trace, uint64_t ts,
+		   const struct gtop_record_client *clients, uint32_t nr)
+{
+	uint32_t i;
+
+	if (nr > GTOP_RECORD_MAX_CLIENTS)
+		nr = GTOP_RECORD_MAX_CLIENTS;
+
+	for (i = 0; i < nr && !trace->client_events; i++)
+		if (!gtop_trace_has_client(trace->clients, trace->nr_clients, clients[i].pid))
+			gtop_trace_client_event(trace, "arrived", &clients[i], ts);
+
+	for (i = 0; i < trace->nr_clients && !trace->client_events; i++)
+		if (!gtop_trace_has_client(clients, nr, trace->clients[i].pid))
+			gtop_trace_client_event(trace, "exited", &trace->clients[i], ts);
+
+	memcpy(trace->clients, clients, nr * sizeof(*clients));
+	trace->nr_clients = nr;
+}
+
+static void
+gtop_trace_client_change(struct gtop_trace *trace, uint64_t ts,
+			 const struct gtop_record_client_event *event)
+{
+	struct gtop_record_client client = {};
+
+	client.pid = event->pid;
+	memcpy(client.name, event->name, sizeof(client.name));
+	client.name[sizeof(client.name) - 1] = '\0';
+
+	gtop_trace_client_event(trace, event->type == GTOP_CLIENT_ARRIVED ?
+				"arrived" : "exited", &client, ts);
+	trace->client_events = true;
+}
+
+static void
+gtop_trace_fini(struct gtop_trace *trace)
+{
+	uint32_t t;
+
+	for (t = 0; t < trace->nr_tables; t++)
+		gtop_trace_slice_set(trace, &trace->tables[t], -1, trace->last);
+	gtop_trace_slice_set(trace, &trace->governor, -1, trace->last);
+	gtop_trace_slice_set(trace, &trace->bottleneck, -1, trace->last);
+
+	fprintf(trace->f, "\n]}\n");
+}
+
+static void
+gtop_trace_usage(void)
+{
+	fprintf(stderr, "Usage: gputop trace [-o output] [-b] [-s start] [-e end] [-M MB/s] <recording>\n");
+	fprintf(stderr, "  -o <output>   Write to output instead of stdout\n");
+	fprintf(stderr, "  -s <secs>     Start that many seconds into the recording\n");
+	fprintf(stderr, "  -e <secs>     Stop that many seconds into the recording\n");
+	fprintf(stderr, "  -b            Use CLOCK_BOOTTIME timestamps, CLOCK_MONOTONIC by default\n");
+	fprintf(stderr, "  -M <MB/s>     Peak bandwidth of a DDR controller, for the bottleneck track\n");
+}
+
+int
+gtop_trace_main(int argc, char **argv)
+{
+	struct gtop_record_cursor cursor;
+	struct gtop_record_index index;
+	struct gtop_record_entry entry;
+	struct gtop_record_file file;
+	struct gtop_snapshot snap;
+	struct gtop_record_range range;
+	struct gtop_trace *trace;
+	const char *output = NULL;
+	const void *payload;
+	bool boottime = false;
+	uint64_t offset = 0, from = 0, to = UINT64_MAX;
+	double ddr_peak = 0.0;
+	off_t begin;
+	FILE *f = stdout;
+	int c, ret;
+
+	optind = 1;
+	while ((c = getopt(argc, argv, "o:bs:e:M:h")) != -1) {
+		switch (c) {
+		case 'o':
+			output = optarg;
+			break;
+		case 'b':
+			boottime = true;
+			break;
+		case 's':
+			if (gtop_record_parse_time(optarg, &from) < 0)
+				return EXIT_FAILURE;
+			break;
+		case 'e':
+			if (gtop_record_parse_time(optarg, &to) < 0)
+				return EXIT_FAILURE;
+			break;
+		case 'M':
+			ddr_peak = atof(optarg);
+			break;
+		case 'h':
+		default:
+			gtop_trace_usage();
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (optind != argc - 1) {
+		gtop_trace_usage();
+		return EXIT_FAILURE;
+	}
+
+	if (gtop_record_open(&file, argv[optind]) < 0)
+		return EXIT_FAILURE;
+
+	if (boottime) {
+		if (!file.header.boottime) {
+			fprintf(stderr, "%s has no CLOCK_BOOTTIME reference\n", argv[optind]);
+			gtop_record_file_close(&file);
+			return EXIT_FAILURE;
+		}
+		offset = file.header.boottime - file.header.start;
+	}
+
+	gtop_record_window(&file.header, &from, &to);
+
+	/* go straight to the block holding from */
+	if (gtop_record_index_load(&index, &file) < 0) {
+		gtop_record_file_close(&file);
+		return EXIT_FAILURE;
+	}
+	begin = gtop_record_index_seek(&index, from);
+	gtop_record_index_fini(&index);
+
+	trace = malloc(sizeof(*trace));
+	if (!trace || gtop_record_cursor_init(&cursor, &file, begin) < 0) {
+		free(trace);
+		gtop_record_file_close(&file);
+		return EXIT_FAILURE;
+	}
+
+	if (output) {
+		f = fopen(output, "w");
+		if (!f) {
+			fprintf(stderr, "Failed to create %s\n", output);
+			ret = -1;
+			goto out;
+		}
+	}
+
+	gtop_trace_init(trace, f, &file.names, offset, ddr_peak);
+
+	while ((ret = gtop_record_cursor_next(&cursor, &entry, &payload)) > 0) {
+		if (entry.timestamp < from)
+			continue;
+		/* ranges may end a bit out of order, snapshots don't */
+		if (entry.timestamp > to) {
+			if (entry.type == GTOP_RECORD_SNAPSHOT)
+				break;
+			continue;
+		}
+
+		switch (entry.type) {
+		case GTOP_RECORD_SNAPSHOT:
+			if (entry.size < sizeof(snap))
+				break;
+			memcpy(&snap, payload, sizeof(snap));
+			gtop_trace_snapshot(trace, &snap);
+			break;
+		case GTOP_RECORD_CLIENTS:
+			gtop_trace_clients(trace, entry.timestamp, payload,
+					   entry.size / sizeof(struct gtop_record_client));
+			break;
+		case GTOP_RECORD_RANGE:
+			if (entry.size < offsetof(struct gtop_record_range, counters))
+				break;
+			memcpy(&range, payload, offsetof(struct gtop_record_range, counters));
+			range.name[sizeof(range.name) - 1] = '\0';
+			gtop_trace_range(trace, &range);
+			break;
+		case GTOP_RECORD_CLIENT_EVENT:
+			if (entry.size < sizeof(struct gtop_record_client_event))
+				break;
+			gtop_trace_client_change(trace, entry.timestamp, payload);
+			break;
+		default:
+			break;
+		}
+	}
+
+	gtop_trace_fini(trace);
+
+	if (ret < 0)
+		fprintf(stderr, "Failed to read %s\n", argv[optind]);
+	if (f != stdout && fclose(f)) {
+		fprintf(stderr, "Failed to write %s\n", output);
+		ret = -1;
+	}
+
+out:
+	gtop_record_cursor_fini(&cursor);
+	gtop_record_file_close(&file);
+	free(trace);
+
+	return ret < 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
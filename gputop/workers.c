@@ -0,0 +1,213 @@
+/*
+ * Copyright NXP 2017
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sub license,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "workers.h"
+
+struct gtop_workers {
+	pthread_t threads[GTOP_WORKERS_MAX];
+	unsigned int nr;
+
+	/* everything below */
+	pthread_mutex_t lock;
+	/* work queued, or stopping */
+	pthread_cond_t wake;
+	/* work done */
+	pthread_cond_t done_cond;
+
+	/* first in, first out */
+	struct gtop_work *queued;
+	struct gtop_work *queued_tail;
+	struct gtop_work *done;
+
+	/* queued or running */
+	uint32_t pending;
+	bool stop;
+};
+
+static void *
+gtop_workers_run(void *arg)
+{
+	struct gtop_workers *workers = arg;
+
+	pthread_mutex_lock(&workers->lock);
+	for (;;) {
+		struct gtop_work *work;
+
+		while (!workers->queued && !workers->stop)
+			pthread_cond_wait(&workers->wake, &workers->lock);
+
+		if (!workers->queued)
+			break;
+
+		work = workers->queued;
+		workers->queued = work->next;
+		if (!workers->queued)
+			workers->queued_tail = NULL;
+
+		pthread_mutex_unlock(&workers->lock);
+		work->run(work);
+		pthread_mutex_lock(&workers->lock);
+
+		work->next = workers->done;
+		workers->done = work;
+		workers->pending--;
+		pthread_cond_broadcast(&workers->done_cond);
+	}
+	pthread_mutex_unlock(&workers->lock);
+
+	return NULL;
+}
+
+struct gtop_workers *
+gtop_workers_create(unsigned int nr)
+{
+	struct gtop_workers *workers;
+	pthread_condattr_t attr;
+
+	workers = calloc(1, sizeof(*workers));
+	if (!workers)
+		return NULL;
+
+	if (nr > GTOP_WORKERS_MAX)
+		nr = GTOP_WORKERS_MAX;
+
+	/* deadlines are CLOCK_MONOTONIC, as everywhere else */
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+
+	pthread_mutex_init(&workers->lock, NULL);
+	pthread_cond_init(&workers->wake, NULL);
+	pthread_cond_init(&workers->done_cond, &attr);
+	pthread_condattr_destroy(&attr);
+
+	for (; workers->nr < nr; workers->nr++) {
+		if (pthread_create(&workers->threads[workers->nr], NULL,
+				   gtop_workers_run, workers))
+			break;
+	}
+
+	return workers;
+}
+
+void
+gtop_workers_destroy(struct gtop_workers *workers)
+{
+	if (!workers)
+		return;
+
+	pthread_mutex_lock(&workers->lock);
+	workers->stop = true;
+	pthread_cond_broadcast(&workers->wake);
+	pthread_mutex_unlock(&workers->lock);
+
+	for (unsigned int i = 0; i < workers->nr; i++)
+		pthread_join(workers->threads[i], NULL);
+
+	pthread_cond_destroy(&workers->done_cond);
+	pthread_cond_destroy(&workers->wake);
+	pthread_mutex_destroy(&workers->lock);
+	free(workers);
+}
+
+void
+gtop_workers_queue(struct gtop_workers *workers, struct gtop_work *work)
+{
+	work->next = NULL;
+
+	if (!workers->nr) {
+		work->run(work);
+		work->next = workers->done;
+		workers->done = work;
+		return;
+	}
+
+	pthread_mutex_lock(&workers->lock);
+	if (workers->queued_tail)
+		workers->queued_tail->next = work;
+	else
+		workers->queued = work;
+	workers->queued_tail = work;
+	workers->pending++;
+	pthread_cond_signal(&workers->wake);
+	pthread_mutex_unlock(&workers->lock);
+}
+
+uint32_t
+gtop_workers_wait(struct gtop_workers *workers, uint64_t deadline)
+{
+	struct timespec ts = {
+		.tv_sec = deadline / 1000000000ULL,
+		.tv_nsec = deadline % 1000000000ULL,
+	};
+	uint32_t pending;
+
+	if (!workers->nr)
+		return 0;
+
+	pthread_mutex_lock(&workers->lock);
+	while (workers->pending) {
+		if (!deadline) {
+			pthread_cond_wait(&workers->done_cond, &workers->lock);
+			continue;
+		}
+
+		if (pthread_cond_timedwait(&workers->done_cond, &workers->lock,
+					   &ts) == ETIMEDOUT)
+			break;
+	}
+	pending = workers->pending;
+	pthread_mutex_unlock(&workers->lock);
+
+	return pending;
+}
+
+struct gtop_work *
+gtop_workers_take(struct gtop_workers *workers)
+{
+	struct gtop_work *work;
+
+	if (workers->nr)
+		pthread_mutex_lock(&workers->lock);
+
+	work = workers->done;
+	if (work)
+		workers->done = work->next;
+
+	if (workers->nr)
+		pthread_mutex_unlock(&workers->lock);
+
+	return work;
+}
+
+unsigned int
+gtop_workers_threads(const struct gtop_workers *workers)
+{
+	return workers->nr;
+}
@@ -0,0 +1,110 @@
+/*
+ * Copyright NXP 2017
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sub license,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#ifndef __GPUTOP_WORKERS_H
+#define __GPUTOP_WORKERS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* threads a pool can have */
+#define GTOP_WORKERS_MAX	16
+
+/**
+ * gtop_work:
+ *
+ * One piece of work for the pool, embedded in whatever the caller needs to
+ * run it and keep its result. It belongs to the pool from
+ * gtop_workers_queue() until gtop_workers_take() hands it back, so it has to
+ * stay around until then, even past a deadline.
+ */
+struct gtop_work {
+	void (*run)(struct gtop_work *work);
+
+	/* used by the pool */
+	struct gtop_work *next;
+};
+
+struct gtop_workers;
+
+/**
+ * gtop_workers_create:
+ *
+ * A pool of nr threads, at most GTOP_WORKERS_MAX. With 0 threads, or if
+ * none could be started, work runs as it is queued.
+ */
+struct gtop_workers *
+gtop_workers_create(unsigned int nr);
+
+/**
+ * gtop_workers_destroy:
+ *
+ * Wait for the work queued to be done, then stop the threads. Work not
+ * taken back is dropped, gtop_workers_wait() with no deadline then
+ * gtop_workers_take() get it all back first.
+ */
+void
+gtop_workers_destroy(struct gtop_workers *workers);
+
+/**
+ * gtop_workers_queue:
+ *
+ * Have work run by the first thread free.
+ */
+void
+gtop_workers_queue(struct gtop_workers *workers, struct gtop_work *work);
+
+/**
+ * gtop_workers_wait:
+ *
+ * Wait until all work queued is done, or until deadline (CLOCK_MONOTONIC,
+ * ns) has passed; 0 waits for as long as it takes. Returns the number of
+ * pieces of work not done yet.
+ */
+uint32_t
+gtop_workers_wait(struct gtop_workers *workers, uint64_t deadline);
+
+/**
+ * gtop_workers_take:
+ *
+ * Work done, in no particular order, NULL once there's none left.
+ */
+struct gtop_work *
+gtop_workers_take(struct gtop_workers *workers);
+
+/**
+ * gtop_workers_threads:
+ *
+ * Threads running, 0 if work runs as it is queued.
+ */
+unsigned int
+gtop_workers_threads(const struct gtop_workers *workers);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __GPUTOP_WORKERS_H */
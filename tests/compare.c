@@ -0,0 +1,115 @@
+/*
+ * Copyright NXP 2017
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sub license,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+/*
+ * gtop_compare_metric() on recordings of the same workload must find no
+ * difference, with an interval narrow enough that a real one would show;
+ * and must find it once the workload costs more. Recordings from before
+ * the first collect was dropped, with its huge rate over a few ms, must
+ * compare the same.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "compare.h"
+#include "util.h"
+
+#include "synth.h"
+
+#define TEST_RATE		5000.0
+
+#define TEST_A			"test-compare-a.gtp"
+#define TEST_B			"test-compare-b.gtp"
+
+static int
+test_record(const char *path, double rate, unsigned int seed, bool first_interval)
+{
+	struct synth synth;
+
+	synth_init(&synth, rate, seed, 60000000000ULL);
+	synth.first_interval = first_interval;
+
+	return synth_record(&synth, path, 20);
+}
+
+static int
+test_compare(double rate, bool first_interval, bool significant)
+{
+	static const uint32_t metrics[] = {
+		GTOP_METRIC_DDR, GTOP_METRIC_COUNTERS(0),
+	};
+	struct gtop_report a, b;
+	struct gtop_compare cmp;
+	unsigned int i;
+	int ret = -1;
+
+	if (test_record(TEST_A, TEST_RATE, 1, first_interval) < 0 ||
+	    test_record(TEST_B, TEST_RATE * rate, 2, first_interval) < 0)
+		return -1;
+
+	if (gtop_report_build(&a, TEST_A, 1, 0, UINT64_MAX, 0.0) < 0)
+		return -1;
+	if (gtop_report_build(&b, TEST_B, 1, 0, UINT64_MAX, 0.0) < 0)
+		goto out_a;
+
+	for (i = 0; i < ARRAY_SIZE(metrics); i++) {
+		if (gtop_compare_metric(&a, &b, metrics[i], 0.95, &cmp) < 0) {
+			fprintf(stderr, "metric %u: nothing to compare\n", metrics[i]);
+			goto out;
+		}
+
+		/* the interval is that of the rates compared, within a few % */
+		if (cmp.significant != significant ||
+		    (cmp.high - cmp.low) / 2 > cmp.a * 0.05) {
+			fprintf(stderr, "%s%.2fx: metric %u %.2f -> %.2f (+/- %.2f)%s\n",
+				first_interval ? "first interval, " : "", rate, metrics[i],
+				cmp.a, cmp.b, (cmp.high - cmp.low) / 2,
+				cmp.significant ? " significant" : "");
+			goto out;
+		}
+	}
+
+	ret = 0;
+out:
+	gtop_report_fini(&b);
+out_a:
+	gtop_report_fini(&a);
+	return ret;
+}
+
+int
+main(void)
+{
+	int ret = EXIT_FAILURE;
+
+	if (test_compare(1.0, false, false) < 0 ||
+	    test_compare(1.2, false, true) < 0 ||
+	    test_compare(1.0, true, false) < 0 ||
+	    test_compare(1.2, true, true) < 0)
+		goto out;
+
+	ret = EXIT_SUCCESS;
+out:
+	remove(TEST_A);
+	remove(TEST_B);
+	return ret;
+}
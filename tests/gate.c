@@ -0,0 +1,120 @@
+/*
+ * Copyright NXP 2017
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sub license,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+/*
+ * gtop_gate_check() on recordings of the same workload must pass, and
+ * fail once the workload costs more, counters that were idle in the
+ * baseline included.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "gate.h"
+
+#include "synth.h"
+
+#define TEST_RATE		5000.0
+
+#define TEST_RULES		"test-gate.rules"
+#define TEST_BASELINE		"test-gate-baseline.gtp"
+#define TEST_RUN		"test-gate-run.gtp"
+
+static const char test_rules[] =
+	"ctr1.* rise 5%\n"
+	"ctr1.* drop 5%\n"
+	"ddr.* rise 5%\n"
+	"core0 rise 5\n"
+	"core0 below 60\n";
+
+static int
+test_write_rules(void)
+{
+	FILE *f = fopen(TEST_RULES, "w");
+
+	if (!f || fputs(test_rules, f) < 0) {
+		perror(TEST_RULES);
+		if (f)
+			fclose(f);
+		return -1;
+	}
+
+	return fclose(f);
+}
+
+static int
+test_baseline(double rate)
+{
+	struct synth synth;
+
+	synth_init(&synth, rate, 1, 5000000000ULL);
+	return synth_record(&synth, TEST_BASELINE, 20);
+}
+
+/* a run of nr snapshots at rate */
+static int
+test_gate(double rate, unsigned int seed, uint32_t nr, int expected)
+{
+	struct synth synth;
+	int ret;
+
+	synth_init(&synth, rate, seed, 30000000000ULL);
+	if (synth_record(&synth, TEST_RUN, nr) < 0)
+		return -1;
+
+	ret = gtop_gate_check(TEST_RULES, TEST_BASELINE, TEST_RUN, stdout, 0);
+	if (ret != expected) {
+		fprintf(stderr, "run at %.0f/s: gate returned %d, not %d\n",
+			rate, ret, expected);
+		return -1;
+	}
+
+	return 0;
+}
+
+int
+main(void)
+{
+	int ret = EXIT_FAILURE;
+
+	if (test_write_rules() < 0)
+		return EXIT_FAILURE;
+
+	/* the same workload, sampled for less time, then a costlier one */
+	if (test_baseline(TEST_RATE) < 0 ||
+	    test_gate(TEST_RATE, 2, 3, GTOP_GATE_PASS) < 0 ||
+	    test_gate(TEST_RATE, 3, 10, GTOP_GATE_PASS) < 0 ||
+	    test_gate(TEST_RATE * 1.3, 4, 10, GTOP_GATE_FAIL) < 0)
+		goto out;
+
+	/* idle counters: staying so passes, rising by any % of 0 doesn't */
+	if (test_baseline(0) < 0 ||
+	    test_gate(0, 5, 10, GTOP_GATE_PASS) < 0 ||
+	    test_gate(TEST_RATE, 6, 10, GTOP_GATE_FAIL) < 0)
+		goto out;
+
+	ret = EXIT_SUCCESS;
+out:
+	remove(TEST_RULES);
+	remove(TEST_BASELINE);
+	remove(TEST_RUN);
+	return ret;
+}
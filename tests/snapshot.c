@@ -0,0 +1,92 @@
+/*
+ * Copyright NXP 2017
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sub license,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+/*
+ * Snapshots of a GPU doing the same thing all along must all report the
+ * same rates, the first one included: it can't cover what the counters
+ * counted before gputop first read them.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "snapshot.h"
+
+#include "synth.h"
+
+#define TEST_RATE		5000.0
+#define TEST_SNAPSHOTS		10
+
+/* within the noise of synth */
+static bool
+test_close(double value, double expected)
+{
+	return fabs(value - expected) <= expected * 0.05;
+}
+
+/* counters enabled warmup ns before gputop first reads them */
+static int
+test_rates(uint64_t warmup)
+{
+	struct gtop_snapshot snap;
+	struct synth synth;
+	float values[GTOP_METRIC_NR];
+	uint32_t nr = 0, collects = 0;
+
+	synth_init(&synth, TEST_RATE, 1, warmup);
+
+	while (nr < TEST_SNAPSHOTS) {
+		collects++;
+		if (!synth_next(&synth, &snap))
+			continue;
+
+		gtop_snapshot_metrics(&snap, values);
+		if (!test_close(values[GTOP_METRIC_COUNTERS(0)], TEST_RATE) ||
+		    !test_close(values[GTOP_METRIC_DDR], TEST_RATE / 1000)) {
+			fprintf(stderr, "warm-up %.1fs: snapshot %u at %.1f/s and %.2f MB/s, "
+				"not %.1f/s and %.2f MB/s\n", warmup / 1e9, nr,
+				values[GTOP_METRIC_COUNTERS(0)], values[GTOP_METRIC_DDR],
+				TEST_RATE, TEST_RATE / 1000);
+			return -1;
+		}
+		nr++;
+	}
+
+	/* the first collect only starts the first interval */
+	if (collects != TEST_SNAPSHOTS + 1) {
+		fprintf(stderr, "warm-up %.1fs: %u collects for %u snapshots\n",
+			warmup / 1e9, collects, nr);
+		return -1;
+	}
+
+	return 0;
+}
+
+int
+main(void)
+{
+	/* gputop started with the profiler, and long after it */
+	if (test_rates(7000000ULL) < 0 || test_rates(150000000000ULL) < 0)
+		return EXIT_FAILURE;
+
+	return EXIT_SUCCESS;
+}
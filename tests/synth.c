@@ -0,0 +1,181 @@
+/*
+ * Copyright NXP 2017
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sub license,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "record.h"
+
+#include "synth.h"
+
+/* time between collects, and how much it wanders */
+#define SYNTH_INTERVAL		1000000000ULL
+#define SYNTH_JITTER		50000000ULL
+
+/* time a collect takes, occupancy is sampled over it */
+#define SYNTH_COLLECT		7000000ULL
+
+/* in [-1, 1] */
+static double
+synth_noise(struct synth *synth)
+{
+	return 2.0 * rand_r(&synth->seed) / RAND_MAX - 1.0;
+}
+
+/* counters and DDR traffic go on whether they are read or not */
+static void
+synth_run(struct synth *synth, uint64_t ns)
+{
+	synth->now += ns;
+}
+
+/* what a counter going at rate has counted since it was enabled */
+static double
+synth_events(const struct synth *synth, double rate)
+{
+	return rate * (synth->now - synth->enabled) / 1e9;
+}
+
+void
+synth_init(struct synth *synth, double rate, unsigned int seed, uint64_t warmup)
+{
+	struct timespec ts;
+
+	memset(synth, 0, sizeof(*synth));
+
+	synth->rate = rate;
+	synth->ddr_rate = rate / 1000;
+	synth->busy = 50;
+	synth->seed = seed;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	synth->enabled = synth->now = ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+
+	synth_run(synth, warmup);
+}
+
+void
+synth_names(struct gtop_snapshot_names *names)
+{
+	memset(names, 0, sizeof(*names));
+
+	strcpy(names->counters[GTOP_SNAPSHOT_PART1][0], "counter");
+	strcpy(names->ddr[0], "read");
+}
+
+bool
+synth_next(struct synth *synth, struct gtop_snapshot *snap)
+{
+	double events, ddr;
+	uint64_t interval;
+	bool collected;
+
+	memset(snap, 0, sizeof(*snap));
+
+	synth_run(synth, SYNTH_COLLECT);
+
+	/* read and reset, the way the counters and DDR PMUs are */
+	events = synth_events(synth, synth->rate);
+	ddr = synth_events(synth, synth->ddr_rate);
+
+	snap->valid = GTOP_SNAPSHOT_OCCUPANCY | GTOP_SNAPSHOT_COUNTERS_PART1 |
+		GTOP_SNAPSHOT_COUNTER_EVENTS | GTOP_SNAPSHOT_DDR;
+	snap->nr_cores = 1;
+	snap->core_busy[0] = synth->busy + synth_noise(synth);
+	snap->nr_counters[GTOP_SNAPSHOT_PART1] = 1;
+	snap->counters[GTOP_SNAPSHOT_PART1][0] =
+		(events - synth->events) * (1 + synth_noise(synth) / 100);
+	snap->nr_ddr = 1;
+	snap->ddr_mb[0] = (ddr - synth->ddr) * (1 + synth_noise(synth) / 100);
+
+	synth->events = events;
+	synth->ddr = ddr;
+
+	collected = gtop_snapshot_interval(&synth->last, synth->now, &interval);
+	if (!collected && synth->first_interval) {
+		interval = SYNTH_COLLECT;
+		collected = true;
+	}
+	snap->timestamp = synth->now;
+	snap->interval = interval;
+
+	synth_run(synth, SYNTH_INTERVAL - SYNTH_COLLECT + synth_noise(synth) * SYNTH_JITTER);
+
+	return collected;
+}
+
+static int
+synth_record_version(const char *path, uint16_t minor)
+{
+	FILE *f = fopen(path, "r+b");
+	int ret = 0;
+
+	if (!f)
+		return -1;
+
+	if (fseek(f, offsetof(struct gtop_record_header, version_minor), SEEK_SET) < 0 ||
+	    fwrite(&minor, sizeof(minor), 1, f) != 1)
+		ret = -1;
+
+	if (fclose(f))
+		ret = -1;
+	return ret;
+}
+
+int
+synth_record(struct synth *synth, const char *path, uint32_t nr)
+{
+	struct gtop_snapshot_names names;
+	struct gtop_snapshot snap;
+	struct gtop_record *rec;
+	int ret = 0;
+
+	synth_names(&names);
+
+	rec = gtop_record_create(path, &names, SYNTH_INTERVAL);
+	if (!rec)
+		return -1;
+
+	while (nr) {
+		if (!synth_next(synth, &snap))
+			continue;
+
+		if (gtop_record_write(rec, GTOP_RECORD_SNAPSHOT, snap.timestamp,
+				      &snap, sizeof(snap)) < 0) {
+			fprintf(stderr, "Failed to write %s\n", path);
+			ret = -1;
+			break;
+		}
+		nr--;
+	}
+
+	gtop_record_close(rec);
+
+	/* older gputop wrote 1.4 recordings */
+	if (!ret && synth->first_interval)
+		ret = synth_record_version(path, 4);
+
+	return ret;
+}
@@ -0,0 +1,99 @@
+/*
+ * Copyright NXP 2017
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sub license,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#ifndef __GPUTOP_TESTS_SYNTH_H
+#define __GPUTOP_TESTS_SYNTH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "snapshot.h"
+
+/**
+ * synth:
+ *
+ * A GPU that never changes what it does, collected the way gputop does it:
+ * counters and DDR traffic count from when they were enabled and are read
+ * once per collect, about every second; occupancy is sampled during the
+ * collect. Every interval sees the same rates, give or take a little
+ * noise, so every snapshot should say the same.
+ */
+struct synth {
+	/* events/s of ctr1.counter and MB/s of ddr.read */
+	double rate;
+	double ddr_rate;
+	/* % of core0 busy */
+	double busy;
+
+	unsigned int seed;
+
+	/*
+	 * publish the first collect as older gputop did, as if it was an
+	 * interval of the time it took, and record it as a 1.4 file
+	 */
+	bool first_interval;
+
+	/* CLOCK_MONOTONIC (ns) of the device, and when counters were enabled */
+	uint64_t now;
+	uint64_t enabled;
+	/* of the last collect, see gtop_snapshot_interval() */
+	uint64_t last;
+	/* what was read at the last collect */
+	double events;
+	double ddr;
+};
+
+/**
+ * synth_init:
+ *
+ * Counters are enabled now, the first collect comes warmup ns later.
+ */
+void
+synth_init(struct synth *synth, double rate, unsigned int seed, uint64_t warmup);
+
+/**
+ * synth_names:
+ *
+ * Names of what synth_next() fills.
+ */
+void
+synth_names(struct gtop_snapshot_names *names);
+
+/**
+ * synth_next:
+ *
+ * Collect, then wait for the next collect. False if what was collected
+ * isn't a snapshot, as for the first one.
+ */
+bool
+synth_next(struct synth *synth, struct gtop_snapshot *snap);
+
+/**
+ * synth_record:
+ *
+ * Record nr snapshots of synth at path. Returns -1 on error, which is
+ * printed.
+ */
+int
+synth_record(struct synth *synth, const char *path, uint32_t nr);
+
+#endif /* __GPUTOP_TESTS_SYNTH_H */